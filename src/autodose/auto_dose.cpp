@@ -32,43 +32,11 @@ void auto_dose(struct ProcessTrain *train,
     struct Effluent *co2_1; // effluent of CO2 addition, location #1
     struct Effluent *rapid_mix;
 
-    int debug = TRUE; // (TRUE/FALSE): TRUE to print debugging statements to output file, FALSE for no output
-
-    /* Put date/timestamp on treatment train/root-finding file */
-    std::string log_dir; // log directory
-    std::string log_ext; // log extension
-    log_dir = "./out/single_sim/log/";
-    log_ext = ".log";
-    std::string log_filepath = log_dir + current_datetime + log_ext;
-
-    /* Open file stream to log file */
-    FILE *flog = fopen(log_filepath.c_str(), "w"); // print out the treatment train and rooting finding progress
-
-    if (!flog)
-    { /* Error handling */
-        printf("Error opening %s \n, check that the proper directory and file name has been specified.\n", log_filepath.c_str());
-        exit(EXIT_FAILURE);
-    }
-
-    /* Print out treatment train/root-finding file description */
-    if (debug == TRUE)
-    {
-        fprintf(flog, "############################### TREATMENT TRAIN AND ROOT FINDING FILE ###############################\n");
-        fprintf(flog, "# The following file has information about the treatment train parameters and reports the progress of \n");
-        fprintf(flog, "# the root-finding algorithms (e.g. Secant and Bisection Methods) during the automatic chemical dose \n");
-        fprintf(flog, "# routine, auto_dose(). This file is overwritten each time auto_dose() is called, so only the  \n");
-        fprintf(flog, "# information about the last call of auto_dose() will be shown. \n");
-        fprintf(flog, "# This file is particularly useful for checking the intial and final configurations of the treatment \n");
-        fprintf(flog, "# train and for debugging the root-finding algorithms. \n");
-        // fprintf(flog, "# The name train&rootfinding_MM-DD-YY_HH-MM-SS.out is used to uniquely identify each run by the date and time.\n");
-        fprintf(flog, "\n");
-    }
-
     RF_FUNC_PTR mod_dose_check_target_ptr = mod_dose_check_target; //set function pointer to pass mod_dose_check_target() function into root_find()
 
     int iter = 0;
     int max_iter = 50;
-    static int run_number = 0; // number of model runs (maximum run_number = (number of function evaluations * Monte Carlo evaluations [or 1 if not in MC mode]))
+    int *run_number = &train->ctx.run_number; // number of model runs (maximum run_number = (number of function evaluations * Monte Carlo evaluations [or 1 if not in MC mode]))
 
     double lime_lo = 0.0;    // set lower bound for lime dosing search
     double lime_up = 1000.0; // set upper bound for lime dosing search
@@ -81,7 +49,7 @@ void auto_dose(struct ProcessTrain *train,
     int co2_cntr = 0;        /* counts number of CARBON_DIOXIDE points in train, WJR */
 
     double lime_dose_pH;  // lime dose needed to meet pH setpoint
-    double lime_dose_alk; // lime does needed to meet alkalinity setpoint
+    double lime_dose_alk = 0.0; // lime does needed to meet alkalinity setpoint (none if the alkalinity is above it)
 
     int setptflag_pH_1 = FALSE;
     int setptflag_alk_1 = FALSE;
@@ -105,19 +73,16 @@ void auto_dose(struct ProcessTrain *train,
     double target, x_lo, x_up;
 
     /* Run WTP model and define water quality sampling locations (influent, effluent, end of system, etc.) */
-    if (debug == TRUE)
+    dose_log_clear(); // the ring buffer holds the messages of this call only
+    DOSE_LOG(DOSE_LOG_INFO, DOSE_LOG_AUTODOSE, "start of auto_dose(), model run number %d", *run_number);
+    DOSE_LOG(DOSE_LOG_INFO, DOSE_LOG_AUTODOSE, "alk_setpt_1: %f, pH_setpt_1: %f, End of system Cl2 setpoint: %f, pH_setpt_2: %f",
+             alk_setpt_1, pH_setpt_1, cl2_setpt, pH_setpt_2);
+    DOSE_LOG(DOSE_LOG_INFO, DOSE_LOG_AUTODOSE, "DBP_safety_factor: %f, toc_safety_factor: %f", DBP_safety_factor, toc_safety_factor);
+    if (DOSE_LOG_PRINTED(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE))
     {
-        fprintf(flog, "============ START of auto_dose() ============\n");
-        fprintf(flog, "model run number: %d \n", run_number);
-        fprintf(flog, "alk_setpt_1: %f \n", alk_setpt_1);
-        fprintf(flog, "pH_setpt_1: %f \n", pH_setpt_1);
-        fprintf(flog, "End of system Cl2 setpoint: %f \n", cl2_setpt);
-        fprintf(flog, "pH_setpt_2: %f \n", pH_setpt_2);
-        fprintf(flog, "DBP_safety_factor: %f \n", DBP_safety_factor);
-        fprintf(flog, "toc_safety_factor: %f \n", toc_safety_factor);
-        fprintf(flog, "\n=========== Process Train =========== \n");
-        writewtp(flog, train, flog); // write out process train to file
-        fprintf(flog, "\n");
+        fprintf(dose_log_file(), "\n=========== Process Train =========== \n");
+        writewtp(dose_log_file(), train, dose_log_file()); // write out process train to log
+        fprintf(dose_log_file(), "\n");
     }
 
     /* Run model */
@@ -187,13 +152,10 @@ void auto_dose(struct ProcessTrain *train,
             x_lo = lime_lo;
             x_up = lime_up;
 
-            if (debug == TRUE)
-            {
-                fprintf(flog, "auto_dose: add lime to meet raw water alkalinity setpoint. Entering rootfind_and_mod_dose()! \n\n");
-                write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target, flog);
-            }
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "add lime to meet raw water alkalinity setpoint. Entering rootfind_and_mod_dose()!");
+            write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target);
 
-            lime_dose_alk = rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up, flog);
+            lime_dose_alk = rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up);
             //bisect_method(mod_dose_check_target_ptr, train, LIME, 0, 'A', CARBON_DIOXIDE, 0, alk_setpt_1, lime_lo, lime_up, flog);
         }
 
@@ -210,12 +172,9 @@ void auto_dose(struct ProcessTrain *train,
             x_lo = lime_lo;
             x_up = lime_up;
 
-            if (debug == TRUE)
-            {
-                fprintf(flog, "auto_dose: add lime to meet raw water pH setpoint. Entering rootfind_and_mod_dose()! \n\n");
-                write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target, flog);
-            }
-            lime_dose_pH = rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up, flog);
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "add lime to meet raw water pH setpoint. Entering rootfind_and_mod_dose()!");
+            write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target);
+            lime_dose_pH = rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up);
 
             /* Select whichever lime dose is higher (to acheive either pH or alkalinity setpoint) */
             if (lime_dose_alk > lime_dose_pH)
@@ -230,13 +189,10 @@ void auto_dose(struct ProcessTrain *train,
                 x_lo = lime_lo;
                 x_up = lime_up;
 
-                if (debug == TRUE)
-                {
-                    fprintf(flog, "auto_dose: add lime to meet raw water alkalinity setpoint. Entering rootfind_and_mod_dose()! \n\n");
-                    write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target, flog);
-                }
+                DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "add lime to meet raw water alkalinity setpoint. Entering rootfind_and_mod_dose()!");
+                write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target);
 
-                lime_dose_alk = rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up, flog);
+                lime_dose_alk = rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up);
             }
         }
         else
@@ -251,21 +207,17 @@ void auto_dose(struct ProcessTrain *train,
             x_lo = co2_lo;
             x_up = co2_up;
 
-            if (debug == TRUE)
-            {
-                fprintf(flog, "auto_dose: add CO2 to meet raw water pH setpoint. Entering rootfind_and_mod_dose()! \n\n");
-                write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target, flog);
-            }
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "add CO2 to meet raw water pH setpoint. Entering rootfind_and_mod_dose()!");
+            write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target);
 
-            rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up, flog);
+            rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up);
         }
 
         /*======================== END RAW WATER pH AND ALKALINITY ADJUSTMENT ==========================*/
 
         /*===================== START ALUM ADJUSTMENT TO ACHIEVE DBP AND TOC REGS ==========================*/
         /* For first iteration, set alum to minimum dose (18 mg/L) to control turbidity */
-        if (debug == TRUE)
-            fprintf(flog, "auto_dose: set alum to minimum dose (18 mg/L). \n");
+        DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "set alum to minimum dose (18 mg/L).");
 
         for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit))
         {
@@ -286,8 +238,7 @@ void auto_dose(struct ProcessTrain *train,
             if ((influent->TOC < 2.0))
             {
                 // Do nothing if TOC < 2.0
-                if (debug == TRUE)
-                    fprintf(flog, "auto_dose: influent TOC =< 2.0, do not change alum dose. \n");
+                DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "influent TOC =< 2.0, do not change alum dose.");
             }
             else
             {
@@ -295,8 +246,7 @@ void auto_dose(struct ProcessTrain *train,
                 {
                     toc_rem_req = 35.0;
                     toc_rem_target = toc_rem_req * (1 + toc_safety_factor);
-                    if (debug == TRUE)
-                        fprintf(flog, "auto_dose: influent TOC < 4.0, TOC removal target set to 35%%. \n");
+                    DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "influent TOC < 4.0, TOC removal target set to 35%%.");
                 }
                 else
                 {
@@ -304,15 +254,13 @@ void auto_dose(struct ProcessTrain *train,
                     {
                         toc_rem_req = 45.0;
                         toc_rem_target = toc_rem_req * (1 + toc_safety_factor);
-                        if (debug == TRUE)
-                            fprintf(flog, "auto_dose: influent 4.0 <= TOC < 8.0, TOC removal target set to 45%%. \n");
+                        DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "influent 4.0 <= TOC < 8.0, TOC removal target set to 45%%.");
                     }
                     else
                     {
                         toc_rem_req = 45.0;
                         toc_rem_target = toc_rem_req * (1 + toc_safety_factor);
-                        if (debug == TRUE)
-                            fprintf(flog, "auto_dose: influent TOC >= 8.0, TOC removal target set to 50%%. \n");
+                        DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "influent TOC >= 8.0, TOC removal target set to 50%%.");
                     }
                 }
                 if (((influent->TOC - effluent->TOC) / influent->TOC * 100.0) < toc_rem_target)
@@ -327,20 +275,16 @@ void auto_dose(struct ProcessTrain *train,
                     x_lo = alum_lo;
                     x_up = alum_up;
 
-                    if (debug == TRUE)
-                    {
-                        fprintf(flog, "auto_dose: add alum to meet TOC target. Entering rootfind_and_mod_dose()! \n\n");
-                        write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target, flog);
-                    }
+                    DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "add alum to meet TOC target. Entering rootfind_and_mod_dose()!");
+                    write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target);
 
-                    rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up, flog);
+                    rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up);
                 }
             }
         }
         else
         {
-            if (debug == TRUE)
-                fprintf(stderr, "auto_dose: have not yet included logic for raw water alkalinity >= 60 mg/L! \n");
+            dose_log_fail(DOSE_LOG_AUTODOSE, "auto_dose: have not yet included logic for raw water alkalinity >= 60 mg/L!");
             exit(EXIT_FAILURE);
         }
 
@@ -357,12 +301,9 @@ void auto_dose(struct ProcessTrain *train,
             x_lo = alum_lo;
             x_up = alum_up;
 
-            if (debug == TRUE)
-            {
-                fprintf(flog, "auto_dose: add alum to meet TTHM. Entering rootfind_and_mod_dose()! \n\n");
-                write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target, flog);
-            }
-            rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up, flog);
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "add alum to meet TTHM. Entering rootfind_and_mod_dose()!");
+            write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target);
+            rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up);
         }
 
         if (eos->HAA5 > HAA5_target)
@@ -377,12 +318,9 @@ void auto_dose(struct ProcessTrain *train,
             x_lo = alum_lo;
             x_up = alum_up;
 
-            if (debug == TRUE)
-            {
-                fprintf(flog, "auto_dose: add alum to meet HAA5. Entering rootfind_and_mod_dose()! \n\n");
-                write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target, flog);
-            }
-            rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up, flog);
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "add alum to meet HAA5. Entering rootfind_and_mod_dose()!");
+            write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target);
+            rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up);
         }
 
         /* If achieving TOC and DBP regs reduces rapid mix pH below 5.5, adjust alum dose to achieve minimum pH. 
@@ -401,13 +339,10 @@ void auto_dose(struct ProcessTrain *train,
             x_lo = alum_min;
             x_up = alum_up;
 
-            if (debug == TRUE)
-            {
-                fprintf(flog, "auto_dose: adjust alum to meet pH target. TOC removal or DBP MCL regs will be violated. \n");
-                fprintf(flog, "auto_dose: alum dose minimum guess set to 0.0 mg/L to attempt to achieve pH >= 5.5. Entering rootfind_and_mod_dose()! \n\n");
-                write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target, flog);
-            }
-            rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up, flog);
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "adjust alum to meet pH target. TOC removal or DBP MCL regs will be violated.");
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "alum dose minimum guess set to 0.0 mg/L to attempt to achieve pH >= 5.5. Entering rootfind_and_mod_dose()!");
+            write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target);
+            rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up);
         }
 
         /*===================== END ALUM ADJUSTMENT TO ACHIEVE DBP AND TOC REGS ==========================*/
@@ -427,12 +362,9 @@ void auto_dose(struct ProcessTrain *train,
             x_lo = naocl_lo;
             x_up = naocl_up;
 
-            if (debug == TRUE)
-            {
-                fprintf(flog, "auto_dose: Add sodium hypochlorite to meet cl2 residual target.  Entering rootfind_and_mod_dose()! \n\n");
-                write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target, flog);
-            }
-            rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up, flog);
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "Add sodium hypochlorite to meet cl2 residual target.  Entering rootfind_and_mod_dose()!");
+            write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target);
+            rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up);
         }
         /*===================== END EOS CL2 ADJUSTMENT TO MAINTAIN RESIDUAL ==========================*/
 
@@ -451,13 +383,10 @@ void auto_dose(struct ProcessTrain *train,
             x_lo = lime_lo;
             x_up = lime_up;
 
-            if (debug == TRUE)
-            {
-                fprintf(flog, "auto_dose: add lime to meet corrosion control pH criteria. Entering rootfind_and_mod_dose()! \n\n");
-                write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target, flog);
-            }
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "add lime to meet corrosion control pH criteria. Entering rootfind_and_mod_dose()!");
+            write_dose_target(dose_unit, dose_location, target_param, target_unit, target_location, target);
 
-            rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up, flog);
+            rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up);
         }
         else
         { // adjust pH by adding carbon dioxide
@@ -471,12 +400,9 @@ void auto_dose(struct ProcessTrain *train,
             x_lo = co2_lo;
             x_up = co2_up;
 
-            if (debug == TRUE)
-            {
-                fprintf(flog, "auto_dose: add CO2 to meet corrosion control pH criteria. Entering rootfind_and_mod_dose()! \n\n");
-            }
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "add CO2 to meet corrosion control pH criteria. Entering rootfind_and_mod_dose()!");
 
-            rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up, flog);
+            rootfind_and_mod_dose(mod_dose_check_target_ptr, train, dose_unit, dose_location, target_param, target_unit, target_location, target, x_lo, x_up);
         }
         /*======================== END EFFLUENT pH AND ALKALINITY ADJUSTMENT FOR CORROSION CONTROL ==========================*/
 
@@ -484,20 +410,17 @@ void auto_dose(struct ProcessTrain *train,
         if ((co2_1->Alk * MW_CaCO3 / 2.0) >= alk_setpt_1 - ERROR_TOL)
         {
             setptflag_alk_1 = TRUE;
-            if (debug == TRUE)
-                fprintf(flog, "auto_dose: alkalinity setpoint conditions met! Setting setptflag_alk_1 to TRUE. \n");
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "alkalinity setpoint conditions met! Setting setptflag_alk_1 to TRUE.");
         }
         if (fabs(co2_1->pH - pH_setpt_1) < ERROR_TOL)
         {
             setptflag_pH_1 = TRUE;
-            if (debug == TRUE)
-                fprintf(flog, "auto_dose: pH setpoint conditions met! Setting setptflag_pH_1 to TRUE. \n");
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "pH setpoint conditions met! Setting setptflag_pH_1 to TRUE.");
         }
         if (fabs((eos->FreeCl2 * MW_Cl2) - cl2_setpt) < ERROR_TOL)
         {
             setptflag_cl2 = TRUE;
-            if (debug == TRUE)
-                fprintf(flog, "auto_dose: chlorine setpoint conditions met! Setting setptflag_cl2 to TRUE. \n");
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "chlorine setpoint conditions met! Setting setptflag_cl2 to TRUE.");
         }
 
         if (fabs(effluent->pH - pH_setpt_2) < ERROR_TOL)  
@@ -508,71 +431,52 @@ void auto_dose(struct ProcessTrain *train,
              ((influent->TOC - effluent->TOC) / influent->TOC * 100.0) >= (toc_rem_req - ERROR_TOL)))
         {
             setptflag_DBP = TRUE;
-            if (debug == TRUE)
-                fprintf(flog, "auto_dose: influent TOC >= 2.0 and TTHM, HAA5, and TOC removal conditions met! Setting setptflag_DBP to TRUE. \n");
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "influent TOC >= 2.0 and TTHM, HAA5, and TOC removal conditions met! Setting setptflag_DBP to TRUE.");
         }
         else if ((eos->TTHM < (TTHM_MCL + ERROR_TOL) && eos->HAA5 < (HAA5_MCL + ERROR_TOL) &&
                   influent->TOC < 2.0))
         {
-            if (debug == TRUE)
-                fprintf(flog, "auto_dose: influent TOC < 2.0 (TOC removal exempt) and TTHM and HAA5 conditions met! Setting setptflag_DBP to TRUE. \n");
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "influent TOC < 2.0 (TOC removal exempt) and TTHM and HAA5 conditions met! Setting setptflag_DBP to TRUE.");
             setptflag_DBP = TRUE;
         }
         else if (fabs(rapid_mix->pH - pH_setpt_alum) < ERROR_TOL)
         {
-            if (debug == TRUE)
-                fprintf(flog, "auto_dose: TTHM, HAA5, or TOC could not be achieved! Alum dose set to get pH of 5.5 (the minimum). Setting setptflag_DBP to TRUE.  \n");
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "TTHM, HAA5, or TOC could not be achieved! Alum dose set to get pH of 5.5 (the minimum). Setting setptflag_DBP to TRUE.");
             setptflag_DBP = TRUE;
         }
 
         iter++;
 
-        if (debug == TRUE)
-        {
-            fprintf(flog, "\n ERROR_TOL = %f\n", ERROR_TOL);
-            fprintf(flog, "\n======== CHECK alkalinity setpt #1 =========\n");
-            fprintf(flog, "Alkalinity: %f \n", co2_1->Alk * MW_CaCO3 / 2.0);
-            fprintf(flog, "alk_setpt_1 - ERROR_TOL: %f \n", alk_setpt_1 - ERROR_TOL);
-            fprintf(flog, "\n======== CHECK pH setpt #1 ========\n");
-            fprintf(flog, "pH: %f \n", co2_1->pH);
-            fprintf(flog, "(fabs(co2_1->pH - pH_setpt_1) < ERROR_TOL)? Answer: %d\n", (fabs(co2_1->pH - pH_setpt_1) < ERROR_TOL));
-            fprintf(flog, "\n=========== CHECK DBP variables ==========\n");
-            fprintf(flog, "End of system TTHM: %f \n", eos->TTHM);
-            fprintf(flog, "End of system TTHM + ERROR_TOL: %f \n", TTHM_MCL + ERROR_TOL);
-            fprintf(flog, "End of system HAA5: %f \n", eos->HAA5);
-            fprintf(flog, "End of system HAA5: %f \n", HAA5_MCL + ERROR_TOL);
-            fprintf(flog, "Influent TOC: %f \n", influent->TOC);
-            fprintf(flog, "Effluent TOC: %f \n", effluent->TOC);
-            fprintf(flog, "Percent TOC removal: %f\n", (influent->TOC - effluent->TOC) / influent->TOC * 100.0);
-            fprintf(flog, "TOC removal requirement - ERROR_TOL: %f\n", toc_rem_req - ERROR_TOL);
-            fprintf(flog, "Difference between rapid mix pH and pH setpoint: %f\n", fabs(rapid_mix->pH - pH_setpt_alum));
-            fprintf(flog, "\n");
-            fprintf(flog, "========== CHECK FLAGS for auto_dose iteration %d =========\n", iter);
-            fprintf(flog, "setptflag_alk_1: %d \n", setptflag_alk_1);
-            fprintf(flog, "setptflag_pH_1: %d \n", setptflag_pH_1);
-            fprintf(flog, "setptflag_DBP: %d \n", setptflag_DBP);
-            fprintf(flog, "setptflag_cl2: %d \n", setptflag_cl2);
-            fprintf(flog, "setptflag_pH_2: %d \n", setptflag_pH_2);
-            fprintf(flog, "\n");
-        }
+        DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "check alkalinity setpt #1: alkalinity %f, alk_setpt_1 - ERROR_TOL %f",
+                 co2_1->Alk * MW_CaCO3 / 2.0, alk_setpt_1 - ERROR_TOL);
+        DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "check pH setpt #1: pH %f, |pH - pH_setpt_1| %f, ERROR_TOL %f",
+                 co2_1->pH, fabs(co2_1->pH - pH_setpt_1), ERROR_TOL);
+        DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "check DBP variables: End of system TTHM %f (MCL + ERROR_TOL %f), HAA5 %f (MCL + ERROR_TOL %f)",
+                 eos->TTHM, TTHM_MCL + ERROR_TOL, eos->HAA5, HAA5_MCL + ERROR_TOL);
+        DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "check DBP variables: Influent TOC %f, Effluent TOC %f, Percent TOC removal %f, requirement - ERROR_TOL %f",
+                 influent->TOC, effluent->TOC, (influent->TOC - effluent->TOC) / influent->TOC * 100.0, toc_rem_req - ERROR_TOL);
+        DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "check DBP variables: difference between rapid mix pH and pH setpoint %f", fabs(rapid_mix->pH - pH_setpt_alum));
+        DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "check flags for auto_dose iteration %d: alk_1 %d, pH_1 %d, DBP %d",
+                 iter, setptflag_alk_1, setptflag_pH_1, setptflag_DBP);
+        DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "check flags for auto_dose iteration %d: cl2 %d, pH_2 %d", iter, setptflag_cl2, setptflag_pH_2);
 
         if (iter > max_iter)
         {
-            fprintf(stderr, "Maximum iterations exceeded in while loop for auto_dose()!\n");
+            dose_log_fail(DOSE_LOG_AUTODOSE, "Maximum iterations exceeded in while loop for auto_dose()!");
             exit(EXIT_FAILURE);
         }
 
     } /* end while-loop */
 
-    if (debug == TRUE)
+    DOSE_LOG(DOSE_LOG_INFO, DOSE_LOG_AUTODOSE, "end of auto_dose() after %d iterations", iter);
+    if (DOSE_LOG_PRINTED(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE))
     {
-        fprintf(flog, "=========== Process Train =========== \n");
-        writewtp(flog, train, flog); // write out process train to file
-        fprintf(flog, "\n");
+        fprintf(dose_log_file(), "=========== Process Train =========== \n");
+        writewtp(dose_log_file(), train, dose_log_file()); // write out process train to log
+        fprintf(dose_log_file(), "\n");
     }
 
-    run_number++;
-    fclose(flog);  // close log file
+    (*run_number)++;
 
     /* Write water treatment plant process train to result file */
     if (fres) 
@@ -589,18 +493,32 @@ void auto_dose(struct ProcessTrain *train,
     return;
 }
 
-void write_dose_target(int dose_unit, int dose_location, char target_param, int target_unit, int target_location, double target, FILE *flog)
+void write_dose_target(int dose_unit, int dose_location, char target_param, int target_unit, int target_location, double target)
 {
 
-    /* Purpose: write information about chemical dose adjustments and water quality targets to output file */
+    /* Purpose: log information about chemical dose adjustments and water quality targets (level DEBUG). */
 
-    fprintf(flog, "dose_unit: %d \n", dose_unit);
-    fprintf(flog, "dose_location: %d \n", dose_location);
-    fprintf(flog, "target_param: %c \n", target_param);
-    fprintf(flog, "target_unit: %d \n", target_unit);
-    fprintf(flog, "target: %f \n", target);
-    fprintf(flog, "target location: %d \n", target_location);
-    fprintf(flog, "\n");
+    static const struct
+    {
+        char param;
+        const char *name;
+        const char *units;
+    } params[] = {
+        {'P', "pH", ""},
+        {'A', "alkalinity", " mg/L as CaCO3"},
+        {'C', "chlorine residual", " mg/L as Cl2"},
+        {'T', "TTHM", " ug/L"},
+        {'H', "HAA5", " ug/L"},
+        {'O', "TOC removal", " %"},
+        {'?', "unknown", ""},
+    };
+    int i = 0;
+
+    while (params[i].param != '?' && params[i].param != target_param)
+        i++;
+    DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "dose_unit: %d, dose_location: %d, target_unit: %d, target location: %d",
+             dose_unit, dose_location, target_unit, target_location);
+    DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_AUTODOSE, "target_param: %s, target: %f%s", params[i].name, target, params[i].units);
 
     return;
-}
\ No newline at end of file
+}
@@ -12,16 +12,94 @@
 
 /* TODO add comments to auto_dose.h */
 double mod_dose_check_target(struct ProcessTrain *train, int dose_unit, double dose, int dose_location,
-                             char target_param, int target_unit, double target, int target_location, FILE *fout);
+                             char target_param, int target_unit, double target, int target_location);
 void auto_dose(struct ProcessTrain *train,
                double pH_setpt_1, double alk_setpt_1, double cl2_setpt, double pH_setpt_2, double DBP_safety_factor, 
                FILE *fres);
 // void meet_TOC_req(struct ProcessTrain *train, double cl2_setpt, double pH_setpt_2);
-void write_dose_target(int dose_unit, int dose_location, char target_param, int target_unit, int target_location, double target, FILE *fout);
-typedef double (*RF_FUNC_PTR)(struct ProcessTrain *, int, double, int, char, int, double, int, FILE *);
+void write_dose_target(int dose_unit, int dose_location, char target_param, int target_unit, int target_location, double target);
+typedef double (*RF_FUNC_PTR)(struct ProcessTrain *, int, double, int, char, int, double, int);
 // a function pointer passed into rootfind_and_mod_dose() to evaluate the impact of changing a chemical dose
 double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int dose_unit, int dose_location, char target_param,
-                             int target_unit, int target_location, double target, double x_lo, double x_up, FILE *fout);
+                             int target_unit, int target_location, double target, double x_lo, double x_up);
+
+/* Leveled logging of auto_dose() and the root finder: located in dose_log.cpp
+ * A message is printed when its level is at most the level set for its component (see dose_log_parse()),
+ * and kept in a ring buffer of the last DOSE_LOG_RING_SIZE messages of the thread when its level is at
+ * most the ring level. The ring holds the format and the numbers of each message, not the text, and is
+ * printed only when a solve fails (see dose_log_fail()). */
+#define DOSE_LOG_OFF 0
+#define DOSE_LOG_ERROR 1  /* a solve fails */
+#define DOSE_LOG_WARN 2   /* a solve goes on with a doubtful result */
+#define DOSE_LOG_INFO 3   /* set points and doses of each auto_dose() call */
+#define DOSE_LOG_DEBUG 4  /* steps of auto_dose() and of the root searches, process train */
+#define DOSE_LOG_TRACE 5  /* water quality of every model run of a root search */
+
+#define DOSE_LOG_AUTODOSE 0x1  /* auto_dose() */
+#define DOSE_LOG_ROOTFIND 0x2  /* rootfind_and_mod_dose() */
+#define DOSE_LOG_TARGET 0x4    /* mod_dose_check_target() */
+#define DOSE_LOG_ALL 0x7
+
+/* Messages above DOSE_LOG_MAX_LEVEL are removed at compile time, e.g. with -DDOSE_LOG_MAX_LEVEL=0 */
+#ifndef DOSE_LOG_MAX_LEVEL
+#define DOSE_LOG_MAX_LEVEL DOSE_LOG_TRACE
+#endif
+
+#define DOSE_LOG_RING_SIZE 256  /* messages kept for dose_log_fail() */
+#define DOSE_LOG_MAX_ARGS 4     /* arguments of a message */
+#define DOSE_LOG_TEXT_LEN 128   /* characters of the strings of a message */
+
+struct DoseLogConfig
+{
+  int level;            /* print the messages of these components up to this level */
+  unsigned components;  /* DOSE_LOG_AUTODOSE | ... */
+  int ring_level;       /* keep the messages of all components up to this level in the ring */
+  FILE *fp;             /* where to print, NULL for stderr */
+};
+extern struct DoseLogConfig dose_log_config;
+
+/* TRUE if a message of level and component is printed or kept */
+#define DOSE_LOG_WANTED(lv, comp) ((lv) <= DOSE_LOG_MAX_LEVEL && \
+    ((lv) <= dose_log_config.ring_level || ((lv) <= dose_log_config.level && ((comp) & dose_log_config.components))))
+/* TRUE if a message of level and component is printed */
+#define DOSE_LOG_PRINTED(lv, comp) ((lv) <= DOSE_LOG_MAX_LEVEL && \
+    (lv) <= dose_log_config.level && ((comp) & dose_log_config.components))
+
+/* Logs a message: format is a string constant, kept by its address, followed by at most DOSE_LOG_MAX_ARGS
+ * arguments, each a number (%f, %g, %e), an int (%d) or a string (%s, copied, at most DOSE_LOG_TEXT_LEN
+ * characters in all). The arguments are not evaluated when the message is neither printed nor kept; the
+ * compiler checks them against the format. */
+#define DOSE_LOG(lv, comp, ...) \
+  do { if (DOSE_LOG_WANTED(lv, comp)) { if (0) dose_log_check(__VA_ARGS__); dose_log_write(lv, comp, __VA_ARGS__); } } while (0)
+
+struct DoseLogArg
+{
+  char type;  /* 'g', 'd' or 's' */
+  union
+  {
+    double number;
+    int integer;
+    const char *text;
+  };
+};
+
+void dose_log_check(const char *format, ...) __attribute__((format(printf, 1, 2)));  /* never called */
+void dose_log_add(int level, int component, const char *format, int n_args, const struct DoseLogArg *args);
+inline struct DoseLogArg dose_log_arg(double number) { struct DoseLogArg arg; arg.type = 'g'; arg.number = number; return (arg); }
+inline struct DoseLogArg dose_log_arg(int integer) { struct DoseLogArg arg; arg.type = 'd'; arg.integer = integer; return (arg); }
+inline struct DoseLogArg dose_log_arg(const char *text) { struct DoseLogArg arg; arg.type = 's'; arg.text = text; return (arg); }
+template <typename... Args>
+inline void dose_log_write(int level, int component, const char *format, Args... args)
+{
+  static_assert(sizeof...(args) <= DOSE_LOG_MAX_ARGS, "too many arguments for a dose log message");
+  struct DoseLogArg values[] = {dose_log_arg(0.0), dose_log_arg(args)...};
+  dose_log_add(level, component, format, (int)sizeof...(args), values + 1);
+}
+FILE *dose_log_file();  /* where the messages are printed */
+int dose_log_parse(const char *spec, FILE *ferr);  /* set levels from "level[:component,...]" or "ring=level" */
+void dose_log_clear();  /* empty the ring of the thread, at the start of a solve */
+void dose_log_dump(FILE *fp);  /* print the ring of the thread */
+void dose_log_fail(int component, const char *message);  /* report a failed solve with the ring */
 
 /* Functions in extrema.cpp used to find max or mins of an array */
 double min(double array[], int n); // finds minimum value of an array of doubles of length n
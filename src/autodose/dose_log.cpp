@@ -0,0 +1,251 @@
+/* dose_log.c */
+
+#include "wtp.h"
+#include "auto_dose.h"
+
+/* Purpose: this file contains the leveled logging of auto_dose() and the root finder.
+ *
+ *  The solves run millions of times in the optimization, so a message costs nothing unless its level is
+ *  wanted: the DOSE_LOG() macro tests the level before the arguments are evaluated, and messages above
+ *  DOSE_LOG_MAX_LEVEL are removed by the compiler. Printed messages are formatted at once. Messages kept
+ *  for a failure are stored as their format and arguments in a ring buffer of each thread, and formatted
+ *  only if dose_log_fail() prints them, so a solve that fails can be diagnosed after the fact without
+ *  the cost of writing a log for every solve that does not.
+ */
+
+struct DoseLogRecord
+{
+  const char *format;  /* string literal of DOSE_LOG() */
+  unsigned char level;
+  unsigned char component;
+  unsigned char n_args;
+  struct DoseLogArg args[DOSE_LOG_MAX_ARGS];
+  char text[DOSE_LOG_TEXT_LEN + DOSE_LOG_MAX_ARGS];  /* the strings of args, each ended by '\0' */
+};
+
+struct DoseLogRing
+{
+  struct DoseLogRecord records[DOSE_LOG_RING_SIZE];
+  long n;  /* messages added since the last dose_log_clear() */
+};
+
+struct DoseLogConfig dose_log_config = {DOSE_LOG_ERROR, DOSE_LOG_ALL, DOSE_LOG_DEBUG, NULL};
+
+static thread_local struct DoseLogRing ring;  /* each thread solves its own trains */
+
+static const char *level_names[] = {"off", "error", "warn", "info", "debug", "trace"};
+static const char *component_names[] = {"autodose", "rootfind", "target"};
+
+static void print_record(FILE *fp, const struct DoseLogRecord *record)
+{
+  /* Purpose: print a message as "<component> <level>: <text>", one conversion of its format at a time */
+
+  const char *p = record->format;
+  char conversion[32];
+  size_t length;
+  int c = 0, a = 0;
+
+  while (c < 2 && !(record->component & (1 << c)))
+    c++;
+  fprintf(fp, "%s %s: ", component_names[c], level_names[record->level]);
+  while (*p != '\0')
+  {
+    if (*p != '%' || p[1] == '%')
+    {
+      fputc(*p, fp);
+      p += (*p == '%') ? 2 : 1;
+      continue;
+    }
+    length = 1 + strspn(p + 1, "-+ #0123456789.hlLjzt");
+    if (p[length] != '\0')
+      length++;
+    if (length >= sizeof(conversion) || a >= record->n_args)
+    { /* not a conversion of DOSE_LOG(), see dose_log_check() */
+      fwrite(p, 1, length, fp);
+      p += length;
+      continue;
+    }
+    memcpy(conversion, p, length);
+    conversion[length] = '\0';
+    p += length;
+    switch (record->args[a].type)
+    {
+    case 'd':
+      fprintf(fp, conversion, record->args[a].integer);
+      break;
+    case 's':
+      fprintf(fp, conversion, record->args[a].text);
+      break;
+    default:
+      fprintf(fp, conversion, record->args[a].number);
+      break;
+    }
+    a++;
+  }
+  fputc('\n', fp);
+}
+
+void dose_log_check(const char *format, ...)
+{
+  /* Purpose: none at run time: DOSE_LOG() passes its arguments here in dead code, so that the compiler
+   *  checks them against the format (-Wformat) */
+}
+
+void dose_log_add(int level, int component, const char *format, int n_args, const struct DoseLogArg *args)
+{
+  /* Purpose: print and/or keep a message, see DOSE_LOG().
+   *
+   * Inputs:
+   *  level     = DOSE_LOG_ERROR ... DOSE_LOG_TRACE.
+   *  component = DOSE_LOG_AUTODOSE, DOSE_LOG_ROOTFIND or DOSE_LOG_TARGET.
+   *  format    = string literal, kept by its address.
+   *  args      = the n_args arguments of the format; strings are copied into the record.
+   */
+
+  struct DoseLogRecord *record;
+  struct DoseLogRecord printed;
+  size_t used = 0, length;
+  int i;
+
+  if (level <= dose_log_config.ring_level)
+    record = &ring.records[ring.n++ % DOSE_LOG_RING_SIZE];
+  else
+    record = &printed;
+  record->format = format;
+  record->level = (unsigned char)level;
+  record->component = (unsigned char)component;
+  record->n_args = (unsigned char)n_args;
+  for (i = 0; i < n_args; i++)
+  {
+    record->args[i] = args[i];
+    if (args[i].type == 's')
+    {
+      length = (args[i].text && used < DOSE_LOG_TEXT_LEN) ? strnlen(args[i].text, DOSE_LOG_TEXT_LEN - used) : 0;
+      if (length > 0)
+        memcpy(record->text + used, args[i].text, length);
+      record->text[used + length] = '\0';
+      record->args[i].text = record->text + used;
+      used += length + 1;
+    }
+  }
+
+  if (level <= dose_log_config.level && (component & dose_log_config.components))
+    print_record(dose_log_file(), record);
+}
+
+FILE *dose_log_file()
+{
+  /* Purpose: return where the messages are printed */
+
+  return (dose_log_config.fp ? dose_log_config.fp : stderr);
+}
+
+static int parse_level(const char *name, int length)
+{
+  /* Purpose: return the level of a name, or -1 */
+
+  int level;
+
+  for (level = DOSE_LOG_OFF; level <= DOSE_LOG_TRACE; level++)
+  {
+    if ((int)strlen(level_names[level]) == length && strncmp(name, level_names[level], length) == 0)
+      return (level);
+  }
+  return (-1);
+}
+
+int dose_log_parse(const char *spec, FILE *ferr)
+{
+  /* Purpose: set the levels of dose_log_config from a command line specification.
+   *
+   * Inputs:
+   *  spec = "level" for all components, "level:component,component..." (components autodose, rootfind,
+   *         target), or "ring=level" for the ring buffer. The levels are off, error, warn, info, debug
+   *         and trace.
+   *
+   * Return:
+   *  TRUE/FALSE for success/fail.
+   */
+
+  const char *colon = strchr(spec, ':');
+  const char *name, *end;
+  unsigned components = 0;
+  int level, c;
+
+  if (strncmp(spec, "ring=", 5) == 0)
+  {
+    if ((level = parse_level(spec + 5, (int)strlen(spec + 5))) < 0)
+    {
+      fprintf(ferr, "Error: unknown log level in \"%s\"\n", spec);
+      return (FALSE);
+    }
+    dose_log_config.ring_level = level;
+    return (TRUE);
+  }
+
+  if ((level = parse_level(spec, colon ? (int)(colon - spec) : (int)strlen(spec))) < 0)
+  {
+    fprintf(ferr, "Error: unknown log level in \"%s\"\n", spec);
+    return (FALSE);
+  }
+  if (colon == NULL)
+    components = DOSE_LOG_ALL;
+  for (name = colon ? colon + 1 : NULL; name != NULL; name = (*end == ',') ? end + 1 : NULL)
+  {
+    end = name + strcspn(name, ",");
+    for (c = 0; c < 3; c++)
+    {
+      if ((int)strlen(component_names[c]) == end - name && strncmp(name, component_names[c], end - name) == 0)
+        break;
+    }
+    if (c == 3)
+    {
+      fprintf(ferr, "Error: unknown log component in \"%s\", expected autodose, rootfind or target\n", spec);
+      return (FALSE);
+    }
+    components |= 1 << c;
+  }
+  dose_log_config.level = level;
+  dose_log_config.components = components;
+  if (level > DOSE_LOG_MAX_LEVEL)
+    fprintf(ferr, "Warning: messages above level %s were removed at compile time (DOSE_LOG_MAX_LEVEL)\n",
+            level_names[DOSE_LOG_MAX_LEVEL]);
+  return (TRUE);
+}
+
+void dose_log_clear()
+{
+  /* Purpose: empty the ring buffer of the thread, so that it holds the messages of one solve */
+
+  ring.n = 0;
+}
+
+void dose_log_dump(FILE *fp)
+{
+  /* Purpose: print the messages of the ring buffer of the thread, oldest first */
+
+  long i, first = (ring.n > DOSE_LOG_RING_SIZE) ? ring.n - DOSE_LOG_RING_SIZE : 0;
+
+  if (first > 0)
+    fprintf(fp, "(%ld earlier messages were dropped)\n", first);
+  for (i = first; i < ring.n; i++)
+    print_record(fp, &ring.records[i % DOSE_LOG_RING_SIZE]);
+}
+
+void dose_log_fail(int component, const char *message)
+{
+  /* Purpose: report a failed solve: print message to stderr with the messages of the solve that led
+   *  to it, as kept in the ring buffer. The caller then exits.
+   */
+
+  DOSE_LOG(DOSE_LOG_ERROR, component, "%s", message);
+  if (dose_log_file() != stderr || !DOSE_LOG_PRINTED(DOSE_LOG_ERROR, component))
+    fprintf(stderr, "%s\n", message);
+  if (ring.n > 0 && dose_log_config.ring_level > DOSE_LOG_OFF)
+  {
+    fprintf(stderr, "---- auto_dose() messages before the failure ----\n");
+    dose_log_dump(stderr);
+    fprintf(stderr, "---- end of auto_dose() messages ----\n");
+  }
+  fflush(NULL);
+}
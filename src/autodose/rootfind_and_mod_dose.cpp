@@ -20,7 +20,7 @@
 
 double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int dose_unit, int dose_location, 
                            char target_param, int target_unit, int target_location, double target, 
-                           double x_lo, double x_up, FILE *fout) {
+                           double x_lo, double x_up) {
 
     /* Purpose: use Bisection or Secant method to find root of function. 
      * 
@@ -40,17 +40,16 @@ double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int d
     int i, j;
     double x_lo_guess = x_lo;  // save initial lower guess
     double x_up_guess = x_up;  // save initial upper guess
-    int debug = TRUE;  // (TRUE/FALSE): TRUE to output debugging print statements, FALSE for no output
     
-    if (debug==TRUE) fprintf(fout,"=========== START rootfind_and_mod_dose() =========== \n\n");
+    DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "start: dose between %g and %g", x_lo, x_up);
     
     f_0 = func(train, dose_unit, x_lo, dose_location, target_param, 
-                    target_unit, target, target_location, fout); 
-    if (debug==TRUE) fprintf(fout, "rootfind_and_mod_dose: initial f(x_min) = %.3f \n", f_0);                
+                    target_unit, target, target_location); 
+    DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "initial f(x_min) = %.3f", f_0);                
     
     f_1 = func(train, dose_unit, x_up, dose_location, target_param, 
-                    target_unit, target, target_location, fout);    
-    if (debug==TRUE) fprintf(fout, "rootfind_and_mod_dose: initial f(x_max) = %.3f \n", f_1); 
+                    target_unit, target, target_location);    
+    DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "initial f(x_max) = %.3f", f_1);
     
     if (f_0*f_1 < 0)  /* Check bracketing of lower and upper guesses */
     {
@@ -60,7 +59,7 @@ double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int d
 		 * Of those roots, this code will return the minimum non-negative root. This method
 		 * guarantees that a root is found given sufficient iterations. */
         
-        if (debug==TRUE) fprintf(fout,"\nBracketing conditions met, using BISECTION METHOD... \n");
+        DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "bracketing conditions met, using BISECTION METHOD");
         
         /* Define array of roots to choose from if there are multiple roots */
         int max_starts = 3;  // maximum number of roots that can be found
@@ -70,7 +69,7 @@ double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int d
 		/* Search for multiple roots */
         for (j=0; j<max_starts; j++) {
             
-            fprintf(fout, "\n============= BISECTION METHOD: iteration %d ============== \n", j+1);
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "BISECTION METHOD: iteration %d", j+1);
             
 			/* After the first root is found (for j==0), look for other roots by updating lower and upper bounds */
             if (j==1) {  // once first root is found, check between the lower bound and just left of the root
@@ -82,23 +81,14 @@ double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int d
                 x_up = x_up_guess + 0.1; // bracket just to the right of the root that was found and the upper bound
             }
             
-            if (debug==TRUE) {
-                fprintf(fout, "\n");
-                fprintf(fout, "low guess (x_lo) = %f\n", x_lo);
-                fprintf(fout, "upper guess (x_up) = %f\n", x_up);
-                fprintf(fout, "\n");
-            }
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "low guess (x_lo) = %f, upper guess (x_up) = %f", x_lo, x_up);
             
 			/* Perform Bisection Method */
             for (i=0; i<max_iter; i++) {
                 x_mid = (x_lo + x_up)/2.0; 
                 f_mid = func(train, dose_unit, x_mid, dose_location, target_param, 
-                            target_unit, target, target_location, fout); 
-                if (debug==TRUE) {
-                    fprintf(fout, "rootfind_and_mod_dose: current x = %.8f \n", x_mid); 
-                    fprintf(fout, "rootfind_and_mod_dose: current f(x) = %.8f \n", f_mid);  
-                    fprintf(fout, "\n");
-                }
+                            target_unit, target, target_location); 
+                DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "current x = %.8f, f(x) = %.8f", x_mid, f_mid);
                 
                 error = fabs(f_mid);
                 
@@ -110,7 +100,7 @@ double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int d
                 
                 if (fabs(error) < err_tol) {
                     roots[j] = x_mid;
-                    if (debug==TRUE) fprintf(fout, "Root found!\n");
+                    DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "root found!");
                     break;
                 }
             }
@@ -118,19 +108,18 @@ double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int d
 
 		/* Choose minimum non-negative root to return from function */
         min_root = find_min_nonneg(roots, max_starts); 
-        if (debug==TRUE) fprintf(fout,"rootfind_and_mod_dose: Minimum root found = %f\n\n", min_root); 
+        DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "minimum root found = %f", min_root);
         
 		/* Handle the case where no root has been found */
         if (min_root == DBL_MAX) { 
-            fprintf(stderr, "No roots found with Bisection method. Increase maximum iterations! \n");
+            dose_log_fail(DOSE_LOG_ROOTFIND, "No roots found with Bisection method. Increase maximum iterations!");
             exit(EXIT_FAILURE); 
         }
         
         /* Apply minimum, non-negative root found to change the chemical dose */
         double f_min_root = func(train, dose_unit, min_root, dose_location, target_param, 
-                                target_unit, target, target_location, fout); 
-        if (debug==TRUE) fprintf(fout, "rootfind_and_mod_dose: f(x) of minimum root = %f\n\n", f_min_root); 
-        if (debug==TRUE) fprintf(fout, "============= END BISECTION METHOD: rootfind_and_mod_dose() ============\n\n");
+                                target_unit, target, target_location); 
+        DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "f(x) of minimum root = %f, end of BISECTION METHOD", f_min_root);
         
         return  min_root;
     
@@ -141,7 +130,7 @@ double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int d
 		 * Of those roots, this code will return the minimum positive root. If no root exists, 
 		 * the minimum |f(x)| which has a non-negative x-value is returned instead. */
 		 
-		fprintf(fout,"Bracketing conditions not met, using SECANT METHOD instead of Bisection... \n");
+		DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "bracketing conditions not met, using SECANT METHOD instead of Bisection");
 		        
         /* Keep track of minimum and maximum function evalutions during root-finding search */ 
         double bracket_array[] = {f_0, f_1};
@@ -160,7 +149,7 @@ double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int d
             if (x_lo >= 0) x_max = x_lo;  // only set x_min value if x_lo is positive
             if (x_up >= 0) x_min = x_up;  // only set x_max value if x_up is positive
         } else {
-            fprintf(fout,"Error setting x_min and x_max. Exiting program...\n");
+            dose_log_fail(DOSE_LOG_ROOTFIND, "Error setting x_min and x_max. Exiting program...");
             exit(EXIT_FAILURE);
         }
         
@@ -171,7 +160,7 @@ double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int d
 
         for (j=0; j < max_starts; j++) { 
             
-            fprintf(fout, "\n============= SECANT METHOD: iteration %d ==============\n", j+1);
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "SECANT METHOD: iteration %d", j+1);
             
             roots[j] = DBL_MAX;  // set default value of roots to NaN. If NaN remains after root-finding, no root was found. 
             x_0 = x_lo_guess + fabs(x_lo_guess-x_up_guess)*((double)(j)/(double)(max_starts)); 
@@ -195,10 +184,10 @@ double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int d
             }
 
             f_0 = func(train, dose_unit, x_0, dose_location, target_param, 
-                      target_unit, target, target_location, fout); 
+                      target_unit, target, target_location); 
             
             f_1 = func(train, dose_unit, x_1, dose_location, target_param, 
-                      target_unit, target, target_location, fout); 
+                      target_unit, target, target_location); 
             
             /* Determine x which corresponds to minimum and maximum observed function values 
 			 * thus far which is non-negative*/ 
@@ -207,17 +196,17 @@ double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int d
             
             /* Update f_min and f_max based on x's found above */ 
             f_min = func(train, dose_unit, x_min, dose_location, target_param, 
-                        target_unit, target, target_location, fout); 
+                        target_unit, target, target_location); 
 
             f_max = func(train, dose_unit, x_max, dose_location, target_param, 
-                        target_unit, target, target_location, fout); 
+                        target_unit, target, target_location); 
             
 			/* Perform Secant Method */
             for (i=1; i<= max_iter; i++) {
                 if (f_0 == f_1) {
                     
                     if (x_0 != x_1) {
-                        fprintf(fout,"Tolerance of %f reached. \n", (x_0 - x_1));
+                        DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "tolerance of %f reached", (x_0 - x_1));
                     }
                     
                     x = (x_0 + x_1)/2.0; 
@@ -236,7 +225,7 @@ double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int d
                 f_0 = f_1; 
                 x_1 = x;
                 f_1 = func(train, dose_unit, x_1, dose_location, target_param, 
-                          target_unit, target, target_location, fout); 
+                          target_unit, target, target_location); 
                 
                 /* Determine x which corresponds to minimum and maximum observed function values thus far */ 
 				x_min = update_xextrema_nonneg(f_min, f_0, f_1, x_min, x_0, x_1, maximum = 0); 
@@ -244,61 +233,45 @@ double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int d
             
                 /* Update f_min and f_max based on x's found above */ 
                 f_min = func(train, dose_unit, x_min, dose_location, target_param, 
-                            target_unit, target, target_location, fout); 
-                if (debug==TRUE) {
-                    fprintf(fout, "rootfind_and_mod_dose: x_min = %.8f \n", x_min); 
-                    fprintf(fout, "rootfind_and_mod_dose: f(x_min) = %.8f \n", f_min);  
-                    fprintf(fout, "\n");
-                }
+                            target_unit, target, target_location); 
+                DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "x_min = %.8f, f(x_min) = %.8f", x_min, f_min);
                 
                 f_max = func(train, dose_unit, x_max, dose_location, target_param, 
-                            target_unit, target, target_location, fout);
+                            target_unit, target, target_location);
                             
-                if (debug==TRUE) {
-                    fprintf(fout, "rootfind_and_mod_dose: x_max = %.8f \n", x_max); 
-                    fprintf(fout, "rootfind_and_mod_dose: f(x_max) = %.8f \n", f_max);  
-                    fprintf(fout, "\n");
-                }
+                DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "x_max = %.8f, f(x_max) = %.8f", x_max, f_max);
 			}
         }
         
         min_root = find_min_nonneg(roots, max_starts); 
         
         if (min_root == DBL_MAX) {  // this statement means that no root was found
-            if (debug==TRUE) fprintf(fout,"No roots found: use x value which corresponds to function evalution closest to the root instead. \n");
+            DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "no roots found: use x value which corresponds to function evalution closest to the root instead");
             if ((fabs(f_min)) < fabs(f_max)) {
                 /* Check to make sure that the x_min is not the default value */
                 if (x_min == DBL_MAX) {  // this statement means that root was not found
-                    fprintf(fout,"Error: no root found \n");
+                    dose_log_fail(DOSE_LOG_ROOTFIND, "Error: no root found");
                     exit(EXIT_FAILURE); 
 				} 
                 
                 /* Apply minimum, non-negative root found to change the chemical dose */
                 func(train, dose_unit, x_min, dose_location, target_param, 
-                        target_unit, target, target_location, fout); 
-                if (debug==TRUE) {
-                    fprintf(fout, "rootfind_and_mod_dose: x_min = %.8f \n", x_min); 
-                    fprintf(fout, "rootfind_and_mod_dose: f(x_min) = %.8f \n", f_min);  
-                    fprintf(fout, "\n");
-                }
+                        target_unit, target, target_location); 
+                DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "x_min = %.8f, f(x_min) = %.8f", x_min, f_min);
                 
                 return x_min;
                 
             } else {
                 /* Check to make sure that the x_max is not the default value */
                 if (x_max == DBL_MAX) {  // this statement means that root was not found
-                    fprintf(fout,"Error: no root found \n");
+                    dose_log_fail(DOSE_LOG_ROOTFIND, "Error: no root found");
                     exit(EXIT_FAILURE); 
 				} 
                 
                 /* Apply minimum, non-negative root found to change the chemical dose */
                 func(train, dose_unit, x_max, dose_location, target_param, 
-                        target_unit, target, target_location, fout); 
-                if (debug==TRUE) {
-                    fprintf(fout, "rootfind_and_mod_dose: x_max = %.8f \n", x_max); 
-                    fprintf(fout, "rootfind_and_mod_dose: f(x_max) = %.8f \n", f_max);  
-                    fprintf(fout, "\n");
-                }
+                        target_unit, target, target_location); 
+                DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "x_max = %.8f, f(x_max) = %.8f", x_max, f_max);
                 
                 return x_max;
             }
@@ -306,19 +279,15 @@ double rootfind_and_mod_dose(RF_FUNC_PTR func, struct ProcessTrain *train, int d
         
         /* Apply minimum, non-negative root found to change the chemical dose */
         double f_min_root = func(train, dose_unit, min_root, dose_location, target_param, 
-                                target_unit, target, target_location, fout); 
-        if (debug==TRUE) {
-            fprintf(fout, "rootfind_and_mod_dose: minimum root = %.8f \n", min_root); 
-            fprintf(fout, "rootfind_and_mod_dose: f(x) of minimum root = %.8f \n", f_min_root);  
-            fprintf(fout, "\n");
-        }
+                                target_unit, target, target_location); 
+        DOSE_LOG(DOSE_LOG_DEBUG, DOSE_LOG_ROOTFIND, "minimum root = %.8f, f(x) of minimum root = %.8f", min_root, f_min_root);
         
         return min_root; 
     }
 }
 
 double mod_dose_check_target(struct ProcessTrain *train, int dose_unit,   double dose,   int dose_location, 
-                           char target_param, int target_unit, double target, int target_location, FILE *fout)
+                           char target_param, int target_unit, double target, int target_location)
      /* Purpose: 
      *  Modify the chemical dose at particular unit process, then calculate the difference between the unit process 
      *  effluent water quality and the target (or setpoint) value at a target unit process. 
@@ -332,8 +301,7 @@ double mod_dose_check_target(struct ProcessTrain *train, int dose_unit,   double
      *  target_location = For the case that there are multiple of the same processes in a treatment train (e.g. 
      *                    two CO2 addition points), input the location for the particular instance of the unit process
      *                    to which the setpoint refers. 0 for the first unit process, 1 for the second, 2 for the third, etc. 
-     *  fout            = Output file to store print statements (for debugging). 
-     * 
+         * 
      * Outputs: 
      *  eff - target = Difference between effluent and target water quality.
      * 
@@ -347,9 +315,6 @@ double mod_dose_check_target(struct ProcessTrain *train, int dose_unit,   double
     double eff; 
     register struct UnitProcess *unit;
     struct Effluent             *influent;
-    
-    /* Debugging: print train output */ 
-    int    debug = TRUE; 
 
     /* Set chemical dosing (supports lime, CO2, alum, and hypochlorite) */ 
     for( unit=FirstUnitProcess(train); unit; unit=NextUnitProcess(unit) )
@@ -414,19 +379,12 @@ double mod_dose_check_target(struct ProcessTrain *train, int dose_unit,   double
                         /* Get value for CO2 unit process effluent: either pH or alkalinity */
                         if (target_param == 'P'){ 
                             eff = unit->eff.pH;
-                            if (debug == TRUE) 
-                            {
-                                fprintf(fout, "mod_dose_check_target(): pH at co2 = %f \n", eff);     
-							    fprintf(fout, "mod_dose_check_target(): alk at co2 = %f \n", unit->eff.Alk * MW_CaCO3 / 2.0);
-                            }   
+                            DOSE_LOG(DOSE_LOG_TRACE, DOSE_LOG_TARGET, "dose %g: pH at co2 = %f, alk at co2 = %f", dose, eff, unit->eff.Alk * MW_CaCO3 / 2.0);
                         } else if (target_param == 'A') {
                             eff = unit->eff.Alk * MW_CaCO3 / 2.0;
-                            if (debug == TRUE) 
-                            {
-                                fprintf(fout, "mod_dose_check_target(): alk at co2 = %f \n", eff);
-                            }
+                            DOSE_LOG(DOSE_LOG_TRACE, DOSE_LOG_TARGET, "dose %g: alk at co2 = %f", dose, eff);
                         } else {
-                            fprintf(stderr, "Incorrect target parameter input for CO2! \n"); 
+                            dose_log_fail(DOSE_LOG_TARGET, "Incorrect target parameter input for CO2!");
                             exit(EXIT_FAILURE);
                         }
                     }
@@ -437,12 +395,12 @@ double mod_dose_check_target(struct ProcessTrain *train, int dose_unit,   double
               case RAPID_MIX:
                 if (target_unit == RAPID_MIX){
                     
-                    if (debug==TRUE) fprintf(fout, "pH at rapid mix = %f\n", unit->eff.pH);
+                    DOSE_LOG(DOSE_LOG_TRACE, DOSE_LOG_TARGET, "dose %g: pH at rapid mix = %f", dose, unit->eff.pH);
                     
                     /* Get value for rapid mix effluent: pH */
                     if (target_param == 'P')       eff = unit->eff.pH;
                     else {
-                        fprintf(stderr, "Incorrect target parameter input for Rapid Mix! \n"); 
+                        dose_log_fail(DOSE_LOG_TARGET, "Incorrect target parameter input for Rapid Mix!");
                         exit(EXIT_FAILURE);
                     }
                 }
@@ -453,12 +411,12 @@ double mod_dose_check_target(struct ProcessTrain *train, int dose_unit,   double
                     /* Get value for water treatment plant effluent: either pH or alkalinity */
                     if (target_param == 'P') {
                         eff = unit->eff.pH;
-                        if (debug==TRUE) fprintf(fout, "pH at effluent = %f \n", eff);
+                        DOSE_LOG(DOSE_LOG_TRACE, DOSE_LOG_TARGET, "dose %g: pH at effluent = %f", dose, eff);
                     } else if (target_param == 'A')  {
                         eff = unit->eff.Alk * MW_CaCO3 / 2.0;
-                        if (debug==TRUE) fprintf(fout, "alk at effluent = %f \n", eff);
+                        DOSE_LOG(DOSE_LOG_TRACE, DOSE_LOG_TARGET, "dose %g: alk at effluent = %f", dose, eff);
                     } else {
-                        fprintf(stderr, "Incorrect target parameter input for Effluent! \n"); 
+                        dose_log_fail(DOSE_LOG_TARGET, "Incorrect target parameter input for Effluent!");
                         exit(EXIT_FAILURE);
                     }
                 }
@@ -470,24 +428,24 @@ double mod_dose_check_target(struct ProcessTrain *train, int dose_unit,   double
                         % TOC removal, or chlorine residual */
                     if (target_param == 'P') {
                         eff = unit->eff.pH;
-                        if (debug==TRUE) fprintf(fout, "pH at EOS = %.8f \n", eff);
+                        DOSE_LOG(DOSE_LOG_TRACE, DOSE_LOG_TARGET, "dose %g: pH at EOS = %.8f", dose, eff);
                     } else if (target_param == 'A') {
                         eff = unit->eff.Alk * MW_CaCO3 / 2.0;
-                        if (debug==TRUE) fprintf(fout, "alk at EOS = %.8f \n", eff);
+                        DOSE_LOG(DOSE_LOG_TRACE, DOSE_LOG_TARGET, "dose %g: alk at EOS = %.8f", dose, eff);
                     } else if (target_param == 'T') {
                         eff = unit->eff.TTHM;
-                        if (debug==TRUE) fprintf(fout, "TTHM at EOS = %.8f \n", eff);
+                        DOSE_LOG(DOSE_LOG_TRACE, DOSE_LOG_TARGET, "dose %g: TTHM at EOS = %.8f", dose, eff);
                     } else if (target_param == 'H') {
                         eff = unit->eff.HAA5; 
-                        if (debug==TRUE) fprintf(fout, "HAA5 at EOS = %.8f \n", eff);
+                        DOSE_LOG(DOSE_LOG_TRACE, DOSE_LOG_TARGET, "dose %g: HAA5 at EOS = %.8f", dose, eff);
                     } else if (target_param == 'O') {
                         eff = ((influent->TOC - unit->eff.TOC) / influent->TOC * 100.0); 
-                        if (debug==TRUE) fprintf(fout, "TOC rmv at EOS = %.8f \n", eff);
+                        DOSE_LOG(DOSE_LOG_TRACE, DOSE_LOG_TARGET, "dose %g: TOC rmv at EOS = %.8f", dose, eff);
                     } else if (target_param == 'C') {
                         eff = unit->eff.FreeCl2 * MW_Cl2; 
-                        if (debug==TRUE) fprintf(fout, "cl2 at EOS = %.8f \n", eff);
+                        DOSE_LOG(DOSE_LOG_TRACE, DOSE_LOG_TARGET, "dose %g: cl2 at EOS = %.8f", dose, eff);
                     } else {
-                        fprintf(stderr, "Incorrect target parameter input for End of System! \n"); 
+                        dose_log_fail(DOSE_LOG_TARGET, "Incorrect target parameter input for End of System!");
                         exit(EXIT_FAILURE);
                     }
                 }
@@ -0,0 +1,107 @@
+/* client_main.cpp -- Command line client of the simulation server
+*
+*  Usage: wtp_client.exe <socket> [request ...]
+*
+*  Sends requests to a server started with "wtp-optimize.exe -r serve -s
+*  <socket>" (see serve.cpp) and prints one response line per request.
+*  Each argument is a request line; without arguments the request lines
+*  are read from stdin.  All the requests are sent before the responses
+*  are read, so the server works on them in parallel and the responses
+*  may come back in another order: match them by their <id>.
+*
+*  Example:
+*    ./wtp_client.exe /tmp/wtp.sock "1 simulate influent=CLP-2009-Q1_influent.csv alk_setpt=40 pH_setpt=7 DBPsf=0.2"
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// purpose: send all of text. Returns 0/-1 for success/fail.
+static int send_all(int fd, const std::string &text)
+{
+    size_t sent = 0;
+    ssize_t n;
+
+    while (sent < text.size())
+    {
+        if ((n = send(fd, text.data() + sent, text.size() - sent, 0)) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return (-1);
+        }
+        sent += n;
+    }
+    return (0);
+}
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_un address;
+    std::string requests;
+    char buffer[4096];
+    ssize_t n;
+    int fd, i;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <socket> [request ...]\n", argv[0]);
+        return (EXIT_FAILURE);
+    }
+    if (strlen(argv[1]) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "Error: socket path %s is too long.\n", argv[1]);
+        return (EXIT_FAILURE);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Requests */
+    for (i = 2; i < argc; i++)
+        requests += std::string(argv[i]) + "\n";
+    if (argc == 2)
+    {
+        while ((n = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0)
+            requests.append(buffer, n);
+        if (!requests.empty() && requests[requests.size() - 1] != '\n')
+            requests += "\n";
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, argv[1]);
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        fprintf(stderr, "Error: cannot connect to %s: %s\n", argv[1], strerror(errno));
+        return (EXIT_FAILURE);
+    }
+
+    /* Send every request, then read the responses until the server closes the connection */
+    if (send_all(fd, requests) < 0)
+    {
+        fprintf(stderr, "Error: cannot send the requests: %s\n", strerror(errno));
+        close(fd);
+        return (EXIT_FAILURE);
+    }
+    shutdown(fd, SHUT_WR);
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) != 0)
+    {
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "Error: cannot read the responses: %s\n", strerror(errno));
+            close(fd);
+            return (EXIT_FAILURE);
+        }
+        fwrite(buffer, 1, n, stdout);
+    }
+    close(fd);
+    return (EXIT_SUCCESS);
+}
@@ -0,0 +1,51 @@
+/* gen_main.cpp -- Command line front end of gen_wtp()
+*
+*  Usage: gen_wtp.exe <train.wtp> <function name> [output.cpp]
+*
+*  Reads a process train and writes a specialized runmodel() for it, see
+*  gen_wtp.cpp.  The output goes to stdout if no file is given.
+*/
+
+#include "wtp.h"
+
+int main(int argc, char *argv[])
+{
+    ProcessTrain *train;
+    FILE *fout = stdout;
+    int success;
+
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <train.wtp> <function name> [output.cpp]\n", argv[0]);
+        return (EXIT_FAILURE);
+    }
+
+    if ((train = AllocProcessTrain()) == NULL)
+    {
+        fprintf(stderr, "Error: cannot allocate memory for process train.\n");
+        return (EXIT_FAILURE);
+    }
+    if (open_wtp(argv[1], train, NULL) == FALSE)
+    {
+        fprintf(stderr, "Error: cannot read process train %s.\n", argv[1]);
+        FreeProcessTrain(train);
+        return (EXIT_FAILURE);
+    }
+
+    if (argc > 3 && (fout = fopen(argv[3], "w")) == NULL)
+    {
+        fprintf(stderr, "Error: cannot open %s.\n", argv[3]);
+        FreeProcessTrain(train);
+        return (EXIT_FAILURE);
+    }
+
+    success = gen_wtp(fout, train, argv[2], stderr);
+
+    if (fout != stdout && fclose(fout) != 0)
+        success = FALSE;
+    if (success == FALSE && fout != stdout)
+        remove(argv[3]);
+    FreeProcessTrain(train);
+
+    return (success == TRUE ? EXIT_SUCCESS : EXIT_FAILURE);
+}
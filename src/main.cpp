@@ -57,12 +57,22 @@ int main(int argc, char *argv[])
     int n_flag = FALSE;
     int i_flag = FALSE;
     int o_flag = FALSE;
-
-    while ((opt = getopt(argc, argv, "r:f:n:i:o:h")) != -1)
+    const char *network_filepath = NULL;  // distribution network file
+    const char *scenario_filepath = NULL; // Monte Carlo scenario store
+    const char *trace_filepath = NULL;    // trace file of per-quarter results
+    int u_flag = FALSE;                   // TRUE to trace the effluent of every unit
+    const char *manifest_filepath = NULL; // batch of influent/operations pairs
+    int num_workers = 0;                  // worker processes of batch, reevaluate and serve modes, 0 for one per processor
+    const char *archive_filepath = NULL;  // Pareto archive to re-evaluate
+    const char *socket_filepath = NULL;   // Unix domain socket of the serve mode
+    int time_limit_ms = 1000;             // time limit of the doses of a record in stream mode
+    int v_flag = FALSE;                   // TRUE if the auto_dose() log levels were given
+
+    while ((opt = getopt(argc, argv, "r:f:n:i:o:d:m:t:ub:j:a:s:l:v:h")) != -1)
     {
         switch (opt)
         {
-        case 'r': // run mode: either simulate or optimize
+        case 'r': // run mode: simulate, batch, optimize, reevaluate, serve or stream
             runmode = std::string(optarg);
             validate_optarg_runmode(runmode); // check that run mode is valid
             printf("run mode: %s\n", runmode.c_str());
@@ -75,51 +85,88 @@ int main(int argc, char *argv[])
             f_flag = TRUE;
             break;
 
-        case 'n':                             // number of influent scenarios (optimization mode only)
+        case 'n':                             // number of influent scenarios (optimization and reevaluate modes)
             validate_optarg_int(optarg, opt); // make sure input is non-zero integer
             printf("number of influent scenarios: %s\n", optarg);
             num_wq_scenarios = atoi(optarg); 
             n_flag = TRUE;
             break;
 
-        case 'i':                              // influent file (simulation mode only)
+        case 'i':                              // influent file (simulate mode), pattern of influent files (batch mode), or stream of records (stream mode)
             // validate_optarg_file(influent_filepath.c_str(), opt); // check that file exists
             printf("influent file: %s\n", optarg);
             i_flag = TRUE;
-
-            // Read influent data
-            influent_file = optarg;  // input file name
-            influent_filepath = in_dir + influent_dir + influent_file;
-            influent_data = read_single_sim(influent_filepath, true);  // read csv file with operations data
-
-            // Populate influent parameter structure
-            influent_wq = new InfluentParameters;
-            influent_wq->alkalinity = influent_data[INF_ALKALINITY];
-            influent_wq->nh3 = influent_data[INF_AMMONIA];
-            influent_wq->bromide = influent_data[INF_BROMIDE];
-            influent_wq->calcium = influent_data[INF_CALCIUM_HARDNESS];
-            influent_wq->hardness = influent_data[INF_TOTAL_HARDNESS];
-            influent_wq->pH = influent_data[INF_PH];
-            influent_wq->temp = influent_data[INF_TEMPERATURE];
-            influent_wq->toc = influent_data[INF_TOTAL_ORGANIC_CARBON];
-            influent_wq->ntu = influent_data[INF_TURBIDITY];
-            influent_wq->uv254 = influent_data[INF_UV254];
+            influent_file = optarg;  // input file name, read by the run mode
             break;
 
-        case 'o':                              // operations file (simulation mode only)
+        case 'o':                              // operations file (simulate and stream modes), or pattern of operations files (batch mode)
             // validate_optarg_file(optarg, opt); // check that file exists
             printf("operations file: %s\n", optarg);
             o_flag = TRUE;
+            operations_file = optarg;  // operations file, read by the run mode
+            break;
 
-            // Read influent data
-            operations_file = optarg;  // operations file
-            operations_filepath = in_dir + operations_dir + operations_file;
-            operations_data = read_single_sim(operations_filepath, true);  // read csv file with operations data
+        case 'd':                              // distribution network file (both run modes)
+            printf("distribution network file: %s\n", optarg);
+            network_filepath = optarg;
+            if (open_network(network_filepath, train, stderr) == FALSE)
+            {
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case 'm':                              // Monte Carlo scenario store (optimization, reevaluate and serve modes)
+            validate_optarg_file(optarg, opt); // check that file exists
+            printf("scenario store: %s\n", optarg);
+            scenario_filepath = optarg;
+            break;
+
+        case 't':                              // trace file (optimization mode only)
+            printf("trace file: %s\n", optarg);
+            trace_filepath = optarg;
+            break;
+
+        case 'u':                              // trace the effluent of every unit (with "-t")
+            u_flag = TRUE;
+            break;
+
+        case 'b':                              // manifest of influent/operations pairs (batch mode only)
+            validate_optarg_file(optarg, opt); // check that file exists
+            printf("batch manifest: %s\n", optarg);
+            manifest_filepath = optarg;
+            break;
+
+        case 'j':                             // number of worker processes (batch, reevaluate and serve modes)
+            validate_optarg_int(optarg, opt); // make sure input is non-zero integer
+            printf("number of workers: %s\n", optarg);
+            num_workers = atoi(optarg);
+            break;
+
+        case 'a':                              // Pareto archive (reevaluate mode only)
+            validate_optarg_file(optarg, opt); // check that file exists
+            printf("archive file: %s\n", optarg);
+            archive_filepath = optarg;
+            break;
 
-            operations = new OperationalParameters;
-            operations->alk_setpt = operations_data[0];
-            operations->pH_setpt = operations_data[1];
-            operations->DBPsf = operations_data[2];
+        case 's':                              // Unix domain socket (serve mode only)
+            printf("socket: %s\n", optarg);
+            socket_filepath = optarg;
+            break;
+
+        case 'l':                             // time limit of a record in milliseconds (stream mode only)
+            validate_optarg_int(optarg, opt); // make sure input is non-zero integer
+            printf("time limit (ms): %s\n", optarg);
+            time_limit_ms = atoi(optarg);
+            break;
+
+        case 'v':                              // auto_dose() log levels, may be repeated
+            if (!dose_log_parse(optarg, stderr))
+            {
+                fprintf(stderr, "For additional documentation, use \"-h\".\n");
+                exit(EXIT_FAILURE);
+            }
+            if (strncmp(optarg, "ring=", 5) != 0)
+                v_flag = TRUE;
             break;
 
         case 'h': // help
@@ -141,6 +188,32 @@ int main(int argc, char *argv[])
             exit(EXIT_FAILURE);
         }
 
+        // Read influent data
+        influent_filepath = in_dir + influent_dir + influent_file;
+        influent_data = read_single_sim(influent_filepath, influent_columns, N_SCENARIO_PARAMS);  // read csv file with influent data, in INF_ order
+
+        // Populate influent parameter structure
+        influent_wq = new InfluentParameters;
+        influent_wq->alkalinity = influent_data[INF_ALKALINITY];
+        influent_wq->nh3 = influent_data[INF_AMMONIA];
+        influent_wq->bromide = influent_data[INF_BROMIDE];
+        influent_wq->calcium = influent_data[INF_CALCIUM_HARDNESS];
+        influent_wq->hardness = influent_data[INF_TOTAL_HARDNESS];
+        influent_wq->pH = influent_data[INF_PH];
+        influent_wq->temp = influent_data[INF_TEMPERATURE];
+        influent_wq->toc = influent_data[INF_TOTAL_ORGANIC_CARBON];
+        influent_wq->ntu = influent_data[INF_TURBIDITY];
+        influent_wq->uv254 = influent_data[INF_UV254];
+
+        // Read operations data
+        operations_filepath = in_dir + operations_dir + operations_file;
+        operations_data = read_single_sim(operations_filepath, operations_columns, N_OPERATIONS_COLS);  // read csv file with operations data
+
+        operations = new OperationalParameters;
+        operations->alk_setpt = operations_data[ALKALINITY_SETPT];
+        operations->pH_setpt = operations_data[PH_SETPT];
+        operations->DBPsf = operations_data[DBP_SAFETY_FACTOR];
+
         /* Record command line arguments (i.e., run configuration) */
         std::string cli_dir; // command line interface directory
         std::string cli_ext; // command line interface extension
@@ -155,6 +228,10 @@ int main(int argc, char *argv[])
         std::string copy_ext = ".wtp";
         std::string copy_filepath = copy_dir + current_datetime + copy_ext;
         copy_file(wtp_filepath, copy_filepath);
+        if (network_filepath != NULL)
+        {
+            copy_file(network_filepath, copy_dir + current_datetime + ".net");
+        }
 
         /* Define output file for simulation results */
         std::string result_dir; // result directory
@@ -171,6 +248,22 @@ int main(int argc, char *argv[])
             exit(EXIT_FAILURE);
         }
 
+        /* Log every message of auto_dose() unless other levels were given with "-v" */
+        std::string filepath_log = "./out/single_sim/log/" + current_datetime + ".log";
+
+        FILE *flog = fopen(filepath_log.c_str(), "w");
+
+        if (!flog)
+        { /* Error handling */
+            printf("Error opening %s \n, check that the proper directory and file name has been specified.\n", filepath_log.c_str());
+            exit(EXIT_FAILURE);
+        }
+        dose_log_config.fp = flog;
+        if (v_flag == FALSE)
+        {
+            dose_log_parse("trace", stderr);
+        }
+
         std::cout << "Single simulation with automatic chemical dosing" << std::endl;
 
         /* Call single simulation with automatic dosing */
@@ -178,11 +271,64 @@ int main(int argc, char *argv[])
         single_sim_mode(train, operations, influent_wq, fres); // TODO: call single_sim() instead for continuity
 
         fclose(fres); // close file stream
+        print_memo_stats(flog, &train->ctx); // hit rates of the unit kernel memos, to the log file
+        dose_log_config.fp = NULL;
+        fclose(flog);
 
         // Free dynamically allocated memory
         delete operations;
         delete influent_wq;
     }
+    else if (runmode.compare("batch") == 0)  // batch simulate mode
+    {
+        // Validate batch parameters
+        if ((manifest_filepath == NULL) && ((i_flag == FALSE) || (o_flag == FALSE)))
+        {
+            fprintf(stderr, "Error: either a manifest file (\"-b\") or influent and operations file patterns (\"-i\" and \"-o\") must be specified.\nFor additional documentation, use \"-h\".\n");
+            exit(EXIT_FAILURE);
+        }
+
+        /* Record command line arguments */
+        std::string cli_dir = "./out/batch/cli_args/"; // command line interface directory
+        std::string filepath_cli_args = cli_dir + current_datetime + ".cli";
+
+        save_cli_args(filepath_cli_args, argc, argv);
+
+        /* Copy .wtp file used for the batch */
+        std::string copy_dir = "./out/batch/wtp_train/";
+        std::string copy_filepath = copy_dir + current_datetime + ".wtp";
+        copy_file(wtp_filepath, copy_filepath);
+
+        /* Define output file for batch results */
+        std::string filepath_result = "./out/batch/result/" + current_datetime + ".csv";
+
+        FILE *fres = fopen(filepath_result.c_str(), "w"); // open file stream
+
+        if (!fres)
+        { /* Error handling */
+            printf("Error opening %s \n, check that the proper directory and file name has been specified.\n", filepath_result.c_str());
+            exit(EXIT_FAILURE);
+        }
+
+        std::cout << "Batch simulation with automatic chemical dosing" << std::endl;
+
+        std::string batch_influent_dir = in_dir + influent_dir;
+        std::string batch_operations_dir = in_dir + operations_dir;
+        struct BatchParameters batch_params;
+        batch_params.manifest_filename = manifest_filepath;
+        batch_params.influent_pattern = influent_file.c_str();
+        batch_params.operations_pattern = operations_file.c_str();
+        batch_params.influent_dir = batch_influent_dir.c_str();
+        batch_params.operations_dir = batch_operations_dir.c_str();
+        batch_params.n_workers = num_workers;
+
+        int n_failed = batch_sim_mode(train, &batch_params, fres);
+
+        if (fclose(fres) != 0 || n_failed < 0)
+        {
+            exit(EXIT_FAILURE);
+        }
+    }
     else if (runmode.compare("optimize") == 0)  // optimize mode
     {
         // Validate optimize parameters
@@ -206,10 +352,22 @@ int main(int argc, char *argv[])
         std::string copy_ext = ".wtp";
         std::string copy_filepath = copy_dir + current_datetime + copy_ext;
         copy_file(wtp_filepath, copy_filepath);
+        if (network_filepath != NULL)
+        {
+            copy_file(network_filepath, copy_dir + current_datetime + ".net");
+        }
 
         // Optimize water treatment
         simopt_params.num_func_evals = num_func_evals;
         simopt_params.num_wq_scenarios = num_wq_scenarios;
+        simopt_params.network_filename = network_filepath;
+        simopt_params.scenario_filename = scenario_filepath;
+        simopt_params.trace_units = u_flag;
+        if (trace_filepath != NULL &&
+            (simopt_params.trace = open_trace(trace_filepath, wtp_trace_columns(train, u_flag), stderr)) == NULL)
+        {
+            exit(EXIT_FAILURE);
+        }
 
         // /* Define Monte Carlo parameters for influent water quality data */
         // params.mc.mc_flag = true;
@@ -226,6 +384,140 @@ int main(int argc, char *argv[])
 
         std::cout << "Simulation-optimization mode\n";
         sim_opt_mode(train);
+
+        if (close_trace(simopt_params.trace, stderr) == FALSE)
+        {
+            exit(EXIT_FAILURE);
+        }
+        simopt_params.trace = NULL;
+    }
+
+    else if (runmode.compare("reevaluate") == 0)  // reevaluate mode
+    {
+        // Validate reevaluate parameters
+        if ((archive_filepath == NULL) || (n_flag == FALSE))
+        {
+            fprintf(stderr, "Error: both the archive file and number of influent scenarios must be specified using the \"-a\" and \"-n\" flags.\nFor additional documentation, use \"-h\".\n");
+            exit(EXIT_FAILURE);
+        }
+
+        /* Record command line arguments */
+        std::string filepath_cli_args = "./out/reevaluate/cli_args/" + current_datetime + ".cli";
+
+        save_cli_args(filepath_cli_args, argc, argv);
+
+        /* Copy .wtp file and archive used for the re-evaluation */
+        std::string copy_dir = "./out/reevaluate/wtp_train/";
+        copy_file(wtp_filepath, copy_dir + current_datetime + ".wtp");
+        copy_file(archive_filepath, copy_dir + current_datetime + ".archive");
+        if (network_filepath != NULL)
+        {
+            copy_file(network_filepath, copy_dir + current_datetime + ".net");
+        }
+
+        /* Define output file for the re-evaluated archive */
+        std::string filepath_result = "./out/reevaluate/result/" + current_datetime + ".result";
+
+        FILE *fres = fopen(filepath_result.c_str(), "w"); // open file stream
+
+        if (!fres)
+        { /* Error handling */
+            printf("Error opening %s \n, check that the proper directory and file name has been specified.\n", filepath_result.c_str());
+            exit(EXIT_FAILURE);
+        }
+
+        simopt_params.num_wq_scenarios = num_wq_scenarios;
+        simopt_params.network_filename = network_filepath;
+        simopt_params.scenario_filename = scenario_filepath;
+
+        std::cout << "Re-evaluation mode\n";
+        int n_failed = reevaluate_mode(archive_filepath, num_workers, fres);
+
+        if (fclose(fres) != 0 || n_failed < 0)
+        {
+            exit(EXIT_FAILURE);
+        }
+        std::cout << "Complete! Check output file " << filepath_result << " for results." << std::endl;
+    }
+
+    else if (runmode.compare("serve") == 0)  // serve mode
+    {
+        // Validate serve parameters
+        if (socket_filepath == NULL)
+        {
+            fprintf(stderr, "Error: the socket must be specified using the \"-s\" flag.\nFor additional documentation, use \"-h\".\n");
+            exit(EXIT_FAILURE);
+        }
+
+        /* Requests name files of the input directories */
+        std::string serve_influent_dir = in_dir + influent_dir;
+        std::string serve_operations_dir = in_dir + operations_dir;
+        struct ServeParameters serve_params;
+        serve_params.socket_filename = socket_filepath;
+        serve_params.influent_dir = serve_influent_dir.c_str();
+        serve_params.operations_dir = serve_operations_dir.c_str();
+        serve_params.scenario_filename = scenario_filepath;
+        serve_params.n_workers = num_workers;
+
+        std::cout << "Serve mode\n";
+        if (serve_mode(train, &serve_params) == FALSE)
+        {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    else if (runmode.compare("stream") == 0)  // stream mode
+    {
+        struct StreamParameters stream_params;
+        stream_params.stream_filename = (i_flag == FALSE || influent_file == "-") ? NULL : influent_file.c_str();
+        stream_params.timeout_ms = time_limit_ms;
+        for (int p = 0; p < N_OPERATIONS_COLS; p++)
+        {
+            stream_params.setpoints[p] = NAN; // from the records
+        }
+
+        // Read operations data, the set points of the records without them
+        if (o_flag == TRUE)
+        {
+            operations_filepath = in_dir + operations_dir + operations_file;
+            operations_data = read_single_sim(operations_filepath, operations_columns, N_OPERATIONS_COLS);
+            for (int p = 0; p < N_OPERATIONS_COLS; p++)
+            {
+                stream_params.setpoints[p] = operations_data[p];
+            }
+        }
+
+        /* Record command line arguments */
+        std::string filepath_cli_args = "./out/stream/cli_args/" + current_datetime + ".cli";
+
+        save_cli_args(filepath_cli_args, argc, argv);
+
+        /* Copy .wtp file used for the stream */
+        std::string copy_dir = "./out/stream/wtp_train/";
+        copy_file(wtp_filepath, copy_dir + current_datetime + ".wtp");
+        if (network_filepath != NULL)
+        {
+            copy_file(network_filepath, copy_dir + current_datetime + ".net");
+        }
+
+        /* Define output file for the doses of the records */
+        std::string filepath_result = "./out/stream/result/" + current_datetime + ".csv";
+
+        FILE *fres = fopen(filepath_result.c_str(), "w"); // open file stream
+
+        if (!fres)
+        { /* Error handling */
+            printf("Error opening %s \n, check that the proper directory and file name has been specified.\n", filepath_result.c_str());
+            exit(EXIT_FAILURE);
+        }
+
+        std::cout << "Streaming dosing mode, writing " << filepath_result << std::endl;
+        int n_failed = stream_mode(train, &stream_params, fres);
+
+        if (fclose(fres) != 0 || n_failed < 0)
+        {
+            exit(EXIT_FAILURE);
+        }
     }
 
     /* Free memory */
@@ -238,16 +530,17 @@ int main(int argc, char *argv[])
 }
 
 /* Validation functions */
-// purpose: validate run mode command line argument is either "simulate" or "optimize" (optimize)
+// purpose: validate run mode command line argument is "simulate", "batch", "optimize", "reevaluate", "serve" or "stream"
 void validate_optarg_runmode(std::string runmode)
 {
-    if ((runmode.compare("simulate") == 0) || (runmode.compare("optimize") == 0))
+    if ((runmode.compare("simulate") == 0) || (runmode.compare("batch") == 0) || (runmode.compare("optimize") == 0) ||
+        (runmode.compare("reevaluate") == 0) || (runmode.compare("serve") == 0) || (runmode.compare("stream") == 0))
     {
-        // If true, then entered run mode is either "simulate" or "optimize". Do nothing.
+        // If true, then entered run mode is "simulate", "batch", "optimize", "reevaluate", "serve" or "stream". Do nothing.
     }
     else
     { // If false, an invalid run mode has been entered.
-        fprintf(stderr, "Error: \"simulate\" and \"optimize\" are the only valid run mode options\n");
+        fprintf(stderr, "Error: \"simulate\", \"batch\", \"optimize\", \"reevaluate\", \"serve\" and \"stream\" are the only valid run mode options\n");
         exit(EXIT_FAILURE);
     }
     return;
@@ -287,18 +580,40 @@ void validate_optarg_file(const char *optarg, char opt)
 void display_usage_help()
 {
     printf("\nCommand line arguments available for wtp-optimize:\n");
-    printf("-r (run mode): enter either \"simulate\" or \"optimize\"\n");
+    printf("-r (run mode): enter \"simulate\", \"batch\", \"optimize\", \"reevaluate\", \"serve\" or \"stream\"\n");
     printf("-f (function evalutions): enter a non-zero integer [optimization mode only]\n");
-    printf("-n (number of influent scenarios): enter a non-zero integer [optimization mode only]\n");
-    printf("-i (influent file): enter relative path to influent directory [simulate mode only]\n");
-    printf("-o (operations file): enter relative path to operations directory [simulate mode only]\n");
+    printf("-n (number of influent scenarios): enter a non-zero integer [optimization and reevaluate modes]\n");
+    printf("-i (influent file): enter relative path to influent directory [simulate mode], or a pattern such as \"CLP-*\" [batch mode], or path of a file or FIFO of influent records, stdin if absent or \"-\" [stream mode]\n");
+    printf("-o (operations file): enter relative path to operations directory [simulate mode], or a pattern such as \"CLP-Q1_*\" [batch mode], or of the set points of the records without them [stream mode]\n");
+    printf("-b (batch manifest): enter path to a file of \"influent file,operations file\" lines, in place of \"-i\" and \"-o\" [batch mode only]\n");
+    printf("-j (workers): enter the number of worker processes, by default the number of processors [batch, reevaluate and serve modes]\n");
+    printf("-a (archive file): enter path to a Pareto archive written by the optimize mode [reevaluate mode only]\n");
+    printf("-s (socket): enter path of the Unix domain socket to answer requests on, see wtp_client.exe [serve mode only]\n");
+    printf("-l (time limit): enter the milliseconds allowed to dose a record, 1000 by default [stream mode only]\n");
+    printf("-d (distribution network file): enter path to a file of sampling nodes [optional]\n");
+    printf("-m (scenario store): enter path to a Monte Carlo scenario store written by scenario_store.exe [optimization, reevaluate and serve modes, optional]\n");
+    printf("-t (trace file): enter path of a trace file for the results of every scenario and quarter, read with trace_reader.exe [optimization mode only, optional]\n");
+    printf("-u (unit trace): add the effluent of every unit to the trace file [optimization mode only, optional]\n");
+    printf("-v (log levels): enter \"off\", \"error\", \"warn\", \"info\", \"debug\" or \"trace\" for the messages of auto_dose(), optionally for some components as in \"debug:rootfind,target\" (components autodose, rootfind and target), or \"ring=<level>\" for the messages kept to print when a solve fails, \"debug\" by default; may be repeated. Messages go to the log file at level trace by default [simulate mode], or to stderr at level error by default [other modes] [optional]\n");
     printf("-h (help): display command line arguments documentation\n");
     printf("\n");
     printf("Simulation example (if executable is in the binary directory):\n");
     printf("./bin/wtp-optimize.exe -r simulate -i ./in/influent.txt -o ./in/operations.txt\n");
     printf("\n");
+    printf("Batch example, every influent file with every operations file (if executable is in the binary directory):\n");
+    printf("./bin/wtp-optimize.exe -r batch -i \"*.csv\" -o \"*.csv\" -j 4\n");
+    printf("\n");
     printf("Optimization example (if executable is in the binary directory):\n");
     printf("./bin/wtp-optimize.exe -r optimize -f 10000 -n 100\n");
+    printf("\n");
+    printf("Re-evaluation example, the archive of an optimization over 1000 scenarios (if executable is in the binary directory):\n");
+    printf("./bin/wtp-optimize.exe -r reevaluate -a ./out/sim_opt/result/<date>.result -n 1000 -m ./in/monte_carlo/scenarios.bin\n");
+    printf("\n");
+    printf("Server example, answering requests such as \"1 simulate influent=CLP-2009-Q1_influent.csv operations=CLP-Q1_cluster-1_operations.csv\" sent with wtp_client.exe (if executable is in the binary directory):\n");
+    printf("./bin/wtp-optimize.exe -r serve -s /tmp/wtp.sock -j 4 -m ./in/monte_carlo/scenarios.bin\n");
+    printf("\n");
+    printf("Streaming example, replaying historic influent records (if executable is in the binary directory):\n");
+    printf("./bin/wtp-optimize.exe -r stream -i ./in/stream/CLP-influent-history.csv -o CLP-Q1_cluster-1_operations.csv -l 500\n");
     return;
 }
 
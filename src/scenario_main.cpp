@@ -0,0 +1,39 @@
+/* scenario_main.cpp -- Command line front end of write_scenario_store()
+*
+*  Usage: scenario_store.exe <influent.csv> <store.bin> [nsims]
+*
+*  Converts a Monte Carlo influent CSV file into a scenario store for the
+*  "-m" option of wtp-optimize.exe, see scenario_store.cpp.  All complete
+*  simulations of the file are converted unless nsims is given.  The
+*  store is checked by mapping it back.
+*/
+
+#include "wtp_optimize.h"
+
+int main(int argc, char *argv[])
+{
+    struct ScenarioStore *store;
+    int nsims = 0;
+
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <influent.csv> <store.bin> [nsims]\n", argv[0]);
+        return (EXIT_FAILURE);
+    }
+    if (argc > 3 && (nsims = atoi(argv[3])) <= 0)
+    {
+        fprintf(stderr, "Error: nsims must be a positive integer.\n");
+        return (EXIT_FAILURE);
+    }
+
+    if (write_scenario_store(argv[1], argv[2], nsims, stderr) == FALSE)
+        return (EXIT_FAILURE);
+    if ((store = open_scenario_store(argv[2], stderr)) == NULL)
+        return (EXIT_FAILURE);
+
+    printf("%s: %d simulations of %d years x %d quarters, %d parameters\n",
+           argv[2], store->n_sims, N_YEARS, N_QUARTERS_PER_YEAR, N_SCENARIO_PARAMS);
+    close_scenario_store(store);
+
+    return (EXIT_SUCCESS);
+}
@@ -0,0 +1,69 @@
+/* snap_main.cpp -- Command line converter between .wtp files and snapshots
+*
+*  Usage: wtp_snapshot.exe [-s] <input> <output>
+*
+*  Reads a process train from a text .wtp file or a binary snapshot and
+*  writes it in the other format: a snapshot for a .wtp file (see
+*  save_snapshot()), a .wtp file for a snapshot (see save_wtp()).  With
+*  -s the train is run once with runmodel() and the snapshot also holds
+*  the effluent of every unit and the model context, for inspecting the
+*  state of a run.  Converting a .wtp file to a snapshot and back gives
+*  the same file.
+*/
+
+#include "wtp.h"
+
+int main(int argc, char *argv[])
+{
+    ProcessTrain *train;
+    FILE *fp;
+    char magic[8];
+    int state = FALSE, binary, success;
+
+    if (argc > 1 && strcmp(argv[1], "-s") == 0)
+    {
+        state = TRUE;
+        argc--;
+        argv++;
+    }
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: wtp_snapshot.exe [-s] <input> <output>\n");
+        return (EXIT_FAILURE);
+    }
+
+    if ((fp = fopen(argv[1], "rb")) == NULL)
+    {
+        fprintf(stderr, "Error: cannot open %s.\n", argv[1]);
+        return (EXIT_FAILURE);
+    }
+    binary = (fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+              memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0);
+    fclose(fp);
+
+    if ((train = AllocProcessTrain()) == NULL)
+    {
+        fprintf(stderr, "Error: cannot allocate memory for process train.\n");
+        return (EXIT_FAILURE);
+    }
+    if (open_wtp(argv[1], train, NULL) == FALSE)
+    {
+        fprintf(stderr, "Error: cannot read process train %s.\n", argv[1]);
+        FreeProcessTrain(train);
+        return (EXIT_FAILURE);
+    }
+
+    if (binary)
+        success = save_wtp(argv[2], train, stderr);
+    else if (state == TRUE && runmodel(train) == FALSE)
+    {
+        fprintf(stderr, "Error: cannot run process train %s.\n", argv[1]);
+        success = FALSE;
+    }
+    else
+        success = save_snapshot(argv[2], train, state, stderr);
+
+    FreeProcessTrain(train);
+
+    return (success == TRUE ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,138 @@
+/* test_cascade.cpp -- The CFSTR cascades give the results of the stepwise loops
+*
+*  cl2decay_cascade() and clo2_cascade() run the chlorine and chlorine
+*  dioxide decay of a unit process through its CFSTRs in series in one
+*  pass.  They replaced loops that called new_cl2decay() or clo2_decay()
+*  once per CFSTR.  This test runs those loops (cl2decay_stepwise() and
+*  clo2_stepwise() below, as basn_dbp() had them) and the cascades from
+*  the same water on two clones of conv.wtp, over a grid of residuals,
+*  ammonia, doses, 1 to 25 CFSTRs, and CFSTR times from seconds to days,
+*  with the raw and the coagulated water equations.  The effluents, hours,
+*  and ClO2 sums must agree within CASCADE_TOLERANCE (relative).
+*
+*  Usage: test_cascade.exe [repository directory]
+*/
+
+#include "test_wtp.h"
+
+#define CASCADE_TOLERANCE 1e-12
+
+// purpose: the old chlorine cascade, new_cl2decay() once per CFSTR
+static void cl2decay_stepwise(struct UnitProcess *unit, int ncstrs, double cfstr_time)
+{
+  int i;
+
+  for (i = 1; i <= ncstrs; i++)
+  {
+    new_cl2decay(unit, cfstr_time);
+    if ((unit->eff.FreeCl2 + unit->eff.NH2Cl) > 0.0)
+      unit->eff.hours += cfstr_time;
+  }
+}
+
+// purpose: the old ClO2 cascade, clo2_decay() once per CFSTR. Returns the sum of the residuals.
+static double clo2_stepwise(struct UnitProcess *unit, int ncstrs, double cfstr_time)
+{
+  double sum = 0.0;
+  int i;
+
+  for (i = 1; i <= ncstrs; i++)
+  {
+    clo2_decay(unit, cfstr_time);
+    sum += unit->eff.clo2_res;
+    unit->eff.clo2_minutes += cfstr_time;
+  }
+  return (sum);
+}
+
+// purpose: last unit process of a train
+static struct UnitProcess *last_unit(struct ProcessTrain *train)
+{
+  struct UnitProcess *unit, *last = NULL;
+
+  for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit))
+    last = unit;
+  return (last);
+}
+
+// purpose: set the water of the last unit of a train and the DBP equations to use
+static void set_water(struct ProcessTrain *train, int raw, double free_cl2, double nh3, double nh2cl,
+                      double clo2, double clo2dose, double clo2_minutes)
+{
+  struct UnitProcess *unit = last_unit(train);
+
+  unit->eff.ctx->swflag = TRUE;
+  unit->eff.ctx->rwdbpflag = raw;
+  unit->eff.ctx->owdbpflag = FALSE;
+  unit->eff.FreeCl2 = free_cl2 / MW_Cl2; /* mg/L as Cl2 */
+  unit->eff.NH3 = nh3 / MW_NH3;          /* mg/L as N   */
+  unit->eff.NH2Cl = nh2cl / MW_Cl2;      /* mg/L as Cl2 */
+  unit->eff.NHCl2 = 0.0;
+  unit->eff.cl2dose = free_cl2 + nh2cl;
+  unit->eff.hours = 0.5;
+  unit->eff.clo2_res = clo2;
+  unit->eff.clo2dose = clo2dose;
+  unit->eff.clo2_minutes = clo2_minutes;
+}
+
+int main(int argc, char *argv[])
+{
+  double free_cl2[] = {0.0, 0.3, 1.5, 4.0};  /* mg/L as Cl2  */
+  double nh3[] = {0.0, 0.2, 1.0};            /* mg/L as N    */
+  double nh2cl[] = {0.0, 1.0, 3.0};          /* mg/L as Cl2  */
+  double hours[] = {0.002, 0.05, 0.5, 4.0, 48.0, 500.0};
+  double clo2[][3] = {{0.0, 1.0, 0.0}, {0.8, 1.0, 0.0}, {2.5, 3.0, 0.0}, {2.5, 3.0, 30.0}};
+  int ncstrs[] = {1, 2, 7, 25};
+  struct ProcessTrain *base, *a, *b;
+  double sum_a, sum_b, worst = 0.0, d;
+  int raw, f, n, m, h, c, k, runs = 0;
+  char name[128];
+
+  if (argc > 1)
+    test_root = argv[1];
+
+  base = test_train("in/wtp_train/conv.wtp");
+  check(runmodel(base) == TRUE, "conv.wtp: runmodel() failed");
+
+  for (raw = 0; raw < 2; raw++)
+    for (f = 0; f < 4; f++)
+      for (n = 0; n < 3; n++)
+        for (m = 0; m < 3; m++)
+          for (c = 0; c < 4; c++)
+            for (k = 0; k < 4; k++)
+              for (h = 0; h < 6; h++)
+              {
+                snprintf(name, sizeof(name), "raw %d Cl2 %g NH3 %g NH2Cl %g ClO2 %g/%g/%g, %d x %g h", raw,
+                         free_cl2[f], nh3[n], nh2cl[m], clo2[c][0], clo2[c][1], clo2[c][2], ncstrs[k], hours[h]);
+                a = clone_train(base);
+                b = clone_train(base);
+                set_water(a, raw, free_cl2[f], nh3[n], nh2cl[m], clo2[c][0], clo2[c][1], clo2[c][2]);
+                set_water(b, raw, free_cl2[f], nh3[n], nh2cl[m], clo2[c][0], clo2[c][1], clo2[c][2]);
+
+                /* Chlorine: the CFSTR time in hours */
+                cl2decay_stepwise(last_unit(a), ncstrs[k], hours[h]);
+                cl2decay_cascade(last_unit(b), ncstrs[k], hours[h]);
+
+                /* ClO2: the CFSTR time in minutes */
+                sum_a = clo2_stepwise(last_unit(a), ncstrs[k], hours[h] * 60.0);
+                sum_b = clo2_cascade(last_unit(b), ncstrs[k], hours[h] * 60.0);
+
+                if ((d = compare_effluents(a, b, CASCADE_TOLERANCE, name)) > worst)
+                  worst = d;
+                d = rel_diff(sum_a, sum_b);
+                if (d > worst)
+                  worst = d;
+                check(d <= CASCADE_TOLERANCE, "%s: ClO2 sum %.17g != %.17g", name, sum_a, sum_b);
+                check(rel_diff(last_unit(a)->eff.clo2_res, last_unit(b)->eff.clo2_res) <= CASCADE_TOLERANCE &&
+                          last_unit(a)->eff.clo2_minutes == last_unit(b)->eff.clo2_minutes,
+                      "%s: ClO2 %.17g != %.17g", name, last_unit(a)->eff.clo2_res, last_unit(b)->eff.clo2_res);
+                FreeProcessTrain(a);
+                FreeProcessTrain(b);
+                runs++;
+              }
+
+  FreeProcessTrain(base);
+  printf("test_cascade: %d cascades, largest relative difference %.3g (tolerance %.3g)\n", runs, worst,
+         CASCADE_TOLERANCE);
+  return (test_report("test_cascade"));
+}
@@ -0,0 +1,164 @@
+/* test_gen.cpp -- The runmodel() written by gen_wtp() gives the results of run_plan()
+*
+*  For every process train of in/wtp_train, bin/makefile generates its
+*  evaluator with gen_wtp.exe (runmodel_<train>(), see gen_wtp.cpp) and
+*  links it into this test; GEN_TRAINS lists them as X(<train>).  Every
+*  train is run with every influent file of in/single_sim/influent, once
+*  interpreted by run_plan() and once by its generated evaluator:
+*    - with the doses of the .wtp file (runmodel()),
+*    - dosed by auto_dose() with every CLP operations file, which runs the
+*      train many times with changing doses.
+*  The effluent of every unit and the doses must agree within
+*  GEN_TOLERANCE (relative).
+*
+*  Usage: test_gen.exe [repository directory]
+*/
+
+#include "test_wtp.h"
+#include "auto_dose.h"
+#include <dirent.h>
+#include <vector>
+
+#define GEN_TOLERANCE 1e-12
+
+#ifndef GEN_TRAINS
+#error GEN_TRAINS lists the generated evaluators, see the test_gen.exe rule of bin/makefile
+#endif
+
+#define X(t) int runmodel_##t(struct ProcessTrain *train);
+GEN_TRAINS
+#undef X
+
+struct GeneratedTrain
+{
+  const char *name;                             /* in/wtp_train/<name>.wtp */
+  int (*evaluator)(struct ProcessTrain *train); /* runmodel_<name>()      */
+};
+
+static const struct GeneratedTrain generated[] = {
+#define X(t) {#t, runmodel_##t},
+    GEN_TRAINS
+#undef X
+};
+
+// purpose: sorted names of the files of a directory of the repository ending with suffix
+static std::vector<std::string> list_files(const char *dir, const char *suffix)
+{
+  std::vector<std::string> names;
+  struct dirent *entry;
+  size_t n = strlen(suffix), i, j;
+  DIR *d;
+
+  if ((d = opendir(test_path(dir).c_str())) == NULL)
+    return (names);
+  while ((entry = readdir(d)) != NULL)
+  {
+    std::string name = entry->d_name;
+    if (name.size() > n && name.compare(name.size() - n, n, suffix) == 0)
+      names.push_back(name);
+  }
+  closedir(d);
+  for (i = 1; i < names.size(); i++) /* insertion sort, a dozen names */
+    for (j = i; j > 0 && names[j] < names[j - 1]; j--)
+      names[j].swap(names[j - 1]);
+  return (names);
+}
+
+// purpose: check that the chemical doses of two trains agree within GEN_TOLERANCE
+static double compare_doses(struct ProcessTrain *a, struct ProcessTrain *b, const char *what)
+{
+  struct UnitProcess *ua, *ub;
+  double da, db, d, worst = 0.0;
+  int i;
+
+  for (ua = FirstUnitProcess(a), ub = FirstUnitProcess(b), i = 0; ua && ub;
+       ua = NextUnitProcess(ua), ub = NextUnitProcess(ub), i++)
+  {
+    if (ua->type == LIME)
+      da = ua->data.lime->dose, db = ub->data.lime->dose;
+    else if (ua->type == CARBON_DIOXIDE)
+      da = ua->data.chemical->co2, db = ub->data.chemical->co2;
+    else if (ua->type == ALUM)
+      da = ua->data.alum->dose, db = ub->data.alum->dose;
+    else if (ua->type == HYPOCHLORITE)
+      da = ua->data.chemical->naocl, db = ub->data.chemical->naocl;
+    else
+      continue;
+    d = rel_diff(da, db);
+    if (d > worst)
+      worst = d;
+    check(d <= GEN_TOLERANCE, "%s: unit %d dose %.17g != %.17g", what, i, da, db);
+  }
+  return (worst);
+}
+
+int main(int argc, char *argv[])
+{
+  static const char *const operations_columns[] = {"alk_setpt", "pH_setpt", "DBPsf"};
+  std::vector<std::string> influents, operations;
+  struct ProcessTrain *interpreted, *compiled;
+  double o[3], d, worst = 0.0;
+  std::string wtp, name;
+  size_t g, i, k;
+  int runs = 0;
+
+  if (argc > 1)
+    test_root = argv[1];
+
+  influents = list_files("in/single_sim/influent", "_influent.csv");
+  operations = list_files("in/single_sim/operations", "_operations.csv");
+  check(influents.size() > 0 && operations.size() > 0, "no influent or operations files");
+  check(list_files("in/wtp_train", ".wtp").size() == sizeof(generated) / sizeof(generated[0]),
+        "in/wtp_train has a train without a generated evaluator");
+
+  for (g = 0; g < sizeof(generated) / sizeof(generated[0]); g++)
+  {
+    wtp = std::string("in/wtp_train/") + generated[g].name + ".wtp";
+    for (i = 0; i < influents.size(); i++)
+    {
+      std::string influent = "in/single_sim/influent/" + influents[i];
+
+      /* The doses of the .wtp file */
+      interpreted = test_train(wtp.c_str());
+      compiled = test_train(wtp.c_str());
+      compiled->evaluator = generated[g].evaluator;
+      check(test_set_influent(interpreted, influent.c_str()) && test_set_influent(compiled, influent.c_str()),
+            "cannot read %s", influent.c_str());
+      check(runmodel(interpreted) == TRUE && runmodel(compiled) == TRUE, "%s: runmodel() failed", influent.c_str());
+      name = generated[g].name + (" " + influents[i]);
+      if ((d = compare_effluents(interpreted, compiled, GEN_TOLERANCE, name.c_str())) > worst)
+        worst = d;
+      runs++;
+
+      /* Dosed with every CLP operations file, starting from the same trains */
+      for (k = 0; k < operations.size(); k++)
+      {
+        std::string file = "in/single_sim/operations/" + operations[k];
+        struct ProcessTrain *a, *b;
+
+        if (operations[k].compare(0, 4, "CLP-") != 0)
+          continue; /* the other set points are not met by every influent */
+        if (!check(test_read_row(file.c_str(), operations_columns, 3, o), "cannot read %s", file.c_str()))
+          continue;
+        a = clone_train(interpreted);
+        b = clone_train(compiled);
+        auto_dose(a, o[1], o[0], 0.2, 8.0, o[2], NULL);
+        auto_dose(b, o[1], o[0], 0.2, 8.0, o[2], NULL);
+        name = generated[g].name + (" " + influents[i]) + " " + operations[k];
+        if ((d = compare_doses(a, b, name.c_str())) > worst)
+          worst = d;
+        if ((d = compare_effluents(a, b, GEN_TOLERANCE, name.c_str())) > worst)
+          worst = d;
+        runs++;
+        FreeProcessTrain(a);
+        FreeProcessTrain(b);
+      }
+      FreeProcessTrain(interpreted);
+      FreeProcessTrain(compiled);
+    }
+  }
+
+  printf("test_gen: %d runs of %d generated trains, largest relative difference %.3g (tolerance %.3g)\n",
+         runs, (int)(sizeof(generated) / sizeof(generated[0])), worst, GEN_TOLERANCE);
+  return (test_report("test_gen"));
+}
@@ -0,0 +1,130 @@
+/* test_lanes.cpp -- runmodel_lanes() gives the results of runmodel()
+*
+*  Runs a grid of influents (temperature, pH, TOC; with and without lime
+*  softening) and every influent file of in/single_sim/influent through
+*  runmodel_lanes() and through runmodel() on clones of the same trains,
+*  and checks that the effluent of every unit is bit-identical.  The
+*  batch sizes are not multiples of WTP_LANES, so partial batches are
+*  covered too.
+*
+*  Usage: test_lanes.exe [repository directory]
+*/
+
+#include "test_wtp.h"
+#include <time.h>
+#include <vector>
+
+static const char *influent_files[] = {
+    "2019-03-04", "CLP-2009-Q1", "CLP-2009-Q2", "CLP-2009-Q3", "CLP-2009-Q4", "CLP-2014-Q1", "CLP-2014-Q2",
+    "CLP-2014-Q3", "CLP-2014-Q4", "CLP-9999-Q1", "CLP-9999-Q2", "CLP-9999-Q3", "CLP-9999-Q4"};
+
+// purpose: seconds of CPU time
+static double cpu_seconds()
+{
+  return ((double)clock() / CLOCKS_PER_SEC);
+}
+
+// purpose: set the influent and doses of a grid point of conv.wtp
+static void set_grid_point(struct ProcessTrain *train, double temp, double pH, double toc, int soft)
+{
+  struct UnitProcess *unit;
+
+  for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit))
+  {
+    if (unit->type == INFLUENT)
+    {
+      unit->data.influent->temp = temp;
+      unit->data.influent->pH = pH;
+      unit->data.influent->toc = toc;
+      unit->data.influent->uv254 = toc * 0.03;
+    }
+    else if (unit->type == ALUM)
+      unit->data.alum->dose = 25.0;
+    else if (unit->type == HYPOCHLORITE)
+      unit->data.chemical->naocl = 3.0;
+    else if (unit->type == LIME && unit == NextUnitProcess(FirstUnitProcess(train)))
+    {
+      unit->data.lime->dose = soft ? 180.0 : 10.0;
+      unit->data.lime->purpose = soft ? 'S' : 'P';
+    }
+  }
+}
+
+// purpose: run trains with runmodel_lanes() and their clones with runmodel(), and compare them
+static void compare_batch(std::vector<struct ProcessTrain *> &trains, const char *what, double *t_lanes, double *t_serial)
+{
+  std::vector<struct ProcessTrain *> clones;
+  double t;
+  size_t i;
+  char name[64];
+
+  for (i = 0; i < trains.size(); i++)
+    clones.push_back(clone_train(trains[i]));
+
+  t = cpu_seconds();
+  check(runmodel_lanes(trains.data(), (int)trains.size()) == TRUE, "%s: runmodel_lanes() failed", what);
+  *t_lanes += cpu_seconds() - t;
+
+  t = cpu_seconds();
+  for (i = 0; i < clones.size(); i++)
+    check(runmodel(clones[i]) == TRUE, "%s %d: runmodel() failed", what, (int)i);
+  *t_serial += cpu_seconds() - t;
+
+  for (i = 0; i < trains.size(); i++)
+  {
+    snprintf(name, sizeof(name), "%s %d", what, (int)i);
+    compare_effluents(trains[i], clones[i], 0.0, name);
+    FreeProcessTrain(clones[i]);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  double temps[] = {0.5, 4.0, 12.0, 22.0, 30.0};
+  double phs[] = {6.5, 7.4, 8.3};
+  double tocs[] = {1.5, 3.2, 6.0};
+  std::vector<struct ProcessTrain *> trains;
+  double t_lanes = 0.0, t_serial = 0.0;
+  struct ProcessTrain *train;
+  int soft, a, b, c, repeat;
+  size_t i, f;
+
+  if (argc > 1)
+    test_root = argv[1];
+
+  for (repeat = 0; repeat < 10; repeat++)
+  {
+    /* Grid of 90 influents, softening and not */
+    for (soft = 0; soft < 2; soft++)
+      for (a = 0; a < 5; a++)
+        for (b = 0; b < 3; b++)
+          for (c = 0; c < 3; c++)
+          {
+            train = test_train("in/wtp_train/conv.wtp");
+            set_grid_point(train, temps[a], phs[b], tocs[c], soft);
+            trains.push_back(train);
+          }
+    compare_batch(trains, "grid", &t_lanes, &t_serial);
+    for (i = 0; i < trains.size(); i++)
+      FreeProcessTrain(trains[i]);
+    trains.clear();
+
+    /* The 13 influent files */
+    for (f = 0; f < sizeof(influent_files) / sizeof(influent_files[0]); f++)
+    {
+      std::string name = std::string("in/single_sim/influent/") + influent_files[f] + "_influent.csv";
+
+      train = test_train("in/wtp_train/conv.wtp");
+      check(test_set_influent(train, name.c_str()), "cannot read %s", name.c_str());
+      trains.push_back(train);
+    }
+    compare_batch(trains, "influent files", &t_lanes, &t_serial);
+    for (i = 0; i < trains.size(); i++)
+      FreeProcessTrain(trains[i]);
+    trains.clear();
+  }
+
+  printf("test_lanes: runmodel_lanes() %.3f s, runmodel() %.3f s for 1030 trains (WTP_LANES %d)\n",
+         t_lanes, t_serial, WTP_LANES);
+  return (test_report("test_lanes"));
+}
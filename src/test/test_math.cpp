@@ -0,0 +1,186 @@
+/* test_math.cpp -- Accuracy of the WTP_FAST_MATH functions against the C library
+*
+*  bin/makefile builds math_wtp.cpp into this test with -DWTP_FAST_MATH=1,
+*  whatever the CPPFLAGS of the library.  Each function is run on random
+*  arguments (the same on every run) over the ranges of the table in
+*  math_wtp.cpp, and its error in ulp of the result is measured against
+*  the long double C library (expl(), logl(), powl()), which carries 11
+*  more bits than a double.  The largest error must be within the bound
+*  of the table, listed below in cases[].  The error of the double
+*  C library (exp(), log(), pow()) against the same reference is printed
+*  for comparison.  The batch functions (wtp_exp_n() ...) must return the
+*  values of the scalar functions.
+*
+*  Usage: test_math.exe
+*/
+
+#include "test_wtp.h"
+#include <stdint.h>
+#include <vector>
+
+#if !WTP_FAST_MATH
+#error test_math.cpp is built with -DWTP_FAST_MATH=1, see bin/makefile
+#endif
+
+#define MATH_SAMPLES 200000
+
+enum MathFunction
+{
+  M_EXP,
+  M_LOG,
+  M_LOG10,
+  M_EXP10,
+  M_POW
+};
+
+struct MathCase
+{
+  const char *name;       /* Function and range                    */
+  enum MathFunction f;
+  double lo, hi;          /* Range of x, or of y*ln(x) for wtp_pow() */
+  int log_scale;          /* x = exp(uniform in [lo, hi])            */
+  double bound;           /* Largest error allowed (ulp)             */
+};
+
+static const struct MathCase cases[] = {
+    {"wtp_exp(x)    |x| <= 708", M_EXP, -708.0, 708.0, FALSE, 0.52},
+    {"wtp_exp(x)    |x| <= 1", M_EXP, -1.0, 1.0, FALSE, 0.52},
+    {"wtp_log(x)    x normal", M_LOG, -708.0, 709.0, TRUE, 0.9},
+    {"wtp_log(x)    |x-1| < 0.1", M_LOG, -0.1, 0.1, TRUE, 0.9},
+    {"wtp_log10(x)  x normal", M_LOG10, -708.0, 709.0, TRUE, 1.2},
+    {"wtp_exp10(x)  |x| <= 307", M_EXP10, -307.0, 307.0, FALSE, 0.52},
+    {"wtp_pow(x,y)  |y*ln(x)| <= 150", M_POW, -150.0, 150.0, FALSE, 1.0},
+    {"wtp_pow(x,y)  |y*ln(x)| <= 708", M_POW, -708.0, 708.0, FALSE, 2.0},
+};
+
+static uint64_t random_state = 0x2545f4914f6cdd1dULL;
+
+// purpose: uniform random double in [0, 1), the same sequence on every run
+static double uniform()
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+  return ((double)(random_state >> 11) * (1.0 / 9007199254740992.0));
+}
+
+// purpose: error of y in ulp of the exact result ref
+static double ulp_error(double y, long double ref)
+{
+  int e;
+
+  if (ref == 0.0L)
+    return (y == 0.0 ? 0.0 : HUGE_VAL);
+  frexpl(ref, &e);
+  return ((double)(fabsl((long double)y - ref) / ldexpl(1.0L, e - 53)));
+}
+
+// purpose: the fast function, the C library function, and the long double reference at (x, y)
+static void evaluate(enum MathFunction f, double x, double y, double *fast, double *libm, long double *ref)
+{
+  *fast = *libm = 0.0;
+  *ref = 0.0L;
+  switch (f)
+  {
+  case M_EXP:
+    *fast = wtp_exp(x), *libm = exp(x), *ref = expl((long double)x);
+    break;
+  case M_LOG:
+    *fast = wtp_log(x), *libm = log(x), *ref = logl((long double)x);
+    break;
+  case M_LOG10:
+    *fast = wtp_log10(x), *libm = log10(x), *ref = log10l((long double)x);
+    break;
+  case M_EXP10:
+    *fast = wtp_exp10(x), *libm = pow(10.0, x), *ref = powl(10.0L, (long double)x);
+    break;
+  case M_POW:
+    *fast = wtp_pow(x, y), *libm = pow(x, y), *ref = powl((long double)x, (long double)y);
+    break;
+  }
+}
+
+// purpose: the batch function on n arguments
+static void evaluate_n(enum MathFunction f, int n, const double *x, const double *y, double *z)
+{
+  switch (f)
+  {
+  case M_EXP:
+    wtp_exp_n(n, x, z);
+    break;
+  case M_LOG:
+    wtp_log_n(n, x, z);
+    break;
+  case M_LOG10:
+    for (int i = 0; i < n; i++) /* no batch function */
+      z[i] = wtp_log10(x[i]);
+    break;
+  case M_EXP10:
+    wtp_exp10_n(n, x, z);
+    break;
+  case M_POW:
+    wtp_pow_n(n, x, y, z);
+    break;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  std::vector<double> x(MATH_SAMPLES), y(MATH_SAMPLES), z(MATH_SAMPLES), scalar(MATH_SAMPLES);
+  double fast, libm, e, worst, worst_libm, worst_x, worst_y;
+  const struct MathCase *c;
+  long double ref;
+  size_t k;
+  int i;
+
+  for (k = 0; k < sizeof(cases) / sizeof(cases[0]); k++)
+  {
+    c = &cases[k];
+    worst = worst_libm = worst_x = worst_y = 0.0;
+    for (i = 0; i < MATH_SAMPLES; i++)
+    {
+      e = c->lo + (c->hi - c->lo) * uniform();
+      if (c->f == M_POW)
+      {
+        /* x log-uniform over the normal doubles, y such that y*ln(x) = e */
+        x[i] = exp(-708.0 + 1417.0 * uniform());
+        y[i] = fabs(log(x[i])) > 1e-3 ? e / log(x[i]) : e;
+        if (!(fabs(y[i] * log(x[i])) <= c->hi))
+          y[i] = 0.5;
+      }
+      else
+      {
+        x[i] = c->log_scale ? exp(e) : e;
+        y[i] = 0.0;
+      }
+      evaluate(c->f, x[i], y[i], &fast, &libm, &ref);
+      scalar[i] = fast;
+      if ((e = ulp_error(fast, ref)) > worst)
+        worst = e, worst_x = x[i], worst_y = y[i];
+      if ((e = ulp_error(libm, ref)) > worst_libm)
+        worst_libm = e;
+    }
+    check(worst <= c->bound, "%s: %.3f ulp at x %.17g y %.17g, bound %.2f ulp", c->name, worst, worst_x, worst_y,
+          c->bound);
+
+    /* The batch function, on every length up to 70 and on the whole sample */
+    for (i = 1; i <= 70; i++)
+    {
+      evaluate_n(c->f, i, x.data(), y.data(), z.data());
+      check(memcmp(z.data(), scalar.data(), i * sizeof(double)) == 0, "%s: batch of %d differs", c->name, i);
+    }
+    evaluate_n(c->f, MATH_SAMPLES, x.data(), y.data(), z.data());
+    for (i = 0; i < MATH_SAMPLES; i++)
+      check(z[i] == scalar[i], "%s: batch %.17g != %.17g at x %.17g y %.17g", c->name, z[i], scalar[i], x[i], y[i]);
+
+    printf("test_math: %-31s %.3f ulp (bound %.2f), C library %.3f ulp\n", c->name, worst, c->bound, worst_libm);
+  }
+
+  /* Arguments outside the ranges go to the C library */
+  check(wtp_exp(710.0) == exp(710.0) && wtp_exp(-745.0) == exp(-745.0), "wtp_exp() out of range");
+  check(wtp_log(0.0) == log(0.0) && wtp_log(1e-310) == log(1e-310), "wtp_log() out of range");
+  check(wtp_pow(1e-310, 0.5) == pow(1e-310, 0.5) && wtp_pow(10.0, 400.0) == pow(10.0, 400.0), "wtp_pow() out of range");
+  check(wtp_exp(0.0) == 1.0 && wtp_log(1.0) == 0.0 && wtp_pow(3.0, 0.0) == 1.0, "wtp_exp(0), wtp_log(1), wtp_pow(x,0)");
+
+  return (test_report("test_math"));
+}
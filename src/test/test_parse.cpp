@@ -0,0 +1,271 @@
+/* test_parse.cpp -- parse_wtp() and writewtp() round trips, and damaged input
+*
+*  Round trips: in/wtp_train/conv.wtp, the same file with CR LF line ends
+*  and with every value -DBL_MAX (the longest text of a write() function,
+*  see WTP_WRITE_LEN), and a train with one unit process of every type of
+*  UnitProcessTable[] but VACANT (default data) are parsed, written with
+*  writewtp(), and parsed again.  The two trains must write the same text;
+*  that is, they agree in every value as writewtp() prints it (its formats
+*  round, e.g. pH to 0.1).  The file is also saved with save_wtp() and
+*  read back with open_wtp().
+*
+*  Damaged input: every truncation of those two texts and PARSE_MUTATIONS
+*  random mutations of them (bytes changed, lines deleted, duplicated or
+*  swapped, values too long or not numbers, '=' removed) are parsed and
+*  written in a child process, which must end normally.  parse_wtp() may
+*  return FALSE, or exit() for an unknown unit process name (as it
+*  always has), but must not crash.
+*
+*  Usage: test_parse.exe [repository directory]
+*/
+
+#include "test_wtp.h"
+#include <stdint.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#define PARSE_MUTATIONS 2000
+
+static uint64_t random_state = 0x9e3779b97f4a7c15ULL;
+static int n_accepted, n_rejected, n_exited; /* Outcomes of the damaged input */
+
+// purpose: random integer in [0, n), the same sequence on every run
+static size_t random_below(size_t n)
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+  return (n > 0 ? (size_t)(random_state % n) : 0);
+}
+
+// purpose: text written by writewtp() for a train
+static std::string write_text(struct ProcessTrain *train)
+{
+  std::string text;
+  char buffer[4096];
+  size_t n;
+  FILE *fp;
+
+  if ((fp = tmpfile()) == NULL)
+    return (text);
+  check(writewtp(fp, train, stdout) == TRUE, "writewtp() failed");
+  rewind(fp);
+  while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+    text.append(buffer, n);
+  fclose(fp);
+  return (text);
+}
+
+// purpose: parse text into a new train; the text is copied without a terminating '\0'
+static struct ProcessTrain *parse_text(const std::string &text, int *ok)
+{
+  struct ProcessTrain *train = AllocProcessTrain();
+  char *copy = (char *)malloc(text.size() + 1);
+
+  memcpy(copy, text.data(), text.size());
+  *ok = parse_wtp(copy, text.size(), train, NULL);
+  free(copy);
+  return (train);
+}
+
+// purpose: parse text, write it, parse what was written, and compare
+static void round_trip(const std::string &text, const char *what)
+{
+  struct ProcessTrain *a, *b;
+  std::string text_a, text_b;
+  int ok;
+
+  a = parse_text(text, &ok);
+  check(ok == TRUE, "%s: parse_wtp() failed", what);
+  text_a = write_text(a);
+  b = parse_text(text_a, &ok);
+  check(ok == TRUE, "%s: parse_wtp() of the written text failed", what);
+  text_b = write_text(b);
+  check(text_a.size() > 0 && text_a == text_b, "%s: the text written after a round trip differs:\n%s\n----\n%s",
+        what, text_a.c_str(), text_b.c_str());
+  FreeProcessTrain(a);
+  FreeProcessTrain(b);
+}
+
+// purpose: parse and write damaged text in a child process, which must end normally
+static void parse_damaged(const std::string &text, const char *what)
+{
+  struct ProcessTrain *train;
+  FILE *fp;
+  pid_t pid;
+  int status, ok;
+
+  fflush(stdout);
+  if ((pid = fork()) == 0)
+  {
+    if (freopen("/dev/null", "w", stderr) == NULL || (fp = fopen("/dev/null", "w")) == NULL)
+      _exit(3);
+    train = parse_text(text, &ok);
+    writewtp(fp, train, NULL);
+    FreeProcessTrain(train);
+    fclose(fp);
+    _exit(ok == TRUE ? 0 : 2);
+  }
+  if (!check(pid > 0 && waitpid(pid, &status, 0) == pid, "%s: fork() failed", what))
+    return;
+  if (!check(WIFEXITED(status) && WEXITSTATUS(status) != 3, "%s: parse_wtp() crashed (status %d):\n%s", what,
+             status, text.c_str()))
+    return;
+  if (WEXITSTATUS(status) == 0)
+    n_accepted++;
+  else if (WEXITSTATUS(status) == 2)
+    n_rejected++;
+  else
+    n_exited++; /* exit() for an unknown unit process name */
+}
+
+// purpose: start of every line of text
+static std::vector<size_t> line_starts(const std::string &text)
+{
+  std::vector<size_t> starts(1, 0);
+  size_t i;
+
+  for (i = 0; i + 1 < text.size(); i++)
+    if (text[i] == '\n')
+      starts.push_back(i + 1);
+  return (starts);
+}
+
+// purpose: a random mutation of text
+static std::string mutate(const std::string &text)
+{
+  static const char *const values[] = {"", "nan", "-1e308", "1e999", "abc", "= =", "#", "End", "0x10", "-0"};
+  std::vector<size_t> starts = line_starts(text);
+  std::string s = text, line;
+  size_t a, b, eq;
+
+  a = random_below(starts.size());
+  b = random_below(starts.size());
+  switch (random_below(8))
+  {
+  case 0: /* change a byte to any value */
+    s[random_below(s.size())] = (char)random_below(256);
+    break;
+  case 1: /* change a byte to a printable character */
+    s[random_below(s.size())] = (char)(' ' + random_below(95));
+    break;
+  case 2: /* delete a line */
+    s.erase(starts[a], (a + 1 < starts.size() ? starts[a + 1] : s.size()) - starts[a]);
+    break;
+  case 3: /* duplicate a line */
+    line = s.substr(starts[a], (a + 1 < starts.size() ? starts[a + 1] : s.size()) - starts[a]);
+    s.insert(starts[b], line);
+    break;
+  case 4: /* swap two lines */
+    if (a > b)
+      std::swap(a, b);
+    if (a < b && b + 1 < starts.size())
+    {
+      line = s.substr(starts[b], starts[b + 1] - starts[b]);
+      s.erase(starts[b], line.size());
+      s.insert(starts[a], line);
+    }
+    break;
+  case 5: /* a value longer than a read() buffer */
+    if ((eq = s.find('=', starts[a])) != std::string::npos)
+      s.insert(eq + 1, std::string(200 + random_below(200), '9'));
+    break;
+  case 6: /* a value that is not a number */
+    if ((eq = s.find('=', starts[a])) != std::string::npos)
+      s.replace(eq + 1, s.find('\n', eq) - eq - 1, values[random_below(10)]);
+    break;
+  case 7: /* no '=' */
+    if ((eq = s.find('=', starts[a])) != std::string::npos)
+      s.erase(eq, 1);
+    break;
+  }
+  return (s);
+}
+
+int main(int argc, char *argv[])
+{
+  std::string conv, crlf, extreme, all_units, damaged;
+  struct ProcessTrain *train, *saved;
+  char name[64], buffer[4096];
+  size_t n, i;
+  int type, k;
+  FILE *fp;
+
+  if (argc > 1)
+    test_root = argv[1];
+
+  if ((fp = fopen(test_path("in/wtp_train/conv.wtp").c_str(), "r")) == NULL)
+  {
+    check(FALSE, "cannot read in/wtp_train/conv.wtp");
+    return (test_report("test_parse"));
+  }
+  while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+    conv.append(buffer, n);
+  fclose(fp);
+  for (i = 0; i < conv.size(); i++)
+    crlf += (conv[i] == '\n') ? std::string("\r\n") : std::string(1, conv[i]);
+  for (i = 0; i < conv.size(); i = conv.find('\n', i) + 1) /* every value -DBL_MAX */
+  {
+    n = conv.find('\n', i);
+    if (conv.find('=', i) < n)
+      extreme += conv.substr(i, conv.find('=', i) + 1 - i) + " -1.7976931348623157e308\n";
+    else
+      extreme += conv.substr(i, n + 1 - i);
+    if (n == std::string::npos)
+      break;
+  }
+
+  /* A train with every unit process type */
+  train = AllocProcessTrain();
+  for (type = VACANT + 1; UnitProcessTable[type].name != NULL; type++)
+    check(AddUnitProcess(train, (short)type) != NULL, "AddUnitProcess(%s) failed", UnitProcessTable[type].name);
+  all_units = write_text(train);
+  FreeProcessTrain(train);
+
+  /* Round trips */
+  round_trip(conv, "conv.wtp");
+  round_trip(crlf, "conv.wtp with CR LF");
+  round_trip(all_units, "every unit process");
+  round_trip(extreme, "conv.wtp with every value -DBL_MAX");
+  train = parse_text(conv, &k);
+  saved = parse_text(crlf, &k);
+  check(write_text(train) == write_text(saved), "CR LF line ends change the train");
+  FreeProcessTrain(train);
+  FreeProcessTrain(saved);
+
+  snprintf(name, sizeof(name), "test_parse_%d.wtp", (int)getpid());
+  train = test_train("in/wtp_train/conv.wtp");
+  saved = AllocProcessTrain();
+  check(save_wtp(name, train, stdout) == TRUE, "save_wtp(%s) failed", name);
+  check(open_wtp(name, saved, NULL) == TRUE, "open_wtp(%s) failed", name);
+  check(write_text(train) == write_text(saved), "save_wtp() and open_wtp() change the train");
+  remove(name);
+  FreeProcessTrain(train);
+  FreeProcessTrain(saved);
+
+  /* Damaged input */
+  for (i = 0; i <= conv.size(); i++)
+  {
+    snprintf(name, sizeof(name), "conv.wtp truncated to %d bytes", (int)i);
+    parse_damaged(conv.substr(0, i), name);
+  }
+  for (i = 0; i <= all_units.size(); i += 3)
+  {
+    snprintf(name, sizeof(name), "every unit process truncated to %d bytes", (int)i);
+    parse_damaged(all_units.substr(0, i), name);
+  }
+  for (k = 0; k < PARSE_MUTATIONS; k++)
+  {
+    damaged = mutate(k % 2 ? all_units : conv);
+    if (k % 5 == 0)
+      damaged = mutate(damaged);
+    snprintf(name, sizeof(name), "mutation %d", k);
+    parse_damaged(damaged, name);
+  }
+
+  printf("test_parse: damaged input accepted %d, rejected %d, unknown unit process %d\n", n_accepted, n_rejected,
+         n_exited);
+  return (test_report("test_parse"));
+}
@@ -0,0 +1,83 @@
+/* test_pool.cpp -- run_worker_pool() with workers that exit and are killed
+*
+*  Runs items on pools of 1, 3 and 8 workers, where some items exit() (as
+*  auto_dose() does when it fails), some kill their worker, and some are
+*  not to be evaluated (a status on entry).  Every other item must have
+*  its values and the status "ok", each failed item the reason it failed,
+*  and the count of failed items must be returned.  The caller has a
+*  child of its own while the pool runs, which the pool must not wait for.
+*
+*  Usage: test_pool.exe
+*/
+
+#include "test_wtp.h"
+#include "wtp_optimize.h"
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define N_ITEMS 200
+#define N_VALUES 3
+
+// purpose: the values of an item, or its failure
+static void pool_task(long item, double *values, void *arg)
+{
+  int k;
+
+  usleep(100); /* the child of the caller ends first */
+  if (item % 37 == 5)
+    exit(3);
+  if (item % 53 == 7)
+    kill(getpid(), SIGKILL);
+  for (k = 0; k < N_VALUES; k++)
+    values[k] = item * 10.0 + k;
+}
+
+int main(int argc, char *argv[])
+{
+  static const int pool_sizes[] = {1, 3, 8};
+  std::vector<std::string> status;
+  std::vector<double> values;
+  int n_failed, expected, p, k, wstatus;
+  pid_t child;
+  long i;
+
+  for (p = 0; p < 3; p++)
+  {
+    /* A child of the caller, which ends while the pool runs */
+    if ((child = fork()) == 0)
+      _exit(42);
+
+    status.assign(N_ITEMS, "");
+    values.assign(N_ITEMS * N_VALUES, -1.0);
+    for (i = 0; i < N_ITEMS; i += 41)
+      status[i] = "failed: cannot read its inputs";
+    n_failed = run_worker_pool(N_ITEMS, N_VALUES, pool_sizes[p], pool_task, NULL, &values[0], status);
+
+    expected = 0;
+    for (i = 0; i < N_ITEMS; i++)
+    {
+      if (i % 41 == 0)
+        check(status[i] == "failed: cannot read its inputs", "%d workers: item %ld: %s", pool_sizes[p], i,
+              status[i].c_str());
+      else if (i % 37 == 5)
+        check(status[i] == "failed: exit status 3", "%d workers: item %ld: %s", pool_sizes[p], i, status[i].c_str());
+      else if (i % 53 == 7)
+        check(status[i] == "failed: signal 9", "%d workers: item %ld: %s", pool_sizes[p], i, status[i].c_str());
+      else
+      {
+        check(status[i] == "ok", "%d workers: item %ld: %s", pool_sizes[p], i, status[i].c_str());
+        for (k = 0; k < N_VALUES; k++)
+          check(values[i * N_VALUES + k] == i * 10.0 + k, "%d workers: item %ld value %d", pool_sizes[p], i, k);
+        continue;
+      }
+      expected++;
+    }
+    check(n_failed == expected, "%d workers: %d items failed, not %d", pool_sizes[p], n_failed, expected);
+
+    check(waitpid(child, &wstatus, 0) == child && WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 42,
+          "%d workers: the pool waited for a child of the caller", pool_sizes[p]);
+  }
+
+  return (test_report("test_pool"));
+}
@@ -0,0 +1,257 @@
+/* test_snapshot.cpp -- write_snapshot(), parse_snapshot() and load_snapshot()
+*
+*  Round trips: in/wtp_train/conv.wtp is run with runmodel() and written
+*  with write_snapshot(), without and with state.  The buffer is loaded
+*  with load_snapshot() into a new train (units rebuilt) and into another
+*  train read from conv.wtp (units restored in place), and each is written
+*  again; the two buffers must be byte-identical.  With state, the
+*  Effluent pointers of the loaded train must refer to its own units and
+*  context, at the same indices as in the original train, and eff.dbpmodel
+*  to the same model name.  Every loaded train, run with runmodel(), must
+*  give the effluents of the text-parsed train bit for bit.  The train is
+*  also saved with save_snapshot() and read back with open_wtp().
+*
+*  Damaged input: every truncation of both buffers, and buffers with a bad
+*  header (magic, version, byte order, state, structure sizes, n_units) or
+*  a bad unit record (type, size, rel[], dbpmodel) in every unit, must be
+*  rejected by parse_snapshot() and load_snapshot().
+*
+*  Usage: test_snapshot.exe [repository directory]
+*/
+
+#include "test_wtp.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+
+/* Layout of a snapshot file, see the notes of write_snapshot() */
+struct FileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t n_units;
+  uint32_t state;
+  uint32_t effluent_size;
+  uint32_t context_size;
+};
+
+struct FileUnit
+{
+  int16_t type;
+  int16_t rel[4];
+  int16_t dbpmodel;
+  uint32_t size;
+};
+
+#define N_DBP_MODELS 6 /* Names in dbp_model_names[] of snap_wtp.cpp */
+
+// purpose: bytes written by write_snapshot() for a train
+static std::string write_bytes(struct ProcessTrain *train, int state)
+{
+  struct TrainSnapshot *snap;
+  std::string bytes;
+  char buffer[4096];
+  size_t n;
+  FILE *fp;
+
+  if ((snap = snapshot_train(train, NULL)) == NULL || (fp = tmpfile()) == NULL)
+  {
+    check(FALSE, "snapshot_train() or tmpfile() failed");
+    FreeTrainSnapshot(snap);
+    return (bytes);
+  }
+  check(write_snapshot(fp, snap, state, stdout) == TRUE, "write_snapshot() failed");
+  rewind(fp);
+  while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+    bytes.append(buffer, n);
+  fclose(fp);
+  FreeTrainSnapshot(snap);
+  return (bytes);
+}
+
+// purpose: check that the Effluent pointers of a loaded train match those of the original train
+static void check_pointers(struct ProcessTrain *loaded, struct ProcessTrain *train, const char *what)
+{
+  struct UnitProcess *ul, *ut;
+  int i;
+
+  for (ul = FirstUnitProcess(loaded), ut = FirstUnitProcess(train), i = 0; ul && ut;
+       ul = NextUnitProcess(ul), ut = NextUnitProcess(ut), i++)
+  {
+#define X(p)                                                                                          \
+    check((ul->eff.p == NULL && ut->eff.p == NULL) ||                                                 \
+              (ul->eff.p != NULL && ut->eff.p != NULL &&                                              \
+               GetUnitIndex(loaded, ul->eff.p) == GetUnitIndex(train, ut->eff.p)),                    \
+          "%s: unit %d eff.%s does not point to the same unit of the loaded train", what, i, #p);
+    X(influent) X(wtp_effluent) X(last_rm_inf) X(last_o3_inf)
+#undef X
+    check(ul->eff.ctx == &loaded->ctx, "%s: unit %d eff.ctx is not the context of the loaded train", what, i);
+    check((ul->eff.dbpmodel == NULL && ut->eff.dbpmodel == NULL) ||
+              (ul->eff.dbpmodel != NULL && ut->eff.dbpmodel != NULL &&
+               strcmp(ul->eff.dbpmodel, ut->eff.dbpmodel) == 0),
+          "%s: unit %d eff.dbpmodel \"%s\" != \"%s\"", what, i, ul->eff.dbpmodel ? ul->eff.dbpmodel : "NULL",
+          ut->eff.dbpmodel ? ut->eff.dbpmodel : "NULL");
+  }
+  check(ul == NULL && ut == NULL, "%s: trains of different lengths", what);
+}
+
+// purpose: check that parse_snapshot() and load_snapshot() reject a buffer
+static void check_rejected(const std::string &bytes, const char *what)
+{
+  struct TrainSnapshot *snap;
+  struct ProcessTrain *train;
+
+  snap = parse_snapshot(bytes.data(), bytes.size(), NULL);
+  check(snap == NULL, "%s: parse_snapshot() accepted the buffer", what);
+  FreeTrainSnapshot(snap);
+  train = AllocProcessTrain();
+  check(load_snapshot(bytes.data(), bytes.size(), train, NULL) == FALSE, "%s: load_snapshot() accepted the buffer",
+        what);
+  FreeProcessTrain(train);
+}
+
+// purpose: a copy of bytes with the value at offset replaced
+template <class T>
+static std::string patch(const std::string &bytes, size_t offset, T value)
+{
+  std::string s = bytes;
+
+  memcpy(&s[offset], &value, sizeof(value));
+  return (s);
+}
+
+// purpose: damaged copies of a snapshot buffer, all of which must be rejected
+static void damaged_input(const std::string &bytes, int state, const char *what)
+{
+  struct FileHeader header;
+  struct FileUnit rec;
+  char name[128];
+  size_t i, offset, at;
+  int u;
+
+  /* Every truncation */
+  for (i = 0; i < bytes.size(); i++)
+  {
+    snprintf(name, sizeof(name), "%s truncated to %d bytes", what, (int)i);
+    if (!check(parse_snapshot(bytes.data(), i, NULL) == NULL, "%s: parse_snapshot() accepted the buffer", name))
+      break;
+  }
+  snprintf(name, sizeof(name), "%s truncated by one byte", what);
+  check_rejected(bytes.substr(0, bytes.size() - 1), name);
+
+  /* Header */
+  memcpy(&header, bytes.data(), sizeof(header));
+#define BAD_HEADER(field, value, text)                                                          \
+  snprintf(name, sizeof(name), "%s with %s", what, text);                                      \
+  check_rejected(patch(bytes, offsetof(struct FileHeader, field), (uint32_t)(value)), name);
+  BAD_HEADER(magic, 0x4e53ffffu, "bad magic")
+  BAD_HEADER(version, header.version + 1, "bad version")
+  BAD_HEADER(byte_order, 0x04030201u, "bad byte order")
+  BAD_HEADER(state, 2, "bad state")
+  BAD_HEADER(state, !header.state, "state flipped")
+  BAD_HEADER(effluent_size, header.effluent_size + 8, "bad effluent size")
+  BAD_HEADER(context_size, header.context_size + 8, "bad context size")
+  BAD_HEADER(n_units, header.n_units + 1, "n_units + 1")
+  BAD_HEADER(n_units, 0x80000000u, "n_units 0x80000000")
+  BAD_HEADER(n_units, 0xffffffffu, "n_units 0xffffffff")
+#undef BAD_HEADER
+
+  /* Every unit record */
+  offset = sizeof(header) + (state ? sizeof(struct WtpContext) : 0);
+  for (u = 0; u < (int)header.n_units && offset + sizeof(rec) <= bytes.size(); u++)
+  {
+    memcpy(&rec, &bytes[offset], sizeof(rec));
+#define BAD_UNIT(field, type, value, text)                                                      \
+    snprintf(name, sizeof(name), "%s unit %d with %s", what, u, text);                         \
+    check_rejected(patch(bytes, offset + offsetof(struct FileUnit, field), (type)(value)), name);
+    BAD_UNIT(size, uint32_t, rec.size + 1, "size + 1")
+    BAD_UNIT(size, uint32_t, 0, "size 0")
+    BAD_UNIT(size, uint32_t, 0xffffffffu, "size 0xffffffff")
+    BAD_UNIT(type, int16_t, -1, "type -1")
+    BAD_UNIT(type, int16_t, 32767, "type 32767")
+    BAD_UNIT(dbpmodel, int16_t, -1, "dbpmodel -1")
+    BAD_UNIT(dbpmodel, int16_t, N_DBP_MODELS + 1, "dbpmodel past the table")
+    for (i = 0; i < 4; i++)
+    {
+      at = offset + offsetof(struct FileUnit, rel) + i * sizeof(int16_t);
+      snprintf(name, sizeof(name), "%s unit %d with rel[%d] -1", what, u, (int)i);
+      check_rejected(patch(bytes, at, (int16_t)-1), name);
+      snprintf(name, sizeof(name), "%s unit %d with rel[%d] n_units + 1", what, u, (int)i);
+      check_rejected(patch(bytes, at, (int16_t)(header.n_units + 1)), name);
+    }
+#undef BAD_UNIT
+
+    offset += sizeof(rec) + rec.size + (state ? sizeof(struct Effluent) : 0);
+  }
+  check(u == (int)header.n_units && offset == bytes.size(), "%s: unit records do not fill the buffer", what);
+}
+
+int main(int argc, char *argv[])
+{
+  struct ProcessTrain *text, *loaded, *in_place, *saved;
+  std::string bytes[2], again;
+  char name[128];
+  int state;
+
+  if (argc > 1)
+    test_root = argv[1];
+
+  text = test_train("in/wtp_train/conv.wtp");
+  runmodel(text);
+
+  for (state = FALSE; state <= TRUE; state++)
+  {
+    const char *what = state ? "with state" : "without state";
+
+    bytes[state] = write_bytes(text, state);
+    check(bytes[state].size() > sizeof(struct FileHeader), "%s: write_snapshot() wrote nothing", what);
+
+    /* Loaded into a new train, whose units are rebuilt */
+    loaded = AllocProcessTrain();
+    check(load_snapshot(bytes[state].data(), bytes[state].size(), loaded, stdout) == TRUE,
+          "%s: load_snapshot() into a new train failed", what);
+    again = write_bytes(loaded, state);
+    check(again == bytes[state], "%s: the snapshot of the loaded train differs (%d and %d bytes)", what,
+          (int)again.size(), (int)bytes[state].size());
+    if (state)
+      check_pointers(loaded, text, "new train with state");
+    runmodel(loaded);
+    snprintf(name, sizeof(name), "new train %s", what);
+    compare_effluents(loaded, text, 0.0, name);
+
+    /* Loaded into a train of the same units, restored in place */
+    in_place = test_train("in/wtp_train/conv.wtp");
+    check(load_snapshot(bytes[state].data(), bytes[state].size(), in_place, stdout) == TRUE,
+          "%s: load_snapshot() into a train of the same units failed", what);
+    again = write_bytes(in_place, state);
+    check(again == bytes[state], "%s: the snapshot of the train loaded in place differs", what);
+    if (state)
+      check_pointers(in_place, text, "train loaded in place with state");
+    runmodel(in_place);
+    snprintf(name, sizeof(name), "train loaded in place %s", what);
+    compare_effluents(in_place, text, 0.0, name);
+
+    FreeProcessTrain(loaded);
+    FreeProcessTrain(in_place);
+  }
+
+  /* save_snapshot() and open_wtp() */
+  snprintf(name, sizeof(name), "test_snapshot_%d.snap", (int)getpid());
+  saved = AllocProcessTrain();
+  check(save_snapshot(name, text, TRUE, stdout) == TRUE, "save_snapshot(%s) failed", name);
+  check(open_wtp(name, saved, NULL) == TRUE, "open_wtp(%s) of a snapshot failed", name);
+  check(write_bytes(saved, TRUE) == bytes[TRUE], "save_snapshot() and open_wtp() change the snapshot");
+  check_pointers(saved, text, "open_wtp() of a snapshot");
+  runmodel(saved);
+  compare_effluents(saved, text, 0.0, "open_wtp() of a snapshot");
+  remove(name);
+  FreeProcessTrain(saved);
+
+  /* Damaged input */
+  damaged_input(bytes[FALSE], FALSE, "snapshot without state");
+  damaged_input(bytes[TRUE], TRUE, "snapshot with state");
+
+  FreeProcessTrain(text);
+  return (test_report("test_snapshot"));
+}
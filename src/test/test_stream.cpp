@@ -0,0 +1,132 @@
+/* test_stream.cpp -- Replay of in/stream/CLP-influent-history.csv through stream mode
+*
+*  Feeds the quarterly influent records of the CLP history through
+*  stream_mode() with conv.wtp and the set points of
+*  CLP-Q1_cluster-1_operations.csv, as "-r stream" does.  Every record must
+*  give one result line, in order and with its time, and within the time
+*  limit of a record (STREAM_LIMIT_MS, the default of "-l") plus
+*  STREAM_SLACK_MS to stop a worker that ran past it.  A record is dosed
+*  ("ok"), or reported as "timeout" or "failed: ...".  The doses of every
+*  record dosed must be those of batch_sim() run here on the same record,
+*  bit for bit: the workers start each record from the train as read, not
+*  from the doses of the record before.
+*
+*  Usage: test_stream.exe [repository directory]
+*/
+
+#include "test_wtp.h"
+#include "wtp_optimize.h"
+#include <sstream>
+#include <vector>
+
+#define STREAM_LIMIT_MS 1000
+#define STREAM_SLACK_MS 250.0
+
+// purpose: split a CSV line into its fields
+static std::vector<std::string> csv_fields(const std::string &line)
+{
+  std::vector<std::string> fields;
+  std::stringstream in(line);
+  std::string field;
+
+  while (std::getline(in, field, ','))
+    fields.push_back(field);
+  return (fields);
+}
+
+// purpose: the lines of a text file of the repository, or of an open file
+static std::vector<std::string> read_lines(FILE *fp)
+{
+  std::vector<std::string> lines;
+  char line[4096];
+
+  while (fgets(line, sizeof(line), fp) != NULL)
+  {
+    line[strcspn(line, "\r\n")] = '\0';
+    lines.push_back(line);
+  }
+  return (lines);
+}
+
+int main(int argc, char *argv[])
+{
+  std::vector<std::string> records, results, header, fields, in_header, in_fields;
+  std::string stream_name, time;
+  struct StreamParameters params;
+  struct TrainSnapshot *start;
+  struct ProcessTrain *train;
+  double influent[N_SCENARIO_PARAMS], values[N_BATCH_COLS], latency;
+  size_t r, c, p;
+  int n_ok = 0, n_bad;
+  FILE *fp, *fout;
+
+  if (argc > 1)
+    test_root = argv[1];
+
+  train = test_train("in/wtp_train/conv.wtp");
+  check(test_read_row("in/single_sim/operations/CLP-Q1_cluster-1_operations.csv", operations_columns,
+                      N_OPERATIONS_COLS, params.setpoints),
+        "cannot read CLP-Q1_cluster-1_operations.csv");
+  stream_name = test_path("in/stream/CLP-influent-history.csv");
+  params.stream_filename = stream_name.c_str();
+  params.timeout_ms = STREAM_LIMIT_MS;
+
+  if ((fp = fopen(stream_name.c_str(), "r")) == NULL || (fout = tmpfile()) == NULL)
+  {
+    check(FALSE, "cannot read %s", stream_name.c_str());
+    return (test_report("test_stream"));
+  }
+  records = read_lines(fp);
+  fclose(fp);
+
+  n_bad = stream_mode(train, &params, fout);
+  rewind(fout);
+  results = read_lines(fout);
+  fclose(fout);
+
+  /* One result line per record, in order */
+  check(results.size() == records.size(), "%d result lines for %d records", (int)results.size() - 1,
+        (int)records.size() - 1);
+  check(n_bad >= 0, "stream_mode() failed");
+  if (results.size() != records.size() || n_bad < 0)
+    return (test_report("test_stream"));
+  header = csv_fields(results[0]);
+  in_header = csv_fields(records[0]);
+  check(header.size() == 5 + N_BATCH_COLS && header[1] == "time" && header[2] == "status" && header[4] == "latency_ms",
+        "result header %s", results[0].c_str());
+
+  start = snapshot_train(train, NULL);
+  for (r = 1; r < records.size(); r++)
+  {
+    fields = csv_fields(results[r]);
+    in_fields = csv_fields(records[r]);
+    if (!check(fields.size() == header.size(), "record %d: %s", (int)r, results[r].c_str()))
+      continue;
+    check(atoi(fields[0].c_str()) == (int)r && fields[1] == in_fields[0], "record %d is %s, time %s", (int)r,
+          fields[0].c_str(), fields[1].c_str());
+    check(fields[2] == "ok" || fields[2] == "timeout" || fields[2].compare(0, 8, "failed: ") == 0,
+          "record %d: status %s", (int)r, fields[2].c_str());
+    latency = atof(fields[4].c_str());
+    check(latency >= 0.0 && latency <= STREAM_LIMIT_MS + STREAM_SLACK_MS, "record %d: latency %.3f ms", (int)r, latency);
+    if (fields[2] != "ok")
+      continue;
+
+    /* The doses of batch_sim() */
+    train_influent(train, influent);
+    for (c = 0; c < in_header.size(); c++)
+      for (p = 0; p < N_SCENARIO_PARAMS; p++)
+        if (in_header[c] == influent_columns[p])
+          influent[p] = strtod(in_fields[c].c_str(), NULL);
+    batch_sim(train, start, influent, params.setpoints, values);
+    for (c = 0; c < N_BATCH_COLS; c++)
+      check(strtod(fields[5 + c].c_str(), NULL) == values[c], "record %d: %s %s != %.17g", (int)r, batch_columns[c],
+            fields[5 + c].c_str(), values[c]);
+    n_ok++;
+  }
+  check(n_ok > 0, "no record was dosed");
+  printf("test_stream: %d of %d records dosed within %d ms\n", n_ok, (int)records.size() - 1, STREAM_LIMIT_MS);
+
+  FreeTrainSnapshot(start);
+  FreeProcessTrain(train);
+  return (test_report("test_stream"));
+}
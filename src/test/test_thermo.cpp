@@ -0,0 +1,84 @@
+/* test_thermo.cpp -- The thermo_coef() table against the direct formulas
+*
+*  bin/makefile builds coef.cpp into this test with -DWTP_THERMO_TABLE=1,
+*  whatever the CPPFLAGS of the library, so the table is always tested.
+*  Over 0-40 deg C, every 0.001 deg C (nodes and points between them),
+*  each of the eleven coefficients of thermo_coef() must be within
+*  THERMO_TOLERANCE (relative) of its function in coef.cpp (Kw(), K_HCO3(),
+*  ...), the bound stated in coef.cpp.  The coefficients depend on
+*  temperature only.  Outside the table, and at the nodes, they must be
+*  those of the functions.
+*
+*  Usage: test_thermo.exe
+*/
+
+#include "test_wtp.h"
+
+#define THERMO_TOLERANCE 1.0e-6
+
+#if !WTP_THERMO_TABLE
+#error test_thermo.cpp is built with -DWTP_THERMO_TABLE=1, see bin/makefile
+#endif
+
+#define COEFFICIENTS                                                                          \
+  X(kw, Kw) X(k1, K_HCO3) X(k2, K_CO3) X(k_hocl, K_HOCl) X(k_nh3, K_NH3) X(k_mgoh, K_MgOH) \
+  X(k_mgoh2, K_MgOH2) X(k_mgoh2aq, K_MgOH2aq) X(k_caoh, K_CaOH) X(k_caco3, K_CaCO3)        \
+  X(k_caoh2aq, K_CaOH2aq)
+
+static struct WtpContext ctx;
+
+/* purpose: relative error of a coefficient. Unlike rel_diff(), not floored
+   at 1E-15: K_CaOH2aq and K_MgOH2aq are near 1E-28. */
+static double rel_error(double k, double direct)
+{
+  if (k == direct)
+    return (0.0);
+  return (fabs(k - direct) / fabs(direct));
+}
+
+// purpose: compare thermo_coef() at DegK with the functions, within tol; keeps the largest errors
+static void compare_at(double DegK, double tol, double *worst)
+{
+  const struct ThermoCoef *coef = thermo_coef(&ctx, DegK);
+  double d;
+  int c = 0;
+
+#define X(k, f)                                                                               \
+  d = rel_error(coef->k, f(DegK));                                                            \
+  if (d > worst[c])                                                                           \
+    worst[c] = d;                                                                             \
+  check(d <= tol, "%s at %.3f K: %.17g != %.17g (%s)", #k, DegK, coef->k, f(DegK), #f);       \
+  c++;
+  COEFFICIENTS
+#undef X
+}
+
+int main(int argc, char *argv[])
+{
+  static const char *names[] = {
+#define X(k, f) #f,
+      COEFFICIENTS
+#undef X
+  };
+  double worst[11] = {0.0}, exact[11] = {0.0};
+  double outside[] = {313.4, 318.15, 333.15}; /* below 0 deg C Kw() complains */
+  int i, c;
+
+  /* 0-40 deg C, every 0.001 deg C */
+  for (i = 0; i <= 40000; i++)
+    compare_at(273.15 + i * 0.001, THERMO_TOLERANCE, worst);
+
+  /* The nodes of the table, every 0.25 deg C, and temperatures outside it */
+  for (i = 0; i <= 160; i++)
+    compare_at(273.15 + i * 0.25, 1.0e-15, exact);
+  for (i = 0; i < (int)(sizeof(outside) / sizeof(outside[0])); i++)
+    compare_at(outside[i], 0.0, exact);
+
+  /* The coefficients are kept in the context for the last temperature */
+  check(thermo_coef(&ctx, 290.0) == thermo_coef(&ctx, 290.0) && ctx.thermo.k_DegK == 290.0,
+        "thermo_coef() does not keep the coefficients of the last temperature");
+
+  for (c = 0; c < 11; c++)
+    printf("test_thermo: %-10s largest relative error %.2e (tolerance %.1e)\n", names[c], worst[c], THERMO_TOLERANCE);
+  return (test_report("test_thermo"));
+}
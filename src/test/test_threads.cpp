@@ -0,0 +1,155 @@
+/* test_threads.cpp -- Process trains run on several threads at once
+*
+*  Every process train carries its own model context (struct WtpContext),
+*  so separate trains may be run on separate threads.  This test doses
+*  every pair of the CLP influent and operations files of in/single_sim
+*  with auto_dose() on clones of conv.wtp, first one pair after the other
+*  on one thread, then on TEST_THREADS threads at once, each thread taking
+*  every TEST_THREADS-th pair.  It checks that the doses and the effluent
+*  of every unit are bit-identical to the serial run.  The threaded run is
+*  repeated with the pairs in another order, so that different pairs meet
+*  on the threads.
+*
+*  Usage: test_threads.exe [repository directory]
+*/
+
+#include "test_wtp.h"
+#include "auto_dose.h"
+#include <thread>
+#include <vector>
+
+#define TEST_THREADS 8
+#define N_FILES 12
+
+struct DoseJob
+{                               /* One influent/operations pair       */
+  int influent, operations;     /*   Indices of the files             */
+  struct ProcessTrain *train;   /*   Dosed clone of the base train    */
+};
+
+static struct ProcessTrain *base;
+static double influent_wq[N_FILES][10];
+static double operations[N_FILES][3];
+
+// purpose: dose one pair on a clone of the base train, as batch_sim() does
+static void run_job(struct DoseJob *job)
+{
+  const double *w = influent_wq[job->influent];
+  const double *o = operations[job->operations];
+  struct UnitProcess *unit;
+
+  job->train = clone_train(base);
+  runmodel(job->train);
+  for (unit = FirstUnitProcess(job->train); unit; unit = NextUnitProcess(unit))
+  {
+    if (unit->type == INFLUENT)
+    {
+      unit->data.influent->alkalinity = w[0];
+      unit->data.influent->nh3 = w[1];
+      unit->data.influent->bromide = w[2];
+      unit->data.influent->calcium = w[3];
+      unit->data.influent->hardness = w[4];
+      unit->data.influent->pH = w[5];
+      unit->data.influent->temp = w[6];
+      unit->data.influent->toc = w[7];
+      unit->data.influent->ntu = w[8];
+      unit->data.influent->uv254 = w[9];
+    }
+  }
+  auto_dose(job->train, o[1], o[0], 0.2, 8.0, o[2], NULL);
+}
+
+// purpose: run every stride-th job from first on this thread
+static void run_jobs(std::vector<struct DoseJob> *jobs, int first, int stride)
+{
+  size_t j;
+
+  for (j = first; j < jobs->size(); j += stride)
+    run_job(&(*jobs)[j]);
+}
+
+// purpose: check that the doses of two dosed trains are bit-identical
+static void compare_doses(struct ProcessTrain *a, struct ProcessTrain *b, const char *what)
+{
+  struct UnitProcess *ua, *ub;
+  int i;
+
+  for (ua = FirstUnitProcess(a), ub = FirstUnitProcess(b), i = 0; ua && ub;
+       ua = NextUnitProcess(ua), ub = NextUnitProcess(ub), i++)
+  {
+    if (ua->type == LIME)
+      check(ua->data.lime->dose == ub->data.lime->dose, "%s: unit %d lime dose", what, i);
+    else if (ua->type == CARBON_DIOXIDE)
+      check(ua->data.chemical->co2 == ub->data.chemical->co2, "%s: unit %d CO2 dose", what, i);
+    else if (ua->type == ALUM)
+      check(ua->data.alum->dose == ub->data.alum->dose, "%s: unit %d alum dose", what, i);
+    else if (ua->type == HYPOCHLORITE)
+      check(ua->data.chemical->naocl == ub->data.chemical->naocl, "%s: unit %d NaOCl dose", what, i);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  static const char *const influent_columns[] = {"alk", "ammonia", "bromide", "calcium", "hard",
+                                                 "pH", "temp", "toc", "turb", "uv254"};
+  static const char *const operations_columns[] = {"alk_setpt", "pH_setpt", "DBPsf"};
+  static const char *const quarters[] = {"Q1", "Q2", "Q3", "Q4"};
+  static const char *const years[] = {"2009", "2014", "9999"};
+  std::vector<struct DoseJob> serial, threaded;
+  std::vector<std::thread> threads;
+  char name[128];
+  int i, k, t, pass;
+
+  if (argc > 1)
+    test_root = argv[1];
+
+  base = test_train("in/wtp_train/conv.wtp");
+  for (i = 0; i < N_FILES; i++)
+  {
+    snprintf(name, sizeof(name), "in/single_sim/influent/CLP-%s-%s_influent.csv", years[i / 4], quarters[i % 4]);
+    if (!check(test_read_row(name, influent_columns, 10, influent_wq[i]), "cannot read %s", name))
+      return (test_report("test_threads"));
+    snprintf(name, sizeof(name), "in/single_sim/operations/CLP-%s_cluster-%d_operations.csv", quarters[i / 3], i % 3 + 1);
+    if (!check(test_read_row(name, operations_columns, 3, operations[i]), "cannot read %s", name))
+      return (test_report("test_threads"));
+  }
+
+  /* Serial run */
+  for (i = 0; i < N_FILES; i++)
+    for (k = 0; k < N_FILES; k++)
+    {
+      struct DoseJob job = {i, k, NULL};
+      serial.push_back(job);
+    }
+  run_jobs(&serial, 0, 1);
+
+  for (pass = 0; pass < 2; pass++)
+  {
+    /* Threaded run, the pairs in order or in reverse order */
+    threaded.clear();
+    for (i = 0; i < (int)serial.size(); i++)
+      threaded.push_back(serial[pass == 0 ? i : serial.size() - 1 - i]);
+    for (i = 0; i < (int)threaded.size(); i++)
+      threaded[i].train = NULL;
+    threads.clear();
+    for (t = 0; t < TEST_THREADS; t++)
+      threads.push_back(std::thread(run_jobs, &threaded, t, TEST_THREADS));
+    for (t = 0; t < TEST_THREADS; t++)
+      threads[t].join();
+
+    for (i = 0; i < (int)threaded.size(); i++)
+    {
+      const struct DoseJob *s = &serial[pass == 0 ? i : serial.size() - 1 - i];
+
+      snprintf(name, sizeof(name), "pass %d influent %d operations %d", pass, s->influent, s->operations);
+      compare_doses(threaded[i].train, s->train, name);
+      compare_effluents(threaded[i].train, s->train, 0.0, name);
+      FreeProcessTrain(threaded[i].train);
+    }
+  }
+
+  for (i = 0; i < (int)serial.size(); i++)
+    FreeProcessTrain(serial[i].train);
+  FreeProcessTrain(base);
+  return (test_report("test_threads"));
+}
@@ -0,0 +1,229 @@
+/* test_trace.cpp -- trace_append(), close_trace() and read_trace_table()
+*
+*  TRACE_THREADS threads append TRACE_THREAD_ROWS rows each to one trace
+*  at once, several times TRACE_QUEUE_ROWS in all, so that the queue of
+*  trace_append() fills and the appenders wait for the writer thread
+*  (close_trace() notes how often).  The file read back must hold every
+*  row once, with the rows of each thread in the order they were
+*  appended, and n_rows in its header must be the row count.
+*
+*  A file that was not closed is made from a copy of the closed file,
+*  with n_rows set back to its value while being written and the file cut
+*  at every row group boundary and inside every row group.  It must be
+*  read up to its last whole row group, and the same file with n_rows set
+*  must be rejected as truncated.
+*
+*  Usage: test_trace.exe [repository directory]
+*/
+
+#include "test_wtp.h"
+#include "wtp_optimize.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <thread>
+#include <vector>
+
+#define TRACE_THREADS 4
+#define TRACE_THREAD_ROWS (3 * TRACE_QUEUE_ROWS + 1001)
+#define TRACE_COLS 3
+
+/* Layout of a trace file, see trace_store.cpp */
+struct FileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t n_cols;
+  uint32_t block_rows;
+  uint64_t n_rows;
+};
+
+// purpose: append the rows of one thread: thread, row of the thread, a value of both
+static void append_rows(struct TraceWriter *trace, int t)
+{
+  double row[TRACE_COLS];
+  int k;
+
+  for (k = 0; k < TRACE_THREAD_ROWS; k++)
+  {
+    row[0] = t;
+    row[1] = k;
+    row[2] = t * 1e6 + k * 0.5;
+    trace_append(trace, row);
+  }
+}
+
+// purpose: the text written to a temporary error stream
+static std::string stream_text(FILE *fp)
+{
+  std::string text;
+  char buffer[1024];
+  size_t n;
+
+  rewind(fp);
+  while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+    text.append(buffer, n);
+  return (text);
+}
+
+// purpose: bytes of a file
+static std::string read_bytes(const char *name)
+{
+  std::string bytes;
+  FILE *fp;
+
+  if ((fp = fopen(name, "rb")) != NULL)
+  {
+    bytes = stream_text(fp);
+    fclose(fp);
+  }
+  return (bytes);
+}
+
+// purpose: write bytes to a file
+static void write_bytes(const char *name, const std::string &bytes)
+{
+  FILE *fp;
+
+  check((fp = fopen(name, "wb")) != NULL && fwrite(bytes.data(), 1, bytes.size(), fp) == bytes.size(),
+        "cannot write %s", name);
+  if (fp != NULL)
+    fclose(fp);
+}
+
+// purpose: read a damaged copy of the trace; rows are the whole rows it holds
+static void read_cut(const char *name, const std::string &bytes, size_t size, long rows,
+                     const struct CsvTable *full)
+{
+  std::string cut = bytes.substr(0, size);
+  struct CsvTable table;
+  uint64_t n_rows = UINT64_MAX;
+  FILE *ferr = tmpfile();
+  int ok;
+
+  /* Not closed */
+  memcpy(&cut[offsetof(struct FileHeader, n_rows)], &n_rows, sizeof(n_rows));
+  write_bytes(name, cut);
+  ok = read_trace_table(name, &table, ferr);
+  check(ok == TRUE, "file not closed, cut to %d bytes: read_trace_table() failed", (int)size);
+  check(table.n_rows == rows, "file not closed, cut to %d bytes: %ld rows read, not %ld", (int)size, table.n_rows,
+        rows);
+  check(ok == FALSE || stream_text(ferr).find("was not closed") != std::string::npos,
+        "file not closed, cut to %d bytes: no note", (int)size);
+  if (ok == TRUE && table.n_rows == rows)
+    check(table.values.size() == (size_t)rows * TRACE_COLS &&
+              memcmp(table.values.data(), full->values.data(), table.values.size() * sizeof(double)) == 0,
+          "file not closed, cut to %d bytes: rows differ from the closed file", (int)size);
+  fclose(ferr);
+
+  /* Closed, but cut */
+  if (rows < full->n_rows)
+  {
+    n_rows = (uint64_t)full->n_rows;
+    memcpy(&cut[offsetof(struct FileHeader, n_rows)], &n_rows, sizeof(n_rows));
+    write_bytes(name, cut);
+    ferr = tmpfile();
+    check(read_trace_table(name, &table, ferr) == FALSE, "closed file cut to %d bytes: read_trace_table() accepted it",
+          (int)size);
+    fclose(ferr);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  std::vector<std::string> names;
+  std::vector<std::thread> threads;
+  std::vector<long> next(TRACE_THREADS, 0);
+  struct TraceWriter *trace;
+  struct FileHeader header;
+  struct CsvTable table;
+  std::string bytes, text;
+  char name[64], cut_name[64];
+  size_t offset, group;
+  long r, rows;
+  int t, k;
+  FILE *ferr;
+
+  if (argc > 1)
+    test_root = argv[1];
+
+  snprintf(name, sizeof(name), "test_trace_%d.trace", (int)getpid());
+  snprintf(cut_name, sizeof(cut_name), "test_trace_%d_cut.trace", (int)getpid());
+  names.push_back("thread");
+  names.push_back("row");
+  names.push_back("value");
+
+  /* Appends from several threads */
+  ferr = tmpfile();
+  if (!check((trace = open_trace(name, names, stdout)) != NULL, "open_trace(%s) failed", name))
+    return (test_report("test_trace"));
+  for (t = 0; t < TRACE_THREADS; t++)
+    threads.push_back(std::thread(append_rows, trace, t));
+  for (t = 0; t < TRACE_THREADS; t++)
+    threads[t].join();
+  check(close_trace(trace, ferr) == TRUE, "close_trace() failed");
+  text = stream_text(ferr);
+  fclose(ferr);
+  check(text.find("queue was full") != std::string::npos, "the queue of trace_append() was never full:\n%s",
+        text.c_str());
+
+  /* The rows read back */
+  ferr = tmpfile();
+  check(read_trace_table(name, &table, ferr) == TRUE, "read_trace_table(%s) failed", name);
+  check(stream_text(ferr).empty(), "read_trace_table() of a closed file wrote:\n%s", stream_text(ferr).c_str());
+  fclose(ferr);
+  check(table.n_cols == TRACE_COLS && table.names == names, "column names differ");
+  check(table.n_rows == (long)TRACE_THREADS * TRACE_THREAD_ROWS, "%ld rows read, not %ld", table.n_rows,
+        (long)TRACE_THREADS * TRACE_THREAD_ROWS);
+  for (r = 0; r < table.n_rows && (size_t)(r + 1) * TRACE_COLS <= table.values.size(); r++)
+  {
+    const double *row = &table.values[(size_t)r * TRACE_COLS];
+
+    t = (int)row[0];
+    if (!check(t >= 0 && t < TRACE_THREADS && row[0] == t, "row %ld: thread %g", r, row[0]))
+      break;
+    if (!check(row[1] == next[t] && row[2] == t * 1e6 + next[t] * 0.5,
+               "row %ld: thread %d row %g value %.17g, expected row %ld", r, t, row[1], row[2], next[t]))
+      break;
+    next[t]++;
+  }
+  for (t = 0; t < TRACE_THREADS; t++)
+    check(next[t] == TRACE_THREAD_ROWS, "thread %d: %ld of %d rows read in order", t, next[t], TRACE_THREAD_ROWS);
+
+  /* n_rows in the header */
+  bytes = read_bytes(name);
+  if (!check(bytes.size() > sizeof(header) + TRACE_COLS * TRACE_NAME_LEN, "%s is too short", name))
+    return (test_report("test_trace"));
+  memcpy(&header, bytes.data(), sizeof(header));
+  check(header.n_rows == (uint64_t)table.n_rows && header.block_rows == TRACE_BLOCK_ROWS &&
+            header.n_cols == TRACE_COLS,
+        "header: n_rows %llu, block_rows %u, n_cols %u", (unsigned long long)header.n_rows, header.block_rows,
+        header.n_cols);
+
+  /* Files that were not closed, cut at and inside every row group */
+  offset = sizeof(header) + TRACE_COLS * TRACE_NAME_LEN;
+  for (rows = 0; offset < bytes.size(); rows += k)
+  {
+    uint32_t n[2];
+
+    memcpy(n, &bytes[offset], sizeof(n));
+    k = (int)n[0];
+    group = sizeof(n) + (size_t)k * TRACE_COLS * sizeof(double);
+    if (!check(k > 0 && k <= TRACE_BLOCK_ROWS && offset + group <= bytes.size(), "bad row group at %d",
+               (int)offset))
+      break;
+    read_cut(cut_name, bytes, offset, rows, &table);
+    read_cut(cut_name, bytes, offset + 4, rows, &table);
+    read_cut(cut_name, bytes, offset + sizeof(n), rows, &table);
+    read_cut(cut_name, bytes, offset + group / 2, rows, &table);
+    read_cut(cut_name, bytes, offset + group - 1, rows, &table);
+    offset += group;
+  }
+  check(rows == table.n_rows, "row groups hold %ld rows, not %ld", rows, table.n_rows);
+  read_cut(cut_name, bytes, bytes.size(), table.n_rows, &table);
+
+  remove(name);
+  remove(cut_name);
+  return (test_report("test_trace"));
+}
@@ -0,0 +1,181 @@
+/* test_wtp.h -- Helpers of the test programs
+*
+*  The tests are built and run from the bin directory with "make test"
+*  (see bin/makefile).  Each test program takes the repository directory
+*  as its optional argument (".." by default), prints a line for every
+*  check that fails and a summary line, and exits with status 1 if a
+*  check failed.
+*
+*  The following functions are in this file:
+*    check()
+*    test_report()
+*    test_path()
+*    test_train()
+*    test_read_row()
+*    test_set_influent()
+*    rel_diff()
+*    compare_effluents()
+*/
+#ifndef TEST_WTP_H
+#define TEST_WTP_H 1
+
+#include "wtp.h"
+#include <stdarg.h>
+#include <string>
+
+/* Effluent terms compared by compare_effluents() */
+#define TEST_EFFLUENT_TERMS                                                                  \
+  X(DegK) X(Flow) X(pH) X(TOC) X(UV) X(UV_out) X(SUVA) X(Br) X(Alk) X(NH3) X(Turbidity)     \
+  X(FreeCl2) X(NH2Cl) X(NHCl2) X(CHCl3) X(CHBrCl2) X(CHBr2Cl) X(CHBr3) X(TTHM) X(MCAA)      \
+  X(DCAA) X(TCAA) X(MBAA) X(DBAA) X(BCAA) X(BDCAA) X(DBCAA) X(TBAA) X(HAA5) X(HAA6) X(HAA9) \
+  X(CO2_aq) X(Ca_aq) X(Ca_solid) X(Mg_aq) X(Mg_solid) X(solids) X(AlumDose) X(LimeDose)    \
+  X(CBminusCA) X(hours) X(ct_ratio) X(ct_ratio_v) X(cl2dose) X(BrO3) X(chlorite)
+
+static int test_checks = 0;   /* checks made   */
+static int test_failures = 0; /* checks failed */
+static std::string test_root = "..";
+
+// purpose: count a check, and print the printf() style message if it failed. Returns ok.
+static inline int check(int ok, const char *format, ...)
+{
+  va_list args;
+
+  test_checks++;
+  if (!ok)
+  {
+    test_failures++;
+    printf("FAIL: ");
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+  }
+  return (ok);
+}
+
+// purpose: print the summary line of a test. Returns the exit status of the test.
+static inline int test_report(const char *test)
+{
+  printf("%s: %d checks, %d failed\n", test, test_checks, test_failures);
+  return (test_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+// purpose: path of a file of the repository, e.g. test_path("in/wtp_train/conv.wtp")
+static inline std::string test_path(const char *name)
+{
+  return (test_root + "/" + name);
+}
+
+// purpose: read a process train from a .wtp file of the repository; exits if it cannot.
+static inline struct ProcessTrain *test_train(const char *name)
+{
+  struct ProcessTrain *train;
+
+  if ((train = AllocProcessTrain()) == NULL || open_wtp(test_path(name).c_str(), train, NULL) == FALSE)
+  {
+    printf("FAIL: cannot read %s\n", test_path(name).c_str());
+    exit(EXIT_FAILURE);
+  }
+  return (train);
+}
+
+/* purpose: read the values of the named columns from a CSV file of the
+   repository, a header line and one line of values. Returns TRUE/FALSE. */
+static inline int test_read_row(const char *name, const char *const *columns, int n, double *values)
+{
+  char header[512], line[512];
+  char *h, *v;
+  int found = 0, c;
+  FILE *fp;
+
+  if ((fp = fopen(test_path(name).c_str(), "r")) == NULL)
+    return (FALSE);
+  if (fgets(header, sizeof(header), fp) == NULL || fgets(line, sizeof(line), fp) == NULL)
+  {
+    fclose(fp);
+    return (FALSE);
+  }
+  fclose(fp);
+  for (h = strtok(header, ",\r\n"), v = line; h != NULL; h = strtok(NULL, ",\r\n"))
+  {
+    for (c = 0; c < n && strcmp(h, columns[c]) != 0; c++)
+      ;
+    if (c < n)
+    {
+      values[c] = strtod(v, NULL);
+      found++;
+    }
+    if ((v = strchr(v, ',')) == NULL)
+      break;
+    v++;
+  }
+  return (found == n);
+}
+
+// purpose: set the influent of a train from a file of in/single_sim/influent. Returns TRUE/FALSE.
+static inline int test_set_influent(struct ProcessTrain *train, const char *name)
+{
+  static const char *const columns[] = {"alk", "ammonia", "bromide", "calcium", "hard",
+                                        "pH", "temp", "toc", "turb", "uv254"};
+  double value[10];
+  struct UnitProcess *unit;
+  struct Influent *inf;
+
+  if (test_read_row(name, columns, 10, value) == FALSE)
+    return (FALSE);
+  for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit))
+  {
+    if (unit->type != INFLUENT)
+      continue;
+    inf = unit->data.influent;
+    inf->alkalinity = value[0];
+    inf->nh3 = value[1];
+    inf->bromide = value[2];
+    inf->calcium = value[3];
+    inf->hardness = value[4];
+    inf->pH = value[5];
+    inf->temp = value[6];
+    inf->toc = value[7];
+    inf->ntu = value[8];
+    inf->uv254 = value[9];
+  }
+  return (TRUE);
+}
+
+// purpose: relative difference of two values, 0 when they are equal (also when both are 0).
+static inline double rel_diff(double a, double b)
+{
+  double scale = fabs(a) > fabs(b) ? fabs(a) : fabs(b);
+
+  if (a == b)
+    return (0.0);
+  if (a != a || b != b)
+    return (HUGE_VAL); /* NaN */
+  return (fabs(a - b) / (scale > 1e-15 ? scale : 1e-15));
+}
+
+/* purpose: check that the effluents of every unit of two runs of a train
+   agree within a relative tolerance (0 for bit-identical results).
+   Returns the largest relative difference. */
+static inline double compare_effluents(struct ProcessTrain *a, struct ProcessTrain *b, double tol, const char *what)
+{
+  struct UnitProcess *ua, *ub;
+  double d, worst = 0.0;
+  int i;
+
+  for (ua = FirstUnitProcess(a), ub = FirstUnitProcess(b), i = 0; ua && ub;
+       ua = NextUnitProcess(ua), ub = NextUnitProcess(ub), i++)
+  {
+#define X(term)                                                                                 \
+    d = rel_diff(ua->eff.term, ub->eff.term);                                                   \
+    if (d > worst)                                                                              \
+      worst = d;                                                                                \
+    check(d <= tol, "%s: unit %d %s %.17g != %.17g", what, i, #term, ua->eff.term, ub->eff.term);
+    TEST_EFFLUENT_TERMS
+#undef X
+  }
+  check(ua == NULL && ub == NULL, "%s: trains of different lengths", what);
+  return (worst);
+}
+
+#endif
@@ -0,0 +1,80 @@
+/* trace_main.cpp -- Command line reader of trace files
+*
+*  Usage: trace_reader.exe [-c name,name,...] <trace.bin> [output.csv]
+*
+*  Exports a trace file written with the "-t" option of wtp-optimize.exe
+*  (see trace_store.cpp) as a CSV file, to stdout if no file is given.
+*  With -c only the named columns are exported, in the order given.
+*  Values are printed with 17 significant digits, so they read back as
+*  the doubles of the trace.
+*/
+
+#include "wtp_optimize.h"
+
+int main(int argc, char *argv[])
+{
+    struct CsvTable table;
+    std::vector<std::string> columns;
+    std::vector<int> index;
+    std::string list, name;
+    FILE *fout = stdout;
+    size_t c;
+    long r;
+    int opt, e = 0;
+
+    while ((opt = getopt(argc, argv, "c:")) != -1)
+    {
+        if (opt != 'c')
+        {
+            argc = 0; // print usage
+            break;
+        }
+        list = optarg;
+    }
+    if (argc - optind < 1 || argc - optind > 2)
+    {
+        fprintf(stderr, "Usage: %s [-c name,name,...] <trace.bin> [output.csv]\n", argv[0]);
+        return (EXIT_FAILURE);
+    }
+
+    if (read_trace_table(argv[optind], &table, stderr) == FALSE)
+        return (EXIT_FAILURE);
+
+    /* Columns to export */
+    std::stringstream names(list);
+    while (std::getline(names, name, ','))
+        columns.push_back(name);
+    if (columns.empty())
+        columns = table.names;
+    std::vector<const char *> wanted;
+    for (c = 0; c < columns.size(); c++)
+        wanted.push_back(columns[c].c_str());
+    index.resize(columns.size());
+    if (csv_columns(&table, wanted.data(), (int)wanted.size(), index.data(), stderr) == FALSE)
+        return (EXIT_FAILURE);
+
+    if (argc - optind == 2 && (fout = fopen(argv[optind + 1], "w")) == NULL)
+    {
+        fprintf(stderr, "Error: cannot open %s.\n", argv[optind + 1]);
+        return (EXIT_FAILURE);
+    }
+
+    for (c = 0; c < columns.size(); c++)
+        e |= fprintf(fout, "%s%s", c ? "," : "", columns[c].c_str()) < 0;
+    e |= fprintf(fout, "\n") < 0;
+    for (r = 0; r < table.n_rows; r++)
+    {
+        for (c = 0; c < columns.size(); c++)
+            e |= fprintf(fout, "%s%.17g", c ? "," : "", table.values[r * table.n_cols + index[c]]) < 0;
+        e |= fprintf(fout, "\n") < 0;
+    }
+
+    if (fout != stdout && fclose(fout) != 0)
+        e = 1;
+    if (e)
+    {
+        fprintf(stderr, "Error: could not write the CSV file.\n");
+        return (EXIT_FAILURE);
+    }
+    return (EXIT_SUCCESS);
+}
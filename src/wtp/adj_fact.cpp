@@ -8,12 +8,12 @@
 //******************************************************************
 
 /* Define pH adjustment function */
-double f_adj_pH(double pH)
+double f_adj_pH(double pH, struct UnitProcess *unit)
 {
   double Adj_pH;
   double m, b;
 
-  if (softflag == TRUE)
+  if (unit->eff.ctx->softflag == TRUE)
   { //Use correction factors for Softening Plants (at all locations
     //in the plant - thus the use of 'softflag').  Based on analysis of ph
     // at unit processes with a volume, excluding plant-months with negative
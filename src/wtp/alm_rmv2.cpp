@@ -19,6 +19,7 @@ void alum_rmv(struct UnitProcess *unit)
 *  5. The inputs are not range checked within this fuction.  Table A-11
 *     lists the ranges of the inputs that were used in developing the
 *     equations.
+*  6. The results are memoized per unit on the inputs, see memo_wtp.cpp.
 *
 * Documentation and code by WJS, December 1998.
 * Model parameters corrected to 'General' on Table 3 of Edwards (1997) by WJR, August 2017.
@@ -57,6 +58,8 @@ void alum_rmv(struct UnitProcess *unit)
 
   /* Internal: */
   register struct Effluent *eff;
+  double key[9], out[6];
+  const double *memo;
 
   if (unit != NULL)
   {
@@ -76,19 +79,41 @@ void alum_rmv(struct UnitProcess *unit)
 
     if (unit->type == RAPID_MIX && AlumDose > 0.0 && inf_toc > 0.0)
     {
+      key[0] = pH;
+      key[1] = inf_toc;
+      key[2] = inf_uv;
+      key[3] = inf_uv_out;
+      key[4] = eff->AlumDose;
+      key[5] = eff->FericDose;
+      key[6] = eff->toc_sludge;
+      key[7] = eff->alum_to_sludge;
+      key[8] = eff->iron_to_sludge;
+      if ((memo = memo_find(unit, MEMO_ALUM_RMV, key, 9)) != NULL)
+      { /* See note 6 */
+        eff->TOC = memo[0];
+        eff->UV = memo[1];
+        eff->UV_out = memo[2];
+        eff->toc_sludge = memo[3];
+        eff->alum_to_sludge = memo[4];
+        eff->iron_to_sludge = memo[5];
+        eff->AlumDose = 0.0;
+        eff->FericDose = 0.0;
+        return;
+      }
+
       suva = 100 * inf_uv / inf_toc;
       fns_doc_inf = K1 * suva + K2;
       doc_non_sorb = fns_doc_inf * inf_toc;
       doc_sorb_inf = inf_toc - doc_non_sorb;
-      a = x3 * pow(pH, 3.0) + x2 * pow(pH, 2.0) + x1 * pH;
+      a = x3 * wtp_pow(pH, 3.0) + x2 * wtp_pow(pH, 2.0) + x1 * pH;
 
-      term1 = pow(((doc_sorb_inf * b) - (b * a * AlumDose) - 1), 2.0) + (4.0 * b * doc_sorb_inf);
+      term1 = wtp_pow(((doc_sorb_inf * b) - (b * a * AlumDose) - 1), 2.0) + (4.0 * b * doc_sorb_inf);
 
       term2 = 1 + (a * b * AlumDose) - (doc_sorb_inf * b);
 
       /* Calculate both solutions of quadratic equation */
-      doc_sorb_eff1 = (term2 - pow(term1, 0.5)) / (-2.0 * b);
-      doc_sorb_eff2 = (term2 + pow(term1, 0.5)) / (-2.0 * b);
+      doc_sorb_eff1 = (term2 - wtp_pow(term1, 0.5)) / (-2.0 * b);
+      doc_sorb_eff2 = (term2 + wtp_pow(term1, 0.5)) / (-2.0 * b);
 
       /* If one of the answers is negative, choose the other as the solution */
       if (doc_sorb_eff1 >= 0.0)
@@ -128,10 +153,10 @@ void alum_rmv(struct UnitProcess *unit)
       /*New equation*/
       if (pH < 3.0)
         pH = 3.0; /*self-protection*/
-      term1 = pow(inf_uv, 1.0894);
-      term1_out = pow(inf_uv_out, 1.0894);
-      term2 = pow(AlumDose, 0.305);
-      term3 = pow(pH, -0.9513);
+      term1 = wtp_pow(inf_uv, 1.0894);
+      term1_out = wtp_pow(inf_uv_out, 1.0894);
+      term2 = wtp_pow(AlumDose, 0.305);
+      term3 = wtp_pow(pH, -0.9513);
       delta_uv = 5.7154 * term1 * term2 * term3;
       delta_uv_out = 5.7154 * term1_out * term2 * term3;
       eff->UV -= delta_uv;
@@ -145,6 +170,14 @@ void alum_rmv(struct UnitProcess *unit)
       if (eff->UV_out > inf_uv_out)
         eff->UV_out = inf_uv_out;
 
+      out[0] = eff->TOC;
+      out[1] = eff->UV;
+      out[2] = eff->UV_out;
+      out[3] = eff->toc_sludge;
+      out[4] = eff->alum_to_sludge;
+      out[5] = eff->iron_to_sludge;
+      memo_store(unit, MEMO_ALUM_RMV, key, 9, out, 6);
+
     } /* End if(unit->type == RAPID_MIX && AlumDose > 0.0 && inf_toc > 0.0)..*/
 
   } /* End if(unit != NULL)...*/
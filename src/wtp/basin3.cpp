@@ -24,7 +24,6 @@ void basn_dbp(struct UnitProcess *unit)
   double ncstrs;            /* Number of CSTRs that the unit process basin is
 			   modeled as (calc.) */
   double clo2_avg = 0.0;    /* Average concentration for ClO2 for CT calcs */
-  int i;
 
   register struct Effluent *eff;
   struct Basin *basin;
@@ -58,36 +57,26 @@ void basn_dbp(struct UnitProcess *unit)
 
     t_ten = t_ten_theo * theo_res_time; //minutes
 
-    // Using new_cl2decay() in the framework of CFSTRs in series
+    // Using cl2decay_cascade() in the framework of CFSTRs in series
     //--------------------------------------------------------------------------------
     if (eff->cl2cnt > 0.0)
     {
       ncstrs = ncstr(t_ten_theo);
       rxnhours = mean_theo * theo_res_time / (60.0 * ncstrs); //hours
-      for (i = 1; i <= ncstrs; i++)
-      {
-        new_cl2decay(unit, rxnhours);
-        if ((eff->FreeCl2 + eff->NH2Cl) > 0.0)
-          eff->hours += rxnhours;
-      }
+      cl2decay_cascade(unit, (int)ncstrs, rxnhours);
 
       //Calculate DBP formation
       choose_dbpmodel(unit); /* NEW CODE (WJS, 10/98) */
     }
 
-    // Using clo2_decay() in the framework of CFSTRs in series
+    // Using clo2_cascade() in the framework of CFSTRs in series
     //--------------------------------------------------------------------------------
     if (eff->clo2_cntr > 0)
     {
       ncstrs = ncstr(t_ten_theo);
       rxnminutes = mean_theo * theo_res_time / ncstrs; //minutes
 
-      for (i = 1; i <= ncstrs; i++)
-      {
-        clo2_decay(unit, rxnminutes);
-        clo2_avg += eff->clo2_res;
-        eff->clo2_minutes += rxnminutes;
-      }
+      clo2_avg = clo2_cascade(unit, (int)ncstrs, rxnminutes);
       eff->clo2_avg = clo2_avg / ncstrs;
     }
 
@@ -114,3 +114,51 @@ void breakpt(struct UnitProcess *unit)
   if (change_ph_flag)
     phchange(unit, TRUE);
 }
+
+void breakpt_lanes(struct EffluentLanes *lanes)
+/*
+* Purpose: breakpt() for every lane of a batch.
+*
+* Notes:
+*  1. The reactions are computed for all lanes and selected per lane.
+*  2. Unlike breakpt(), phchange() is not called for the lanes where
+*     breakpoint occurred.  runmodel_lanes() calls phchange_lanes() for
+*     every lane right after this function, which gives the same result.
+*/
+{
+  int l;
+
+  for (l = 0; l < lanes->n; l++)
+  {
+    double freecl2 = lanes->FreeCl2[l];
+    double nh3 = lanes->NH3[l];
+    double nh2cl = lanes->NH2Cl[l];
+    double CBminusCA = lanes->CBminusCA[l];
+    double f, n, a;
+    int r1, r2, cl2_limits;
+
+    /* Reaction 1, formation of monochloramine */
+    f = freecl2;
+    n = nh3;
+    a = nh2cl;
+    r1 = (f > 0.0) && (n > 0.0);
+    cl2_limits = f < n;
+    nh2cl = r1 ? (cl2_limits ? a + f : a + n) : a;
+    nh3 = r1 ? (cl2_limits ? n - f : 0.0) : n;
+    freecl2 = r1 ? (cl2_limits ? 0.0 : f - n) : f;
+
+    /* Reaction 2, breakpoint */
+    f = freecl2;
+    a = nh2cl;
+    r2 = (f > 0.0) && (a > 0.0);
+    cl2_limits = f < 0.5 * a;
+    nh2cl = r2 ? (cl2_limits ? a - 2.0 * f : 0.0) : a;
+    CBminusCA = r2 ? (cl2_limits ? CBminusCA - 3.0 * f : CBminusCA - 1.5 * a) : CBminusCA;
+    freecl2 = r2 ? (cl2_limits ? 0.0 : f - 0.5 * a) : f;
+
+    lanes->FreeCl2[l] = freecl2;
+    lanes->NH3[l] = nh3;
+    lanes->NH2Cl[l] = nh2cl;
+    lanes->CBminusCA[l] = CBminusCA;
+  }
+}
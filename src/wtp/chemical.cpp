@@ -318,8 +318,8 @@ void o3add(struct UnitProcess *unit)
 
   if (o3_dose > 0.0)
   {
-    eff_uv = 0.622 * pow(uv, 0.931) * pow(o3_dose / toc, -0.252);
-    eff_uv_out = 0.622 * pow(uv_out, 0.931) * pow(o3_dose / toc, -0.252);
+    eff_uv = 0.622 * wtp_pow(uv, 0.931) * wtp_pow(o3_dose / toc, -0.252);
+    eff_uv_out = 0.622 * wtp_pow(uv_out, 0.931) * wtp_pow(o3_dose / toc, -0.252);
     if (eff_uv > uv)
       eff_uv = uv;
     if (eff_uv_out > uv_out)
@@ -1,6 +1,91 @@
-/* Cl2Decay3.c */
+/* Cl2Decay3.c -- Chlorine and chloramine decay in CFSTRs in series
+*
+*  The following functions are in this file:
+*    new_cl2decay()     Decay in one CFSTR
+*    cl2decay_cascade() Decay in a series of CFSTRs
+*    cl2decay_start()   First part of cl2decay_cascade()
+*    cl2decay_tanks()   Second part of cl2decay_cascade()
+*/
 #include "wtp.h"
 
+static void cl2decay_coef(struct Effluent *eff, int free_cl2, struct Cl2DecayCoef *coef)
+/*
+* Purpose: Decay parameters of new_cl2decay() for the water in 'eff'.  They
+*   depend only on TOC, UV, and the chlorine dose, which do not change as
+*   the water moves through the CFSTRs of a unit process.  The free chlorine
+*   parameters (one pow()) are only set if 'free_cl2' is TRUE.
+*/
+{
+  struct WtpContext *ctx = eff->ctx;
+  double toc, uv, cl2dose, Co, k2;
+
+  toc = eff->TOC;
+  uv = eff->UV;
+  cl2dose = eff->cl2dose;
+
+  /*Self-protection Statements*/
+  if (uv < 0.001)
+    uv = 0.001;
+  if (toc < 0.1)
+    toc = 0.1;
+  if (cl2dose > 50.0)
+    cl2dose = 50.0;
+  if (cl2dose <= 0.0)
+    cl2dose = 0.09;
+
+  Co = cl2dose;
+
+  if (free_cl2)
+  {
+    //Parameters for Free Cl2 decay
+    if (ctx->swflag == TRUE && (ctx->rwdbpflag == TRUE || ctx->owdbpflag == TRUE))
+    { // use raw water decay equations
+      coef->free_a1 = -0.817 * Co;
+      k2 = -2.2808 * wtp_pow((Co / uv), -1.2971);
+    }
+    else
+    { //use coagulated water decay equations for coag. water, gac-treated or mem-treated water, or groundwater
+      coef->free_a1 = -0.8408 * Co;
+      k2 = -0.404 * wtp_pow((Co / uv), -0.918);
+    }
+    coef->free_a2 = k2 * toc;
+  }
+
+  //Parameters for chloramine decay
+  coef->comb_a1 = -0.990 * Co;
+  coef->comb_a2 = -0.015 * uv;
+}
+
+static double cfstr_decay(double alpha1, double alpha2, double Cin, double cfstr_time)
+/*
+* Purpose: Residual (mg/L as Cl2) at the effluent of one CFSTR with influent
+*   residual 'Cin', from the quadratic solution described in new_cl2decay().
+*   Residuals below 0.1 mg/L are set to zero.
+*/
+{
+  double b, c;
+  double Ctout;
+
+  //Quadratic equation parameters (a = 1)
+  b = alpha1 - Cin + alpha2 * cfstr_time;
+  c = -alpha1 * Cin;
+
+  Ctout = (-b - sqrt(b * b - 4.0 * c)) / 2.0;
+
+  //Check that answer makes sense
+  if (Ctout > Cin)
+    Ctout = Cin;
+  if (Ctout < 0.0)
+    Ctout = 0.0;
+
+  /* Limit chlorine residual to 0.1 mg/L */
+  if (Ctout < 0.1)
+    Ctout = 0.0;
+
+  return (Ctout);
+}
+
+
 void new_cl2decay(struct UnitProcess *unit, double cfstr_time)
 /*
 * Purpose:
@@ -54,28 +139,11 @@ void new_cl2decay(struct UnitProcess *unit, double cfstr_time)
 * Documentation and Code by WJS - 05/2001
 */
 {
-  //FILE *fptr2;
-
-  /* Inputs: ******************************************************/
-  double toc;     /*  "      "    "                     (mg/L) */
-  double uv;      /*  "      "    "                     (1/cm) */
-                  //  double  hours;    /* Cumulative hours to CFSTR influent. (hrs) */
-  double cl2dose; /* Total chlorine                     (mg/l) */
-
   /* Inputs changed (Outputs) *************************************/
   double cl2res;   /* Free chlorine residual     (mg/L) as Cl2 */
   double comb_cl2; /* Combined chlorine residual (mg/L) as Cl2 */
 
-  /* Internal *****************************************************/
-  double alpha1, alpha2, k2;
-  double a, b, c;
-  double Co;
-  //  double  Ctin;
-  double Ctout;
-  //  double  DeltaCt;
-  //  double  t;
-  //  double guessCt,prev_guessCt,dose_fract,calcCt;
-
+  struct Cl2DecayCoef coef;
   struct Effluent *eff;
 
   /* Update [FreeCl] and [NH2Cl] using breakpoint estimation. */
@@ -83,107 +151,91 @@ void new_cl2decay(struct UnitProcess *unit, double cfstr_time)
 
   /* Get inputs from UnitProcess structure */
   eff = &unit->eff;
-  toc = eff->TOC;
-  uv = eff->UV;
-  //  hours    = eff->hours;
   cl2res = eff->FreeCl2 * MW_Cl2;
-  cl2dose = eff->cl2dose;
   comb_cl2 = eff->NH2Cl * MW_Cl2;
 
-  /*Self-protection Statements*/
-  if (uv < 0.001)
-    uv = 0.001;
-  if (toc < 0.1)
-    toc = 0.1;
-  if (cl2dose > 50.0)
-    cl2dose = 50.0;
-  if (cl2dose <= 0.0)
-    cl2dose = 0.09;
-
-  Co = cl2dose;
+  cl2decay_coef(eff, cl2res > 0.0, &coef);
 
-  /* Estimate free chlorine decay *********************************************/
+  /* Estimate free chlorine decay */
   if (cl2res > 0.0)
-  {
-
-    //Parameters for Free Cl2 decay
-    if (swflag == TRUE && (rwdbpflag == TRUE || owdbpflag == TRUE))
-    { // use raw water decay equations
-      alpha1 = -0.817 * Co;
-      k2 = -2.2808 * pow((Co / uv), -1.2971);
-    }
-    else
-    { //use coagulated water decay equations for coag. water, gac-treated or mem-treated water, or groundwater
-      alpha1 = -0.8408 * Co;
-      k2 = -0.404 * pow((Co / uv), -0.918);
-    }
-
-    alpha2 = k2 * toc;
-
-    // Estimate free chlorine at CFSTR effluent ---------------
-
-    //Quadratic equation parameters
-    a = 1.0;
-    b = alpha1 - cl2res + alpha2 * cfstr_time;
-    c = -alpha1 * cl2res;
-
-    Ctout = (-b - pow((b * b - 4.0 * a * c), 0.5)) / (2.0 * a);
-
-    //Check that answer makes sense
-    if (Ctout > cl2res)
-      Ctout = cl2res;
-    if (Ctout < 0.0)
-      Ctout = 0.0;
-
-    //Calculate new chlorine residual
-    cl2res = Ctout;
-
-    /* Limit chlorine residual to 0.1 mg/L */
-    if (cl2res < 0.1)
-    {
-      cl2res = 0.0;
-    }
-
-  } //end   if( cl2res > 0.0 )
-
-  /*****************************************************************************
-  * Estimate chloramine decay...  Section A.6.3 and A-6.4  */
+    cl2res = cfstr_decay(coef.free_a1, coef.free_a2, cl2res, cfstr_time);
 
+  /* Estimate chloramine decay...  Section A.6.3 and A-6.4  */
   if (comb_cl2 > 0.0)
-  {
-    //Parameters for chloramine decay
-    alpha1 = -0.990 * Co;
-    alpha2 = -0.015 * uv;
+    comb_cl2 = cfstr_decay(coef.comb_a1, coef.comb_a2, comb_cl2, cfstr_time);
 
-    // Estimate combined chlorine at CFSTR effluent---------------
-
-    //Quadratic equation parameters
-    a = 1.0;
-    b = alpha1 - comb_cl2 + alpha2 * cfstr_time;
-    c = -alpha1 * comb_cl2;
+  /* Copy outputs to UnitProcess data structure */
+  eff->FreeCl2 = cl2res / MW_Cl2;
+  eff->NH2Cl = comb_cl2 / MW_Cl2;
+}
 
-    Ctout = (-b - pow((b * b - 4.0 * a * c), 0.5)) / (2.0 * a);
+void cl2decay_cascade(struct UnitProcess *unit, int ncstrs, double cfstr_time)
+/*
+* Purpose:
+*   Estimate chlorine and chloramine decay through 'ncstrs' CFSTRs in series,
+*   each with residence time 'cfstr_time' (hours).  Equivalent to calling
+*   new_cl2decay() once per CFSTR and adding 'cfstr_time' to unit->eff.hours
+*   after each CFSTR that leaves a residual, which is what this routine does
+*   to unit->eff.hours.
+*
+* Notes:
+*  1. After the first breakpt() either free chlorine is zero or ammonia and
+*     monochloramine are both zero, and decay only lowers the residuals, so
+*     breakpt() (and the phchange() it may call) is a no-op in every later
+*     CFSTR.  It is called once here.
+*  2. The decay parameters do not change from CFSTR to CFSTR and are set
+*     once.  Once both residuals are zero no later CFSTR changes anything.
+*  3. dist_dbp() calls the two parts, cl2decay_start() and cl2decay_tanks(),
+*     itself so that the sampling points can share the first.
+*/
+{
+  struct Cl2DecayCoef coef;
 
-    //Check that answer makes sense
-    if (Ctout > comb_cl2)
-      Ctout = comb_cl2;
-    if (Ctout < 0.0)
-      Ctout = 0.0;
+  cl2decay_start(unit, &coef);
+  cl2decay_tanks(&unit->eff, &coef, ncstrs, cfstr_time);
+}
 
-    //Calculate new combined chlorine residual
-    comb_cl2 = Ctout;
+void cl2decay_start(struct UnitProcess *unit, struct Cl2DecayCoef *coef)
+/*
+* Purpose: breakpt() and the decay parameters of the water in unit->eff,
+*          see cl2decay_cascade() notes 1 and 2.
+*/
+{
+  breakpt(unit);
+  cl2decay_coef(&unit->eff, unit->eff.FreeCl2 > 0.0, coef);
+}
 
-    /* Limit chlorine residual to 0.1 mg/L */
-    if (comb_cl2 < 0.1)
-    {
-      comb_cl2 = 0.0;
-    }
+void cl2decay_tanks(struct Effluent *eff, const struct Cl2DecayCoef *coef, int ncstrs, double cfstr_time)
+/*
+* Purpose: Decay of the residuals in 'eff' through 'ncstrs' CFSTRs with the
+*          parameters from cl2decay_start().  eff->hours is advanced by
+*          'cfstr_time' for every CFSTR that leaves a residual.
+*
+* Notes:
+*  1. Running n1 CFSTRs and then n2 more gives the same eff as running
+*     n1+n2, which is how dist_dbp() follows one trajectory.
+*/
+{
+  double cl2res;   /* Free chlorine residual     (mg/L) as Cl2 */
+  double comb_cl2; /* Combined chlorine residual (mg/L) as Cl2 */
+  double hours;
+  int i;
 
-  } //end   if( comb_cl2>0.0 )
+  cl2res = eff->FreeCl2 * MW_Cl2;
+  comb_cl2 = eff->NH2Cl * MW_Cl2;
+  hours = eff->hours;
 
-  /**************************************************************/
+  for (i = 0; i < ncstrs && (cl2res > 0.0 || comb_cl2 > 0.0); i++)
+  {
+    if (cl2res > 0.0)
+      cl2res = cfstr_decay(coef->free_a1, coef->free_a2, cl2res, cfstr_time);
+    if (comb_cl2 > 0.0)
+      comb_cl2 = cfstr_decay(coef->comb_a1, coef->comb_a2, comb_cl2, cfstr_time);
+    if ((cl2res + comb_cl2) > 0.0)
+      hours += cfstr_time;
+  }
 
-  /* Copy outputs to UnitProcess data structure */
   eff->FreeCl2 = cl2res / MW_Cl2;
   eff->NH2Cl = comb_cl2 / MW_Cl2;
+  eff->hours = hours;
 }
@@ -1,6 +1,97 @@
-/* ClO2.c */
+/* ClO2.c -- Chlorine dioxide decay in CFSTRs in series
+*
+*  The following functions are in this file:
+*    clo2_decay()    Decay in one CFSTR
+*    clo2_cascade()  Decay in a series of CFSTRs
+*/
 #include "wtp.h"
 
+struct ClO2Water
+{               /* Inputs of the ClO2 decay equations, limited */
+  double degC;  /*   Temperature (Degrees C)                   */
+  double pH;
+  double uv;    /*   UV-254 (1/cm)                             */
+  double toc;   /*   TOC (mg/L)                                */
+  double dose;  /*   ClO2 dose (mg/L)                          */
+  int raw;      /*   TRUE=use raw water equations              */
+};
+
+static void clo2_water(struct Effluent *eff, struct ClO2Water *w)
+{
+  struct WtpContext *ctx = eff->ctx;
+
+  /*Get inputs from Effluent data structure*/
+  w->degC = eff->DegK - 273.15;
+  w->pH = eff->pH;
+  w->uv = eff->UV;
+  w->toc = eff->TOC;
+  w->dose = eff->clo2dose;
+  w->raw = ctx->swflag == TRUE && (ctx->rwdbpflag == TRUE || ctx->owdbpflag == TRUE);
+
+  /*These limits are established to keep predicted ClO2 decay from being
+    unrealistically slow.  They are based on the model development
+    database parameter value ranges. */
+  if (w->degC < 4.3)
+    w->degC = 4.3;
+  if (w->uv < 0.027)
+    w->uv = 0.027;
+  if (w->toc < 1.3)
+    w->toc = 1.3;
+}
+
+static double clo2_initial(struct ClO2Water *w)
+/*
+* Purpose: Residual after the initial demand right after a ClO2 dose (mg/L).
+*/
+{
+  double term1, term2, term3, term4;
+
+  //Determine initial residual based upon raw or coagulated water equations
+  if (w->raw)
+  { // use raw water equation
+
+    term1 = wtp_pow(w->dose, 1.802);
+    term2 = wtp_pow(w->degC, -0.0475);
+    term3 = wtp_pow(w->pH, 1.47);
+    term4 = wtp_pow((w->toc * w->uv), -0.284);
+    return (0.0157 * term1 * term2 * term3 * term4);
+  }
+  else
+  { //use coagulated water equation
+
+    term1 = wtp_pow(w->dose, 1.415);
+    term2 = wtp_pow(w->degC, -0.0395);
+    term3 = wtp_pow(w->pH, 1.85);
+    term4 = wtp_pow((w->toc * w->uv), -0.182);
+    return (0.0124 * term1 * term2 * term3 * term4);
+  }
+}
+
+static double clo2_k1(struct ClO2Water *w)
+/*
+* Purpose: First order decay constant (1/min).
+*/
+{
+  double term1, term2, term3;
+
+  if (w->raw)
+  { // use raw water equation
+
+    term1 = wtp_pow(w->dose, -0.673);
+    term2 = wtp_pow(w->degC, 0.398);
+    term3 = wtp_pow((w->toc * w->uv), 0.441);
+    return (-0.014 * term1 * term2 * term3);
+  }
+  else
+  { //use coagulated water equation
+
+    term1 = wtp_pow(w->dose, -0.544);
+    term2 = wtp_pow(w->degC, 0.237);
+    term3 = wtp_pow((w->toc * w->uv), 0.764);
+    return (-0.0282 * term1 * term2 * term3);
+  }
+}
+
 void clo2_decay(struct UnitProcess *unit, double cfstr_time)
 /*
 * Purpose:
@@ -12,18 +103,7 @@ void clo2_decay(struct UnitProcess *unit, double cfstr_time)
 * Documention and Code by WJS, 5/2001
 */
 {
-  double clo2_minutes; /* Time since the last clo2 dose */
-
-  /*Unit Process Influent Parameters*/
-  double degC; /* Temperature (Degrees C)*/
-  double pH;
-  double uv;   /* UV-254 (1/cm)*/
-  double toc;  /* TOC (mg/L) */
-  double dose; /* ClO2 dose (mg/L)*/
-  double k1;   /* First order rate constant */
-
-  /*Internal Variables*/
-  double term1, term2, term3, term4;
+  struct ClO2Water w;
   double clo2_in;  /* ClO2 residual at influent */
   double clo2_res; /* intermediate */
 
@@ -33,93 +113,92 @@ void clo2_decay(struct UnitProcess *unit, double cfstr_time)
   register struct Effluent *eff;
 
   eff = &unit->eff;
-
-  /*Get inputs from Effluent data structure*/
-  degC = eff->DegK - 273.15;
-  pH = eff->pH;
-  uv = eff->UV;
-  toc = eff->TOC;
-  dose = eff->clo2dose;
+  clo2_water(eff, &w);
   clo2_in = eff->clo2_res;
-  clo2_minutes = eff->clo2_minutes;
 
   //Initialize this way in case clo2_in = 0.0
   clo2_out = clo2_in;
 
-  /*These limits are established to keep predicted ClO2 decay from being
-    unrealistically slow.  They are based on the model development
-    database parameter value ranges. */
-  if (degC < 4.3)
-    degC = 4.3;
-  if (uv < 0.027)
-    uv = 0.027;
-  if (toc < 1.3)
-    toc = 1.3;
-
-  if (clo2_minutes == 0.0)
+  if (eff->clo2_minutes == 0.0)
   { //Take care of initial decay first, but only if this is right after a dose
-
-    //Determine initial residual based upon raw or coagulated water equations
-    if (swflag == TRUE && (rwdbpflag == TRUE || owdbpflag == TRUE))
-    { // use raw water equation
-
-      term1 = pow(dose, 1.802);
-      term2 = pow(degC, -0.0475);
-      term3 = pow(pH, 1.47);
-      term4 = pow((toc * uv), -0.284);
-      clo2_res = 0.0157 * term1 * term2 * term3 * term4;
-    }
-    else
-    { //use coagulated water equation
-
-      term1 = pow(dose, 1.415);
-      term2 = pow(degC, -0.0395);
-      term3 = pow(pH, 1.85);
-      term4 = pow((toc * uv), -0.182);
-      clo2_res = 0.0124 * term1 * term2 * term3 * term4;
-    }
+    clo2_res = clo2_initial(&w);
 
     //no increasing of ClO2 concentration here
     if (clo2_res > clo2_in)
       clo2_res = clo2_in;
-
-  } //End"if(clo2_minutes = 0.0)"
+  }
   else
   {
     clo2_res = clo2_in;
   }
 
-  //--------------------------------------------------------------------------------------
-
-  if (clo2_res > 0.0 && dose > 0.0)
+  if (clo2_res > 0.0 && w.dose > 0.0)
   { //Calculate decay with 1st order constant based upon raw or coagulated water equations
     //and fact that we are talking about a CFSTR where Ceff = Cin / (1-kt)
-
-    if (swflag == TRUE && (rwdbpflag == TRUE || owdbpflag == TRUE))
-    { // use raw water equation
-
-      term1 = pow(dose, -0.673);
-      term2 = pow(degC, 0.398);
-      term3 = pow((toc * uv), 0.441);
-      k1 = -0.014 * term1 * term2 * term3;
-    }
-    else
-    { //use coagulated water equation
-
-      term1 = pow(dose, -0.544);
-      term2 = pow(degC, 0.237);
-      term3 = pow((toc * uv), 0.764);
-      k1 = -0.0282 * term1 * term2 * term3;
-    }
-
-    clo2_out = clo2_res / (1.0 - k1 * cfstr_time);
+    clo2_out = clo2_res / (1.0 - clo2_k1(&w) * cfstr_time);
 
     //No residuals less than 0.1 mg/L
     if (clo2_out < 0.1)
       clo2_out = 0.0;
-
-  } //End"if(clo2_res > 0.0 && dose > 0.0)"
+  }
 
   /*Update Unit Process Effluent data structure*/
   eff->clo2_res = clo2_out;
-}
\ No newline at end of file
+}
+
+double clo2_cascade(struct UnitProcess *unit, int ncstrs, double cfstr_time)
+/*
+* Purpose:
+*   Estimate ClO2 decay through 'ncstrs' CFSTRs in series, each with
+*   residence time 'cfstr_time' (minutes).  Equivalent to calling
+*   clo2_decay() once per CFSTR and adding 'cfstr_time' to
+*   unit->eff.clo2_minutes after each.
+*
+* Return:
+*   Sum of the ClO2 residuals at the effluent of each CFSTR (mg/L), for
+*   the average residual of the unit process.
+*
+* Notes:
+*  1. The decay constant does not depend on the residual and is computed
+*     once, instead of with three pow() calls per CFSTR.
+*/
+{
+  struct ClO2Water w;
+  double clo2_res, clo2_init;
+  double k1 = 0.0;
+  double sum = 0.0;
+  int have_k1 = FALSE;
+  int i;
+
+  register struct Effluent *eff;
+
+  eff = &unit->eff;
+  clo2_water(eff, &w);
+  clo2_res = eff->clo2_res;
+
+  for (i = 0; i < ncstrs; i++)
+  {
+    if (eff->clo2_minutes == 0.0 && w.dose > 0.0)
+    {
+      clo2_init = clo2_initial(&w);
+      if (clo2_init < clo2_res)
+        clo2_res = clo2_init;
+    }
+    if (clo2_res > 0.0 && w.dose > 0.0)
+    {
+      if (have_k1 == FALSE)
+      {
+        k1 = clo2_k1(&w);
+        have_k1 = TRUE;
+      }
+      clo2_res = clo2_res / (1.0 - k1 * cfstr_time);
+      if (clo2_res < 0.1)
+        clo2_res = 0.0;
+    }
+    sum += clo2_res;
+    eff->clo2_minutes += cfstr_time;
+  }
+  eff->clo2_res = clo2_res;
+
+  return (sum);
+}
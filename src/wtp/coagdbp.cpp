@@ -25,7 +25,6 @@ void coagdbp(struct UnitProcess *unit)
   double DegC;           /* Temperature         (Deg C) */
   double doc;            /* Really, its TOC      (mg/L) */
   double uv;             /* UV254                (1/cm) */
-  double doc_uv;         /* Product of the above two    */
   double br;             /* Bromide              (ug/L) */
   double cl2dose;        /* Free chlorine (mg/L) as Cl2 */
   double eff_hours;      /* Contact time        (hours) */
@@ -60,7 +59,9 @@ void coagdbp(struct UnitProcess *unit)
   double delta_tox = 0.0;
 
   /* Internal: */
-  double factor, term1, term2, term3, term4, term5, term6;
+  double factor, term6;
+  struct DbpTerms dbp;
+  struct WtpContext *ctx = unit->eff.ctx;
   double eff_Br, moles_br_incorporated;
   double HAA6_9_inf, HAA6_9_eff, HAA9_inf, HAA9_eff;
   double TTHM_factor, HAA6_factor, TTHM_delta, HAA6_delta;
@@ -104,8 +105,6 @@ void coagdbp(struct UnitProcess *unit)
   if (doc < 0.1 && doc > 0.0)
     doc = 0.1;
 
-  doc_uv = doc * uv;
-
   /*  Get Cumulative time to influent of UnitProcess.    */
   if (eff->wtp_effluent != NULL)
   {
@@ -135,243 +134,81 @@ void coagdbp(struct UnitProcess *unit)
   if ((inf_FreeCl > 0.0 || inf_nh2cl > 0.0) && doc > 0.0 && cl2dose > 0.0 && eff_hours > 0.0)
   { /* THMs and/or HAAs should be forming */
 
-    /* Estimate THMs */
+    /* Estimate THMs, HAAs and TOX (ug/liter), see dbp_wtp.cpp */
+    dbp_formation(unit->eff.ctx, DBP_COAG_MODEL, doc, uv, cl2dose, br, DegC, pH, eff_hours, inf_hours, &dbp);
 
-    /* Estimate TTHM (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, 0.403);
-    term2 = pow(cl2dose, 0.225);
-    term3 = pow(br, 0.141);
-    term4 = pow(1.026, (DegC - 20));
-    term5 = pow(1.156, (pH - 7.5));
-    if (pre_re_chlor_flag == 1 && inf_hours > 0.0)
+    /* TTHM */
+    if (pre_re_chlor_flag == 1)
     { //use adjustment factor from regression of Miguel Arias (RSS student) pre-/re-chlor data
-      TTHM_delta = 23.9 * term1 * term2 * term3 * term4 * term5 * (pow(eff_hours, 0.264) - pow(inf_hours, 0.264));
-      term6 = pow(eff_hours, 0.264) / (1.84 * pow(pre_chlor_TTHM, 0.021) * pow(eff_hours, -0.143)) - pow(inf_hours, 0.264) / (1.84 * pow(pre_chlor_TTHM, 0.021) * pow(eff_hours, -0.143));
-      TTHM_factor = term6 / (pow(eff_hours, 0.264) - pow(inf_hours, 0.264));
+      TTHM_delta = dbp.delta[DBP_TTHM];
+      factor = 1.84 * wtp_pow(pre_chlor_TTHM, 0.021) * wtp_pow(eff_hours, -0.143);
+      term6 = dbp.te[DBP_TTHM] / factor - dbp.ti[DBP_TTHM] / factor;
+      TTHM_factor = term6 / (dbp.te[DBP_TTHM] - dbp.ti[DBP_TTHM]);
+      delta_tthm = dbp.k[DBP_TTHM] * term6;
     }
-    else if (pre_re_chlor_flag == 1 && inf_hours <= 0.0)
-    {
-      TTHM_delta = 23.9 * term1 * term2 * term3 * term4 * term5 * pow(eff_hours, 0.264);
-      term6 = pow(eff_hours, 0.264) / (1.84 * pow(pre_chlor_TTHM, 0.021) * pow(eff_hours, -0.143));
-      TTHM_factor = term6 / pow(eff_hours, 0.264);
-    }
-    else
-    { /* no adjustment needed*/
-      term6 = pow(eff_hours, 0.264) - pow(inf_hours, 0.264);
-    }
-    delta_tthm = 23.9 * term1 * term2 * term3 * term4 * term5 * term6;
-
-    /* Estimate CHCl3 (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, 0.483);
-    term2 = pow(cl2dose, 0.424);
-    term3 = pow(br, -0.679);
-    term4 = pow(1.018, (DegC - 20));
-    term5 = pow(1.132, (pH - 7.5));
-    term6 = pow(eff_hours, 0.333) - pow(inf_hours, 0.333);
-    delta_chcl3 = 266.0 * term1 * term2 * term3 * term4 * term5 * term6;
-
-    /* Estimate CHBrCl2 (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, 0.260);
-    term2 = pow(cl2dose, 0.114);
-    term3 = pow(br, 0.462);
-    term4 = pow(1.026, (DegC - 20));
-    term5 = pow(1.098, (pH - 7.5));
-    term6 = pow(eff_hours, 0.196) - pow(inf_hours, 0.196);
-    delta_chbrcl2 = 1.68 * term1 * term2 * term3 * term4 * term5 * term6;
-
-    /* Estimate CHBr2Cl (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, -0.056);
-    term2 = pow(cl2dose, -0.157);
-    term3 = pow(br, 1.425);
-    term4 = pow(1.021, (DegC - 20));
-    term5 = pow(1.127, (pH - 7.5));
-    term6 = pow(eff_hours, 0.148) - pow(inf_hours, 0.148);
-    delta_chbr2cl = 0.0080 * term1 * term2 * term3 * term4 * term5 * term6;
-
-    /* Estimate CHBr3  (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, -0.300);
-    term2 = pow(cl2dose, -0.221);
-    term3 = pow(br, 2.134);
-    term4 = pow(1.037, (DegC - 20));
-    term5 = pow(1.391, (pH - 7.5));
-    term6 = pow(eff_hours, 0.143) - pow(inf_hours, 0.143);
-    delta_chbr3 = 4.4 * pow(10, -5.0) * term1 * term2 * term3 * term4 * term5 * term6;
-
-    /* Estimate HAAs */
-
-    /* Estimate HAA6  (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, 0.328);
-    term2 = pow(cl2dose, 0.585);
-    term3 = pow(br, -0.121);
-    term4 = pow(1.022, (DegC - 20));
-    term5 = pow(0.922, (pH - 7.5));
-
-    if (pre_re_chlor_flag == 1 && inf_hours > 0.0)
+    else /* no adjustment needed*/
+      delta_tthm = dbp.delta[DBP_TTHM];
+
+    delta_chcl3 = dbp.delta[DBP_CHCL3];
+    delta_chbrcl2 = dbp.delta[DBP_CHBRCL2];
+    delta_chbr2cl = dbp.delta[DBP_CHBR2CL];
+    delta_chbr3 = dbp.delta[DBP_CHBR3];
+
+    /* HAA6 */
+    if (pre_re_chlor_flag == 1)
     { //use adjustment factor from regression of Miguel Arias (RSS student) pre-/re-chlor data
-      HAA6_delta = 30.7 * term1 * term2 * term3 * term4 * term5 * (pow(eff_hours, 0.150) - pow(inf_hours, 0.150));
-      term6 = pow(eff_hours, 0.150) / (2.32 * pow(pre_chlor_HAA6, -0.044) * pow(eff_hours, -0.24)) - pow(inf_hours, 0.150) / (2.32 * pow(pre_chlor_HAA6, -0.044) * pow(eff_hours, -0.24));
-      HAA6_factor = term6 / (pow(eff_hours, 0.150) - pow(inf_hours, 0.150));
+      HAA6_delta = dbp.delta[DBP_HAA6];
+      factor = 2.32 * wtp_pow(pre_chlor_HAA6, -0.044) * wtp_pow(eff_hours, -0.24);
+      term6 = dbp.te[DBP_HAA6] / factor - dbp.ti[DBP_HAA6] / factor;
+      HAA6_factor = term6 / (dbp.te[DBP_HAA6] - dbp.ti[DBP_HAA6]);
+      delta_haa6 = dbp.k[DBP_HAA6] * term6;
     }
-    else if (pre_re_chlor_flag == 1 && inf_hours <= 0.0)
-    {
-      HAA6_delta = 30.7 * term1 * term2 * term3 * term4 * term5 * pow(eff_hours, 0.150);
-      term6 = pow(eff_hours, 0.150) / (2.32 * pow(pre_chlor_HAA6, -0.044) * pow(eff_hours, -0.24));
-      HAA6_factor = term6 / pow(eff_hours, 0.150);
-    }
-    else
-    { //no adjustment needed
-      term6 = pow(eff_hours, 0.150) - pow(inf_hours, 0.150);
-    }
-    delta_haa6 = 30.7 * term1 * term2 * term3 * term4 * term5 * term6;
-
-    /* Estimate HAA5  (ug/liter) ------------------------ Equation XX */
-    /*term1 = pow( doc_uv   , 0.302 );
-      term2 = pow( cl2dose  , 0.541 );
-      term3 = pow( br	    ,-0.012 );
-      term4 = pow( 1.022    , (DegC-20));
-      term5 = pow( 0.922    , (pH-7.5));
-      term6 = pow( eff_hours, 0.161 ) - pow( inf_hours, 0.161 );*/
-
-    /* Estimate MCAA  (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, -0.090);
-    term2 = pow(cl2dose, 0.662);
-    term3 = pow(br, -0.224);
-    term4 = pow(1.024, (DegC - 20));
-    term5 = pow(1.042, (pH - 7.5));
-    if (inf_hours > 0.0)
-      term6 = pow(eff_hours, -0.043) - pow(inf_hours, -0.043);
-    else
-      term6 = pow(eff_hours, -0.043);
-    delta_mcaa = 4.58 * term1 * term2 * term3 * term4 * term5 * term6;
+    else //no adjustment needed
+      delta_haa6 = dbp.delta[DBP_HAA6];
+
+    delta_mcaa = dbp.delta[DBP_MCAA];
     if (delta_mcaa > 25.0)
       delta_mcaa = 25.0; //based on model development database
-
-    /* Estimate MBAA  (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, 0.358);
-    term2 = pow(cl2dose, -0.101);
-    term3 = pow(br, 0.812);
-    term4 = pow(1.162, (DegC - 20));
-    term5 = pow(0.653, (pH - 7.5));
-    term6 = pow(eff_hours, 0.088) - pow(inf_hours, 0.088);
-    delta_mbaa = 0.0206 * term1 * term2 * term3 * term4 * term5 * term6;
-
-    /* Estimate DCAA  (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, 0.397);
-    term2 = pow(cl2dose, 0.665);
-    term3 = pow(br, -0.558);
-    term4 = pow(1.017, (DegC - 20));
-    term5 = pow(1.034, (pH - 7.5));
-    term6 = pow(eff_hours, 0.222) - pow(inf_hours, 0.222);
-    delta_dcaa = 60.4 * term1 * term2 * term3 * term4 * term5 * term6;
-
-    /* Estimate TCAA  (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, 0.403);
-    term2 = pow(cl2dose, 0.749);
-    term3 = pow(br, -0.416);
-    term4 = pow(1.014, (DegC - 20));
-    term5 = pow(0.874, (pH - 7.5));
-    term6 = pow(eff_hours, 0.163) - pow(inf_hours, 0.163);
-    delta_tcaa = 52.6 * term1 * term2 * term3 * term4 * term5 * term6;
-
-    /* Estimate DBAA  (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, 0.059);
-    term2 = pow(cl2dose, 0.182);
-    term3 = pow(br, 2.109);
-    term4 = pow(1.007, (DegC - 20));
-    term5 = pow(1.21, (pH - 7.5));
-    term6 = pow(eff_hours, 0.070) - pow(inf_hours, 0.070);
-    delta_dbaa = 9.42 * pow(10, -5.0) * term1 * term2 * term3 * term4 * term5 * term6;
-
-    /* Estimate BCAA  (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, 0.153);
-    term2 = pow(cl2dose, 0.257);
-    term3 = pow(br, 0.586);
-    term4 = pow(1.042, (DegC - 20));
-    term5 = pow(1.181, (pH - 7.5));
-    term6 = pow(eff_hours, 0.201) - pow(inf_hours, 0.201);
-    delta_bcaa = 0.323 * term1 * term2 * term3 * term4 * term5 * term6;
-
-    //  The following are coag.-water HAA9 species and TOX models developed by MPI in 4/2001
-    //  (used here in place of a suitable raw water model)
-
-    /*  Estimate TBAA  (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, 0.0657);
-    term2 = pow(cl2dose, -2.51);
-    term3 = pow(br, 2.32);
-    term4 = pow(1.059, (DegC - 20.0));
-    term5 = pow(0.555, (pH - 8.0));
-    term6 = pow(eff_hours, 1.26) - pow(inf_hours, 1.26);
-    delta_tbaa = 5.59 * pow(10, -6.0) * term1 * term2 * term3 * term4 * term5 * term6;
-
-    /*  Estimate DBCAA  (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, -0.0162);
-    term2 = pow(cl2dose, -0.170);
-    term3 = pow(br, 0.972);
-    term4 = pow(1.054, (DegC - 20.0));
-    term5 = pow(0.839, (pH - 8.0));
-    term6 = pow(eff_hours, 0.685) - pow(inf_hours, 0.685);
-    delta_dbcaa = 3.7 * pow(10, -3.0) * term1 * term2 * term3 * term4 * term5 * term6;
-
-    /*  Estimate BDCAA  (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, 0.230);
-    term2 = pow(cl2dose, 0.140);
-    term3 = pow(br, 0.301);
-    term4 = pow(1.022, (DegC - 20.0));
-    term5 = pow(0.700, (pH - 8.0));
-    term6 = pow(eff_hours, 0.422) - pow(inf_hours, 0.422);
-    delta_bdcaa = 0.589 * term1 * term2 * term3 * term4 * term5 * term6;
-
-    /*  Estimate HAA9  (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, 0.250);
-    term2 = pow(cl2dose, 0.500);
-    term3 = pow(br, 0.054);
-    term4 = pow(1.015, (DegC - 20.0));
-    term5 = pow(0.894, (pH - 8.0));
-
+    delta_mbaa = dbp.delta[DBP_MBAA];
+    delta_dcaa = dbp.delta[DBP_DCAA];
+    delta_tcaa = dbp.delta[DBP_TCAA];
+    delta_dbaa = dbp.delta[DBP_DBAA];
+    delta_bcaa = dbp.delta[DBP_BCAA];
+    delta_tbaa = dbp.delta[DBP_TBAA];
+    delta_dbcaa = dbp.delta[DBP_DBCAA];
+    delta_bdcaa = dbp.delta[DBP_BDCAA];
+
+    /* HAA9 and HAA6 for HAA9 */
     if (pre_re_chlor_flag == 1)
     { //use adjustment factor from regression of Miguel Arias (RSS student) pre-/re-chlor data
-      HAA9_inf = 10.78 * term1 * term2 * term3 * term4 * term5 * pow(inf_hours, 0.348);
+      /* The adjustment has always used 10.78 in place of 10.783 */
+      HAA9_inf = dbp.k[DBP_HAA9] * (10.78 / 10.783) * dbp.ti[DBP_HAA9];
       if (HAA9_inf > 300.0)
         HAA9_inf = 300.0;
-      HAA9_eff = 10.78 * term1 * term2 * term3 * term4 * term5 * pow(eff_hours, 0.348);
+      HAA9_eff = dbp.k[DBP_HAA9] * (10.78 / 10.783) * dbp.te[DBP_HAA9];
       if (HAA9_eff > 300.0)
         HAA9_eff = 300.0;
-      term6 = pow(eff_hours, 0.348) / (1.16 - 0.0012 * HAA9_eff) - pow(inf_hours, 0.348) / (1.16 - 0.0012 * HAA9_inf);
-    }
-    else //no need to adjust
-      term6 = pow(eff_hours, 0.348) - pow(inf_hours, 0.348);
-    delta_haa9 = 10.783 * term1 * term2 * term3 * term4 * term5 * term6;
-
-    /*  Estimate HAA6 for HAA9  (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, 0.320);
-    term2 = pow(cl2dose, 0.510);
-    term3 = pow(br, -0.106);
-    term4 = pow(1.017, (DegC - 20.0));
-    term5 = pow(0.938, (pH - 8.0));
+      term6 = dbp.te[DBP_HAA9] / (1.16 - 0.0012 * HAA9_eff) - dbp.ti[DBP_HAA9] / (1.16 - 0.0012 * HAA9_inf);
+      delta_haa9 = dbp.k[DBP_HAA9] * term6;
 
-    if (pre_re_chlor_flag == 1)
-    { //use adjustment factor from regression of Miguel Arias (RSS student) pre-/re-chlor data
-      HAA6_9_inf = 18.6 * term1 * term2 * term3 * term4 * term5 * pow(inf_hours, 0.353);
+      HAA6_9_inf = dbp.k[DBP_HAA6_9] * dbp.ti[DBP_HAA6_9];
       if (HAA6_9_inf > 250.0)
         HAA6_9_inf = 250.0;
-      HAA6_9_eff = 18.6 * term1 * term2 * term3 * term4 * term5 * pow(eff_hours, 0.353);
+      HAA6_9_eff = dbp.k[DBP_HAA6_9] * dbp.te[DBP_HAA6_9];
       if (HAA6_9_eff > 250.0)
         HAA6_9_eff = 250.0;
-      term6 = pow(eff_hours, 0.353) / (1.073 - 0.0016 * HAA6_9_eff) - pow(inf_hours, 0.353) / (1.073 - 0.0016 * HAA6_9_inf);
+      term6 = dbp.te[DBP_HAA6_9] / (1.073 - 0.0016 * HAA6_9_eff) - dbp.ti[DBP_HAA6_9] / (1.073 - 0.0016 * HAA6_9_inf);
+      delta_haa6_for_haa9 = dbp.k[DBP_HAA6_9] * term6;
     }
     else //no need to adjust
-      term6 = pow(eff_hours, 0.353) - pow(inf_hours, 0.353);
-
-    delta_haa6_for_haa9 = 18.6 * term1 * term2 * term3 * term4 * term5 * term6;
-
-    /*  Estimate TOX  (ug/liter) ------------------------ Equation XX */
-    term1 = pow(doc_uv, 0.362);
-    term2 = pow(cl2dose, 0.129);
-    term4 = pow(DegC, 0.211);
-    term6 = pow(eff_hours, 0.182) - pow(inf_hours, 0.182);
-    delta_tox = 109.0 * term1 * term2 * term4 * term6;
+    {
+      delta_haa9 = dbp.delta[DBP_HAA9];
+      delta_haa6_for_haa9 = dbp.delta[DBP_HAA6_9];
+    }
 
-    if (pre_re_chlor_flag == 1) //Adjust based on the weighted average of the TTHM and HAA6 factors
+    /* TOX */
+    delta_tox = dbp.delta[DBP_TOX];
+    if (pre_re_chlor_flag == 1 && (ctx->need & WTP_OUT_TOX) != 0) //Adjust based on the weighted average of the TTHM and HAA6 factors
       delta_tox *= (TTHM_factor * TTHM_delta + HAA6_factor * HAA6_delta) / (TTHM_delta + HAA6_delta);
 
     ///********CORRECTION FACTORS BASED ON ICR DATA CALIBRATION WORK (WJS, 5/2001 and article 2002)********/
@@ -449,7 +286,12 @@ void coagdbp(struct UnitProcess *unit)
     /******************************END OF FORT COLLINS CORRECTION FACTORS*******************************/
 
     /* Proportion the species based on the bulk TTHM */
-    if (delta_chcl3 > 0.0 || delta_chbrcl2 > 0.0 || delta_chbr2cl > 0.0 || delta_chbr3 > 0.0)
+    if ((ctx->need & WTP_OUT_THM_SPECIES) == 0)
+    { /* Species not evaluated, see dbp_forms() */
+      if (dbp_forms(&dbp, DBP_CHCL3, DBP_CHBR3) == FALSE)
+        delta_tthm = 0.0;
+    }
+    else if (delta_chcl3 > 0.0 || delta_chbrcl2 > 0.0 || delta_chbr2cl > 0.0 || delta_chbr3 > 0.0)
     {
       factor = delta_tthm / (delta_chcl3 + delta_chbrcl2 +
                              delta_chbr2cl + delta_chbr3);
@@ -480,30 +322,33 @@ void coagdbp(struct UnitProcess *unit)
     /* Calc. HAA5 based on HAA6 equation, minus proportioned BCAA */
     delta_haa5 = delta_haa6 - delta_bcaa;
 
-    /* Proportion the HAA9 species based on HAA9-HAA6 */
-    if (delta_haa9 > delta_haa6_for_haa9)
+    if ((ctx->need & WTP_OUT_HAA9) != 0)
     {
-      delta_haa9_haa6 = delta_haa9 - delta_haa6_for_haa9;
-    }
-    else
-    {
-      delta_haa9_haa6 = 0.0;
-      delta_dbcaa = 0.0;
-      delta_bdcaa = 0.0;
-      delta_tbaa = 0.0;
-    }
-
-    if (delta_dbcaa > 0.0 || delta_bdcaa > 0.0 || delta_tbaa > 0.0)
-    {
-      factor = delta_haa9_haa6 / (delta_dbcaa + delta_bdcaa + delta_tbaa);
-      delta_dbcaa *= factor;
-      delta_bdcaa *= factor;
-      delta_tbaa *= factor;
+      /* Proportion the HAA9 species based on HAA9-HAA6 */
+      if (delta_haa9 > delta_haa6_for_haa9)
+      {
+        delta_haa9_haa6 = delta_haa9 - delta_haa6_for_haa9;
+      }
+      else
+      {
+        delta_haa9_haa6 = 0.0;
+        delta_dbcaa = 0.0;
+        delta_bdcaa = 0.0;
+        delta_tbaa = 0.0;
+      }
+
+      if (delta_dbcaa > 0.0 || delta_bdcaa > 0.0 || delta_tbaa > 0.0)
+      {
+        factor = delta_haa9_haa6 / (delta_dbcaa + delta_bdcaa + delta_tbaa);
+        delta_dbcaa *= factor;
+        delta_bdcaa *= factor;
+        delta_tbaa *= factor;
+      }
+
+      /* Calc. HAA9 based on HAA6, plus three additional species */
+      delta_haa9 = delta_haa6 + delta_tbaa + delta_dbcaa + delta_bdcaa;
     }
 
-    /* Calc. HAA9 based on HAA6, plus three additional species */
-    delta_haa9 = delta_haa6 + delta_tbaa + delta_dbcaa + delta_bdcaa;
-
     /* Add incremental outputs in UnitProcess data structure. */
     /* THMs */
     eff->CHCl3 += delta_chcl3;
@@ -530,25 +375,28 @@ void coagdbp(struct UnitProcess *unit)
     eff->tox += delta_tox;
 
     /*Stoichiometric Bromide incorporation (non-THM or HAA TOX not considered)*/
-    moles_br_incorporated =
-        (delta_chbrcl2 / 1000.0) / MW_BDCM * 1.0 +
-        (delta_chbr2cl / 1000.0) / MW_DBCM * 2.0 +
-        (delta_chbr3 / 1000.0) / MW_CHBR3 * 3.0 +
-        (delta_mbaa / 1000.0) / MW_MBAA * 1.0 +
-        (delta_bcaa / 1000.0) / MW_BCAA * 1.0 +
-        (delta_dbaa / 1000.0) / MW_DBAA * 2.0 +
-        (delta_bdcaa / 1000.0) / MW_BDCAA * 1.0 +
-        (delta_dbcaa / 1000.0) / MW_DBCAA * 2.0 +
-        (delta_tbaa / 1000.0) / MW_TBAA * 3.0;
-
-    eff_Br = eff->Br - moles_br_incorporated;
-
-    if (eff_Br > eff->Br)
-      eff_Br = eff->Br; /* No increasing Br allowed */
-    if (eff_Br < 0.0)
-      eff_Br = 0.0; /* No negative Br allowed   */
-
-    eff->Br = eff_Br; /*Update UnitProcess data structure */
+    if ((ctx->need & WTP_OUT_BROMIDE) != 0)
+    { /* Not read downstream unless asked for, see out_need() */
+      moles_br_incorporated =
+          (delta_chbrcl2 / 1000.0) / MW_BDCM * 1.0 +
+          (delta_chbr2cl / 1000.0) / MW_DBCM * 2.0 +
+          (delta_chbr3 / 1000.0) / MW_CHBR3 * 3.0 +
+          (delta_mbaa / 1000.0) / MW_MBAA * 1.0 +
+          (delta_bcaa / 1000.0) / MW_BCAA * 1.0 +
+          (delta_dbaa / 1000.0) / MW_DBAA * 2.0 +
+          (delta_bdcaa / 1000.0) / MW_BDCAA * 1.0 +
+          (delta_dbcaa / 1000.0) / MW_DBCAA * 2.0 +
+          (delta_tbaa / 1000.0) / MW_TBAA * 3.0;
+
+      eff_Br = eff->Br - moles_br_incorporated;
+
+      if (eff_Br > eff->Br)
+        eff_Br = eff->Br; /* No increasing Br allowed */
+      if (eff_Br < 0.0)
+        eff_Br = 0.0; /* No negative Br allowed   */
+
+      eff->Br = eff_Br; /*Update UnitProcess data structure */
+    }
 
     /***********************End of Bromide Incorporation**********************/
 
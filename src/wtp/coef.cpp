@@ -5,6 +5,11 @@
 *   2. Numerical equations are from Appendix A of 1.21 WTP manual.
 *
 * The following functions are in this file.
+*
+* thermo_coef() returns the full set of coefficients at one temperature,
+* computed once per distinct temperature and kept in the model context.
+* Built with -DWTP_THERMO_TABLE=1 it interpolates a table over 0-40 deg C
+* in place of the pow() and exp() of the functions below.
 */
 #include "wtp.h"
 
@@ -23,7 +28,7 @@ double Kw(double DegK) /* Ionization of water. */
 
   /* From Stumm and Morgan (1981) */
   /* Equation A-36 in 1.21 version of WTP manual Appendix A */
-  return (pow(10.0, (6.0875 - (4470.99 / DegK) - (0.01706 * DegK)))); /* A-36 */
+  return (wtp_exp10((6.0875 - (4470.99 / DegK) - (0.01706 * DegK)))); /* A-36 */
 }
 
 double K_HCO3(double DegK)
@@ -40,7 +45,7 @@ double K_HCO3(double DegK)
 *    May 12, 1993
 */
 {
-  return (pow(10.0, (-(3404.71 / DegK) + 14.8435 - (0.032786 * DegK))));
+  return (wtp_exp10((-(3404.71 / DegK) + 14.8435 - (0.032786 * DegK))));
 }
 
 double K_CO3(double DegK)
@@ -60,7 +65,7 @@ double K_CO3(double DegK)
 *     May, 12 1993
 */
 {
-  return (pow(10.0, (-(2902.39 / DegK) + 6.4980 - (0.02379 * DegK))));
+  return (wtp_exp10((-(2902.39 / DegK) + 6.4980 - (0.02379 * DegK))));
 }
 
 double K_HOCl(double DegK) /* Ionization of free chlorine. */
@@ -72,7 +77,7 @@ double K_HOCl(double DegK) /* Ionization of free chlorine. */
   double f_temp;
 
   f_temp = (1 / 293.15) - (1 / DegK);
-  return (exp((13800 * f_temp / 8.31441) - 17.500)); /* A-55 */
+  return (wtp_exp((13800 * f_temp / 8.31441) - 17.500)); /* A-55 */
 }
 
 double K_NH3(double DegK) /* Ionization of ammonia. */
@@ -84,7 +89,7 @@ double K_NH3(double DegK) /* Ionization of ammonia. */
   double f_temp;
 
   f_temp = (1 / 293.15) - (1 / DegK);
-  return (exp((52210.0 * f_temp / 8.31441) - 21.414)); /* A-59 */
+  return (wtp_exp((52210.0 * f_temp / 8.31441) - 21.414)); /* A-59 */
 }
 
 double K_CaOH(double DegK) /* Ionization of Calcium hydroxide. */
@@ -93,7 +98,7 @@ double K_CaOH(double DegK) /* Ionization of Calcium hydroxide. */
 *  Returned: k_CaOH = [CaOH+][H+]/[Ca++]
 */
 {
-  return (exp(-72320.0 / (8.31441 * DegK))); /* A-42 */
+  return (wtp_exp(-72320.0 / (8.31441 * DegK))); /* A-42 */
 }
 
 double K_CaOH2aq(double DegK) /* Solubility of Calcium hydroxied. */
@@ -102,7 +107,7 @@ double K_CaOH2aq(double DegK) /* Solubility of Calcium hydroxied. */
 *  Returned: k_CaOH2aq = [Ca(OH)2][H+][H+]/[Ca++]
 */
 {
-  return (exp(-159800.0 / (8.31441 * DegK))); /* A-47 */
+  return (wtp_exp(-159800.0 / (8.31441 * DegK))); /* A-47 */
 }
 
 double K_CaCO3(double DegK) /* Solubility of Calcium carbonate. */
@@ -114,7 +119,7 @@ double K_CaCO3(double DegK) /* Solubility of Calcium carbonate. */
   double f_temp;
 
   f_temp = (1 / 293.15) - (1 / DegK);
-  return (exp((-12530 * f_temp / 8.31441) - 19.111)); /* A-65 */
+  return (wtp_exp((-12530 * f_temp / 8.31441) - 19.111)); /* A-65 */
 }
 
 double K_MgOH2(double DegK) /* Solubility of magnesium hydroxide. */
@@ -126,7 +131,7 @@ double K_MgOH2(double DegK) /* Solubility of magnesium hydroxide. */
   double f_temp;
 
   f_temp = (1 / 293.15) - (1 / DegK);
-  return (exp(38.78 + (-113960.0 * f_temp / 8.31441))); /* A-76 */
+  return (wtp_exp(38.78 + (-113960.0 * f_temp / 8.31441))); /* A-76 */
 }
 
 double K_MgOH(double DegK) /* Ionization of magnesium hydroxide. */
@@ -136,7 +141,7 @@ double K_MgOH(double DegK) /* Ionization of magnesium hydroxide. */
 *
 */
 {
-  return (exp(-65180.0 / (8.31441 * DegK))); /* A-43 */
+  return (wtp_exp(-65180.0 / (8.31441 * DegK))); /* A-43 */
 }
 
 double K_MgOH2aq(double DegK) /* Solubility of magnesium hydorxide */
@@ -146,5 +151,128 @@ double K_MgOH2aq(double DegK) /* Solubility of magnesium hydorxide */
 *  Returned: k_MgOH2aq = [Mg(OH)2aq][H+][H+]/[Mg++]
 */
 {
-  return (exp(-159760.0 / (8.31441 * DegK))); /* A-51 */
+  return (wtp_exp(-159760.0 / (8.31441 * DegK))); /* A-51 */
+}
+
+#ifndef WTP_THERMO_TABLE
+#define WTP_THERMO_TABLE 0
+#endif
+
+static void thermo_direct(struct ThermoCoef *coef, double DegK)
+{
+  coef->kw = Kw(DegK);
+  coef->k1 = K_HCO3(DegK);
+  coef->k2 = K_CO3(DegK);
+  coef->k_hocl = K_HOCl(DegK);
+  coef->k_nh3 = K_NH3(DegK);
+  coef->k_mgoh = K_MgOH(DegK);
+  coef->k_mgoh2 = K_MgOH2(DegK);
+  coef->k_mgoh2aq = K_MgOH2aq(DegK);
+  coef->k_caoh = K_CaOH(DegK);
+  coef->k_caco3 = K_CaCO3(DegK);
+  coef->k_caoh2aq = K_CaOH2aq(DegK);
+}
+
+#if WTP_THERMO_TABLE
+/*
+*  Table of the coefficients every 0.25 deg C from 0 to 40 deg C.  Each
+*  coefficient is interpolated by the cubic through the four nearest
+*  nodes.  The relative error against the functions above is below 1.0E-6
+*  for all eleven coefficients over the whole range; it is largest, 6.3E-7,
+*  for K_CaOH2aq and K_MgOH2aq, whose ln(K) has the steepest slope in 1/T.
+*  Temperatures outside the table use the functions directly.  The bound
+*  is checked by src/test/test_thermo.cpp ("make test").
+*/
+#define THERMO_T0 273.15 /* First node                      (Deg K) */
+#define THERMO_DT 0.25   /* Node spacing                    (Deg K) */
+#define THERMO_N 161     /* Nodes, 0 to 40 deg C                    */
+
+static struct ThermoCoef thermo_node[THERMO_N];
+
+static int build_thermo_table(void)
+{
+  int i;
+
+  for (i = 0; i < THERMO_N; i++)
+  {
+    thermo_node[i].k_DegK = THERMO_T0 + i * THERMO_DT;
+    thermo_direct(&thermo_node[i], thermo_node[i].k_DegK);
+  }
+  return (TRUE);
+}
+
+static int thermo_table(struct ThermoCoef *coef, double DegK)
+/*
+*  Purpose: Interpolate the coefficients at DegK.  Returns FALSE if DegK
+*           is outside the table.
+*/
+{
+  static const int built = build_thermo_table(); /* Thread safe in C++11 */
+  const struct ThermoCoef *n;
+  double x, t, w0, w1, w2, w3;
+  int i;
+
+  x = (DegK - THERMO_T0) / THERMO_DT;
+  if (built == FALSE || !(x >= 0.0 && x <= THERMO_N - 1))
+    return (FALSE);
+
+  /* Nodes i-1 .. i+2, shifted inside the table at its ends */
+  i = (int)x;
+  if (i < 1)
+    i = 1;
+  if (i > THERMO_N - 3)
+    i = THERMO_N - 3;
+  t = x - i;
+  n = &thermo_node[i - 1];
+
+  /* Lagrange weights of the nodes at t = -1, 0, 1, 2 */
+  w0 = -t * (t - 1.0) * (t - 2.0) / 6.0;
+  w1 = (t + 1.0) * (t - 1.0) * (t - 2.0) / 2.0;
+  w2 = -(t + 1.0) * t * (t - 2.0) / 2.0;
+  w3 = (t + 1.0) * t * (t - 1.0) / 6.0;
+
+#define CUBIC(k) (w0 * n[0].k + w1 * n[1].k + w2 * n[2].k + w3 * n[3].k)
+  coef->kw = CUBIC(kw);
+  coef->k1 = CUBIC(k1);
+  coef->k2 = CUBIC(k2);
+  coef->k_hocl = CUBIC(k_hocl);
+  coef->k_nh3 = CUBIC(k_nh3);
+  coef->k_mgoh = CUBIC(k_mgoh);
+  coef->k_mgoh2 = CUBIC(k_mgoh2);
+  coef->k_mgoh2aq = CUBIC(k_mgoh2aq);
+  coef->k_caoh = CUBIC(k_caoh);
+  coef->k_caco3 = CUBIC(k_caco3);
+  coef->k_caoh2aq = CUBIC(k_caoh2aq);
+#undef CUBIC
+
+  return (TRUE);
+}
+#endif
+
+const struct ThermoCoef *thermo_coef(struct WtpContext *ctx, double DegK)
+/*
+*  Purpose: Return the temperature dependent coefficients at DegK.
+*
+*  Inputs:
+*    ctx  = Model context of the train; ctx->thermo holds the set for the
+*           last temperature asked for.
+*    DegK = Temperature (Deg K).
+*
+*  Notes:
+*   1. Temperature is the same for every unit of a run, so influent(),
+*      phchange() and nf_rmv() share one set per temperature instead of
+*      calling the functions above for every unit.
+*/
+{
+  struct ThermoCoef *coef = &ctx->thermo;
+
+  if (DegK != coef->k_DegK)
+  {
+    coef->k_DegK = DegK;
+#if WTP_THERMO_TABLE
+    if (thermo_table(coef, DegK) == FALSE)
+#endif
+      thermo_direct(coef, DegK);
+  }
+  return (coef);
 }
@@ -1,6 +1,48 @@
 /* CT.c */
 #include "wtp.h"
 
+#define CT_NKEY 28 /* Inputs memoized, see ct_key() */
+#define CT_NOUT 10 /* Outputs memoized              */
+
+static void ct_key(struct UnitProcess *unit, double t_ten, double key[CT_NKEY])
+/*
+*  Purpose: Collect the inputs of ct() for memo_find().  The last ten are
+*           the cumulative terms that ct() updates; its outputs are the
+*           same terms in the same order.
+*/
+{
+	struct Effluent *eff = &unit->eff;
+
+	key[0] = t_ten;
+	key[1] = unit->type;
+	key[2] = eff->pH;
+	key[3] = eff->DegK;
+	key[4] = eff->FreeCl2;
+	key[5] = eff->NH2Cl;
+	key[6] = eff->o3_res;
+	key[7] = eff->clo2_res;
+	key[8] = eff->log_required_g;
+	key[9] = eff->log_required_v;
+	key[10] = eff->log_required_c;
+	key[11] = eff->o3_minutes;
+	key[12] = eff->clo2_minutes;
+	key[13] = eff->first_o3_chamber;
+	key[14] = eff->K_o3decay;
+	key[15] = eff->clo2_avg;
+	key[16] = unit->type == O3_CONTACTOR ? PrevUnitProcess(unit)->eff.o3_minutes : 0.0;
+	key[17] = unit->type == O3_CONTACTOR ? PrevUnitProcess(unit)->eff.o3_res : 0.0;
+	key[18] = eff->ct_cl2;
+	key[19] = eff->ct_nh2cl;
+	key[20] = eff->ct_o3;
+	key[21] = eff->ct_clo2;
+	key[22] = eff->log_inact_ach_g;
+	key[23] = eff->log_inact_ach_v;
+	key[24] = eff->log_inact_ach_c;
+	key[25] = eff->ct_ratio;
+	key[26] = eff->ct_ratio_v;
+	key[27] = eff->ct_ratio_c;
+}
+
 void ct(struct UnitProcess *unit, double t_ten)
 
 /*
@@ -11,6 +53,11 @@ void ct(struct UnitProcess *unit, double t_ten)
 *           components.
 *
 *  ct() is called by basn_dbp() and filt_dbp()
+*
+*  Nothing downstream reads the CT results, so ct() does nothing when
+*  WTP_OUT_CT is not needed, see out_need().
+*
+*  The results are memoized per unit on the inputs, see memo_wtp.cpp.
 */
 
 {
@@ -55,9 +102,29 @@ void ct(struct UnitProcess *unit, double t_ten)
 	double inf_o3;				  /* Influent ozone residual for unit process (mg/L)          */
 
 	struct Effluent *eff;
+	double key[CT_NKEY], out[CT_NOUT];
+	const double *memo;
+
+	if ((unit->eff.ctx->need & WTP_OUT_CT) == 0)
+		return;
 
 	/* Get input parameters from UnitProcess data structure */
 	eff = &unit->eff;
+	ct_key(unit, t_ten, key);
+	if ((memo = memo_find(unit, MEMO_CT, key, CT_NKEY)) != NULL)
+	{
+		eff->ct_cl2 = memo[0];
+		eff->ct_nh2cl = memo[1];
+		eff->ct_o3 = memo[2];
+		eff->ct_clo2 = memo[3];
+		eff->log_inact_ach_g = memo[4];
+		eff->log_inact_ach_v = memo[5];
+		eff->log_inact_ach_c = memo[6];
+		eff->ct_ratio = memo[7];
+		eff->ct_ratio_v = memo[8];
+		eff->ct_ratio_c = memo[9];
+		return;
+	}
 	pH = eff->pH;
 	DegC = eff->DegK - 273.15;
 	free_cl2 = eff->FreeCl2 * MW_Cl2; /* mg/L as Cl2 */
@@ -103,11 +170,11 @@ void ct(struct UnitProcess *unit, double t_ten)
 				{
 					if (DegC < 1.0)
 						DegC = 1.0;
-					CT_Required = log_required / 2.832 * (12.006 + exp(2.46 - 0.073 * DegC + 0.125 * free_cl2 + 0.389 * pH));
+					CT_Required = log_required / 2.832 * (12.006 + wtp_exp(2.46 - 0.073 * DegC + 0.125 * free_cl2 + 0.389 * pH));
 				}
 				else /*(DegC >= 12.5)*/
 				{
-					CT_Required = log_required / 2.770 * (-2.261 + exp(2.69 - 0.065 * DegC + 0.111 * free_cl2 + 0.361 * pH));
+					CT_Required = log_required / 2.770 * (-2.261 + wtp_exp(2.69 - 0.065 * DegC + 0.111 * free_cl2 + 0.361 * pH));
 				}
 
 				// Update cumulative giardia inactivation achieved (based on assumption of linearity
@@ -285,7 +352,7 @@ void ct(struct UnitProcess *unit, double t_ten)
 				else
 				{
 					o3_conc[i] = inf_o3 - unit->eff.K_o3decay *
-											  (pow(time[i], 0.068) - pow(start_time, 0.068));
+											  (wtp_pow(time[i], 0.068) - wtp_pow(start_time, 0.068));
 
 					if (o3_conc[i] > o3_conc[i - 1])
 						o3_conc[i] = o3_conc[i - 1];
@@ -334,11 +401,11 @@ void ct(struct UnitProcess *unit, double t_ten)
 	        CT Table; this table can be closely approxmiated with a regression eqn. */
 
 				if (DegC > 0.5 && DegC <= 25.0)
-					CT = log_required_c * 25.16 * exp(-0.0929 * DegC); //R2=0.99  (WJS, 7/2005)
+					CT = log_required_c * 25.16 * wtp_exp(-0.0929 * DegC); //R2=0.99  (WJS, 7/2005)
 				else if (DegC <= 0.5)
-					CT = log_required_c * 25.16 * exp(-0.0929 * 0.5);
+					CT = log_required_c * 25.16 * wtp_exp(-0.0929 * 0.5);
 				else /* (DegC > 25.0) */
-					CT = log_required_c * 25.16 * exp(-0.0929 * 25.0);
+					CT = log_required_c * 25.16 * wtp_exp(-0.0929 * 25.0);
 				o3_CT_Required_c = CT;
 
 				/*Update Crypto log inactivation achieved based on linearity between CT ratio
@@ -487,11 +554,11 @@ void ct(struct UnitProcess *unit, double t_ten)
 				/* Calculate CT Required for Crypto. with ClO2 based on LT2 Guidance Manuals table */
 
 				if (DegC > 0.5 && DegC <= 25.0)
-					CT = log_required_c * 664.34 * exp(-0.0873 * DegC);
+					CT = log_required_c * 664.34 * wtp_exp(-0.0873 * DegC);
 				else if (DegC <= 0.5)
-					CT = log_required_c * 664.34 * exp(-0.0873 * 0.5);
+					CT = log_required_c * 664.34 * wtp_exp(-0.0873 * 0.5);
 				else /*(DegC > 25.0)*/
-					CT = log_required_c * 664.34 * exp(-0.0873 * 25.0);
+					CT = log_required_c * 664.34 * wtp_exp(-0.0873 * 25.0);
 				clo2_CT_Required_c = CT;
 
 				/*Update Crypto. log inactivation achieved*/
@@ -538,4 +605,16 @@ void ct(struct UnitProcess *unit, double t_ten)
 
 	} /* End " if( any residuals > 0)..." */
 
+	out[0] = eff->ct_cl2;
+	out[1] = eff->ct_nh2cl;
+	out[2] = eff->ct_o3;
+	out[3] = eff->ct_clo2;
+	out[4] = eff->log_inact_ach_g;
+	out[5] = eff->log_inact_ach_v;
+	out[6] = eff->log_inact_ach_c;
+	out[7] = eff->ct_ratio;
+	out[8] = eff->ct_ratio_v;
+	out[9] = eff->ct_ratio_c;
+	memo_store(unit, MEMO_CT, key, CT_NKEY, out, CT_NOUT);
+
 } /* End subroutine */
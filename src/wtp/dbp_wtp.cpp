@@ -0,0 +1,432 @@
+/* Dbp_wtp.c -- Coefficients and evaluation of the empirical DBP equations
+*
+*  Every species equation of the empirical DBP models has the form
+*
+*    delta = A * P^a * cl2dose^b * br^c * T * H * (eff_hours^e - inf_hours^e')
+*
+*  where P is TOC, UV254 or TOC*UV254, T is DegC^d or d^(DegC-20), and H
+*  is pH^f or f^(pH-7.5) or f^(pH-8.0).  In logs, everything but the time
+*  term is the dot product of a row of coefficients with the predictor
+*  vector [1, ln TOC, ln UV, ln TOC*UV, ln cl2dose, ln br, ln DegC,
+*  DegC-20, ln pH, pH-7.5, pH-8.0].  dbp_formation() takes the logs of the
+*  inputs once per call, evaluates all species of a model with one batch
+*  exp(), and raises the contact times to each distinct exponent once.
+*  The powers of a unit's effluent time are kept in the model context,
+*  where the next unit finds them as the powers of its influent time.
+*
+*  The equations are kept below in their published form; the matrices of
+*  log coefficients are built from them before main().  The kernels
+*  (rwdbp(), owdbp(), coagdbp(), gacmbdbp(), modrw1dbp(), modrw2dbp())
+*  apply their own adjustments, caps, and correction factors to the
+*  results.
+*
+*  The following functions are in this file:
+*    dbp_formation()
+*    dbp_forms()
+*/
+#include "wtp.h"
+
+/* Predictors */
+#define X_NONE 0   /* Constant term, or no term    */
+#define X_DOC 1    /* ln(TOC)                      */
+#define X_UV 2     /* ln(UV254)                    */
+#define X_DOC_UV 3 /* ln(TOC*UV254)                */
+#define X_CL2 4    /* ln(cl2dose)                  */
+#define X_BR 5     /* ln(br)                       */
+#define X_DEGC 6   /* ln(DegC):  DegC^d            */
+#define X_T20 7    /* DegC-20:   d^(DegC-20)       */
+#define X_PH 8     /* ln(pH):    pH^f              */
+#define X_PH75 9   /* pH-7.5:    f^(pH-7.5)        */
+#define X_PH8 10   /* pH-8.0:    f^(pH-8.0)        */
+#define DBP_NX 11
+
+struct DbpEquation
+{                  /* One species equation, published form       */
+  short species;   /*   DBP_TTHM ...                              */
+  double a;        /*   Leading constant                          */
+  short org;       /*   X_DOC, X_UV or X_DOC_UV                   */
+  double a_org;    /*   Exponent of the organic term              */
+  double a_cl2;    /*   Exponent of cl2dose                       */
+  double a_br;     /*   Exponent of br                            */
+  short temp;      /*   X_DEGC or X_T20                           */
+  double a_temp;   /*   Exponent or base of the temperature term  */
+  short ph;        /*   X_PH, X_PH75, X_PH8 or X_NONE             */
+  double a_ph;     /*   Exponent or base of the pH term           */
+  double e_eff;    /*   Exponent of eff_hours                     */
+  double e_inf;    /*   Exponent of inf_hours                     */
+};
+
+/*  Raw water model (Jinsik Sohn, Univ. of Col., 1998), also used by
+*   modrw1dbp() and modrw2dbp().  Not used:
+*   {HAA5, 30.0, X_DOC, 0.997, 0.278, -0.138, X_DEGC, 0.341, X_PH, -0.799, 0.169, 0.169}
+*/
+static const struct DbpEquation raw_eqs[] = {
+    {DBP_TTHM, pow(10, -1.385), X_DOC, 1.098, 0.152, 0.068, X_DEGC, 0.609, X_PH, 1.601, 0.263, 0.263},
+    {DBP_CHCL3, pow(10, -1.205), X_DOC, 1.617, -0.094, -0.175, X_DEGC, 0.607, X_PH, 1.403, 0.306, 0.306},
+    {DBP_CHBRCL2, pow(10, -2.874), X_DOC, 0.901, 0.017, 0.733, X_DEGC, 0.498, X_PH, 1.511, 0.199, 0.199},
+    {DBP_CHBR2CL, pow(10, -5.649), X_DOC, -0.226, 0.108, 1.81, X_DEGC, 0.512, X_PH, 2.212, 0.146, 0.146},
+    {DBP_CHBR3, pow(10, -7.83), X_DOC, -0.983, 0.804, 1.765, X_DEGC, 0.754, X_PH, 2.139, 0.566, 0.556},
+    {DBP_HAA6, 9.98, X_DOC, 0.935, 0.443, -0.031, X_DEGC, 0.387, X_PH, -0.655, 0.178, 0.178},
+    {DBP_MCAA, 0.45, X_DOC, 0.173, 0.397, 0.029, X_DEGC, 0.573, X_PH, -0.279, -0.009, -0.009},
+    {DBP_MBAA, 6.21 * pow(10, -5.0), X_DOC, -0.584, 0.754, 1.1, X_DEGC, 0.707, X_PH, 0.604, 0.09, 0.09},
+    {DBP_DCAA, 0.3, X_DOC, 1.396, 0.379, -0.149, X_DEGC, 0.465, X_PH, 0.2, 0.218, 0.218},
+    {DBP_TCAA, 92.68, X_DOC, 1.152, 0.331, -0.229, X_DEGC, 0.299, X_PH, -1.627, 0.18, 0.18},
+    {DBP_DBAA, 3.59 * pow(10, -5.0), X_DOC, -1.086, 0.673, 2.052, X_DEGC, 0.38, X_PH, -0.001, 0.095, 0.095},
+    {DBP_BCAA, 5.51 * pow(10, -3.0), X_DOC, 0.463, 0.522, 0.667, X_DEGC, 0.379, X_PH, 0.581, 0.22, 0.22},
+    /* Coag.-water HAA9 species and TOX models developed by MPI in 4/2001 */
+    {DBP_TBAA, 5.59 * pow(10, -6.0), X_DOC_UV, 0.0657, -2.51, 2.32, X_T20, 1.059, X_PH8, 0.555, 1.26, 1.26},
+    {DBP_DBCAA, 3.7 * pow(10, -3.0), X_DOC_UV, -0.0162, -0.170, 0.972, X_T20, 1.054, X_PH8, 0.839, 0.685, 0.685},
+    {DBP_BDCAA, 0.589, X_DOC_UV, 0.230, 0.140, 0.301, X_T20, 1.022, X_PH8, 0.700, 0.422, 0.422},
+    {DBP_HAA9, 10.783, X_DOC_UV, 0.250, 0.500, 0.054, X_T20, 1.015, X_PH8, 0.894, 0.348, 0.348},
+    {DBP_HAA6_9, 18.6, X_DOC_UV, 0.320, 0.510, -0.106, X_T20, 1.017, X_PH8, 0.938, 0.353, 0.353},
+    {DBP_TOX, 109.0, X_DOC_UV, 0.362, 0.129, 0.0, X_DEGC, 0.211, X_NONE, 0.0, 0.182, 0.182}};
+
+/*  Ozonated raw water model (Jinsik Sohn, Univ. of Col.).  Not used:
+*   {HAA5, 373.3, X_UV, 0.520, 0.340, -0.199, X_DEGC, 0.351, X_PH, -0.788, 0.169, 0.169}
+*/
+static const struct DbpEquation ozone_eqs[] = {
+    {DBP_TTHM, pow(10, -0.377), X_UV, 0.482, 0.339, 0.023, X_DEGC, 0.617, X_PH, 1.609, 0.261, 0.261},
+    {DBP_CHCL3, pow(10, 0.096), X_UV, 0.604, 0.286, -0.242, X_DEGC, 0.619, X_PH, 1.416, 0.304, 0.304},
+    {DBP_CHBRCL2, pow(10, -1.708), X_UV, 0.590, -0.022, 0.679, X_DEGC, 0.505, X_PH, 1.519, 0.196, 0.196},
+    {DBP_CHBR2CL, pow(10, -5.694), X_UV, -0.005, -0.024, 1.820, X_DEGC, 0.510, X_PH, 2.211, 0.146, 0.146},
+    {DBP_CHBR3, pow(10, -9.267), X_UV, -0.722, 0.926, 1.804, X_DEGC, 0.741, X_PH, 2.158, 0.571, 0.571},
+    {DBP_HAA6, 171.4, X_UV, 0.584, 0.398, -0.091, X_DEGC, 0.396, X_PH, -0.645, 0.178, 0.178},
+    {DBP_MCAA, 1.39, X_UV, 0.256, 0.194, 0.038, X_DEGC, 0.571, X_PH, -0.283, -0.008, -0.008},
+    {DBP_MBAA, 1.23 * pow(10, -5.0), X_UV, -0.318, 0.728, 1.147, X_DEGC, 0.701, X_PH, 0.598, 0.09, 0.09},
+    {DBP_DCAA, 30.41, X_UV, 0.963, 0.211, -0.238, X_DEGC, 0.474, X_PH, 0.212, 0.219, 0.219},
+    {DBP_TCAA, 1.64 * pow(10, 3.0), X_UV, 0.593, 0.439, -0.305, X_DEGC, 0.317, X_PH, -1.613, 0.18, 0.18},
+    {DBP_DBAA, 1.75 * pow(10, -6.0), X_UV, -0.607, 0.650, 2.138, X_DEGC, 0.353, X_PH, -0.012, 0.093, 0.093},
+    {DBP_BCAA, 0.072, X_UV, 0.578, 0.121, 0.675, X_DEGC, 0.375, X_PH, 0.578, 0.222, 0.222},
+    /* Coag.-water HAA9 species and TOX models developed by MPI in 4/2001 */
+    {DBP_TBAA, 5.59 * pow(10, -6.0), X_DOC_UV, 0.0657, -2.51, 2.32, X_T20, 1.059, X_PH8, 0.555, 1.26, 1.26},
+    {DBP_DBCAA, 3.7 * pow(10, -3.0), X_DOC_UV, -0.0162, -0.170, 0.972, X_T20, 1.054, X_PH8, 0.839, 0.685, 0.685},
+    {DBP_BDCAA, 0.589, X_DOC_UV, 0.230, 0.140, 0.301, X_T20, 1.022, X_PH8, 0.700, 0.422, 0.422},
+    {DBP_HAA9, 10.783, X_DOC_UV, 0.250, 0.500, 0.054, X_T20, 1.015, X_PH8, 0.894, 0.348, 0.348},
+    {DBP_HAA6_9, 18.6, X_DOC_UV, 0.320, 0.510, -0.106, X_T20, 1.017, X_PH8, 0.938, 0.353, 0.353},
+    {DBP_TOX, 109.0, X_DOC_UV, 0.362, 0.129, 0.0, X_DEGC, 0.211, X_NONE, 0.0, 0.182, 0.182}};
+
+/*  Coagulated water model (Jinsik Sohn, Univ. of Col., May 1999), also
+*   used by gacmbdbp() for TOC > 2 mg/L.  Not used:
+*   {HAA5, 30.7, X_DOC_UV, 0.302, 0.541, -0.012, X_T20, 1.022, X_PH75, 0.922, 0.161, 0.161}
+*/
+static const struct DbpEquation coag_eqs[] = {
+    {DBP_TTHM, 23.9, X_DOC_UV, 0.403, 0.225, 0.141, X_T20, 1.026, X_PH75, 1.156, 0.264, 0.264},
+    {DBP_CHCL3, 266.0, X_DOC_UV, 0.483, 0.424, -0.679, X_T20, 1.018, X_PH75, 1.132, 0.333, 0.333},
+    {DBP_CHBRCL2, 1.68, X_DOC_UV, 0.260, 0.114, 0.462, X_T20, 1.026, X_PH75, 1.098, 0.196, 0.196},
+    {DBP_CHBR2CL, 0.0080, X_DOC_UV, -0.056, -0.157, 1.425, X_T20, 1.021, X_PH75, 1.127, 0.148, 0.148},
+    {DBP_CHBR3, 4.4 * pow(10, -5.0), X_DOC_UV, -0.300, -0.221, 2.134, X_T20, 1.037, X_PH75, 1.391, 0.143, 0.143},
+    {DBP_HAA6, 30.7, X_DOC_UV, 0.328, 0.585, -0.121, X_T20, 1.022, X_PH75, 0.922, 0.150, 0.150},
+    {DBP_MCAA, 4.58, X_DOC_UV, -0.090, 0.662, -0.224, X_T20, 1.024, X_PH75, 1.042, -0.043, -0.043},
+    {DBP_MBAA, 0.0206, X_DOC_UV, 0.358, -0.101, 0.812, X_T20, 1.162, X_PH75, 0.653, 0.088, 0.088},
+    {DBP_DCAA, 60.4, X_DOC_UV, 0.397, 0.665, -0.558, X_T20, 1.017, X_PH75, 1.034, 0.222, 0.222},
+    {DBP_TCAA, 52.6, X_DOC_UV, 0.403, 0.749, -0.416, X_T20, 1.014, X_PH75, 0.874, 0.163, 0.163},
+    {DBP_DBAA, 9.42 * pow(10, -5.0), X_DOC_UV, 0.059, 0.182, 2.109, X_T20, 1.007, X_PH75, 1.21, 0.070, 0.070},
+    {DBP_BCAA, 0.323, X_DOC_UV, 0.153, 0.257, 0.586, X_T20, 1.042, X_PH75, 1.181, 0.201, 0.201},
+    /* Coag.-water HAA9 species and TOX models developed by MPI in 4/2001 */
+    {DBP_TBAA, 5.59 * pow(10, -6.0), X_DOC_UV, 0.0657, -2.51, 2.32, X_T20, 1.059, X_PH8, 0.555, 1.26, 1.26},
+    {DBP_DBCAA, 3.7 * pow(10, -3.0), X_DOC_UV, -0.0162, -0.170, 0.972, X_T20, 1.054, X_PH8, 0.839, 0.685, 0.685},
+    {DBP_BDCAA, 0.589, X_DOC_UV, 0.230, 0.140, 0.301, X_T20, 1.022, X_PH8, 0.700, 0.422, 0.422},
+    {DBP_HAA9, 10.783, X_DOC_UV, 0.250, 0.500, 0.054, X_T20, 1.015, X_PH8, 0.894, 0.348, 0.348},
+    {DBP_HAA6_9, 18.6, X_DOC_UV, 0.320, 0.510, -0.106, X_T20, 1.017, X_PH8, 0.938, 0.353, 0.353},
+    {DBP_TOX, 109.0, X_DOC_UV, 0.362, 0.129, 0.0, X_DEGC, 0.211, X_NONE, 0.0, 0.182, 0.182}};
+
+/*  GAC-treated water model, from the ICR Treatment Study Data for TOC <
+*   2.0 mg/L.  Not used:
+*   {HAA5, 40.0, X_DOC_UV, 0.488, 0.385, -0.155, X_T20, 1.021, X_PH8, 0.867, 0.262, 0.262}
+*/
+static const struct DbpEquation gac_eqs[] = {
+    {DBP_TTHM, 17.73, X_DOC_UV, 0.474, 0.173, 0.245, X_T20, 1.036, X_PH8, 1.316, 0.365, 0.365},
+    {DBP_CHCL3, 101.0, X_DOC_UV, 0.614, 0.698, -0.468, X_T20, 1.035, X_PH8, 1.099, 0.336, 0.336},
+    {DBP_CHBRCL2, 7.37, X_DOC_UV, 0.430, 0.555, 0.075, X_T20, 1.030, X_PH8, 1.349, 0.278, 0.278},
+    {DBP_CHBR2CL, 3.987, X_DOC_UV, 0.525, 0.125, 0.362, X_T20, 1.027, X_PH8, 1.432, 0.319, 0.319},
+    {DBP_CHBR3, 0.158, X_DOC_UV, 0.405, -0.118, 0.950, X_T20, 1.048, X_PH8, 1.430, 0.323, 0.323},
+    {DBP_HAA6, 36.9, X_DOC_UV, 0.502, 0.371, -0.078, X_T20, 1.021, X_PH8, 0.913, 0.279, 0.279},
+    {DBP_MCAA, 1.75, X_DOC_UV, 0.043, 0.126, -0.135, X_T20, 1.009, X_PH8, 0.873, 0.087, 0.087},
+    {DBP_MBAA, 0.666, X_DOC_UV, 0.067, 0.253, -0.044, X_T20, 1.017, X_PH8, 0.845, 0.097, 0.097},
+    {DBP_DCAA, 34.6, X_DOC_UV, 0.473, 0.415, -0.380, X_T20, 1.019, X_PH8, 0.870, 0.288, 0.288},
+    {DBP_TCAA, 37.4, X_DOC_UV, 0.557, 0.692, -0.394, X_T20, 1.010, X_PH8, 0.619, 0.167, 0.167},
+    {DBP_DBAA, 0.467, X_DOC_UV, 0.467, -0.237, 0.640, X_T20, 1.019, X_PH8, 1.286, 0.295, 0.295},
+    {DBP_BCAA, 3.43, X_DOC_UV, 0.484, 0.245, 0.110, X_T20, 1.018, X_PH8, 1.064, 0.313, 0.313},
+    {DBP_TBAA, 1.83 * pow(10, -1.0), X_DOC_UV, 0.385, -0.844, 0.532, X_T20, 1.003, X_PH8, 0.829, 0.464, 0.464},
+    {DBP_DBCAA, 4.35 * pow(10, -1.0), X_DOC_UV, 0.316, -0.081, 0.368, X_T20, 1.008, X_PH8, 0.716, 0.363, 0.363},
+    {DBP_BDCAA, 2.0, X_DOC_UV, 0.518, 0.248, 0.190, X_T20, 0.987, X_PH8, 0.613, 0.317, 0.317},
+    {DBP_HAA9, 20.6, X_DOC_UV, 0.509, 0.253, 0.053, X_T20, 1.019, X_PH8, 0.828, 0.425, 0.425},
+    {DBP_HAA6_9, 18.6, X_DOC_UV, 0.320, 0.510, -0.106, X_T20, 1.017, X_PH8, 0.938, 0.353, 0.353},
+    {DBP_TOX, 168.0, X_DOC_UV, 0.529, 0.349, 0.0, X_T20, 1.009, X_NONE, 0.0, 0.239, 0.239}};
+
+struct DbpMatrix
+{                                     /* Log form of one model             */
+  unsigned used;                      /*   Bit X_... set if predictor used */
+  double c[DBP_NSPECIES][DBP_NX];     /*   Log coefficients                */
+  int n_exp;                          /*   Number of distinct exponents    */
+  double e[DBP_NPOWERS];              /*   Distinct exponents of time      */
+  short i_eff[DBP_NSPECIES];          /*   Index in e[] of e_eff           */
+  short i_inf[DBP_NSPECIES];          /*   Index in e[] of e_inf           */
+};
+
+static struct DbpMatrix dbp_matrix[DBP_NMODELS];
+
+static short exp_index(struct DbpMatrix *m, double e)
+/*
+*  Purpose: Return the index of exponent 'e' in m->e[], adding it if new.
+*/
+{
+  int i;
+
+  for (i = 0; i < m->n_exp; i++)
+    if (m->e[i] == e)
+      return ((short)i);
+  m->e[m->n_exp] = e;
+  return ((short)m->n_exp++);
+}
+
+static void build_matrix(struct DbpMatrix *m, const struct DbpEquation *eqs, int n)
+/*
+*  Purpose: Fill 'm' with the log coefficients of the n equations in eqs[].
+*/
+{
+  const struct DbpEquation *eq;
+  double *c;
+  int i, j;
+
+  memset(m, 0, sizeof(struct DbpMatrix));
+  for (i = 0; i < n; i++)
+  {
+    eq = &eqs[i];
+    c = m->c[eq->species];
+    c[X_NONE] = log(eq->a);
+    c[eq->org] += eq->a_org;
+    c[X_CL2] += eq->a_cl2;
+    c[X_BR] += eq->a_br;
+    c[eq->temp] += (eq->temp == X_DEGC) ? eq->a_temp : log(eq->a_temp);
+    if (eq->ph != X_NONE)
+      c[eq->ph] += (eq->ph == X_PH) ? eq->a_ph : log(eq->a_ph);
+    m->i_eff[eq->species] = exp_index(m, eq->e_eff);
+    m->i_inf[eq->species] = exp_index(m, eq->e_inf);
+  }
+  for (i = 0; i < DBP_NSPECIES; i++)
+    for (j = 1; j < DBP_NX; j++)
+      if (m->c[i][j] != 0.0)
+        m->used |= 1u << j;
+}
+
+static int build_dbp_matrices(void)
+{
+  build_matrix(&dbp_matrix[DBP_RAW_MODEL], raw_eqs, sizeof(raw_eqs) / sizeof(raw_eqs[0]));
+  build_matrix(&dbp_matrix[DBP_OZONE_MODEL], ozone_eqs, sizeof(ozone_eqs) / sizeof(ozone_eqs[0]));
+  build_matrix(&dbp_matrix[DBP_COAG_MODEL], coag_eqs, sizeof(coag_eqs) / sizeof(coag_eqs[0]));
+  build_matrix(&dbp_matrix[DBP_GAC_MODEL], gac_eqs, sizeof(gac_eqs) / sizeof(gac_eqs[0]));
+  return (TRUE);
+}
+
+static const int dbp_matrices = build_dbp_matrices(); /* Before main() */
+
+/* Species rows of the outputs, see dbp_rows() */
+#define DBP_ALL_ROWS ((1u << DBP_NSPECIES) - 1)
+#define THM_ROWS ((1u << DBP_CHCL3) | (1u << DBP_CHBRCL2) | (1u << DBP_CHBR2CL) | \
+                  (1u << DBP_CHBR3))
+#define HAA9_ROWS ((1u << DBP_TBAA) | (1u << DBP_DBCAA) | (1u << DBP_BDCAA) | \
+                   (1u << DBP_HAA9) | (1u << DBP_HAA6_9))
+
+static unsigned dbp_rows(unsigned need)
+/*
+*  Purpose: Return the species (bit DBP_...) to evaluate for the outputs
+*           in 'need' (WTP_OUT_...).  TTHM, HAA6 and its species are always
+*           evaluated, see out_need().
+*/
+{
+  unsigned rows = DBP_ALL_ROWS;
+
+  if ((need & WTP_OUT_THM_SPECIES) == 0)
+    rows &= ~THM_ROWS;
+  if ((need & WTP_OUT_HAA9) == 0)
+    rows &= ~HAA9_ROWS;
+  if ((need & WTP_OUT_TOX) == 0)
+    rows &= ~(1u << DBP_TOX);
+  return (rows);
+}
+
+static struct DbpPowers *find_powers(struct WtpContext *ctx, int model, double hours)
+/*
+*  Purpose: Return the powers of 'hours' in 'model' kept in ctx, NULL if
+*           there are none.
+*/
+{
+  int i;
+
+  for (i = 0; i < DBP_NCARRY; i++)
+    if (ctx->dbp_powers[i].hours == hours && ctx->dbp_powers[i].model == model)
+      return (&ctx->dbp_powers[i]);
+  return (NULL);
+}
+
+void dbp_formation(struct WtpContext *ctx, int model, double doc, double uv,
+                   double cl2dose, double br, double DegC, double pH,
+                   double eff_hours, double inf_hours, struct DbpTerms *dbp)
+/*
+*  Purpose: Evaluate the species equations of an empirical DBP model.
+*
+*  Inputs:
+*    ctx       = Model context that keeps the powers of the contact times,
+*                or NULL
+*    model     = DBP_RAW_MODEL, DBP_OZONE_MODEL, DBP_COAG_MODEL or
+*                DBP_GAC_MODEL
+*    doc       = TOC (mg/L), > 0
+*    uv        = UV254 (1/cm), > 0
+*    cl2dose   = Chlorine dose (mg/L as Cl2), > 0
+*    br        = Bromide (ug/L), > 0
+*    DegC      = Temperature (Deg C), > 0
+*    pH        = pH
+*    eff_hours = Contact time to the effluent (hours), > 0
+*    inf_hours = Contact time to the influent (hours)
+*
+*  Return:
+*    dbp->k[s]     = Everything in the equation of species s but the time term
+*    dbp->te[s]    = eff_hours^e
+*    dbp->ti[s]    = inf_hours^e', 0 if inf_hours <= 0
+*    dbp->delta[s] = k[s] * (te[s] - ti[s])
+*
+*  Notes:
+*   1. The caller applies the minimum values of the inputs.
+*   2. Only the species of the outputs in ctx->need are evaluated, see
+*      dbp_rows().  The others get k[s] = delta[s] = 0; te[s] and ti[s]
+*      are always set, so dbp_forms() still tells if they would form.
+*   3. The inf_hours of a unit process is the eff_hours of the unit before
+*      it (or of the WTP effluent for the distribution samples), so the
+*      powers of eff_hours are kept in ctx->dbp_powers[] for the next
+*      call.  They are looked up by model and contact time, which covers
+*      a change of DBP model between units and the time offset of
+*      modrw2dbp().  A hit returns the same values as computing them.
+*   4. The distribution samples of a run, and the nodes of dist_network(),
+*      see the same water for different contact times.  The k[s] of the
+*      last water are kept in ctx->dbp_coefs, so those calls only raise
+*      their contact time to the exponents of the model.
+*/
+{
+  const struct DbpMatrix *m = &dbp_matrix[model];
+  struct DbpPowers *p_eff = NULL, *p_inf = NULL;
+  struct DbpCoefs *coefs = NULL;
+  const double *t_eff, *t_inf = NULL;
+  const double in[6] = {doc, uv, cl2dose, br, DegC, pH};
+  double x[DBP_NX];
+  double arg[DBP_NSPECIES + 2 * DBP_NPOWERS];
+  double val[DBP_NSPECIES + 2 * DBP_NPOWERS];
+  double lt, sum;
+  unsigned rows = (ctx != NULL) ? dbp_rows(ctx->need) : DBP_ALL_ROWS;
+  int row[DBP_NSPECIES];
+  int i, j, n, i_eff = 0, i_inf = 0, n_exp = m->n_exp;
+
+  /* Species terms of the same water as the last call */
+  if (ctx != NULL && ctx->dbp_coefs.model == model && ctx->dbp_coefs.rows == rows &&
+      memcmp(ctx->dbp_coefs.in, in, sizeof(in)) == 0)
+    coefs = &ctx->dbp_coefs;
+
+  n = 0;
+  if (coefs == NULL)
+  {
+    /* Predictors used by the model */
+    memset(x, 0, sizeof(x));
+    x[X_NONE] = 1.0;
+    if (m->used & (1u << X_DOC))
+      x[X_DOC] = wtp_log(doc);
+    if (m->used & (1u << X_UV))
+      x[X_UV] = wtp_log(uv);
+    if (m->used & (1u << X_DOC_UV))
+      x[X_DOC_UV] = wtp_log(doc * uv);
+    x[X_CL2] = wtp_log(cl2dose);
+    x[X_BR] = wtp_log(br);
+    if (m->used & (1u << X_DEGC))
+      x[X_DEGC] = wtp_log(DegC);
+    x[X_T20] = DegC - 20.0;
+    if (m->used & (1u << X_PH))
+      x[X_PH] = wtp_log(pH);
+    x[X_PH75] = pH - 7.5;
+    x[X_PH8] = pH - 8.0;
+
+    /* ln k[s] for each species evaluated */
+    for (i = 0; i < DBP_NSPECIES; i++)
+    {
+      row[i] = -1;
+      if ((rows & (1u << i)) == 0)
+        continue;
+      sum = 0.0;
+      for (j = 0; j < DBP_NX; j++)
+        sum += m->c[i][j] * x[j];
+      row[i] = n;
+      arg[n++] = sum;
+    }
+  }
+
+  /* Powers of the contact times not kept from an earlier call */
+  if (ctx != NULL)
+  {
+    p_eff = find_powers(ctx, model, eff_hours);
+    if (inf_hours > 0.0)
+      p_inf = find_powers(ctx, model, inf_hours);
+  }
+  if (p_eff == NULL)
+  {
+    lt = wtp_log(eff_hours);
+    for (j = 0, i_eff = n; j < n_exp; j++)
+      arg[n++] = m->e[j] * lt;
+  }
+  if (inf_hours > 0.0 && p_inf == NULL)
+  {
+    lt = wtp_log(inf_hours);
+    for (j = 0, i_inf = n; j < n_exp; j++)
+      arg[n++] = m->e[j] * lt;
+  }
+  wtp_exp_n(n, arg, val);
+  t_eff = (p_eff != NULL) ? p_eff->t : &val[i_eff];
+  if (inf_hours > 0.0)
+    t_inf = (p_inf != NULL) ? p_inf->t : &val[i_inf];
+
+  for (i = 0; i < DBP_NSPECIES; i++)
+  {
+    if (coefs != NULL)
+      dbp->k[i] = coefs->k[i];
+    else
+      dbp->k[i] = (row[i] >= 0) ? val[row[i]] : 0.0;
+    dbp->te[i] = t_eff[m->i_eff[i]];
+    dbp->ti[i] = (t_inf != NULL) ? t_inf[m->i_inf[i]] : 0.0;
+    dbp->delta[i] = dbp->k[i] * (dbp->te[i] - dbp->ti[i]);
+  }
+
+  /* Keep the species terms for the next contact time of this water */
+  if (ctx != NULL && coefs == NULL)
+  {
+    coefs = &ctx->dbp_coefs;
+    coefs->model = model;
+    coefs->rows = rows;
+    memcpy(coefs->in, in, sizeof(in));
+    memcpy(coefs->k, dbp->k, sizeof(coefs->k));
+  }
+
+  /* Keep the powers of eff_hours for the next unit process */
+  if (ctx != NULL && p_eff == NULL)
+  {
+    p_eff = &ctx->dbp_powers[ctx->dbp_next];
+    ctx->dbp_next = (ctx->dbp_next + 1) % DBP_NCARRY;
+    p_eff->model = model;
+    p_eff->hours = eff_hours;
+    memcpy(p_eff->t, t_eff, n_exp * sizeof(double));
+  }
+}
+
+int dbp_forms(const struct DbpTerms *dbp, int first, int last)
+/*
+*  Purpose: TRUE if any of species first..last forms (delta > 0), whether
+*           or not it was evaluated.
+*
+*  Notes:
+*   1. k[s] > 0 and the kernels scale delta[s] by positive factors only,
+*      so delta[s] > 0 exactly when te[s] > ti[s].
+*/
+{
+  int i;
+
+  for (i = first; i <= last; i++)
+    if (dbp->te[i] > dbp->ti[i])
+      return (TRUE);
+  return (FALSE);
+}
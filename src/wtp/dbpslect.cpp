@@ -26,48 +26,49 @@ void choose_dbpmodel(struct UnitProcess *unit)
 * Documention and code by WJS, 10/98 */
 
 {
+	struct WtpContext *ctx = unit->eff.ctx;
 	//FILE *fptr;
 
 	/* Make sure that if this is a groundwater (swflag==FALSE), then we are using
    coagdbp() function */
 
 	/* Call the appropriate support function to estimate DBP formation */
-	if (swflag == FALSE)
+	if (ctx->swflag == FALSE)
 	{ /* Make sure that if this is a groundwater (swflag==FALSE), then we are using
               coagulated water model for DBPs */
 		coagdbp(unit);
 	}
 
-	else if (rwdbpflag == TRUE)
+	else if (ctx->rwdbpflag == TRUE)
 	{
 		rwdbp(unit);
 	}
 
-	else if (owdbpflag == TRUE)
+	else if (ctx->owdbpflag == TRUE)
 	{
 		owdbp(unit);
 	}
 
-	else if (coagdbpflag == TRUE)
+	else if (ctx->coagdbpflag == TRUE)
 	{
 		coagdbp(unit);
 	}
-	else if (gacmemdbpflag == TRUE)
+	else if (ctx->gacmemdbpflag == TRUE)
 	{
 		gacmbdbp(unit);
 	}
 
-	else if (modrw1dbpflag == TRUE)
+	else if (ctx->modrw1dbpflag == TRUE)
 	{
 		modrw1dbp(unit);
 	}
 
-	else if (modrw2dbpflag == TRUE && unit->type != RAPID_MIX)
+	else if (ctx->modrw2dbpflag == TRUE && unit->type != RAPID_MIX)
 	{
 		modrw2dbp(unit);
 	}
 
-	else if (modrw2dbpflag == TRUE && unit->type == RAPID_MIX)
+	else if (ctx->modrw2dbpflag == TRUE && unit->type == RAPID_MIX)
 	{
 		modrw1dbp(unit);
 	}
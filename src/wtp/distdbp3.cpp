@@ -1,28 +1,163 @@
-/* Dist_dbp.c */
+/* Dist_dbp.c -- Distribution system sampling points
+*
+*  Average Tap, End of System and Additional Point units age the plant
+*  effluent (the unit before the first of them) for their own residence
+*  time.  Every point of a run starts from the same water, so the
+*  chlorine chemistry at the entrance to the distribution system,
+*  phchange(), breakpt() and the decay parameters, is computed by the
+*  first point of the run and copied by the others (ctx->dist).
+*
+*  Each point is a cascade of ncstr(1.0) CFSTRs over its own residence
+*  time, so the cascades of two points differ and each point runs its
+*  own.  With ctx->dist_trajectory=TRUE the points instead lie on one
+*  trajectory of CFSTRs the size of those of the shortest point, and each
+*  point takes the state after as many CFSTRs as fit in its residence
+*  time.  The state is carried from each point to the next, so the run
+*  costs the CFSTRs of the longest point rather than ncstr(1.0) per point.
+*  The shortest point is unchanged; the longer ones are modelled with
+*  more, smaller CFSTRs, which ncstr() notes makes no significant
+*  difference.
+*
+*  The following functions are in this file:
+*    dist_dbp()
+*/
 #include "wtp.h"
 
+static double point_minutes(struct UnitProcess *unit, double peakfactor)
+/*
+*  Purpose: Theoretical residence time of a sampling point (minutes), 0 if
+*           'unit' is not a sampling point.
+*/
+{
+  switch (unit->type)
+  {
+  case LOCATION_1:
+  case AVG_TAP:
+    return (unit->data.avg_tap->days * 1440 / peakfactor);
+
+  case END_OF_SYSTEM:
+    return (unit->data.end_of_system->days * 1440 / peakfactor);
+
+  default:
+    return (0.0);
+  }
+}
+
+static void dist_start(struct UnitProcess *unit, double peakfactor)
+/*
+*  Purpose: Bring unit->eff, a copy of the plant effluent, to the state at
+*           the start of the CFSTRs of a sampling point.
+*
+*  Notes:
+*   1. The first point of a run computes the state, later points copy it,
+*      including ctx->ph_cache, so that every point sees what the first
+*      did.  reset_run_context() clears ctx->dist.valid.
+*   2. The trajectory of ctx->dist_trajectory starts here; its CFSTR time
+*      is that of the shortest sampling point in the train.
+*/
+{
+  struct Effluent *eff = &unit->eff;
+  struct WtpContext *ctx = eff->ctx;
+  struct DistStart *d = &ctx->dist;
+  struct UnitProcess *p;
+  double minutes, shortest = 0.0;
+
+  if (d->valid == TRUE)
+  {
+    if (eff->cl2cnt > 0)
+    {
+      eff->pH = d->pH;
+      eff->Alk = d->Alk;
+      eff->CBminusCA = d->CBminusCA;
+      eff->Ca_aq = d->Ca_aq;
+      eff->Ca_solid = d->Ca_solid;
+      eff->Mg_aq = d->Mg_aq;
+      eff->Mg_solid = d->Mg_solid;
+      eff->CO2_aq = d->CO2_aq;
+      eff->FreeCl2 = d->FreeCl2;
+      eff->NH3 = d->NH3;
+      eff->NH2Cl = d->NH2Cl;
+      eff->NHCl2 = d->NHCl2;
+      ctx->ph_cache = d->ph_cache;
+    }
+    return;
+  }
+
+  if (eff->cl2cnt > 0)
+  {
+    phchange(unit, TRUE);
+    cl2decay_start(unit, &d->coef);
+    d->pH = eff->pH;
+    d->Alk = eff->Alk;
+    d->CBminusCA = eff->CBminusCA;
+    d->Ca_aq = eff->Ca_aq;
+    d->Ca_solid = eff->Ca_solid;
+    d->Mg_aq = eff->Mg_aq;
+    d->Mg_solid = eff->Mg_solid;
+    d->CO2_aq = eff->CO2_aq;
+    d->FreeCl2 = eff->FreeCl2;
+    d->NH3 = eff->NH3;
+    d->NH2Cl = eff->NH2Cl;
+    d->NHCl2 = eff->NHCl2;
+    d->ph_cache = ctx->ph_cache;
+  }
+
+  if (ctx->dist_trajectory == TRUE)
+  {
+    for (p = eff->wtp_effluent; p != NULL; p = NextUnitProcess(p))
+    {
+      minutes = point_minutes(p, peakfactor);
+      if (minutes > 0.0 && (shortest == 0.0 || minutes < shortest))
+        shortest = minutes;
+    }
+    d->cfstr_time = shortest / (60.0 * ncstr(1.0));
+    d->n_cl2 = 0;
+    d->FreeCl2_n = eff->FreeCl2;
+    d->NH2Cl_n = eff->NH2Cl;
+    d->hours_n = eff->hours;
+    d->n_clo2 = 0;
+    d->clo2_res_n = eff->clo2_res;
+    d->clo2_minutes_n = eff->clo2_minutes;
+  }
+  d->valid = TRUE;
+}
+
+static int trajectory_cstrs(struct DistStart *d, double theo_res_time)
+/*
+*  Purpose: Number of CFSTRs of the trajectory in 'theo_res_time' (minutes).
+*/
+{
+  return ((int)(theo_res_time / (60.0 * d->cfstr_time) + 0.5));
+}
+
 void dist_dbp(struct UnitProcess *unit)
 /*
 *  Purpose: Estimate chlorine decay, THM, and HAA in distribution sample.
+*
+*  Notes:
+*   1. See the top of this file for what the sampling points of a run
+*      share and for ctx->dist_trajectory.
+*   2. The trajectory is followed in the order of the train, which is
+*      normally that of residence time.  A point shorter than the one
+*      before it starts again from the plant effluent.
 */
 {
+  struct WtpContext *ctx = unit->eff.ctx;
+  struct DistStart *d = &ctx->dist;
   //FILE *fptr;
   /* Inputs: */
   double theo_res_time; /* (minutes)                          */
   double t_ten_theo;    /* Ratio of t10/theo_res_time (0-1.0) */
   double mean_theo;     /* Ratio                              */
 
-  /* Outputs: */
-  double eff_hours; /* Cumulative time to effluent.       */
-
   /* Internal: */
   double ncstrs;   /* Number of equ. constant stired tanks in series. */
   double rxnhours; /* Contact time for one constant stired tank.      */
   double rxnminutes;
   double peakfactor = 1.0; /* Adjust dist. sys. travel time for max. flow case*/
-  int i;
   struct Effluent *eff;
   struct UnitProcess *end;
+  int n;
 
   /* Self protection: */
   if (unit == NULL || unit->data.ptr == NULL)
@@ -49,88 +184,88 @@ void dist_dbp(struct UnitProcess *unit)
   eff = &unit->eff;
   *eff = unit->eff.wtp_effluent->eff;
 
-  if (coldflag == TRUE)
+  if (ctx->coldflag == TRUE)
   {
     peakfactor = unit->eff.Peak / unit->eff.influent->data.influent->avg_flow;
   }
 
-  /* Get inputs from UnitProcess data structure: */
-  eff_hours = eff->hours;
-
   /*DEBUGGING CODE*/
   //      fptr=fopen("debug.dat","a+");
   //      fprintf(fptr,"Module: %d\n",unit->type);
-  //      fprintf(fptr,"eff_hours(before):     %f\n",eff_hours);
+  //      fprintf(fptr,"eff_hours(before):     %f\n",eff->hours);
   //      fclose(fptr);
   /*DEBUGGING CODE*/
 
-  switch (unit->type)
-  {
-
-  case LOCATION_1:
-    theo_res_time = unit->data.avg_tap->days * 1440 / peakfactor;
-    mean_theo = 1.0;
-    t_ten_theo = 1.0;
-    break;
-
-  case AVG_TAP:
-    theo_res_time = unit->data.avg_tap->days * 1440 / peakfactor;
-    mean_theo = 1.0;
-    t_ten_theo = 1.0;
-    break;
-
-  case END_OF_SYSTEM:
-    theo_res_time = unit->data.end_of_system->days * 1440 / peakfactor;
-    mean_theo = 1.0;
-    t_ten_theo = 1.0;
-    break;
-
-  default:
-    theo_res_time = 0.0;
-    mean_theo = 1.0;
-    t_ten_theo = 1.0;
-    break;
-  }
+  theo_res_time = point_minutes(unit, peakfactor);
+  mean_theo = 1.0;
+  t_ten_theo = 1.0;
 
   if (theo_res_time > 0.0)
   {
+    dist_start(unit, peakfactor);
+
     //Cl2_decay based on series of CFSTRs
     if (eff->cl2cnt > 0)
     {
-      phchange(unit, TRUE);
-
-      /* Update eff_hours */
-      ncstrs = ncstr(t_ten_theo);
-      rxnhours = mean_theo * theo_res_time / (60.0 * ncstrs);
-      for (i = 1; i <= ncstrs; i++)
+      /* Update eff->hours */
+      if (ctx->dist_trajectory == TRUE)
+      {
+        n = trajectory_cstrs(d, theo_res_time);
+        if (n >= d->n_cl2)
+        { /* Continue from the last point */
+          eff->FreeCl2 = d->FreeCl2_n;
+          eff->NH2Cl = d->NH2Cl_n;
+          eff->hours = d->hours_n;
+          cl2decay_tanks(eff, &d->coef, n - d->n_cl2, d->cfstr_time);
+        }
+        else
+          cl2decay_tanks(eff, &d->coef, n, d->cfstr_time);
+        d->n_cl2 = n;
+        d->FreeCl2_n = eff->FreeCl2;
+        d->NH2Cl_n = eff->NH2Cl;
+        d->hours_n = eff->hours;
+      }
+      else
       {
-        new_cl2decay(unit, rxnhours);
-        if ((eff->FreeCl2 + eff->NH2Cl) > 0.0)
-          eff_hours += rxnhours;
-        /*- Copy outputs to UnitProcess data structure - */
-        eff->hours = eff_hours;
+        ncstrs = ncstr(t_ten_theo);
+        rxnhours = mean_theo * theo_res_time / (60.0 * ncstrs);
+        cl2decay_tanks(eff, &d->coef, (int)ncstrs, rxnhours);
       }
 
       /* Call dbp formation equations: */
       /*DEBUGGING CODE*/
       //      fptr=fopen("debug.dat","a+");
-      //      fprintf(fptr,"eff_hours(after):     %f\n\n",eff_hours);
+      //      fprintf(fptr,"eff_hours(after):     %f\n\n",eff->hours);
       //      fclose(fptr);
       /*DEBUGGING CODE*/
       choose_dbpmodel(unit); /* NEW CODE (WJS, 10/98) */
     }
 
-    // Using clo2_decay() in the framework of CFSTRs in series
+    // Using clo2_cascade() in the framework of CFSTRs in series
     //--------------------------------------------------------------------------------
     if (eff->clo2_cntr > 0)
     {
-      ncstrs = ncstr(t_ten_theo);
-      rxnminutes = mean_theo * theo_res_time / ncstrs; //minutes
-
-      for (i = 1; i <= ncstrs; i++)
+      if (ctx->dist_trajectory == TRUE)
       {
-        clo2_decay(unit, rxnminutes);
-        eff->clo2_minutes += rxnminutes;
+        n = trajectory_cstrs(d, theo_res_time);
+        if (n >= d->n_clo2)
+        { /* Continue from the last point */
+          eff->clo2_res = d->clo2_res_n;
+          eff->clo2_minutes = d->clo2_minutes_n;
+          clo2_cascade(unit, n - d->n_clo2, 60.0 * d->cfstr_time);
+        }
+        else
+          clo2_cascade(unit, n, 60.0 * d->cfstr_time);
+        d->n_clo2 = n;
+        d->clo2_res_n = eff->clo2_res;
+        d->clo2_minutes_n = eff->clo2_minutes;
+      }
+      else
+      {
+        ncstrs = ncstr(t_ten_theo);
+        rxnminutes = mean_theo * theo_res_time / ncstrs; //minutes
+
+        clo2_cascade(unit, (int)ncstrs, rxnminutes);
       }
     }
 
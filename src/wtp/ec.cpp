@@ -8,6 +8,9 @@ void ec_comply(struct UnitProcess *unit)
 *   with enhanced coagulation (Step 1) requirements or SUVA
 *   and or TOC exemptions
 *
+*   Does nothing when WTP_OUT_EC is not needed, see out_need().
+*   The results are memoized per unit on the inputs, see memo_wtp.cpp.
+*
 * Documentation and code by WJS 5/2001
 */
 
@@ -20,6 +23,11 @@ void ec_comply(struct UnitProcess *unit)
 	double toc_rem;
 	double raw_tsuva;
 	struct Effluent *eff; /* Effluent data  */
+	double key[6], out[2];
+	const double *memo;
+
+	if ((unit->eff.ctx->need & WTP_OUT_EC) == 0)
+		return;
 
 	eff = &unit->eff;
 
@@ -28,6 +36,19 @@ void ec_comply(struct UnitProcess *unit)
 	raw_uva = eff->influent->eff.UV;
 	raw_alk = eff->influent->eff.Alk;
 
+	key[0] = eff_toc;
+	key[1] = raw_toc;
+	key[2] = raw_uva;
+	key[3] = raw_alk;
+	key[4] = eff->ec_meeting_step1;
+	key[5] = eff->ec_exempt;
+	if ((memo = memo_find(unit, MEMO_EC_COMPLY, key, 6)) != NULL)
+	{
+		eff->ec_meeting_step1 = (int)memo[0];
+		eff->ec_exempt = (int)memo[1];
+		return;
+	}
+
 	//First determine compliance status with Step 1
 	if (raw_toc > 0.0)
 		toc_rem = (raw_toc - eff_toc) / raw_toc * 100.0;
@@ -87,4 +108,8 @@ void ec_comply(struct UnitProcess *unit)
 	if (eff_toc <= 2.0 || raw_toc <= 2.0 || raw_tsuva <= 2.0)
 		eff->ec_exempt = TRUE;
 
+	out[0] = eff->ec_meeting_step1;
+	out[1] = eff->ec_exempt;
+	memo_store(unit, MEMO_EC_COMPLY, key, 6, out, 2);
+
 } /* End of ec_comply() */
\ No newline at end of file
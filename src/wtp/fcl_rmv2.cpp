@@ -84,14 +84,14 @@ void fecl_rmv(struct UnitProcess *unit)
         fns_doc_inf = 1.0; /* Self-protection */
       doc_non_sorb = fns_doc_inf * inf_toc;
       doc_sorb_inf = inf_toc - doc_non_sorb;
-      a = x3 * pow(pH, 3.0) + x2 * pow(pH, 2.0) + x1 * pH;
-      term1 = pow(((doc_sorb_inf * b) - (b * a * FerricDose) - 1), 2.0) + (4.0 * b * doc_sorb_inf);
+      a = x3 * wtp_pow(pH, 3.0) + x2 * wtp_pow(pH, 2.0) + x1 * pH;
+      term1 = wtp_pow(((doc_sorb_inf * b) - (b * a * FerricDose) - 1), 2.0) + (4.0 * b * doc_sorb_inf);
 
       term2 = 1 + (a * b * FerricDose) - (doc_sorb_inf * b);
 
       /* Calculate both solutions of quadratic equation */
-      doc_sorb_eff1 = (term2 - pow(term1, 0.5)) / (-2.0 * b);
-      doc_sorb_eff2 = (term2 + pow(term1, 0.5)) / (-2.0 * b);
+      doc_sorb_eff1 = (term2 - wtp_pow(term1, 0.5)) / (-2.0 * b);
+      doc_sorb_eff2 = (term2 + wtp_pow(term1, 0.5)) / (-2.0 * b);
 
       /* If one of the answers is negative, choose the other as the solution */
       if (doc_sorb_eff1 >= 0.0)
@@ -123,10 +123,10 @@ void fecl_rmv(struct UnitProcess *unit)
       /*New equation*/
       if (pH < 3.0)
         pH = 3.0; /*self-protection*/
-      term1 = pow(inf_uv, 1.0894);
-      term1_out = pow(inf_uv_out, 1.0894);
-      term2 = pow(FerricDose, 0.305);
-      term3 = pow(pH, -0.9513);
+      term1 = wtp_pow(inf_uv, 1.0894);
+      term1_out = wtp_pow(inf_uv_out, 1.0894);
+      term2 = wtp_pow(FerricDose, 0.305);
+      term3 = wtp_pow(pH, -0.9513);
       delta_uv = 5.7154 * term1 * term2 * term3;
       delta_uv_out = 5.7154 * term1_out * term2 * term3;
       eff->UV -= delta_uv;
@@ -14,7 +14,6 @@ void filt_dbp(struct UnitProcess *unit)
    double theo_res_time, mean_theo, t_ten_theo, t_ten, rxnhours, rxnminutes;
    double ncstrs;         /* Number of constant stired tank reactors */
    double clo2_avg = 0.0; /* Average concentration for ClO2 for CT calcs */
-   int i;
    struct Filter *filt;  /* Design and Operating data for FILTERs */
    struct Ssf *ssf;      /* Design and Operating data for SLOW_FILTERs*/
    struct Def *def;      /* Design and Operating data for DE_FILTERs */
@@ -54,36 +53,26 @@ void filt_dbp(struct UnitProcess *unit)
       phchange(unit, TRUE);
       t_ten = t_ten_theo * theo_res_time;
 
-      // Apply new_cl2decay() in framework of CFSTRs in series
+      // Apply cl2decay_cascade() in framework of CFSTRs in series
       //--------------------------------------------------------------------------------
       if (eff->cl2cnt > 0)
       {
          ncstrs = ncstr(t_ten_theo);
          rxnhours = mean_theo * theo_res_time / (60.0 * ncstrs);
-         for (i = 1; i <= ncstrs; i++)
-         {
-            new_cl2decay(unit, rxnhours);
-            if ((eff->FreeCl2 + eff->NH2Cl) > 0.0)
-               eff->hours += rxnhours;
-         }
+         cl2decay_cascade(unit, (int)ncstrs, rxnhours);
 
          choose_dbpmodel(unit); /* NEW CODE (WJS, 10/98) */
 
       } // end if (eff->cl2cnt > 0)
 
-      // Using clo2_decay() in the framework of CFSTRs in series
+      // Using clo2_cascade() in the framework of CFSTRs in series
       //--------------------------------------------------------------------------------
       if (eff->clo2_cntr > 0)
       {
          ncstrs = ncstr(t_ten_theo);
          rxnminutes = mean_theo * theo_res_time / ncstrs; //minutes
 
-         for (i = 1; i <= ncstrs; i++)
-         {
-            clo2_decay(unit, rxnminutes);
-            clo2_avg += eff->clo2_res;
-            eff->clo2_minutes += rxnminutes;
-         }
+         clo2_avg = clo2_cascade(unit, (int)ncstrs, rxnminutes);
          eff->clo2_avg = clo2_avg / ncstrs;
       }
 
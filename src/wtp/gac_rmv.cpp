@@ -20,6 +20,7 @@ void gac_rmv(struct UnitProcess *unit)
 *   2. Coded and annoted by WJS, 2/99
 */
 {
+  struct WtpContext *ctx = unit->eff.ctx;
   //  FILE *fptr2;
 
   /* Inputs: */
@@ -52,7 +53,7 @@ void gac_rmv(struct UnitProcess *unit)
   /* Get inputs from UnitProcess data structure */
   gac = unit->data.gac;
   eff = &unit->eff;
-  if (coldflag == TRUE)
+  if (ctx->coldflag == TRUE)
     peak_factor = eff->Peak / eff->influent->data.influent->avg_flow;
   ebct = gac->ebct;
   regen = gac->regen;
@@ -65,7 +66,7 @@ void gac_rmv(struct UnitProcess *unit)
 
   /* Adjust EBCT for peak flow scenario based on whether or not it is a single contactor
      or a system of parallel contactors */
-  if (coldflag == TRUE && config == 'S')
+  if (ctx->coldflag == TRUE && config == 'S')
     ebct /= peak_factor;
   else
   {
@@ -75,19 +76,19 @@ void gac_rmv(struct UnitProcess *unit)
 
   /* Compute coefficients */
   coeff_a = 0.682 * inf_toc;
-  coeff_b = 0.167 * pow(inf_pH, 2.0) - 0.808 * inf_pH + 19.086;
-  coeff_d = inf_toc * (inf_pH * (-0.0000058 * pow(ebct, 2.0) + 0.000111 * ebct + 0.00125) + 0.0001444 * pow(ebct, 2.0) - 0.005486 * ebct + 0.06005);
+  coeff_b = 0.167 * wtp_pow(inf_pH, 2.0) - 0.808 * inf_pH + 19.086;
+  coeff_d = inf_toc * (inf_pH * (-0.0000058 * wtp_pow(ebct, 2.0) + 0.000111 * ebct + 0.00125) + 0.0001444 * wtp_pow(ebct, 2.0) - 0.005486 * ebct + 0.06005);
 
   if (config == 'S' && toc_calc == 'M')
   /* Compute Eff. TOC based on breakthrough at end of regen. period
      this is a worst-case (Max. Eff. TOC scenario) */
   {
-    eff_toc = coeff_a / (1 + coeff_b * exp(-coeff_d * regen));
+    eff_toc = coeff_a / (1 + coeff_b * wtp_exp(-coeff_d * regen));
   }
   else
   { /* We have either a blended effluent scenario or a time-averaged
 	  single contactor scenario */
-    eff_toc = coeff_a + coeff_a / coeff_d / regen * log(1.0 + coeff_b * exp(-coeff_d * regen)) - coeff_a / coeff_d / regen * log(1.0 + coeff_b);
+    eff_toc = coeff_a + coeff_a / coeff_d / regen * wtp_log(1.0 + coeff_b * wtp_exp(-coeff_d * regen)) - coeff_a / coeff_d / regen * wtp_log(1.0 + coeff_b);
   }
 
   /* Check for reasonableness - we are not creating TOC here */
@@ -96,7 +97,7 @@ void gac_rmv(struct UnitProcess *unit)
 
   /* Calculate effluent UV based upon what processes preceded GAC
      updated from G. Solarik in May 2001 */
-  if (pre_o3flag == TRUE || int_o3flag == TRUE)
+  if (ctx->pre_o3flag == TRUE || ctx->int_o3flag == TRUE)
   {
     eff_uv = 0.0114 * eff_toc - 0.0014;
     eff_uv_out = 0.0114 * eff_toc - 0.0014;
@@ -23,7 +23,6 @@ void gacmbdbp(struct UnitProcess *unit)
   double DegC;       /* Temperature         (Deg C) */
   double doc;        /* Really, its TOC      (mg/L) */
   double uv;         /* UV254 absorbance     (1/cm) */
-  double doc_uv;     /* product of the above two    */
   double br;         /* Bromide              (ug/L) */
   double cl2dose;    /* Free chlorine (mg/L) as Cl2 */
   double eff_hours;  /* Contact time        (hours) */
@@ -56,7 +55,9 @@ void gacmbdbp(struct UnitProcess *unit)
   double delta_tox = 0.0;
 
   /* Internal: */
-  double factor, term1, term2, term3, term4, term5, term6;
+  double factor;
+  struct DbpTerms dbp;
+  struct WtpContext *ctx = unit->eff.ctx;
   double eff_Br, moles_br_incorporated;
   register struct Effluent *eff;
 
@@ -83,8 +84,6 @@ void gacmbdbp(struct UnitProcess *unit)
   if (doc > 0.0 && doc < 0.1)
     doc = 0.1; /* Min. non-zero doc */
 
-  doc_uv = doc * uv;
-
   /*  Get Cumulative time to influent of UnitProcess.    */
   if (eff->wtp_effluent != NULL)
   {
@@ -117,182 +116,32 @@ void gacmbdbp(struct UnitProcess *unit)
     if (doc <= 2.0)
     { /* Use the GAC-treated water DBP Formation Equations */
 
-      /* Estimate TTHM (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.474);
-      term2 = pow(cl2dose, 0.173);
-      term3 = pow(br, 0.245);
-      term4 = pow(1.036, (DegC - 20));
-      term5 = pow(1.316, (pH - 8.0));
-      term6 = pow(eff_hours, 0.365) - pow(inf_hours, 0.365);
-      delta_tthm = 17.73 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate CHCl3 (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.614);
-      term2 = pow(cl2dose, 0.698);
-      term3 = pow(br, -0.468);
-      term4 = pow(1.035, (DegC - 20));
-      term5 = pow(1.099, (pH - 8.0));
-      term6 = pow(eff_hours, 0.336) - pow(inf_hours, 0.336);
-      delta_chcl3 = 101.0 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate CHBrCl2 (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.430);
-      term2 = pow(cl2dose, 0.555);
-      term3 = pow(br, 0.075);
-      term4 = pow(1.030, (DegC - 20));
-      term5 = pow(1.349, (pH - 8.0));
-      term6 = pow(eff_hours, 0.278) - pow(inf_hours, 0.278);
-      delta_chbrcl2 = 7.37 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate CHBr2Cl (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.525);
-      term2 = pow(cl2dose, 0.125);
-      term3 = pow(br, 0.362);
-      term4 = pow(1.027, (DegC - 20));
-      term5 = pow(1.432, (pH - 8.0));
-      term6 = pow(eff_hours, 0.319) - pow(inf_hours, 0.319);
-      delta_chbr2cl = 3.987 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate CHBr3  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.405);
-      term2 = pow(cl2dose, -0.118);
-      term3 = pow(br, 0.950);
-      term4 = pow(1.048, (DegC - 20));
-      term5 = pow(1.430, (pH - 8.0));
-      term6 = pow(eff_hours, 0.323) - pow(inf_hours, 0.323);
-      delta_chbr3 = 0.158 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate HAAs */
-
-      /* Estimate HAA6  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.502);
-      term2 = pow(cl2dose, 0.371);
-      term3 = pow(br, -0.078);
-      term4 = pow(1.021, (DegC - 20));
-      term5 = pow(0.913, (pH - 8.0));
-      term6 = pow(eff_hours, 0.279) - pow(inf_hours, 0.279);
-      delta_haa6 = 36.9 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate HAA5  (ug/liter) ------------------------ Equation XX  */
-      /*  term1 = pow( doc_uv   , 0.488  );
-      term2 = pow( cl2dose  , 0.385  );
-      term3 = pow( br	    ,-0.155  );
-      term4 = pow( 1.021    , (DegC-20));
-      term5 = pow( 0.867    , (pH-8.0));
-      term6 = pow( eff_hours, 0.262 ) - pow( inf_hours, 0.262 );
-      delta_haa5 = 40.0*term1*term2*term3*term4*term5*term6;    */
-
-      /* Estimate MCAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.043);
-      term2 = pow(cl2dose, 0.126);
-      term3 = pow(br, -0.135);
-      term4 = pow(1.009, (DegC - 20));
-      term5 = pow(0.873, (pH - 8.0));
-      term6 = pow(eff_hours, 0.087) - pow(inf_hours, 0.087);
-      delta_mcaa = 1.75 * term1 * term2 * term3 * term4 * term5 * term6;
+      /* Estimate THMs, HAAs and TOX (ug/liter), see dbp_wtp.cpp */
+      dbp_formation(unit->eff.ctx, DBP_GAC_MODEL, doc, uv, cl2dose, br, DegC, pH, eff_hours, inf_hours, &dbp);
+      delta_tthm = dbp.delta[DBP_TTHM];
+      delta_chcl3 = dbp.delta[DBP_CHCL3];
+      delta_chbrcl2 = dbp.delta[DBP_CHBRCL2];
+      delta_chbr2cl = dbp.delta[DBP_CHBR2CL];
+      delta_chbr3 = dbp.delta[DBP_CHBR3];
+      delta_haa6 = dbp.delta[DBP_HAA6];
+      delta_mcaa = dbp.delta[DBP_MCAA];
       if (delta_mcaa > 8.0)
         delta_mcaa = 8.0; //based on max. value in development database
-
-      /* Estimate MBAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.067);
-      term2 = pow(cl2dose, 0.253);
-      term3 = pow(br, -0.044);
-      term4 = pow(1.017, (DegC - 20));
-      term5 = pow(0.845, (pH - 8.0));
-      term6 = pow(eff_hours, 0.097) - pow(inf_hours, 0.097);
-      delta_mbaa = 0.666 * term1 * term2 * term3 * term4 * term5 * term6;
+      delta_mbaa = dbp.delta[DBP_MBAA];
       if (delta_mbaa > 6.0)
         delta_mbaa = 6.0; //based on max. value in development database
-
-      /* Estimate DCAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.473);
-      term2 = pow(cl2dose, 0.415);
-      term3 = pow(br, -0.380);
-      term4 = pow(1.019, (DegC - 20));
-      term5 = pow(0.870, (pH - 8.0));
-      term6 = pow(eff_hours, 0.288) - pow(inf_hours, 0.288);
-      delta_dcaa = 34.6 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate TCAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.557);
-      term2 = pow(cl2dose, 0.692);
-      term3 = pow(br, -0.394);
-      term4 = pow(1.010, (DegC - 20));
-      term5 = pow(0.619, (pH - 8.0));
-      term6 = pow(eff_hours, 0.167) - pow(inf_hours, 0.167);
-      delta_tcaa = 37.4 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate DBAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.467);
-      term2 = pow(cl2dose, -0.237);
-      term3 = pow(br, 0.640);
-      term4 = pow(1.019, (DegC - 20));
-      term5 = pow(1.286, (pH - 8.0));
-      term6 = pow(eff_hours, 0.295) - pow(inf_hours, 0.295);
-      delta_dbaa = 0.467 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate BCAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.484);
-      term2 = pow(cl2dose, 0.245);
-      term3 = pow(br, 0.110);
-      term4 = pow(1.018, (DegC - 20));
-      term5 = pow(1.064, (pH - 8.0));
-      term6 = pow(eff_hours, 0.313) - pow(inf_hours, 0.313);
-      delta_bcaa = 3.43 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /*  Estimate TBAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.385);
-      term2 = pow(cl2dose, -0.844);
-      term3 = pow(br, 0.532);
-      term4 = pow(1.003, (DegC - 20.0));
-      term5 = pow(0.829, (pH - 8.0));
-      term6 = pow(eff_hours, 0.464) - pow(inf_hours, 0.464);
-      delta_tbaa = 1.83 * pow(10, -1.0) * term1 * term2 * term3 * term4 * term5 * term6;
+      delta_dcaa = dbp.delta[DBP_DCAA];
+      delta_tcaa = dbp.delta[DBP_TCAA];
+      delta_dbaa = dbp.delta[DBP_DBAA];
+      delta_bcaa = dbp.delta[DBP_BCAA];
+      delta_tbaa = dbp.delta[DBP_TBAA];
       if (delta_tbaa > 10.0)
         delta_tbaa = 10.0; //based on max. value in development database
-
-      /*  Estimate DBCAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.316);
-      term2 = pow(cl2dose, -0.081);
-      term3 = pow(br, 0.368);
-      term4 = pow(1.008, (DegC - 20.0));
-      term5 = pow(0.716, (pH - 8.0));
-      term6 = pow(eff_hours, 0.363) - pow(inf_hours, 0.363);
-      delta_dbcaa = 4.35 * pow(10, -1.0) * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /*  Estimate BDCAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.518);
-      term2 = pow(cl2dose, 0.248);
-      term3 = pow(br, 0.190);
-      term4 = pow(0.987, (DegC - 20.0));
-      term5 = pow(0.613, (pH - 8.0));
-      term6 = pow(eff_hours, 0.317) - pow(inf_hours, 0.317);
-      delta_bdcaa = 2.0 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /*  Estimate HAA9  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.509);
-      term2 = pow(cl2dose, 0.253);
-      term3 = pow(br, 0.053);
-      term4 = pow(1.019, (DegC - 20.0));
-      term5 = pow(0.828, (pH - 8.0));
-      term6 = pow(eff_hours, 0.425) - pow(inf_hours, 0.425);
-      delta_haa9 = 20.6 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /*  Estimate HAA6 for HAA9  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.320);
-      term2 = pow(cl2dose, 0.510);
-      term3 = pow(br, -0.106);
-      term4 = pow(1.017, (DegC - 20.0));
-      term5 = pow(0.938, (pH - 8.0));
-      term6 = pow(eff_hours, 0.353) - pow(inf_hours, 0.353);
-      delta_haa6_for_haa9 = 18.6 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /*  Estimate TOX  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.529);
-      term2 = pow(cl2dose, 0.349);
-      term4 = pow(1.009, (DegC - 20.0));
-      term6 = pow(eff_hours, 0.239) - pow(inf_hours, 0.239);
-      delta_tox = 168.0 * term1 * term2 * term4 * term6;
+      delta_dbcaa = dbp.delta[DBP_DBCAA];
+      delta_bdcaa = dbp.delta[DBP_BDCAA];
+      delta_haa9 = dbp.delta[DBP_HAA9];
+      delta_haa6_for_haa9 = dbp.delta[DBP_HAA6_9];
+      delta_tox = dbp.delta[DBP_TOX];
 
       /* No correction based on ICR data for the GAC-treated water equations*/
 
@@ -301,197 +150,28 @@ void gacmbdbp(struct UnitProcess *unit)
     { /* doc > 2.0 --> Use coagulated water DBP-formation equations with
                          ICR correction factors*/
 
-      /* Estimate TTHM (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.403);
-      term2 = pow(cl2dose, 0.225);
-      term3 = pow(br, 0.141);
-      term4 = pow(1.026, (DegC - 20));
-      term5 = pow(1.156, (pH - 7.5));
-      term6 = pow(eff_hours, 0.264) - pow(inf_hours, 0.264);
-      delta_tthm = 23.9 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate CHCl3 (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.483);
-      term2 = pow(cl2dose, 0.424);
-      term3 = pow(br, -0.679);
-      term4 = pow(1.018, (DegC - 20));
-      term5 = pow(1.132, (pH - 7.5));
-      term6 = pow(eff_hours, 0.333) - pow(inf_hours, 0.333);
-      delta_chcl3 = 266.0 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate CHBrCl2 (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.260);
-      term2 = pow(cl2dose, 0.114);
-      term3 = pow(br, 0.462);
-      term4 = pow(1.026, (DegC - 20));
-      term5 = pow(1.098, (pH - 7.5));
-      term6 = pow(eff_hours, 0.196) - pow(inf_hours, 0.196);
-      delta_chbrcl2 = 1.68 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate CHBr2Cl (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, -0.056);
-      term2 = pow(cl2dose, -0.157);
-      term3 = pow(br, 1.425);
-      term4 = pow(1.021, (DegC - 20));
-      term5 = pow(1.127, (pH - 7.5));
-      term6 = pow(eff_hours, 0.148) - pow(inf_hours, 0.148);
-      delta_chbr2cl = 0.0080 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate CHBr3  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, -0.300);
-      term2 = pow(cl2dose, -0.221);
-      term3 = pow(br, 2.134);
-      term4 = pow(1.037, (DegC - 20));
-      term5 = pow(1.391, (pH - 7.5));
-      term6 = pow(eff_hours, 0.143) - pow(inf_hours, 0.143);
-      delta_chbr3 = 4.4 * pow(10, -5.0) * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate HAAs */
-
-      /* Estimate HAA5  (ug/liter) ------------------------ Equation XX */
-      /*    term1 = pow( doc_uv   , 0.302 );
-      term2 = pow( cl2dose  , 0.541 );
-      term3 = pow( br	    ,-0.012 );
-      term4 = pow( 1.022    , (DegC-20));
-      term5 = pow( 0.922    , (pH-7.5));
-      term6 = pow( eff_hours, 0.161 ) - pow( inf_hours, 0.161 );
-      delta_haa6 = 30.7*term1*term2*term3*term4*term5*term6;  */
-
-      /* WJR COMMENT OUT BEGIN 
-     * Estimate HAA6  (ug/liter) ------------------------ Equation XX 
-      term1 = pow( doc_uv   , 0.328  );
-      term2 = pow( cl2dose  , 0.585  );
-      term3 = pow( br	    ,-0.121  );
-      term4 = pow( 1.021    , (DegC-20));
-      term5 = pow( 0.932    , (pH-7.5));
-      term6 = pow( eff_hours, 0.150 ) - pow( inf_hours, 0.150 );
-      delta_haa5 = 41.6*term1*term2*term3*term4*term5*term6;  
-       * WJR COMMENT OUT END, 4/10 */
-
-      // BEGIN WJR ADD 4/10
-      /* Estimate HAA6  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.328);
-      term2 = pow(cl2dose, 0.585);
-      term3 = pow(br, -0.121);
-      term4 = pow(1.022, (DegC - 20));
-      term5 = pow(0.922, (pH - 7.5));
-      term6 = pow(eff_hours, 0.150) - pow(inf_hours, 0.150);
-      delta_haa6 = 30.7 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      // END WJR ADD 4/10
-
-      /* Estimate MCAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, -0.090);
-      term2 = pow(cl2dose, 0.662);
-      term3 = pow(br, -0.224);
-      term4 = pow(1.024, (DegC - 20));
-      term5 = pow(1.042, (pH - 7.5));
-      if (inf_hours > 0.0)
-        term6 = pow(eff_hours, -0.043) - pow(inf_hours, -0.043);
-      else
-        term6 = pow(eff_hours, -0.043);
-      delta_mcaa = 4.58 * term1 * term2 * term3 * term4 * term5 * term6;
+      /* Estimate THMs, HAAs and TOX (ug/liter), see dbp_wtp.cpp */
+      dbp_formation(unit->eff.ctx, DBP_COAG_MODEL, doc, uv, cl2dose, br, DegC, pH, eff_hours, inf_hours, &dbp);
+      delta_tthm = dbp.delta[DBP_TTHM];
+      delta_chcl3 = dbp.delta[DBP_CHCL3];
+      delta_chbrcl2 = dbp.delta[DBP_CHBRCL2];
+      delta_chbr2cl = dbp.delta[DBP_CHBR2CL];
+      delta_chbr3 = dbp.delta[DBP_CHBR3];
+      delta_haa6 = dbp.delta[DBP_HAA6];
+      delta_mcaa = dbp.delta[DBP_MCAA];
       if (delta_mcaa > 33.0)
         delta_mcaa = 33.0; //based on model development database inputs and eqn.
-
-      /* Estimate MBAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.358);
-      term2 = pow(cl2dose, -0.101);
-      term3 = pow(br, 0.812);
-      term4 = pow(1.162, (DegC - 20));
-      term5 = pow(0.653, (pH - 7.5));
-      term6 = pow(eff_hours, 0.088) - pow(inf_hours, 0.088);
-      delta_mbaa = 0.0206 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate DCAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.397);
-      term2 = pow(cl2dose, 0.665);
-      term3 = pow(br, -0.558);
-      term4 = pow(1.017, (DegC - 20));
-      term5 = pow(1.034, (pH - 7.5));
-      term6 = pow(eff_hours, 0.222) - pow(inf_hours, 0.222);
-      delta_dcaa = 60.4 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate TCAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.403);
-      term2 = pow(cl2dose, 0.749);
-      term3 = pow(br, -0.416);
-      term4 = pow(1.014, (DegC - 20));
-      term5 = pow(0.874, (pH - 7.5));
-      term6 = pow(eff_hours, 0.163) - pow(inf_hours, 0.163);
-      delta_tcaa = 52.6 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate DBAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.059);
-      term2 = pow(cl2dose, 0.182);
-      term3 = pow(br, 2.109);
-      term4 = pow(1.007, (DegC - 20));
-      term5 = pow(1.21, (pH - 7.5));
-      term6 = pow(eff_hours, 0.070) - pow(inf_hours, 0.070);
-      delta_dbaa = 9.42 * pow(10, -5.0) * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /* Estimate BCAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.153);
-      term2 = pow(cl2dose, 0.257);
-      term3 = pow(br, 0.586);
-      term4 = pow(1.042, (DegC - 20));
-      term5 = pow(1.181, (pH - 7.5));
-      term6 = pow(eff_hours, 0.201) - pow(inf_hours, 0.201);
-      delta_bcaa = 0.323 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      //  The following are coag.-water HAA9 species and TOX models developed by MPI in 4/2001
-
-      /*  Estimate TBAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.0657);
-      term2 = pow(cl2dose, -2.51);
-      term3 = pow(br, 2.32);
-      term4 = pow(1.059, (DegC - 20.0));
-      term5 = pow(0.555, (pH - 8.0));
-      term6 = pow(eff_hours, 1.26) - pow(inf_hours, 1.26);
-      delta_tbaa = 5.59 * pow(10, -6.0) * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /*  Estimate DBCAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, -0.0162);
-      term2 = pow(cl2dose, -0.170);
-      term3 = pow(br, 0.972);
-      term4 = pow(1.054, (DegC - 20.0));
-      term5 = pow(0.839, (pH - 8.0));
-      term6 = pow(eff_hours, 0.685) - pow(inf_hours, 0.685);
-      delta_dbcaa = 3.7 * pow(10, -3.0) * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /*  Estimate BDCAA  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.230);
-      term2 = pow(cl2dose, 0.140);
-      term3 = pow(br, 0.301);
-      term4 = pow(1.022, (DegC - 20.0));
-      term5 = pow(0.700, (pH - 8.0));
-      term6 = pow(eff_hours, 0.422) - pow(inf_hours, 0.422);
-      delta_bdcaa = 0.589 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /*  Estimate HAA9  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.250);
-      term2 = pow(cl2dose, 0.500);
-      term3 = pow(br, 0.054);
-      term4 = pow(1.015, (DegC - 20.0));
-      term5 = pow(0.894, (pH - 8.0));
-      term6 = pow(eff_hours, 0.348) - pow(inf_hours, 0.348);
-      delta_haa9 = 10.783 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /*  Estimate HAA6 for HAA9  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.320);
-      term2 = pow(cl2dose, 0.510);
-      term3 = pow(br, -0.106);
-      term4 = pow(1.017, (DegC - 20.0));
-      term5 = pow(0.938, (pH - 8.0));
-      term6 = pow(eff_hours, 0.353) - pow(inf_hours, 0.353);
-      delta_haa6_for_haa9 = 18.6 * term1 * term2 * term3 * term4 * term5 * term6;
-
-      /*  Estimate TOX  (ug/liter) ------------------------ Equation XX */
-      term1 = pow(doc_uv, 0.362);
-      term2 = pow(cl2dose, 0.129);
-      term4 = pow(DegC, 0.211);
-      term6 = pow(eff_hours, 0.182) - pow(inf_hours, 0.182);
-      delta_tox = 109.0 * term1 * term2 * term4 * term6;
+      delta_mbaa = dbp.delta[DBP_MBAA];
+      delta_dcaa = dbp.delta[DBP_DCAA];
+      delta_tcaa = dbp.delta[DBP_TCAA];
+      delta_dbaa = dbp.delta[DBP_DBAA];
+      delta_bcaa = dbp.delta[DBP_BCAA];
+      delta_tbaa = dbp.delta[DBP_TBAA];
+      delta_dbcaa = dbp.delta[DBP_DBCAA];
+      delta_bdcaa = dbp.delta[DBP_BDCAA];
+      delta_haa9 = dbp.delta[DBP_HAA9];
+      delta_haa6_for_haa9 = dbp.delta[DBP_HAA6_9];
+      delta_tox = dbp.delta[DBP_TOX];
 
       /********CORRECTION FACTORS BASED ON ICR DATA CALIBRATION WORK (WJS, 5/2001)********/
 
@@ -566,7 +246,12 @@ void gacmbdbp(struct UnitProcess *unit)
       delta_mcaa = -eff->MCAA;
 
     /* Proportion the species based on the bulk TTHM */
-    if (delta_chcl3 > 0.0 || delta_chbrcl2 > 0.0 || delta_chbr2cl > 0.0 || delta_chbr3 > 0.0)
+    if ((ctx->need & WTP_OUT_THM_SPECIES) == 0)
+    { /* Species not evaluated, see dbp_forms() */
+      if (dbp_forms(&dbp, DBP_CHCL3, DBP_CHBR3) == FALSE)
+        delta_tthm = 0.0;
+    }
+    else if (delta_chcl3 > 0.0 || delta_chbrcl2 > 0.0 || delta_chbr2cl > 0.0 || delta_chbr3 > 0.0)
     {
       factor = delta_tthm / (delta_chcl3 + delta_chbrcl2 +
                              delta_chbr2cl + delta_chbr3);
@@ -597,29 +282,32 @@ void gacmbdbp(struct UnitProcess *unit)
     /* Calc. HAA5 based on HAA6 equation, minus proportioned BCAA */
     delta_haa5 = delta_haa6 - delta_bcaa;
 
-    /* Proportion the HAA9 species based on HAA9-HAA6 */
-    if (delta_haa9 > delta_haa6_for_haa9)
+    if ((ctx->need & WTP_OUT_HAA9) != 0)
     {
-      delta_haa9_haa6 = delta_haa9 - delta_haa6_for_haa9;
-    }
-    else
-    {
-      delta_haa9_haa6 = 0.0;
-      delta_dbcaa = 0.0;
-      delta_bdcaa = 0.0;
-      delta_tbaa = 0.0;
-    }
+      /* Proportion the HAA9 species based on HAA9-HAA6 */
+      if (delta_haa9 > delta_haa6_for_haa9)
+      {
+        delta_haa9_haa6 = delta_haa9 - delta_haa6_for_haa9;
+      }
+      else
+      {
+        delta_haa9_haa6 = 0.0;
+        delta_dbcaa = 0.0;
+        delta_bdcaa = 0.0;
+        delta_tbaa = 0.0;
+      }
 
-    if (delta_dbcaa > 0.0 || delta_bdcaa > 0.0 || delta_tbaa > 0.0)
-    {
-      factor = delta_haa9_haa6 / (delta_dbcaa + delta_bdcaa + delta_tbaa);
-      delta_dbcaa *= factor;
-      delta_bdcaa *= factor;
-      delta_tbaa *= factor;
-    }
+      if (delta_dbcaa > 0.0 || delta_bdcaa > 0.0 || delta_tbaa > 0.0)
+      {
+        factor = delta_haa9_haa6 / (delta_dbcaa + delta_bdcaa + delta_tbaa);
+        delta_dbcaa *= factor;
+        delta_bdcaa *= factor;
+        delta_tbaa *= factor;
+      }
 
-    /* Calc. HAA9 based on HAA5, plus species */
-    delta_haa9 = delta_haa6 + delta_tbaa + delta_dbcaa + delta_bdcaa;
+      /* Calc. HAA9 based on HAA5, plus species */
+      delta_haa9 = delta_haa6 + delta_tbaa + delta_dbcaa + delta_bdcaa;
+    }
 
     /* Add incremental outputs in UnitProcess data structure. */
     /* THMs */
@@ -647,25 +335,28 @@ void gacmbdbp(struct UnitProcess *unit)
     eff->tox += delta_tox;
 
     /*Stoichiometric Bromide incorporation (non-THM or HAA TOX not considered)*/
-    moles_br_incorporated =
-        (delta_chbrcl2 / 1000.0) / MW_BDCM * 1.0 +
-        (delta_chbr2cl / 1000.0) / MW_DBCM * 2.0 +
-        (delta_chbr3 / 1000.0) / MW_CHBR3 * 3.0 +
-        (delta_mbaa / 1000.0) / MW_MBAA * 1.0 +
-        (delta_bcaa / 1000.0) / MW_BCAA * 1.0 +
-        (delta_dbaa / 1000.0) / MW_DBAA * 2.0 +
-        (delta_bdcaa / 1000.0) / MW_BDCAA * 1.0 +
-        (delta_dbcaa / 1000.0) / MW_DBCAA * 2.0 +
-        (delta_tbaa / 1000.0) / MW_TBAA * 3.0;
-
-    eff_Br = eff->Br - moles_br_incorporated;
-
-    if (eff_Br > eff->Br)
-      eff_Br = eff->Br; /* No increasing Br allowed */
-    if (eff_Br < 0.0)
-      eff_Br = 0.0; /* No negative Br allowed   */
-
-    eff->Br = eff_Br; /*Update UnitProcess data structure */
+    if ((ctx->need & WTP_OUT_BROMIDE) != 0)
+    { /* Not read downstream unless asked for, see out_need() */
+      moles_br_incorporated =
+          (delta_chbrcl2 / 1000.0) / MW_BDCM * 1.0 +
+          (delta_chbr2cl / 1000.0) / MW_DBCM * 2.0 +
+          (delta_chbr3 / 1000.0) / MW_CHBR3 * 3.0 +
+          (delta_mbaa / 1000.0) / MW_MBAA * 1.0 +
+          (delta_bcaa / 1000.0) / MW_BCAA * 1.0 +
+          (delta_dbaa / 1000.0) / MW_DBAA * 2.0 +
+          (delta_bdcaa / 1000.0) / MW_BDCAA * 1.0 +
+          (delta_dbcaa / 1000.0) / MW_DBCAA * 2.0 +
+          (delta_tbaa / 1000.0) / MW_TBAA * 3.0;
+
+      eff_Br = eff->Br - moles_br_incorporated;
+
+      if (eff_Br > eff->Br)
+        eff_Br = eff->Br; /* No increasing Br allowed */
+      if (eff_Br < 0.0)
+        eff_Br = 0.0; /* No negative Br allowed   */
+
+      eff->Br = eff_Br; /*Update UnitProcess data structure */
+    }
 
     /***********************End of Bromide Incorporation**********************/
 
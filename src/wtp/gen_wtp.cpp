@@ -0,0 +1,530 @@
+/* Gen_wtp.c -- Generate a specialized runmodel() for one process train
+*
+*  gen_wtp() writes a C++ translation unit with a function that runs one
+*  particular process train, unit by unit, in straight-line code.  The
+*  parts of runmodel() that depend only on the order of the unit processes
+*  are resolved here, once, instead of on every call:
+*    - the model function of each unit (no switch on unit->type),
+*    - the rapid mix, GAC, ozone, and nanofilter counters and the type of
+*      the following unit, so the DBP model transitions that follow from the
+*      layout of the train are written out as plain assignments,
+*    - the units that are always elided (UV disinfection, bank filtration).
+*  What depends on the water quality or on the doses (chlorine count,
+*  coagulant type, biofilter residual, dose signs) is still tested at run
+*  time, exactly as in runmodel().  The unit data packets are still read
+*  through unit->data because auto_dose() and wtp() change the doses and
+*  the influent between runs.
+*
+*  The generated function compiles the plan of the train as runmodel()
+*  does, and hands the train back to run_plan() if its unit types do not
+*  match the train it was generated from.  Install it as train->evaluator
+*  so that runmodel() calls it.
+*
+*  The following functions are in this file:
+*    gen_wtp()
+*/
+#include "wtp.h"
+#include <stdarg.h>
+
+/* Layout counters of runmodel(), known at generation time */
+struct GenState
+{
+  int rm_cntr;
+  int gac_cntr;
+  int o3_cntr;
+  int nf_cntr;
+  int o3_chamber_cntr;
+};
+
+static void put(FILE *fout, int tab, const char *fmt, ...)
+/*
+*  Purpose: Write one line of generated code indented by 'tab' levels.
+*/
+{
+  va_list args;
+
+  fprintf(fout, "%*s", 2 * tab, "");
+  va_start(args, fmt);
+  vfprintf(fout, fmt, args);
+  va_end(args);
+  fputc('\n', fout);
+}
+
+static const char *type_name(short type)
+{
+  return (type > VACANT && type <= END_OF_SYSTEM ? UnitProcessTable[type].name : "None");
+}
+
+static int is_chemical(short type)
+/*
+*  Purpose: TRUE for the chemical additions that runmodel() elides when the
+*           dose is zero, see plan_elide().
+*/
+{
+  switch (type)
+  {
+  case ALUM:
+  case IRON:
+  case LIME:
+  case CHLORINE_DIOXIDE:
+  case SULFURIC_ACID:
+  case SODIUM_HYDROXIDE:
+  case SODA_ASH:
+  case AMMONIA:
+  case AMMONIUM_SULFATE:
+  case PERMANGANATE:
+  case CARBON_DIOXIDE:
+  case SULFUR_DIOXIDE:
+    return (TRUE);
+  default:
+    return (FALSE);
+  }
+}
+
+static const char *chemical_function(short type)
+{
+  switch (type)
+  {
+  case ALUM:
+    return ("alumadd");
+  case IRON:
+    return ("fecladd");
+  case SULFURIC_ACID:
+    return ("h2so4add");
+  case LIME:
+    return ("limeadd");
+  case SODA_ASH:
+    return ("soda_add");
+  case AMMONIA:
+  case AMMONIUM_SULFATE:
+    return ("nh3add");
+  case PERMANGANATE:
+    return ("kmno4add");
+  case CARBON_DIOXIDE:
+    return ("co2_add");
+  case SODIUM_HYDROXIDE:
+    return ("naohadd");
+  case SULFUR_DIOXIDE:
+    return ("so2_add");
+  case CHLORINE_DIOXIDE:
+    return ("clo2add");
+  default:
+    return (NULL);
+  }
+}
+
+static void gen_clear_dbp(FILE *fout, int tab, int coagdbp)
+{
+  put(fout, tab, "ctx->coagdbpflag = %s;", coagdbp == TRUE ? "TRUE" : "FALSE");
+  put(fout, tab, "ctx->modrw1dbpflag = FALSE;");
+  put(fout, tab, "ctx->modrw2dbpflag = FALSE;");
+}
+
+static void gen_rapid_mix(FILE *fout, int tab, int i, short next, struct GenState *s)
+/*
+*  Purpose: Rapid mix, see run_rapid_mix() in runmodel.cpp.
+*/
+{
+  int next_cl2 = (next == CHLORINE || next == HYPOCHLORITE);
+
+  s->rm_cntr += 1;
+
+  if (i > 0)
+    put(fout, tab, "unit->eff.last_rm_inf = u[%d];", i - 1);
+  else
+    put(fout, tab, "unit->eff.last_rm_inf = NULL;");
+  if (s->rm_cntr == 1)
+    put(fout, tab, "unit->eff.EquivAlumDose = unit->eff.AlumDose + unit->eff.FericDose / 270.0 * 297.0;");
+
+  put(fout, tab, "if (unit->eff.cl2cnt > 0)");
+  put(fout, tab + 1, "ctx->modrw2dbptime = unit->data.basin->sb_mean * unit->data.basin->volume / (unit->eff.Flow / 24.0);");
+  put(fout, tab, "else");
+  put(fout, tab + 1, "ctx->modrw2dbptime = 0.0;");
+  put(fout, tab, "ctx->rwdbpflag = FALSE;");
+  put(fout, tab, "ctx->owdbpflag = FALSE;");
+
+  if (next_cl2)
+  {
+    put(fout, tab, "ctx->modrw2dbpflag = TRUE;");
+    put(fout, tab, "modrw2cl2_cntr = 0;");
+  }
+  else
+  {
+    put(fout, tab, "if (unit->eff.cl2cnt > 0)");
+    put(fout, tab + 1, "ctx->modrw1dbpflag = TRUE;");
+    if (s->rm_cntr == 1)
+    {
+      put(fout, tab, "if (unit->eff.cl2cnt == 0)");
+      put(fout, tab + 1, "ctx->coagdbpflag = TRUE;");
+    }
+  }
+
+  if (s->rm_cntr > 1 || s->o3_cntr > 0)
+    gen_clear_dbp(fout, tab, TRUE);
+  else
+  {
+    put(fout, tab, "if (ctx->bio_filtflag == TRUE)");
+    put(fout, tab, "{");
+    gen_clear_dbp(fout, tab + 1, TRUE);
+    put(fout, tab, "}");
+  }
+  if (s->gac_cntr > 0 || s->nf_cntr > 0)
+    gen_clear_dbp(fout, tab, FALSE);
+
+  put(fout, tab, "if (unit->eff.limesoftening == TRUE)");
+  put(fout, tab + 1, "soft_rmv(unit);");
+  put(fout, tab, "else if (unit->eff.AlumDose > 0.0)");
+  put(fout, tab + 1, "alum_rmv(unit);");
+  put(fout, tab, "else if (unit->eff.FericDose > 0.0)");
+  put(fout, tab + 1, "fecl_rmv(unit);");
+  put(fout, tab, "basn_dbp(unit);");
+
+  if (next_cl2)
+    put(fout, tab, "ctx->modrw2dbpcl2 = u[%d]->data.chemical->%s + (unit->eff.FreeCl2 + unit->eff.NH2Cl) * MW_Cl2;",
+        i + 1, next == CHLORINE ? "chlor" : "naocl");
+
+  /* rwdbpflag was cleared above */
+  if (next_cl2)
+    put(fout, tab, "if (unit->eff.pre_chlor_flag == FALSE)");
+  else
+    put(fout, tab, "if (unit->eff.pre_chlor_flag == FALSE && unit->eff.pre_chlor_dose_track > 0)");
+  put(fout, tab, "{");
+  put(fout, tab + 1, "unit->eff.pre_chlor_flag = TRUE;");
+  put(fout, tab + 1, "unit->eff.pre_chlor_dose_ratio = unit->eff.pre_chlor_dose_track;");
+  if (next_cl2)
+    put(fout, tab + 1, "unit->eff.pre_chlor_dose_ratio += u[%d]->data.chemical->%s;",
+        i + 1, next == CHLORINE ? "chlor" : "naocl");
+  put(fout, tab + 1, "if (unit->data.influent->toc > 0.0)");
+  put(fout, tab + 2, "unit->eff.pre_chlor_dose_ratio /= unit->data.influent->toc;");
+  put(fout, tab + 1, "else");
+  put(fout, tab + 2, "unit->eff.pre_chlor_dose_ratio = 999.0;");
+  put(fout, tab, "}");
+}
+
+static void gen_gac_mem(FILE *fout, int tab)
+{
+  put(fout, tab, "ctx->gacmemdbpflag = TRUE;");
+  put(fout, tab, "ctx->rwdbpflag = FALSE;");
+  put(fout, tab, "ctx->owdbpflag = FALSE;");
+  gen_clear_dbp(fout, tab, FALSE);
+}
+
+static void gen_biofilter(FILE *fout, int tab, const char *test)
+{
+  put(fout, tab, "if (%s)", test);
+  put(fout, tab, "{");
+  put(fout, tab + 1, "ctx->bio_filtflag = TRUE;");
+  put(fout, tab + 1, "biofilt_rmv(unit);");
+  put(fout, tab, "}");
+  put(fout, tab, "else");
+  put(fout, tab + 1, "filt_dbp(unit);");
+}
+
+static void gen_chlorine(FILE *fout, int tab, struct GenState *s)
+/*
+*  Purpose: Chlorine and hypochlorite, see run_chlorine() in runmodel.cpp.
+*/
+{
+  put(fout, tab, "if (unit->eff.pre_re_chlor_flag == 1)");
+  put(fout, tab + 1, "unit->eff.pre_re_chlor_flag = 2;");
+  put(fout, tab, "if (ctx->coagdbpflag == TRUE && unit->eff.pre_chlor_flag == TRUE &&");
+  put(fout, tab, "    unit->eff.pre_chlor_dose_ratio >= 0.2 && unit->eff.pre_re_chlor_flag == 0)");
+  put(fout, tab, "  save_pre_chlor(unit);");
+  if (s->rm_cntr > 0)
+  { /* The modrw flags are only set at a rapid mix */
+    put(fout, tab, "if (ctx->modrw1dbpflag == TRUE)");
+    put(fout, tab, "{");
+    put(fout, tab + 1, "ctx->modrw1dbpflag = FALSE;");
+    put(fout, tab + 1, "ctx->coagdbpflag = TRUE;");
+    put(fout, tab + 1, "if (unit->eff.pre_chlor_dose_ratio >= 0.2)");
+    put(fout, tab + 2, "save_pre_chlor(unit);");
+    put(fout, tab, "}");
+    put(fout, tab, "if (ctx->modrw2dbpflag == TRUE && ++modrw2cl2_cntr > 1)");
+    put(fout, tab, "{");
+    put(fout, tab + 1, "ctx->modrw2dbpflag = FALSE;");
+    put(fout, tab + 1, "ctx->coagdbpflag = TRUE;");
+    put(fout, tab + 1, "if (unit->eff.pre_chlor_dose_ratio >= 0.2)");
+    put(fout, tab + 2, "save_pre_chlor(unit);");
+    put(fout, tab, "}");
+  }
+  put(fout, tab, "chloradd(unit);");
+  if (s->rm_cntr > 0)
+  {
+    put(fout, tab, "if (unit->eff.cl2cnt > 1 && cl2uvox == FALSE)");
+    put(fout, tab, "{");
+    put(fout, tab + 1, "unit->eff.UV *= 0.7;");
+    put(fout, tab + 1, "cl2uvox = TRUE;");
+    put(fout, tab, "}");
+  }
+  put(fout, tab, "if (unit->eff.cl2cnt == 1)");
+  put(fout, tab + 1, "unit->eff.UV_out *= 0.7;");
+}
+
+static int gen_unit(FILE *fout, int tab, int i, short type, short next, struct GenState *s)
+/*
+*  Purpose: Write the model calls of one unit process.
+*
+*  Return:
+*    FALSE if the type is unknown to runmodel().
+*/
+{
+  switch (type)
+  {
+  case INFLUENT:
+    put(fout, tab, "influent(unit);");
+    break;
+
+  case RAPID_MIX:
+    gen_rapid_mix(fout, tab, i, next, s);
+    break;
+
+  case GAC:
+  case NF_UP:
+    if (type == GAC)
+      s->gac_cntr += 1;
+    else
+      s->nf_cntr += 1;
+    gen_gac_mem(fout, tab);
+    if (type == GAC)
+    {
+      put(fout, tab, "unit->eff.o3_res = 0.0;");
+      put(fout, tab, "gac_rmv(unit);");
+    }
+    else
+      put(fout, tab, "nf_rmv(unit);");
+    break;
+
+  case OZONE:
+    s->o3_cntr += 1;
+    put(fout, tab, "o3add(unit);");
+    put(fout, tab, "ctx->rwdbpflag = FALSE;");
+    if (s->rm_cntr == 0 && s->nf_cntr == 0 && s->gac_cntr == 0)
+    {
+      put(fout, tab, "if (ctx->bio_filtflag == FALSE)");
+      put(fout, tab + 1, "ctx->owdbpflag = TRUE;");
+    }
+    put(fout, tab, "if (ctx->modrw1dbpflag == TRUE || ctx->modrw2dbpflag == TRUE)");
+    put(fout, tab, "{");
+    gen_clear_dbp(fout, tab + 1, TRUE);
+    put(fout, tab, "}");
+    break;
+
+  case FILTER:
+    if (s->gac_cntr == 0 && s->nf_cntr == 0 && s->rm_cntr > 0)
+      put(fout, tab, "ctx->coagdbpflag = TRUE;");
+    if (s->o3_cntr > 0)
+      gen_biofilter(fout, tab, "(unit->eff.FreeCl2 * MW_Cl2 + unit->eff.NH2Cl * MW_Cl2) < 0.1 && "
+                               "unit->data.filter->cl2_bkwsh == FALSE");
+    else
+      put(fout, tab, "filt_dbp(unit);");
+    put(fout, tab, "solids_rmv(unit);");
+    break;
+
+  case SLOW_FILTER:
+    if (s->gac_cntr == 0 && s->nf_cntr == 0)
+      put(fout, tab, "ctx->coagdbpflag = TRUE;");
+    gen_biofilter(fout, tab, "(unit->eff.FreeCl2 * MW_Cl2 + unit->eff.NH2Cl * MW_Cl2) < 0.1 && "
+                             "unit->eff.o3_res < 0.1");
+    put(fout, tab, "solids_rmv(unit);");
+    break;
+
+  case MFUF_UP:
+  case DE_FILTER:
+  case BAG_FILTER:
+  case CART_FILTER:
+    if (s->gac_cntr == 0 && s->nf_cntr == 0 && s->rm_cntr > 0)
+      put(fout, tab, "ctx->coagdbpflag = TRUE;");
+    if (type == DE_FILTER)
+      put(fout, tab, "filt_dbp(unit);");
+    if (type == MFUF_UP)
+      put(fout, tab, "mfuf_rmv(unit);");
+    put(fout, tab, "solids_rmv(unit);");
+    break;
+
+  case BASIN:
+  case SLOW_MIX:
+  case SETTLING_BASIN:
+  case CONTACT_TANK:
+  case CLEARWELL:
+  case PRESED_BASIN:
+    put(fout, tab, "basn_dbp(unit);");
+    if (type == SETTLING_BASIN || type == PRESED_BASIN)
+      put(fout, tab, "solids_rmv(unit);");
+    break;
+
+  case O3_CONTACTOR:
+    s->o3_chamber_cntr += 1;
+    if (s->o3_chamber_cntr == 1)
+      put(fout, tab, "unit->eff.first_o3_chamber = TRUE;");
+    put(fout, tab, "if (unit->eff.last_o3_inf != NULL)");
+    put(fout, tab + 1, "ozonate(unit);");
+    put(fout, tab, "basn_dbp(unit);");
+    put(fout, tab, "unit->eff.first_o3_chamber = FALSE;");
+    break;
+
+  case CHLORINE:
+  case HYPOCHLORITE:
+    gen_chlorine(fout, tab, s);
+    break;
+
+  case WTP_EFFLUENT:
+    put(fout, tab, "unit->eff.o3_res = 0.0;");
+    put(fout, tab, "unit->eff.wtp_effluent = unit;");
+    put(fout, tab, "ec_comply(unit);");
+    break;
+
+  case AVG_TAP:
+  case LOCATION_1:
+  case END_OF_SYSTEM:
+    put(fout, tab, "dist_dbp(unit);");
+    break;
+
+  default:
+    if (is_chemical(type) == FALSE)
+      return (FALSE);
+    put(fout, tab, "%s(unit);", chemical_function(type));
+    break;
+  }
+
+  return (TRUE);
+}
+
+int gen_wtp(FILE *fout, struct ProcessTrain *train, const char *name, FILE *ferr)
+/*
+*  Purpose: Write a specialized runmodel() for 'train' to 'fout'.
+*
+*  Inputs:
+*    fout  = Output file for the C++ translation unit.
+*    train = Process train, normally read with open_wtp().
+*    name  = Name of the generated function.  It has the signature of
+*            runmodel() and can be assigned to train->evaluator.
+*    ferr  = stderr or file to report errors to.
+*
+*  Return:
+*    TRUE/FALSE for success/fail.  Fails if the train contains a unit type
+*    that runmodel() does not know.
+*/
+{
+  struct GenState s = {0, 0, 0, 0, 0};
+  struct UnitProcess *unit;
+  short type, next;
+  int i, n = 0, has_cl2 = FALSE, has_rm = FALSE;
+
+  if (fout == NULL || train == NULL || name == NULL)
+    return (FALSE);
+
+  for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit), n++)
+  {
+    if (unit->type == CHLORINE || unit->type == HYPOCHLORITE)
+      has_cl2 = TRUE;
+    if (unit->type == RAPID_MIX)
+      has_rm = TRUE;
+  }
+  if (n == 0)
+  {
+    if (ferr != NULL)
+      fprintf(ferr, "gen_wtp: %s has no unit processes\n", train->file_name);
+    return (FALSE);
+  }
+
+  fprintf(fout, "/* %s.cpp -- Generated by gen_wtp from %s.  Do not edit.\n", name, train->file_name);
+  fprintf(fout, "*\n");
+  fprintf(fout, "*  runmodel() specialized for this process train:\n");
+  for (unit = FirstUnitProcess(train), i = 0; unit; unit = NextUnitProcess(unit), i++)
+    fprintf(fout, "*   %2d %s\n", i, type_name(unit->type));
+  fprintf(fout, "*/\n");
+  fprintf(fout, "#include \"wtp.h\"\n\n");
+
+  fprintf(fout, "static const short unit_types[%d] = {", n);
+  for (unit = FirstUnitProcess(train), i = 0; unit; unit = NextUnitProcess(unit), i++)
+    fprintf(fout, "%s%d", i > 0 ? ", " : "", unit->type);
+  fprintf(fout, "};\n\n");
+
+  if (has_cl2 == TRUE)
+  {
+    fprintf(fout, "static void save_pre_chlor(struct UnitProcess *unit)\n");
+    fprintf(fout, "{\n");
+    put(fout, 1, "unit->eff.pre_re_chlor_flag = 1;");
+    put(fout, 1, "unit->eff.pre_chlor_TTHM = unit->eff.TTHM;");
+    put(fout, 1, "unit->eff.pre_chlor_HAA6 = unit->eff.HAA6;");
+    fprintf(fout, "}\n\n");
+  }
+
+  fprintf(fout, "int %s(struct ProcessTrain *train)\n", name);
+  fprintf(fout, "{\n");
+  put(fout, 1, "struct WtpContext *ctx = &train->ctx;");
+  put(fout, 1, "const struct PlanStep *step;");
+  put(fout, 1, "struct UnitProcess *u[%d];", n);
+  put(fout, 1, "struct UnitProcess *unit;");
+  if (has_cl2 == TRUE && has_rm == TRUE)
+  {
+    put(fout, 1, "int cl2uvox = FALSE;");
+    put(fout, 1, "int modrw2cl2_cntr = 0;");
+  }
+  put(fout, 1, "int i;");
+  fprintf(fout, "\n");
+  put(fout, 1, "if (plan_current(train) == FALSE && compile_plan(train) == NULL)");
+  put(fout, 2, "return (FALSE);");
+  put(fout, 1, "step = train->plan->steps;");
+  put(fout, 1, "if (train->plan->n_steps != %d)", n);
+  put(fout, 2, "return (run_plan(train));");
+  put(fout, 1, "for (i = 0; i < %d; i++)", n);
+  put(fout, 1, "{");
+  put(fout, 2, "if (step[i].type != unit_types[i])");
+  put(fout, 3, "return (run_plan(train));");
+  put(fout, 2, "u[i] = step[i].unit;");
+  put(fout, 1, "}");
+  fprintf(fout, "\n");
+  put(fout, 1, "load_plan(train->plan, ctx);");
+  put(fout, 1, "reset_run_context(ctx);");
+
+  for (unit = FirstUnitProcess(train), i = 0; unit; unit = NextUnitProcess(unit), i++)
+  {
+    type = unit->type;
+    next = NextUnitProcess(unit) != NULL ? NextUnitProcess(unit)->type : (short)VACANT;
+
+    fprintf(fout, "\n");
+    put(fout, 1, "/* %d: %s */", i, type_name(type));
+    put(fout, 1, "unit = u[%d];", i);
+    if (i > 0)
+      put(fout, 1, "unit->eff = u[%d]->eff;", i - 1);
+    put(fout, 1, "unit->eff.ctx = ctx;");
+    put(fout, 1, "ctx->need = step[%d].need;", i);
+
+    if (type == UV_DIS || type == BANK_FILTER)
+    {
+      put(fout, 1, "unit->eff.processtime = 0.0;");
+      continue;
+    }
+
+    if (is_chemical(type) == TRUE)
+    { /* Elided by the plan when the dose is zero */
+      put(fout, 1, "if (step[%d].exec == NULL)", i);
+      put(fout, 2, "unit->eff.processtime = 0.0;");
+      put(fout, 1, "else");
+      put(fout, 1, "{");
+      gen_unit(fout, 2, i, type, next, &s);
+      put(fout, 2, "breakpt(unit);");
+      put(fout, 2, "phchange(unit, TRUE);");
+      put(fout, 2, "finish_unit(unit);");
+      put(fout, 1, "}");
+      continue;
+    }
+
+    if (gen_unit(fout, 1, i, type, next, &s) == FALSE)
+    {
+      if (ferr != NULL)
+        fprintf(ferr, "gen_wtp: unknown unit process %d in %s\n", type, train->file_name);
+      return (FALSE);
+    }
+    put(fout, 1, "breakpt(unit);");
+    put(fout, 1, "phchange(unit, TRUE);");
+    put(fout, 1, "finish_unit(unit);");
+  }
+
+  fprintf(fout, "\n");
+  put(fout, 1, "return (TRUE);");
+  fprintf(fout, "}\n");
+
+  return (ferror(fout) ? FALSE : TRUE);
+}
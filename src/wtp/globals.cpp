@@ -241,76 +241,96 @@ struct Basin default_clearwell = {
 struct Avg_tap default_location_1 = {
     /* days */ 1.0};
 
-/* Global flags */
-int coldflag = FALSE; /* TRUE=Run model at cold temperature and peak flow */
-int coagflag = FALSE;
-int conv_filtflag = FALSE;
-int filtflag = FALSE;
-int filt2flag = FALSE;
-int swflag = TRUE;
-int gw_virus_flag = FALSE;
-
-/* More global flags added 10/98 by WJS */
-int softflag = FALSE;
-int soft2flag = FALSE;
-int floccflag = FALSE;
-int sedflag = FALSE;
-int sedconvflag = FALSE;
-int gacflag = FALSE;
-int mfufflag = FALSE;
-int nfflag = FALSE;
-int ssfflag = FALSE;
-int defflag = FALSE;
-int bagfflag = FALSE;
-int cartfflag = FALSE;
-int bankfflag = 0;
-int granf2flag = FALSE;
-int gac2flag = FALSE;
-int mfuf2flag = FALSE;
-int nf2flag = FALSE;
-int ssf2flag = FALSE;
-int def2flag = FALSE;
-int bagf2flag = FALSE;
-int cartf2flag = FALSE;
-int lt2presedflag = FALSE;
-int cfeflag = FALSE;
-int ifeflag = FALSE;
-int uvflag = FALSE;
-int lt2_wscp_flag = FALSE;
-int clo2flag = FALSE;
-int o3flag = FALSE;
-int pre_o3flag = FALSE;
-int int_o3flag = FALSE;
-int post_o3flag = FALSE;
-int dir_filtflag = FALSE;
-int bio_filtflag = FALSE;
-//int   bio_gacflag   = FALSE;
-
-int rwdbpflag = TRUE;
-int owdbpflag = FALSE;
-int coagdbpflag = FALSE;
-int modrw1dbpflag = FALSE;
-int modrw2dbpflag = FALSE;
-int gacmemdbpflag = FALSE;
-
-double nonconv_discredit = 0.0;
-double bin34_inactreqd = 0.0;
-
-/* Global time counter to be used for modrw1dbp() and modrw2dpb()
-   subroutines */
-double modrw2dbptime = 0;
-double modrw2dbpcl2 = 0;
-
-/* Globals added for pathogen removal by filtration/membranes */
-
-//double fi_crypto_lr  = 0.0;
-//double fi_giardia_lr = 0.0;
-//double fi_virus_lr   = 0.0;
-
-double tot_dis_req_c = 0.0;
-double tot_dis_req_g = 0.0;
-double tot_dis_req_v = 0.0;
-
-double tot_crypto_lr = 0.0;
-double tot_giardia_lr = 0.0;
-double tot_virus_lr = 0.0;
\ No newline at end of file
+/* Model context */
+void InitWtpContext(struct WtpContext *ctx)
+/*
+*  Purpose: Set the model flags of a process train context to their
+*           defaults and empty the phchange() caches, see struct WtpContext.
+*/
+{
+  memset(ctx, 0, sizeof(struct WtpContext));
+
+  /* Compute every output of runmodel() */
+  ctx->outputs = WTP_OUT_ALL;
+  ctx->need = WTP_OUT_ALL;
+
+  /* Memoize the unit kernels, see memo_wtp.cpp */
+  ctx->memo = TRUE;
+
+  /* Age the water for each sampling point separately, see dist_dbp() */
+  ctx->dist_trajectory = WTP_DIST_TRAJECTORY;
+
+  /* Flags describing the process train */
+  ctx->coldflag = FALSE; /* TRUE=Run model at cold temperature and peak flow */
+  ctx->coagflag = FALSE;
+  ctx->conv_filtflag = FALSE;
+  ctx->filtflag = FALSE;
+  ctx->filt2flag = FALSE;
+  ctx->swflag = TRUE;
+  ctx->gw_virus_flag = FALSE;
+
+  /* More global flags added 10/98 by WJS */
+  ctx->softflag = FALSE;
+  ctx->soft2flag = FALSE;
+  ctx->floccflag = FALSE;
+  ctx->sedflag = FALSE;
+  ctx->sedconvflag = FALSE;
+  ctx->gacflag = FALSE;
+  ctx->mfufflag = FALSE;
+  ctx->nfflag = FALSE;
+  ctx->ssfflag = FALSE;
+  ctx->defflag = FALSE;
+  ctx->bagfflag = FALSE;
+  ctx->cartfflag = FALSE;
+  ctx->bankfflag = 0;
+  ctx->granf2flag = FALSE;
+  ctx->gac2flag = FALSE;
+  ctx->mfuf2flag = FALSE;
+  ctx->nf2flag = FALSE;
+  ctx->ssf2flag = FALSE;
+  ctx->def2flag = FALSE;
+  ctx->bagf2flag = FALSE;
+  ctx->cartf2flag = FALSE;
+  ctx->lt2presedflag = FALSE;
+  ctx->cfeflag = FALSE;
+  ctx->ifeflag = FALSE;
+  ctx->uvflag = FALSE;
+  ctx->lt2_wscp_flag = FALSE;
+  ctx->clo2flag = FALSE;
+  ctx->o3flag = FALSE;
+  ctx->pre_o3flag = FALSE;
+  ctx->int_o3flag = FALSE;
+  ctx->post_o3flag = FALSE;
+  ctx->dir_filtflag = FALSE;
+  ctx->bio_filtflag = FALSE;
+  //ctx->bio_gacflag = FALSE;
+
+  ctx->rwdbpflag = TRUE;
+  ctx->owdbpflag = FALSE;
+  ctx->coagdbpflag = FALSE;
+  ctx->modrw1dbpflag = FALSE;
+  ctx->modrw2dbpflag = FALSE;
+  ctx->gacmemdbpflag = FALSE;
+
+  ctx->nonconv_discredit = 0.0;
+  ctx->bin34_inactreqd = 0.0;
+
+  /* Global time counter to be used for modrw1dbp() and modrw2dpb()
+     subroutines */
+  ctx->modrw2dbptime = 0;
+  ctx->modrw2dbpcl2 = 0;
+
+  /* Globals added for pathogen removal by filtration/membranes */
+
+  //ctx->fi_crypto_lr = 0.0;
+  //ctx->fi_giardia_lr = 0.0;
+  //ctx->fi_virus_lr = 0.0;
+
+  ctx->tot_dis_req_c = 0.0;
+  ctx->tot_dis_req_g = 0.0;
+  ctx->tot_dis_req_v = 0.0;
+
+  ctx->tot_crypto_lr = 0.0;
+  ctx->tot_giardia_lr = 0.0;
+  ctx->tot_virus_lr = 0.0;
+}
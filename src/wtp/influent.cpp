@@ -9,9 +9,11 @@ void influent(struct UnitProcess *unit)
 *    3. Determine log_inactivation required for Giardia, Virus, and Cryptosporidium.
 */
 {
+  struct WtpContext *ctx = unit->eff.ctx;
   //FILE *fptr2;
   double kw;     /* Ionization coefficient of water                */
   double k1, k2; /* Ionization coefficients of carbonic acid.      */
+  const struct ThermoCoef *coef; /* Temperature dependent coefficients */
   double H;      /* [H+]                              (Mole/Liter) */
   double OH;     /* [OH-]                             (Mole/Liter) */
   double denom, alpha_one, alpha_two;
@@ -32,7 +34,7 @@ void influent(struct UnitProcess *unit)
   eff = &unit->eff;
 
   /* Copy input variables to effluent variables and convert units.   */
-  if (coldflag == TRUE)
+  if (ctx->coldflag == TRUE)
   {
     eff->DegK = inf->low_temp + 273.15;
     eff->Flow = inf->peak_flow; //Still store this in eff->Peak below for use
@@ -65,7 +67,7 @@ void influent(struct UnitProcess *unit)
   eff->Peak = inf->peak_flow;
 
   /* Make sure swflag gets set somewhere */
-  swflag = inf->swflag;
+  ctx->swflag = inf->swflag;
 
   /* Zero the following variables in the Effluent Data Structure */
   if (eff->TOC > 0.0)
@@ -163,11 +165,12 @@ void influent(struct UnitProcess *unit)
   /***********************************pH Stuff**********************************/
 
   /* PChem Coefficients: */
-  kw = Kw(eff->DegK);
-  k1 = K_HCO3(eff->DegK);
-  k2 = K_CO3(eff->DegK);
+  coef = thermo_coef(eff->ctx, eff->DegK);
+  kw = coef->kw;
+  k1 = coef->k1;
+  k2 = coef->k2;
 
-  H = pow(10.0, -(eff->pH));
+  H = wtp_exp10(-(eff->pH));
   OH = kw / H;
 
 #if 1 == 0
@@ -195,18 +198,18 @@ void influent(struct UnitProcess *unit)
 
   /****** Calculate log_inactivation required for Giardia, Virus, and Crypto.********/
 
-  if (swflag == TRUE)
+  if (ctx->swflag == TRUE)
   {
     /* From SWTR, for filtered or unfiltered systems, we have total disinfection
          requirements for Giardia and Viruses: */
     log_required_g = 3.0;
     log_required_v = 4.0;
 
-    if (filtflag == TRUE)
+    if (ctx->filtflag == TRUE)
     { //For filtered systems....
 
       //First, set total disinfection requirements for Crypto.
-      if (dir_filtflag == TRUE) //Total Disinfection Requirements for LT2 for DIRECT FILTER
+      if (ctx->dir_filtflag == TRUE) //Total Disinfection Requirements for LT2 for DIRECT FILTER
       {
         if (inf->crypto_conc < 0.075)
           log_required_c = 3.0; //Bin #1
@@ -246,9 +249,9 @@ void influent(struct UnitProcess *unit)
       }   //end if-else (dir_filtflag == TRUE)
 
       /*Set these globals to use in echoing to run_wtp() output*/
-      tot_dis_req_g = log_required_g;
-      tot_dis_req_v = log_required_v;
-      tot_dis_req_c = log_required_c;
+      ctx->tot_dis_req_g = log_required_g;
+      ctx->tot_dis_req_v = log_required_v;
+      ctx->tot_dis_req_c = log_required_c;
 
       //Next, begin turning the "log_required_x" variables into log inactivations required
 
@@ -256,23 +259,23 @@ void influent(struct UnitProcess *unit)
       if (inf->lt2_wscp_flag == TRUE)
       {
         log_required_c -= 0.5;
-        lt2_wscp_flag = TRUE;
+        ctx->lt2_wscp_flag = TRUE;
       }
 
       //Now, apply the total log removals from treatment (includes, 1st & 2nd stage filtration,
       //bank filtration, optimized filter performance, UV, 2nd stage softening and pre-sed); these
       //were calculated at start of runmodel()
-      log_required_g -= tot_giardia_lr;
-      log_required_v -= tot_virus_lr;
-      log_required_c -= tot_crypto_lr;
+      log_required_g -= ctx->tot_giardia_lr;
+      log_required_v -= ctx->tot_virus_lr;
+      log_required_c -= ctx->tot_crypto_lr;
 
       //Need to make sure that if we are in Bins 3 and 4 that we will get enough CT credit
       // to fulfill the 1.0-log minimum credit via ozone, ClO2, membranes, bags/cartridges
       // bank filters or UV disinfection requirement
-      if (bin34flag == TRUE && (log_required_c + nonconv_discredit) < 1.0)
+      if (bin34flag == TRUE && (log_required_c + ctx->nonconv_discredit) < 1.0)
       {
-        log_required_c = 1.0 - nonconv_discredit;
-        bin34_inactreqd = 1.0 - nonconv_discredit;
+        log_required_c = 1.0 - ctx->nonconv_discredit;
+        ctx->bin34_inactreqd = 1.0 - ctx->nonconv_discredit;
       }
     }
     else
@@ -318,16 +321,16 @@ void influent(struct UnitProcess *unit)
     eff->log_required_c = 999999.0;
 
     /*Set these globals to use in echoing to run_wtp() output*/
-    tot_dis_req_g = 0.0;
-    tot_dis_req_c = 0.0;
-    tot_dis_req_v = 0.0;
+    ctx->tot_dis_req_g = 0.0;
+    ctx->tot_dis_req_c = 0.0;
+    ctx->tot_dis_req_v = 0.0;
 
     if (inf->gw_virus_flag == TRUE)
     { //This is a groundwater needing virus disinfection
-      gw_virus_flag = TRUE;
+      ctx->gw_virus_flag = TRUE;
       log_required_v = inf->gw_tot_dis_req_v; //Sets total amount of disinfection from input value
-      tot_dis_req_v = log_required_v;         //Saves this amount for use in output tables
-      log_required_v -= tot_virus_lr;         //Now takes out removal to calc. inact. req'd
+      ctx->tot_dis_req_v = log_required_v;         //Saves this amount for use in output tables
+      log_required_v -= ctx->tot_virus_lr;         //Now takes out removal to calc. inact. req'd
 
       if (log_required_v <= 0.0) //Check to see if we have more removal credit than
       {                          //  the total disinfection required (unlikely)
@@ -35,8 +35,8 @@ int list_wtp(
   int i;         /* data element index   */
   struct DataID *data;
   struct UnitProcess *unit;
-  char buffer[120];
-  char line[120];
+  char buffer[WTP_WRITE_LEN];
+  char line[WTP_WRITE_LEN + 120];
 
   if (train == NULL || fp == NULL)
     return (FALSE);
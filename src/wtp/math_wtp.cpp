@@ -0,0 +1,357 @@
+/* Math_wtp.c -- exp(), log(), and pow() for the model kernels
+*
+*  The model kernels call wtp_exp(), wtp_log(), wtp_log10(), wtp_exp10(),
+*  and wtp_pow() (see wtp.h).  By default these are the C library
+*  functions.  Built with -DWTP_FAST_MATH=1 they are the functions in this
+*  file, which give the same error bounds on every platform and compiler,
+*  and batch versions that the compiler can vectorize.  Arguments outside
+*  the ranges below (none occur in the model equations) go to the C
+*  library.
+*
+*  Error, round to nearest, against 64 bit long double references over
+*  random arguments (ulp of the result):
+*    wtp_exp(x)    < 0.52 ulp    |x| <= 708
+*    wtp_log(x)    < 0.9 ulp     x normal, > 0
+*    wtp_log10(x)  < 1.2 ulp     x normal, > 0
+*    wtp_exp10(x)  < 0.52 ulp    |x| <= 307
+*    wtp_pow(x,y)  < 1 ulp       x normal, > 0, |y*ln(x)| <= 150
+*                  < 2 ulp       |y*ln(x)| <= 708
+*  src/test/test_math.cpp checks these bounds ("make test").
+*
+*  Method: exp() uses a table of 2^(j/128) and a degree 5 polynomial,
+*  log() a table of log(c) for 128 intervals and a degree 8 polynomial.
+*  pow() and exp10() carry ln(x) and y*ln(x) in two doubles, so the
+*  rounding of y*ln(x) is not magnified by exp().  The tables are built
+*  from the long double C library before main().
+*
+*  The batch functions (wtp_exp_n() ...) return the same values as the
+*  scalar functions.  Their loops have no branches on the common path and
+*  are vectorized at -O3 (with gathers for the tables on AVX2).
+*
+*  The following functions are in this file:
+*    wtp_exp(), wtp_log(), wtp_log10(), wtp_exp10(), wtp_pow()
+*    wtp_exp_n(), wtp_log_n(), wtp_exp10_n(), wtp_pow_n()
+*/
+#include <stdint.h>
+#include "wtp.h"
+
+#if WTP_FAST_MATH
+
+#define EXP_BITS 7
+#define EXP_N (1 << EXP_BITS) /* Intervals of the exp() table, 2^(j/EXP_N) */
+#define LOG_BITS 7
+#define LOG_N (1 << LOG_BITS) /* Intervals of the log() table over [0.6875,1.375) */
+#define LOG_OFF 0x3fe6000000000000ULL /* 0.6875 */
+
+static const double ln2_hi = 6.93147180369123816490e-01; /* 0x3fe62e42fee00000 */
+static const double ln2_lo = 1.90821492927058770002e-10; /* ln(2) - ln2_hi      */
+static const double ln10 = 2.302585092994046;            /* ln(10)              */
+static const double ln10_lo = -2.1707562233822494e-16;   /* ln(10) - ln10       */
+static const double ivln10 = 0.4342944819032518;         /* 1/ln(10)            */
+static const double ivln10_lo = 1.098319650216765e-17;   /* 1/ln(10) - ivln10   */
+static const double shift = 6755399441055744.0;          /* 1.5*2^52            */
+
+static struct
+{
+  double hi, lo; /* 2^(j/EXP_N) = hi + lo */
+} exp_tab[EXP_N];
+
+static struct
+{
+  double c, invc;  /* Center of interval i and 1/c, rounded  */
+  double hi, lo;   /* log(c) = hi + lo, hi a multiple of 2^-43 */
+} log_tab[LOG_N];
+
+static int build_math_tables(void)
+/*
+*  Purpose: Fill the tables from the long double C library, which carries
+*           11 more bits than the tables keep.
+*/
+{
+  long double L;
+  double zlo, zhi;
+  uint64_t i, u;
+
+  for (i = 0; i < EXP_N; i++)
+  {
+    L = exp2l((long double)i / EXP_N);
+    exp_tab[i].hi = (double)L;
+    exp_tab[i].lo = (double)(L - exp_tab[i].hi);
+  }
+  for (i = 0; i < LOG_N; i++)
+  {
+    u = LOG_OFF + (i << (52 - LOG_BITS));
+    memcpy(&zlo, &u, sizeof(zlo));
+    u = LOG_OFF + ((i + 1) << (52 - LOG_BITS));
+    memcpy(&zhi, &u, sizeof(zhi));
+
+    /* The two intervals next to 1 use c = 1, so that r = z - 1 is exact
+       and log(x) keeps its relative accuracy as x goes to 1 */
+    log_tab[i].c = (zlo == 1.0 || zhi == 1.0) ? 1.0 : 0.5 * (zlo + zhi);
+    log_tab[i].invc = 1.0 / log_tab[i].c;
+    L = logl((long double)log_tab[i].c);
+    log_tab[i].hi = ldexp(nearbyint(ldexp((double)L, 43)), -43);
+    log_tab[i].lo = (double)(L - log_tab[i].hi);
+  }
+  return (TRUE);
+}
+
+static const int math_tables = build_math_tables(); /* Before main() */
+
+static inline uint64_t dbl_bits(double x)
+{
+  uint64_t u;
+  memcpy(&u, &x, sizeof(u));
+  return (u);
+}
+
+static inline double bits_dbl(uint64_t u)
+{
+  double x;
+  memcpy(&x, &u, sizeof(x));
+  return (x);
+}
+
+static inline double mul_err(double a, double b, double p)
+/*
+*  Purpose: Return a*b - p exactly, where p is a*b rounded (Dekker).
+*/
+{
+#ifdef __FP_FAST_FMA
+  return (fma(a, b, -p));
+#else
+  const double split = 134217729.0; /* 2^27 + 1 */
+  double t, ah, al, bh, bl;
+
+  t = split * a;
+  ah = t - (t - a);
+  al = a - ah;
+  t = split * b;
+  bh = t - (t - b);
+  bl = b - bh;
+  return (((ah * bh - p) + ah * bl + al * bh) + al * bl);
+#endif
+}
+
+static inline double exp_core(double x, double dx)
+/*
+*  Purpose: exp(x + dx) for |x| <= 708, |dx| < ulp(x).
+*/
+{
+  double kd, r, p;
+  int64_t k, j;
+
+  /* x = (k/EXP_N)*ln(2) + r, |r| <= ln(2)/(2*EXP_N) */
+  kd = x * (EXP_N / 0.693147180559945309417) + shift;
+  k = (int64_t)(dbl_bits(kd) - dbl_bits(shift));
+  kd -= shift;
+  r = (x - kd * (ln2_hi / EXP_N)) - kd * (ln2_lo / EXP_N) + dx;
+
+  /* exp(r) - 1 */
+  p = r + r * r * (0.5 + r * (1.0 / 6.0 + r * (1.0 / 24.0 + r * (1.0 / 120.0))));
+
+  j = k & (EXP_N - 1);
+  p = exp_tab[j].hi + (exp_tab[j].lo + exp_tab[j].hi * p);
+  return (p * bits_dbl((uint64_t)((k >> EXP_BITS) + 1023) << 52));
+}
+
+static inline double log_core(double x, double *lo)
+/*
+*  Purpose: log(x) for normal x > 0 as hi + *lo, hi returned.  The error of
+*           hi + *lo is about 2^-60 (absolute), and 2^-60 relative in the
+*           two intervals next to x = 1.
+*
+*  Method: x = 2^k*z with z in [0.6875,1.375), and z = c*(1+r) for the
+*          center c of one of LOG_N intervals, |r| < 2^-7.  Then log(x) =
+*          k*ln(2) + log(c) + log(1+r).
+*/
+{
+  uint64_t u, tmp;
+  double kd, z, d, r, r_lo, p, t, t1, t2, tail, hi;
+  int i;
+
+  u = dbl_bits(x);
+  tmp = u - LOG_OFF;
+  i = (int)((tmp >> (52 - LOG_BITS)) % LOG_N);
+  kd = (double)((int64_t)tmp >> 52);
+  z = bits_dbl(u - (tmp & 0xfff0000000000000ULL));
+
+  /* z - c is exact; r_lo is the rounding error of r = (z - c)/c, which
+     y*log(x) in pow() would magnify for x near 1 and large y */
+  d = z - log_tab[i].c;
+  r = d * log_tab[i].invc;
+  p = r * log_tab[i].c;
+  r_lo = ((d - p) - mul_err(r, log_tab[i].c, p)) * log_tab[i].invc;
+
+  /* log(1+r) - r */
+  tail = r * r * (-0.5 + r * (1.0 / 3.0 + r * (-0.25 + r * (0.2 + r * (-1.0 / 6.0 + r * (1.0 / 7.0 + r * -0.125))))));
+
+  /* k*ln2_hi (a multiple of 2^-32) plus log_tab.hi is exact, and is zero
+     or larger than |r| */
+  t1 = kd * ln2_hi + log_tab[i].hi;
+  t2 = t1 + r;
+  t = ((t1 - t2) + r) + (kd * ln2_lo + log_tab[i].lo + tail + r_lo);
+
+  /* |t| < |t2|: normalize so *lo is below half an ulp of the sum */
+  hi = t2 + t;
+  *lo = t - (hi - t2);
+  return (hi);
+}
+
+static inline int log_ok(double x)
+{
+  return (x >= DBL_MIN && x <= DBL_MAX);
+}
+
+double wtp_exp(double x)
+{
+  if (!(fabs(x) <= 708.0))
+    return (exp(x));
+  return (exp_core(x, 0.0));
+}
+
+double wtp_log(double x)
+{
+  double hi, lo;
+
+  if (!log_ok(x))
+    return (log(x));
+  hi = log_core(x, &lo);
+  return (hi);
+}
+
+double wtp_log10(double x)
+{
+  double hi, lo, p;
+
+  if (!log_ok(x))
+    return (log10(x));
+  hi = log_core(x, &lo);
+  p = hi * ivln10;
+  return (p + (mul_err(hi, ivln10, p) + lo * ivln10 + hi * ivln10_lo));
+}
+
+double wtp_exp10(double x)
+{
+  double p;
+
+  if (!(fabs(x) <= 307.0))
+    return (pow(10.0, x));
+  p = x * ln10;
+  return (exp_core(p, mul_err(x, ln10, p) + x * ln10_lo));
+}
+
+double wtp_pow(double x, double y)
+{
+  double hi, lo, p;
+
+  if (!log_ok(x) || !(fabs(y) <= DBL_MAX))
+    return (pow(x, y));
+  hi = log_core(x, &lo);
+  p = y * hi;
+  if (!(fabs(p) <= 708.0))
+    return (pow(x, y));
+  return (exp_core(p, mul_err(y, hi, p) + y * lo));
+}
+
+void wtp_exp_n(int n, const double *x, double *y)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    y[i] = exp_core(fabs(x[i]) <= 708.0 ? x[i] : 0.0, 0.0);
+  for (i = 0; i < n; i++)
+    if (!(fabs(x[i]) <= 708.0))
+      y[i] = exp(x[i]);
+}
+
+void wtp_log_n(int n, const double *x, double *y)
+{
+  double lo;
+  int i;
+
+  for (i = 0; i < n; i++)
+  {
+    y[i] = log_core(log_ok(x[i]) ? x[i] : 1.0, &lo);
+    y[i] += lo;
+  }
+  for (i = 0; i < n; i++)
+    if (!log_ok(x[i]))
+      y[i] = log(x[i]);
+}
+
+void wtp_exp10_n(int n, const double *x, double *y)
+{
+  double xi, p;
+  int i;
+
+  for (i = 0; i < n; i++)
+  {
+    xi = fabs(x[i]) <= 307.0 ? x[i] : 0.0;
+    p = xi * ln10;
+    y[i] = exp_core(p, mul_err(xi, ln10, p) + xi * ln10_lo);
+  }
+  for (i = 0; i < n; i++)
+    if (!(fabs(x[i]) <= 307.0))
+      y[i] = pow(10.0, x[i]);
+}
+
+void wtp_pow_n(int n, const double *x, const double *y, double *z)
+{
+  double hi, lo, p, yi;
+  char bad[64];
+  int i, j, m;
+
+  for (j = 0; j < n; j += m)
+  {
+    m = n - j < 64 ? n - j : 64;
+    for (i = 0; i < m; i++)
+    {
+      hi = log_core(log_ok(x[j + i]) ? x[j + i] : 1.0, &lo);
+      p = y[j + i] * hi;
+      bad[i] = !(log_ok(x[j + i]) && fabs(p) <= 708.0);
+      yi = bad[i] ? 0.0 : y[j + i];
+      p = bad[i] ? 0.0 : p;
+      z[j + i] = exp_core(p, mul_err(yi, hi, p) + yi * lo);
+    }
+    for (i = 0; i < m; i++)
+      if (bad[i])
+        z[j + i] = pow(x[j + i], y[j + i]);
+  }
+}
+
+#else /* C library */
+
+void wtp_exp_n(int n, const double *x, double *y)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    y[i] = exp(x[i]);
+}
+
+void wtp_log_n(int n, const double *x, double *y)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    y[i] = log(x[i]);
+}
+
+void wtp_exp10_n(int n, const double *x, double *y)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    y[i] = pow(10.0, x[i]);
+}
+
+void wtp_pow_n(int n, const double *x, const double *y, double *z)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    z[i] = pow(x[i], y[i]);
+}
+
+#endif /* WTP_FAST_MATH */
@@ -26,7 +26,6 @@ void modrw1dbp(struct UnitProcess *unit)
    /* Inputs to model (from influent of last Rapid Mix): */
    double doc;    /* Really, its TOC      (mg/L) */
    double uv;     /* UV254                (1/cm) */
-   double doc_uv; /* Product of DOC and UV-254 (mg/L/cm) */
 
    /* Inputs to model (from current unit process) */
    double pH;         /*                         (-) */
@@ -77,7 +76,9 @@ void modrw1dbp(struct UnitProcess *unit)
    double delta_tox = 0.0;
 
    /* Internal: */
-   double factor, term1, term2, term3, term4, term5, term6;
+   double factor;
+   struct DbpTerms dbp;
+   struct WtpContext *ctx = unit->eff.ctx;
    double eff_Br, moles_br_incorporated;
    register struct Effluent *eff;
 
@@ -144,8 +145,6 @@ void modrw1dbp(struct UnitProcess *unit)
       if (doc > 0.0 && doc < 0.1)
          doc = 0.1; /* Min. non-zero doc   */
 
-      doc_uv = doc * uv;
-
       /* For pre-Cl2 Model, apply Solarik factors to Sohn raw water model predictions */
 
       if ((inf_FreeCl > 0.0 || inf_nh2cl > 0.0) && doc > 0.0 && cl2dose > 0.0 && eff_hours > 0.0)
@@ -163,184 +162,30 @@ void modrw1dbp(struct UnitProcess *unit)
 
          /* Now develop THM and HAA estimates based upon Jinsik Sohn's Raw Water Eq. */
 
-         /* Estimate TTHM (ug/liter) ------------------------ Equation XX*/
-         term1 = pow(doc, 1.098);
-         term2 = pow(cl2dose, 0.152);
-         term3 = pow(br_ugl, 0.068);
-         term4 = pow(DegC, 0.609);
-         term5 = pow(pH, 1.601);
-         term6 = pow(eff_hours, 0.263) - pow(inf_hours, 0.263);
-         delta_tthm = pow(10, -1.385) * term1 * term2 * term3 * term4 * term5 * term6;
-
-         /* Estimate CHCl3 (ug/liter) ------------------------ Equation XX*/
-         term1 = pow(doc, 1.617);
-         term2 = pow(cl2dose, -0.094);
-         term3 = pow(br_ugl, -0.175);
-         term4 = pow(DegC, 0.607);
-         term5 = pow(pH, 1.403);
-         term6 = pow(eff_hours, 0.306) - pow(inf_hours, 0.306);
-         delta_chcl3 = pow(10, -1.205) * term1 * term2 * term3 * term4 * term5 * term6;
-
-         /* Estimate CHBrCl2 (ug/liter) ------------------------ Equation XX*/
-         term1 = pow(doc, 0.901);
-         term2 = pow(cl2dose, 0.017);
-         term3 = pow(br_ugl, 0.733);
-         term4 = pow(DegC, 0.498);
-         term5 = pow(pH, 1.511);
-         term6 = pow(eff_hours, 0.199) - pow(inf_hours, 0.199);
-         delta_chbrcl2 = pow(10, -2.874) * term1 * term2 * term3 * term4 * term5 * term6;
-
-         /* Estimate CHBr2Cl (ug/liter) ------------------------ Equation XX*/
-         term1 = pow(doc, -0.226);
-         term2 = pow(cl2dose, 0.108);
-         term3 = pow(br_ugl, 1.81);
-         term4 = pow(DegC, 0.512);
-         term5 = pow(pH, 2.212);
-         term6 = pow(eff_hours, 0.146) - pow(inf_hours, 0.146);
-         delta_chbr2cl = pow(10, -5.649) * term1 * term2 * term3 * term4 * term5 * term6;
-
-         /* Estimate CHBr3  (ug/liter) ------------------------ Equation XX*/
-         term1 = pow(doc, -0.983);
-         term2 = pow(cl2dose, 0.804);
-         term3 = pow(br_ugl, 1.765);
-         term4 = pow(DegC, 0.754);
-         term5 = pow(pH, 2.139);
-         term6 = pow(eff_hours, 0.566) - pow(inf_hours, 0.556);
-         delta_chbr3 = pow(10, -7.83) * term1 * term2 * term3 * term4 * term5 * term6;
-
-         /*  Estimate HAAs */
-
-         /* Estimate HAA6  (ug/liter) ------------------------ Equation XX */
-         term1 = pow(doc, 0.935);
-         term2 = pow(cl2dose, 0.443);
-         term3 = pow(br_ugl, -0.031);
-         term4 = pow(DegC, 0.387);
-         term5 = pow(pH, -0.655);
-         term6 = pow(eff_hours, 0.178) - pow(inf_hours, 0.178);
-         delta_haa6 = 9.98 * term1 * term2 * term3 * term4 * term5 * term6;
-
-         /* Estimate HAA5  (ug/liter) ------------------------ Equation XX */
-         /*   term1 = pow( doc      , 0.997  );
-      term2 = pow( cl2dose  , 0.278  );
-      term3 = pow( br_ugl   ,-0.138  );
-      term4 = pow( DegC     , 0.341  );
-      term5 = pow( pH       , -0.799 );
-      term6 = pow( eff_hours, 0.169 ) - pow( inf_hours, 0.169 );
-      delta_haa5 = 30.0*term1*term2*term3*term4*term5*term6;   */
-
-         /* Estimate MCAA  (ug/liter) ------------------------ Equation XX */
-         term1 = pow(doc, 0.173);
-         term2 = pow(cl2dose, 0.397);
-         term3 = pow(br_ugl, 0.029);
-         term4 = pow(DegC, 0.573);
-         term5 = pow(pH, -0.279);
-         if (inf_hours > 0.0)
-            term6 = pow(eff_hours, -0.009) - pow(inf_hours, -0.009);
-         else
-            term6 = pow(eff_hours, -0.009);
-         delta_mcaa = 0.45 * term1 * term2 * term3 * term4 * term5 * term6;
+         /* Estimate THMs, HAAs and TOX (ug/liter), see dbp_wtp.cpp */
+         dbp_formation(unit->eff.ctx, DBP_RAW_MODEL, doc, uv, cl2dose, br_ugl, DegC, pH, eff_hours, inf_hours, &dbp);
+         delta_tthm = dbp.delta[DBP_TTHM];
+         delta_chcl3 = dbp.delta[DBP_CHCL3];
+         delta_chbrcl2 = dbp.delta[DBP_CHBRCL2];
+         delta_chbr2cl = dbp.delta[DBP_CHBR2CL];
+         delta_chbr3 = dbp.delta[DBP_CHBR3];
+         delta_haa6 = dbp.delta[DBP_HAA6];
+         delta_mcaa = dbp.delta[DBP_MCAA];
          if (delta_mcaa > 11.0)
             delta_mcaa = 11.0; //based on eqn. and model development input database
-
-         /* Estimate MBAA  (ug/liter) ------------------------ Equation XX */
-         term1 = pow(doc, -0.584);
-         term2 = pow(cl2dose, 0.754);
-         term3 = pow(br_ugl, 1.1);
-         term4 = pow(DegC, 0.707);
-         term5 = pow(pH, 0.604);
-         term6 = pow(eff_hours, 0.09) - pow(inf_hours, 0.09);
-         delta_mbaa = 6.21 * pow(10, -5.0) * term1 * term2 * term3 * term4 * term5 * term6;
-
-         /* Estimate DCAA  (ug/liter) ------------------------ Equation XX */
-         term1 = pow(doc, 1.396);
-         term2 = pow(cl2dose, 0.379);
-         term3 = pow(br_ugl, -0.149);
-         term4 = pow(DegC, 0.465);
-         term5 = pow(pH, 0.2);
-         term6 = pow(eff_hours, 0.218) - pow(inf_hours, 0.218);
-         delta_dcaa = 0.3 * term1 * term2 * term3 * term4 * term5 * term6;
-
-         /* Estimate TCAA  (ug/liter) ------------------------ Equation XX */
-         term1 = pow(doc, 1.152);
-         term2 = pow(cl2dose, 0.331);
-         term3 = pow(br_ugl, -0.229);
-         term4 = pow(DegC, 0.299);
-         term5 = pow(pH, -1.627);
-         term6 = pow(eff_hours, 0.18) - pow(inf_hours, 0.18);
-         delta_tcaa = 92.68 * term1 * term2 * term3 * term4 * term5 * term6;
-
-         /* Estimate DBAA  (ug/liter) ------------------------ Equation XX */
-         term1 = pow(doc, -1.086);
-         term2 = pow(cl2dose, 0.673);
-         term3 = pow(br_ugl, 2.052);
-         term4 = pow(DegC, 0.38);
-         term5 = pow(pH, -0.001);
-         term6 = pow(eff_hours, 0.095) - pow(inf_hours, 0.095);
-         delta_dbaa = 3.59 * pow(10, -5.0) * term1 * term2 * term3 * term4 * term5 * term6;
-
-         /*  Estimate BCAA  (ug/liter) ------------------------ Equation XX */
-         term1 = pow(doc, 0.463);
-         term2 = pow(cl2dose, 0.522);
-         term3 = pow(br_ugl, 0.667);
-         term4 = pow(DegC, 0.379);
-         term5 = pow(pH, 0.581);
-         term6 = pow(eff_hours, 0.22) - pow(inf_hours, 0.22);
-         delta_bcaa = 5.51 * pow(10, -3.0) * term1 * term2 * term3 * term4 * term5 * term6;
-
-         //  The following are coag.-water HAA9 species and TOX models developed by MPI in 4/2001
-         //  (used here in place of a suitable raw water model)
-
-         /*  Estimate TBAA  (ug/liter) ------------------------ Equation XX */
-         term1 = pow(doc_uv, 0.0657);
-         term2 = pow(cl2dose, -2.51);
-         term3 = pow(br_ugl, 2.32);
-         term4 = pow(1.059, (DegC - 20.0));
-         term5 = pow(0.555, (pH - 8.0));
-         term6 = pow(eff_hours, 1.26) - pow(inf_hours, 1.26);
-         delta_tbaa = 5.59 * pow(10, -6.0) * term1 * term2 * term3 * term4 * term5 * term6;
-
-         /*  Estimate DBCAA  (ug/liter) ------------------------ Equation XX */
-         term1 = pow(doc_uv, -0.0162);
-         term2 = pow(cl2dose, -0.170);
-         term3 = pow(br_ugl, 0.972);
-         term4 = pow(1.054, (DegC - 20.0));
-         term5 = pow(0.839, (pH - 8.0));
-         term6 = pow(eff_hours, 0.685) - pow(inf_hours, 0.685);
-         delta_dbcaa = 3.7 * pow(10, -3.0) * term1 * term2 * term3 * term4 * term5 * term6;
-
-         /*  Estimate BDCAA  (ug/liter) ------------------------ Equation XX */
-         term1 = pow(doc_uv, 0.230);
-         term2 = pow(cl2dose, 0.140);
-         term3 = pow(br_ugl, 0.301);
-         term4 = pow(1.022, (DegC - 20.0));
-         term5 = pow(0.700, (pH - 8.0));
-         term6 = pow(eff_hours, 0.422) - pow(inf_hours, 0.422);
-         delta_bdcaa = 0.589 * term1 * term2 * term3 * term4 * term5 * term6;
-
-         /*  Estimate HAA9  (ug/liter) ------------------------ Equation XX */
-         term1 = pow(doc_uv, 0.250);
-         term2 = pow(cl2dose, 0.500);
-         term3 = pow(br_ugl, 0.054);
-         term4 = pow(1.015, (DegC - 20.0));
-         term5 = pow(0.894, (pH - 8.0));
-         term6 = pow(eff_hours, 0.348) - pow(inf_hours, 0.348);
-         delta_haa9 = 10.783 * term1 * term2 * term3 * term4 * term5 * term6;
-
-         /*  Estimate HAA6 for HAA9  (ug/liter) ------------------------ Equation XX */
-         term1 = pow(doc_uv, 0.320);
-         term2 = pow(cl2dose, 0.510);
-         term3 = pow(br, -0.106);
-         term4 = pow(1.017, (DegC - 20.0));
-         term5 = pow(0.938, (pH - 8.0));
-         term6 = pow(eff_hours, 0.353) - pow(inf_hours, 0.353);
-         delta_haa6_for_haa9 = 18.6 * term1 * term2 * term3 * term4 * term5 * term6;
-
-         /*  Estimate TOX  (ug/liter) ------------------------ Equation XX */
-         term1 = pow(doc_uv, 0.362);
-         term2 = pow(cl2dose, 0.129);
-         term4 = pow(DegC, 0.211);
-         term6 = pow(eff_hours, 0.182) - pow(inf_hours, 0.182);
-         delta_tox = 109.0 * term1 * term2 * term4 * term6;
+         delta_mbaa = dbp.delta[DBP_MBAA];
+         delta_dcaa = dbp.delta[DBP_DCAA];
+         delta_tcaa = dbp.delta[DBP_TCAA];
+         delta_dbaa = dbp.delta[DBP_DBAA];
+         delta_bcaa = dbp.delta[DBP_BCAA];
+         delta_tbaa = dbp.delta[DBP_TBAA];
+         delta_dbcaa = dbp.delta[DBP_DBCAA];
+         delta_bdcaa = dbp.delta[DBP_BDCAA];
+         delta_haa9 = dbp.delta[DBP_HAA9];
+         /* HAA6 for HAA9 has always been evaluated with bromide in mg/L here */
+         if ((ctx->need & WTP_OUT_HAA9) != 0)
+            delta_haa6_for_haa9 = dbp.delta[DBP_HAA6_9] * wtp_pow(br / br_ugl, -0.106);
+         delta_tox = dbp.delta[DBP_TOX];
 
          /*******PRE-CL2 FACTORS************/
          /*Modify the delta_XXXXs (Jinsik Sohn Raw Water Model Predictions)
@@ -434,7 +279,12 @@ void modrw1dbp(struct UnitProcess *unit)
          /******************************END OF CORRECTION FACTORS*******************************/
 
          /* Proportion the species based on the bulk TTHM */
-         if (delta_chcl3 > 0.0 || delta_chbrcl2 > 0.0 || delta_chbr2cl > 0.0 || delta_chbr3 > 0.0)
+         if ((ctx->need & WTP_OUT_THM_SPECIES) == 0)
+         { /* Species not evaluated, see dbp_forms() */
+            if (dbp_forms(&dbp, DBP_CHCL3, DBP_CHBR3) == FALSE)
+               delta_tthm = 0.0;
+         }
+         else if (delta_chcl3 > 0.0 || delta_chbrcl2 > 0.0 || delta_chbr2cl > 0.0 || delta_chbr3 > 0.0)
          {
             factor = delta_tthm / (delta_chcl3 + delta_chbrcl2 +
                                    delta_chbr2cl + delta_chbr3);
@@ -465,30 +315,33 @@ void modrw1dbp(struct UnitProcess *unit)
          /* Calc. HAA5 based on HAA6 equation, minus proportioned BCAA */
          delta_haa5 = delta_haa6 - delta_bcaa;
 
-         /* Proportion the HAA9 species based on HAA9-HAA6 */
-         if (delta_haa9 > delta_haa6_for_haa9)
-         {
-            delta_haa9_haa6 = delta_haa9 - delta_haa6_for_haa9;
-         }
-         else
-         {
-            delta_haa9_haa6 = 0.0;
-            delta_dbcaa = 0.0;
-            delta_bdcaa = 0.0;
-            delta_tbaa = 0.0;
-         }
-
-         if (delta_dbcaa > 0.0 || delta_bdcaa > 0.0 || delta_tbaa > 0.0)
+         if ((ctx->need & WTP_OUT_HAA9) != 0)
          {
-            factor = delta_haa9_haa6 / (delta_dbcaa + delta_bdcaa + delta_tbaa);
-            delta_dbcaa *= factor;
-            delta_bdcaa *= factor;
-            delta_tbaa *= factor;
+            /* Proportion the HAA9 species based on HAA9-HAA6 */
+            if (delta_haa9 > delta_haa6_for_haa9)
+            {
+               delta_haa9_haa6 = delta_haa9 - delta_haa6_for_haa9;
+            }
+            else
+            {
+               delta_haa9_haa6 = 0.0;
+               delta_dbcaa = 0.0;
+               delta_bdcaa = 0.0;
+               delta_tbaa = 0.0;
+            }
+
+            if (delta_dbcaa > 0.0 || delta_bdcaa > 0.0 || delta_tbaa > 0.0)
+            {
+               factor = delta_haa9_haa6 / (delta_dbcaa + delta_bdcaa + delta_tbaa);
+               delta_dbcaa *= factor;
+               delta_bdcaa *= factor;
+               delta_tbaa *= factor;
+            }
+
+            /* Calc. HAA9 based on HAA6, plus three additional species */
+            delta_haa9 = delta_haa6 + delta_tbaa + delta_dbcaa + delta_bdcaa;
          }
 
-         /* Calc. HAA9 based on HAA6, plus three additional species */
-         delta_haa9 = delta_haa6 + delta_tbaa + delta_dbcaa + delta_bdcaa;
-
          /* Add incremental outputs in UnitProcess data structure. */
 
          /* THMs */
@@ -516,25 +369,28 @@ void modrw1dbp(struct UnitProcess *unit)
          unit->eff.tox += delta_tox;
 
          /*Stoichiometric Bromide incorporation (non-THM or HAA TOX not considered)*/
-         moles_br_incorporated =
-             (delta_chbrcl2 / 1000.0) / MW_BDCM * 1.0 +
-             (delta_chbr2cl / 1000.0) / MW_DBCM * 2.0 +
-             (delta_chbr3 / 1000.0) / MW_CHBR3 * 3.0 +
-             (delta_mbaa / 1000.0) / MW_MBAA * 1.0 +
-             (delta_bcaa / 1000.0) / MW_BCAA * 1.0 +
-             (delta_dbaa / 1000.0) / MW_DBAA * 2.0 +
-             (delta_bdcaa / 1000.0) / MW_BDCAA * 1.0 +
-             (delta_dbcaa / 1000.0) / MW_DBCAA * 2.0 +
-             (delta_tbaa / 1000.0) / MW_TBAA * 3.0;
-
-         eff_Br = unit->eff.Br - moles_br_incorporated;
-
-         if (eff_Br > unit->eff.Br)
-            eff_Br = unit->eff.Br; /* No increasing Br allowed */
-         if (eff_Br < 0.0)
-            eff_Br = 0.0; /* No negative Br allowed   */
-
-         unit->eff.Br = eff_Br; /*Update UnitProcess data structure */
+         if ((ctx->need & WTP_OUT_BROMIDE) != 0)
+         { /* Not read downstream unless asked for, see out_need() */
+            moles_br_incorporated =
+                (delta_chbrcl2 / 1000.0) / MW_BDCM * 1.0 +
+                (delta_chbr2cl / 1000.0) / MW_DBCM * 2.0 +
+                (delta_chbr3 / 1000.0) / MW_CHBR3 * 3.0 +
+                (delta_mbaa / 1000.0) / MW_MBAA * 1.0 +
+                (delta_bcaa / 1000.0) / MW_BCAA * 1.0 +
+                (delta_dbaa / 1000.0) / MW_DBAA * 2.0 +
+                (delta_bdcaa / 1000.0) / MW_BDCAA * 1.0 +
+                (delta_dbcaa / 1000.0) / MW_DBCAA * 2.0 +
+                (delta_tbaa / 1000.0) / MW_TBAA * 3.0;
+
+            eff_Br = unit->eff.Br - moles_br_incorporated;
+
+            if (eff_Br > unit->eff.Br)
+               eff_Br = unit->eff.Br; /* No increasing Br allowed */
+            if (eff_Br < 0.0)
+               eff_Br = 0.0; /* No negative Br allowed   */
+
+            unit->eff.Br = eff_Br; /*Update UnitProcess data structure */
+         }
                                 /***********************End of Bromide Incorporation**********************/
 
          /* Because of possibility of a negative delta_mcaa, the HAA5 species
@@ -0,0 +1,137 @@
+/* Memo_wtp.c -- Per-unit memos of the pure unit process kernels
+*
+*  phchange(), alum_rmv(), ec_comply() and ct() compute their outputs from
+*  a handful of Effluent fields.  Each unit process keeps the last
+*  MEMO_WAYS input/output pairs of every kernel, so a kernel called again
+*  with bit-identical inputs copies its outputs instead of recomputing
+*  them.  During auto_dose() root finding every unit upstream of the dosed
+*  unit sees the same water on every iteration, and so does every unit of
+*  a train run again with unchanged influent.
+*
+*  Inputs are compared bit for bit, so a memo hit returns exactly what the
+*  kernel would have computed.  The memo of a unit belongs to its process
+*  train, like the unit itself, and is not saved in snapshots.
+*  ctx->memo=FALSE turns the memos off; ctx->memo_stats counts the calls
+*  and hits of each kernel.
+*
+*  The following functions are in this file:
+*    memo_find()
+*    memo_store()
+*    FreeUnitMemo()
+*    print_memo_stats()
+*/
+#include "wtp.h"
+
+struct MemoEntry
+{                           /* One input/output pair of a kernel   */
+  int n_in;                 /*   Number of inputs, 0=empty entry   */
+  double in[MEMO_MAX_IN];   /*   Inputs                            */
+  double out[MEMO_MAX_OUT]; /*   Outputs                           */
+};
+
+struct UnitMemo
+{ /* Memos of one unit process, see memo_wtp.cpp */
+  struct MemoEntry entry[MEMO_NKERNELS][MEMO_WAYS];
+  int last[MEMO_NKERNELS]; /* Entry stored or found last */
+};
+
+static const char *memo_name[MEMO_NKERNELS] = {"phchange", "alum_rmv", "ec_comply", "ct"};
+
+const double *memo_find(struct UnitProcess *unit, int kernel, const double *in, int n_in)
+/*
+*  Purpose: Return the outputs of 'kernel' memoized for the inputs in[],
+*           or NULL if the kernel must be run.
+*
+*  Inputs:
+*    unit   = The unit process the kernel is applied to.
+*    kernel = MEMO_PHCHANGE, MEMO_ALUM_RMV, MEMO_EC_COMPLY, or MEMO_CT.
+*    in[]   = The n_in inputs of the kernel.
+*
+*  Notes:
+*   1. The entries are searched starting with the one found or stored
+*      last, which is the one that hits when the unit sees the same
+*      water as in the previous run.
+*/
+{
+  struct WtpContext *ctx = unit->eff.ctx;
+  struct UnitMemo *memo = unit->memo;
+  struct MemoEntry *e;
+  int i, w;
+
+  if (ctx->memo == FALSE)
+    return (NULL);
+  ctx->memo_stats.calls[kernel]++;
+  if (memo == NULL)
+    return (NULL);
+
+  for (i = 0; i < MEMO_WAYS; i++)
+  {
+    w = (memo->last[kernel] + i) % MEMO_WAYS;
+    e = &memo->entry[kernel][w];
+    if (e->n_in == n_in && memcmp(e->in, in, n_in * sizeof(double)) == 0)
+    {
+      memo->last[kernel] = w;
+      ctx->memo_stats.hits[kernel]++;
+      return (e->out);
+    }
+  }
+  return (NULL);
+}
+
+void memo_store(struct UnitProcess *unit, int kernel, const double *in, int n_in,
+                const double *out, int n_out)
+/*
+*  Purpose: Remember the outputs out[] of 'kernel' for the inputs in[].
+*           The entries of a kernel are replaced round robin.
+*
+*  Notes:
+*   1. The memo of the unit is allocated on the first store.  Nothing is
+*      stored if it can not be allocated or the memos are turned off.
+*/
+{
+  struct UnitMemo *memo;
+  struct MemoEntry *e;
+  int w;
+
+  if (unit->eff.ctx->memo == FALSE)
+    return;
+  if (unit->memo == NULL &&
+      (unit->memo = (struct UnitMemo *)calloc(1, sizeof(struct UnitMemo))) == NULL)
+    return;
+
+  memo = unit->memo;
+  w = (memo->last[kernel] + MEMO_WAYS - 1) % MEMO_WAYS;
+  e = &memo->entry[kernel][w];
+  e->n_in = n_in;
+  memcpy(e->in, in, n_in * sizeof(double));
+  memcpy(e->out, out, n_out * sizeof(double));
+  memo->last[kernel] = w;
+}
+
+struct UnitMemo *FreeUnitMemo(struct UnitMemo *memo)
+/*
+*  Purpose: Release the memo of a unit process.  Returns NULL.
+*/
+{
+  free(memo);
+  return (NULL);
+}
+
+void print_memo_stats(FILE *fp, struct WtpContext *ctx)
+/*
+*  Purpose: Print the calls and hit rate of each memoized kernel.
+*/
+{
+  int k;
+
+  if (ctx->memo == FALSE)
+  {
+    fprintf(fp, "Unit kernel memos: off\n");
+    return;
+  }
+  fprintf(fp, "Unit kernel memos:\n");
+  for (k = 0; k < MEMO_NKERNELS; k++)
+    fprintf(fp, "  %-10s %10ld calls %10ld hits (%5.1f%%)\n", memo_name[k],
+            ctx->memo_stats.calls[k], ctx->memo_stats.hits[k],
+            ctx->memo_stats.calls[k] > 0 ? 100.0 * ctx->memo_stats.hits[k] / ctx->memo_stats.calls[k] : 0.0);
+}
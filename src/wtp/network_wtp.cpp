@@ -0,0 +1,443 @@
+/* Network_wtp.c -- Distribution network of sampling nodes
+*
+*  A distribution network is a set of sampling nodes fed by the plant
+*  effluent of a process train.  Each node has one residence time or a
+*  residence time distribution given as bins of residence time and
+*  fraction of flow.  The network is read from a file with open_network():
+*
+*      # Comment
+*      Node Site_12
+*        DetTime = 2.5            # days
+*        End
+*      Node Tank_3
+*        RTD = 1.0 0.25           # days, fraction of flow
+*        RTD = 3.0 0.50
+*        RTD = 6.0 0.25
+*        End
+*
+*  dist_network() ages the plant effluent for every node after runmodel()
+*  has run the train.  All bins of all nodes lie on one trajectory of
+*  CFSTRs, the size of the CFSTRs of the shortest bin in dist_dbp(), and
+*  are read off the trajectory in order of residence time, so the network
+*  costs one trajectory plus the DBP equations of each bin rather than
+*  ncstr(1.0) CFSTRs per node.  A node with a residence time distribution
+*  gets the flow weighted average of its bins.
+*
+*  dist_network_quarter() keeps the TTHM and HAA5 of the last four
+*  quarters of each node for the locational running annual average (LRAA).
+*
+*  The following functions are in this file:
+*    open_network()
+*    FreeDistNetwork()
+*    dist_network()
+*    dist_network_quarter()
+*    dist_network_reset()
+*    print_network()
+*/
+#include "wtp.h"
+
+static int point_order(const void *a, const void *b)
+{
+  const struct NetworkPoint *pa = (const struct NetworkPoint *)a;
+  const struct NetworkPoint *pb = (const struct NetworkPoint *)b;
+
+  if (pa->days < pb->days)
+    return (-1);
+  if (pa->days > pb->days)
+    return (1);
+  return (pa->node - pb->node);
+}
+
+static int network_error(FILE *fout, const char *file_name, int line, const char *msg)
+{
+  if (fout != NULL)
+    fprintf(fout, "Error: %s on line %d of %s\n", msg, line, file_name);
+  return (FALSE);
+}
+
+static int read_network(FILE *fp, const char *file_name, struct DistNetwork *net, FILE *fout)
+/*
+*  Purpose: Read the nodes of a network file into 'net'.  Returns
+*           TRUE/FALSE for success/fail.
+*/
+{
+  char buffer[256];
+  char word[NODE_NAME_LEN + 1];
+  char *ptr;
+  struct DistNode *node = NULL;
+  double days, weight, sum;
+  int line = 0, max_nodes = 0, i;
+
+  while (fgets(buffer, sizeof(buffer), fp) != NULL)
+  {
+    line++;
+    if ((ptr = strchr(buffer, '#')) != NULL)
+      *ptr = '\0';
+    ptr = buffer;
+    while (*ptr == ' ' || *ptr == '\t')
+      ptr++;
+    if (*ptr == '\0' || *ptr == '\n' || *ptr == '\r')
+      continue;
+
+    if (strncmp(ptr, "Node", 4) == 0 && (ptr[4] == ' ' || ptr[4] == '\t'))
+    {
+      if (node != NULL)
+        return (network_error(fout, file_name, line, "missing End of node"));
+      if (sscanf(ptr + 4, "%32s", word) != 1 || strlen(word) >= NODE_NAME_LEN)
+        return (network_error(fout, file_name, line, "missing or too long node name"));
+      if (net->n_nodes == max_nodes)
+      {
+        max_nodes = max_nodes > 0 ? 2 * max_nodes : 16;
+        if ((node = (struct DistNode *)realloc(net->node, max_nodes * sizeof(struct DistNode))) == NULL)
+          return (network_error(fout, file_name, line, "out of memory"));
+        net->node = node;
+      }
+      node = &net->node[net->n_nodes++];
+      memset(node, 0, sizeof(struct DistNode));
+      strcpy(node->name, word);
+    }
+    else if (node == NULL)
+    {
+      return (network_error(fout, file_name, line, "expected Node"));
+    }
+    else if (sscanf(ptr, "DetTime = %lf", &days) == 1)
+    {
+      if (node->n_bins != 0)
+        return (network_error(fout, file_name, line, "node has more than one DetTime or RTD"));
+      if (days <= 0.0)
+        return (network_error(fout, file_name, line, "residence time must be positive"));
+      node->days[0] = days;
+      node->weight[0] = 1.0;
+      node->n_bins = -1; /* DetTime, no RTD may follow */
+    }
+    else if (sscanf(ptr, "RTD = %lf %lf", &days, &weight) == 2)
+    {
+      if (node->n_bins < 0)
+        return (network_error(fout, file_name, line, "node has more than one DetTime or RTD"));
+      if (node->n_bins == NODE_MAX_BINS)
+        return (network_error(fout, file_name, line, "too many RTD bins"));
+      if (days <= 0.0 || weight <= 0.0)
+        return (network_error(fout, file_name, line, "RTD residence time and fraction must be positive"));
+      node->days[node->n_bins] = days;
+      node->weight[node->n_bins] = weight;
+      node->n_bins++;
+    }
+    else if (strncmp(ptr, "End", 3) == 0)
+    {
+      if (node->n_bins == 0)
+        return (network_error(fout, file_name, line, "node has no DetTime or RTD"));
+      if (node->n_bins < 0)
+        node->n_bins = 1;
+      sum = 0.0;
+      for (i = 0; i < node->n_bins; i++)
+        sum += node->weight[i];
+      for (i = 0; i < node->n_bins; i++)
+        node->weight[i] /= sum;
+      node = NULL;
+    }
+    else
+    {
+      return (network_error(fout, file_name, line, "unknown input"));
+    }
+  }
+
+  if (node != NULL)
+    return (network_error(fout, file_name, line, "missing End of node"));
+  if (net->n_nodes == 0)
+    return (network_error(fout, file_name, line, "no nodes"));
+  return (TRUE);
+}
+
+int open_network(const char *file_name, struct ProcessTrain *train, FILE *fout)
+/*
+*  Purpose: Read a distribution network from a file into train->network.
+*
+*  Return:
+*    TRUE : the network was loaded, any previous network is released.
+*    FALSE: an error occurred, train->network is unchanged.
+*
+*  Notes:
+*   1. Any error messages are sent to 'fout', which may be NULL.
+*   2. See the top of this file for the format of the file.
+*/
+{
+  FILE *fp;
+  struct DistNetwork *net;
+  int i, j, n;
+
+  if (file_name == NULL || train == NULL)
+    return (FALSE);
+  if ((fp = fopen(file_name, "r")) == NULL)
+  {
+    if (fout != NULL)
+      fprintf(fout, "Could not open %s\n", file_name);
+    return (FALSE);
+  }
+
+  if ((net = (struct DistNetwork *)calloc(1, sizeof(struct DistNetwork))) == NULL)
+  {
+    fclose(fp);
+    return (FALSE);
+  }
+  strncpy(net->file_name, file_name, sizeof(net->file_name) - 1);
+  if (read_network(fp, file_name, net, fout) == FALSE)
+  {
+    fclose(fp);
+    FreeDistNetwork(net);
+    return (FALSE);
+  }
+  fclose(fp);
+
+  /* Bins of all nodes in order of residence time */
+  for (i = 0, n = 0; i < net->n_nodes; i++)
+    n += net->node[i].n_bins;
+  if ((net->point = (struct NetworkPoint *)calloc(n, sizeof(struct NetworkPoint))) == NULL ||
+      (net->sample = AllocUnitProcess(LOCATION_1)) == NULL)
+  {
+    FreeDistNetwork(net);
+    return (FALSE);
+  }
+  for (i = 0; i < net->n_nodes; i++)
+    for (j = 0; j < net->node[i].n_bins; j++)
+    {
+      net->point[net->n_points].days = net->node[i].days[j];
+      net->point[net->n_points].weight = net->node[i].weight[j];
+      net->point[net->n_points].node = i;
+      net->n_points++;
+    }
+  qsort(net->point, net->n_points, sizeof(struct NetworkPoint), point_order);
+
+  FreeDistNetwork(train->network);
+  train->network = net;
+  return (TRUE);
+}
+
+struct DistNetwork *FreeDistNetwork(struct DistNetwork *net)
+/*
+*  Purpose: Release a distribution network.  Returns NULL.
+*/
+{
+  if (net != NULL)
+  {
+    if (net->sample != NULL)
+      FreeUnitProcess(net->sample);
+    free(net->point);
+    free(net->node);
+    free(net);
+  }
+  return (NULL);
+}
+
+int dist_network(struct ProcessTrain *train)
+/*
+*  Purpose: Estimate chlorine decay, THM, and HAA5 at every node of
+*           train->network.
+*
+*  Return:
+*    TRUE/FALSE for success/fail (no network or no unit to feed it).
+*
+*  Notes:
+*   1. runmodel() must have run the train.  The network is fed by the
+*      WTP Effluent, or by the unit before the first sampling point, or
+*      by the last unit of the train.
+*   2. ctx->outputs must include WTP_OUT_TTHM and WTP_OUT_HAA5, as
+*      WTP_OUT_ALL and WTP_OUT_OBJECTIVES do.
+*   3. The shortest bin gets what dist_dbp() computes for a sampling
+*      point with its residence time, unless the longest bin would take
+*      more than NETWORK_MAX_CSTRS of its CFSTRs.  Longer bins are
+*      modelled with more CFSTRs of the same size, see ncstr().
+*/
+{
+  struct WtpContext *ctx = &train->ctx;
+  struct DistNetwork *net = train->network;
+  struct UnitProcess *unit, *source = NULL;
+  struct Effluent *eff, start;
+  struct Cl2DecayCoef coef;
+  struct NetworkPoint *p;
+  struct DistNode *node;
+  double peakfactor = 1.0;
+  double ncstrs, cfstr_time, minutes;
+  double FreeCl2, NH2Cl, hours, clo2_res, clo2_minutes;
+  unsigned need;
+  int i, n = 0, n_p;
+
+  if (net == NULL)
+    return (FALSE);
+
+  /* Plant effluent, as in dist_dbp() */
+  for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit))
+  {
+    if (unit->type == AVG_TAP || unit->type == END_OF_SYSTEM || unit->type == LOCATION_1)
+      break;
+    source = unit;
+    if (unit->type == WTP_EFFLUENT)
+      break;
+  }
+  if (source == NULL)
+    return (FALSE);
+
+  eff = &net->sample->eff;
+  *eff = source->eff;
+  eff->wtp_effluent = source;
+  if (ctx->coldflag == TRUE)
+    peakfactor = eff->Peak / eff->influent->data.influent->avg_flow;
+
+  need = ctx->need;
+  ctx->need = WTP_OUT_TTHM | WTP_OUT_HAA5;
+
+  /* Start of the trajectory, see dist_start() in distdbp3.cpp */
+  if (eff->cl2cnt > 0)
+  {
+    phchange(net->sample, TRUE);
+    cl2decay_start(net->sample, &coef);
+  }
+  start = *eff;
+  FreeCl2 = start.FreeCl2;
+  NH2Cl = start.NH2Cl;
+  hours = start.hours;
+  clo2_res = start.clo2_res;
+  clo2_minutes = start.clo2_minutes;
+
+  /* CFSTRs of the shortest bin, at most NETWORK_MAX_CSTRS to the longest */
+  ncstrs = ncstr(1.0);
+  cfstr_time = net->point[0].days * 1440 / peakfactor / (60.0 * ncstrs);
+  minutes = net->point[net->n_points - 1].days * 1440 / peakfactor;
+  if (cfstr_time < minutes / (60.0 * NETWORK_MAX_CSTRS))
+    cfstr_time = minutes / (60.0 * NETWORK_MAX_CSTRS);
+
+  for (i = 0; i < net->n_nodes; i++)
+  {
+    node = &net->node[i];
+    node->hours = node->FreeCl2 = node->NH2Cl = node->clo2_res = 0.0;
+    node->TTHM = node->HAA5 = 0.0;
+  }
+
+  for (i = 0; i < net->n_points; i++)
+  {
+    p = &net->point[i];
+    minutes = p->days * 1440 / peakfactor;
+    n_p = (int)(minutes / (60.0 * cfstr_time) + 0.5);
+    if (n_p < 1)
+      n_p = 1;
+
+    *eff = start;
+    if (eff->cl2cnt > 0)
+    {
+      eff->FreeCl2 = FreeCl2;
+      eff->NH2Cl = NH2Cl;
+      eff->hours = hours;
+      cl2decay_tanks(eff, &coef, n_p - n, cfstr_time);
+      FreeCl2 = eff->FreeCl2;
+      NH2Cl = eff->NH2Cl;
+      hours = eff->hours;
+      choose_dbpmodel(net->sample);
+    }
+    if (eff->clo2_cntr > 0)
+    {
+      eff->clo2_res = clo2_res;
+      eff->clo2_minutes = clo2_minutes;
+      clo2_cascade(net->sample, n_p - n, 60.0 * cfstr_time);
+      clo2_res = eff->clo2_res;
+      clo2_minutes = eff->clo2_minutes;
+    }
+    n = n_p;
+
+    node = &net->node[p->node];
+    node->hours += p->weight * eff->hours;
+    node->FreeCl2 += p->weight * eff->FreeCl2;
+    node->NH2Cl += p->weight * eff->NH2Cl;
+    node->clo2_res += p->weight * eff->clo2_res;
+    node->TTHM += p->weight * eff->TTHM;
+    node->HAA5 += p->weight * eff->HAA5;
+  }
+
+  ctx->need = need;
+  return (TRUE);
+}
+
+void dist_network_quarter(struct DistNetwork *net)
+/*
+*  Purpose: Record the TTHM and HAA5 of the last dist_network() as the
+*           next quarter of every node and update the LRAA of the nodes
+*           with NODE_QUARTERS quarters recorded.
+*
+*  Notes:
+*   1. The LRAA adds the quarters from the oldest to the newest, as wtp()
+*      does for the End of System.
+*/
+{
+  struct DistNode *node;
+  int i, j, k;
+
+  for (i = 0; i < net->n_nodes; i++)
+  {
+    node = &net->node[i];
+    k = node->n_quarters % NODE_QUARTERS;
+    node->q_TTHM[k] = node->TTHM;
+    node->q_HAA5[k] = node->HAA5;
+    node->n_quarters++;
+    if (node->n_quarters >= NODE_QUARTERS)
+    {
+      node->lraa_TTHM = node->lraa_HAA5 = 0.0;
+      for (j = 0; j < NODE_QUARTERS; j++)
+      {
+        k = (node->n_quarters + j) % NODE_QUARTERS;
+        node->lraa_TTHM += node->q_TTHM[k];
+        node->lraa_HAA5 += node->q_HAA5[k];
+      }
+      node->lraa_TTHM /= NODE_QUARTERS;
+      node->lraa_HAA5 /= NODE_QUARTERS;
+    }
+  }
+}
+
+void dist_network_reset(struct DistNetwork *net)
+/*
+*  Purpose: Forget the quarters recorded by dist_network_quarter(), as at
+*           the start of a new influent time series.
+*/
+{
+  int i;
+
+  for (i = 0; i < net->n_nodes; i++)
+  {
+    net->node[i].n_quarters = 0;
+    net->node[i].lraa_TTHM = 0.0;
+    net->node[i].lraa_HAA5 = 0.0;
+  }
+}
+
+int print_network(FILE *fout, struct DistNetwork *net)
+/*
+*  Purpose: Print the results of the last dist_network() for every node.
+*           Returns TRUE/FALSE for success/fail.
+*/
+{
+  struct DistNode *node;
+  double days;
+  int e = 0, i, j;
+
+  e |= fprintf(fout, "\r\n");
+  e |= fprintf(fout, "Distribution Network: %s\r\n", net->file_name);
+  e |= fprintf(fout, "-----------------------------------------------------------------------------\r\n");
+  e |= fprintf(fout, "Node                  Age  Free Cl2   NH2Cl     TTHM     HAA5   LRAA TTHM  HAA5\r\n");
+  e |= fprintf(fout, "                   (days) (mg/L as Cl2)      (ug/L)   (ug/L)      (ug/L)      \r\n");
+  e |= fprintf(fout, "-----------------------------------------------------------------------------\r\n");
+  for (i = 0; i < net->n_nodes; i++)
+  {
+    node = &net->node[i];
+    for (j = 0, days = 0.0; j < node->n_bins; j++)
+      days += node->weight[j] * node->days[j];
+    e |= fprintf(fout, "%-18s%7.2f%9.2f%9.2f%9.0f%9.0f", node->name, days,
+                 node->FreeCl2 * MW_Cl2, node->NH2Cl * MW_Cl2, node->TTHM, node->HAA5);
+    if (node->n_quarters >= NODE_QUARTERS)
+      e |= fprintf(fout, "%10.0f%6.0f\r\n", node->lraa_TTHM, node->lraa_HAA5);
+    else
+      e |= fprintf(fout, "\r\n");
+  }
+  e |= fprintf(fout, "-----------------------------------------------------------------------------\r\n");
+
+  if (e < 0)
+    return (FALSE);
+  return (TRUE);
+}
@@ -60,6 +60,7 @@ void nf_rmv(struct UnitProcess *unit)
 
   struct Nf *nf;
   struct Effluent *eff;
+  const struct ThermoCoef *coef;
 
   if (unit == NULL || unit->data.ptr == NULL || unit->type != NF_UP)
     return;
@@ -85,15 +86,16 @@ void nf_rmv(struct UnitProcess *unit)
   pH = eff->pH;
 
   /* Temperature and PChem Coeffieients: */
-  kw = Kw(eff->DegK);
-  k1 = K_HCO3(eff->DegK);
-  k2 = K_CO3(eff->DegK);
-  k_hocl = K_HOCl(eff->DegK);
-  k_nh3 = K_NH3(eff->DegK);
-  k_mgoh = K_MgOH(eff->DegK);
-  k_mgoh2aq = K_MgOH2aq(eff->DegK);
-  k_caoh = K_CaOH(eff->DegK);
-  k_caoh2aq = K_CaOH2aq(eff->DegK);
+  coef = thermo_coef(eff->ctx, eff->DegK);
+  kw = coef->kw;
+  k1 = coef->k1;
+  k2 = coef->k2;
+  k_hocl = coef->k_hocl;
+  k_nh3 = coef->k_nh3;
+  k_mgoh = coef->k_mgoh;
+  k_mgoh2aq = coef->k_mgoh2aq;
+  k_caoh = coef->k_caoh;
+  k_caoh2aq = coef->k_caoh2aq;
 
   /* Some Protection/Range-Checking */
   if (recovery < 1.0)
@@ -161,7 +163,7 @@ void nf_rmv(struct UnitProcess *unit)
   hardness = ca * MW_CaCO3 + mg * MW_CaCO3;
   if (hardness > 0.0)
   {
-    term = exp(36.801 - 3.327 * log(hardness) - 6.787 * log(mwc) - 0.027 * recovery * log(hardness) + 0.229 * log(recovery) * log(hardness) * log(mwc));
+    term = wtp_exp(36.801 - 3.327 * wtp_log(hardness) - 6.787 * wtp_log(mwc) - 0.027 * recovery * wtp_log(hardness) + 0.229 * wtp_log(recovery) * wtp_log(hardness) * wtp_log(mwc));
     removal = 1 / (term + 1.0);
 
     /* Calculate Ca */
@@ -183,7 +185,7 @@ void nf_rmv(struct UnitProcess *unit)
   alk = alk_equ * MW_CaCO3 / 2; /* (alk is mg/L as CaCO3 ) */
   if (alk > 0.0)
   {
-    term = exp(14.602 - 1.667 * log(mwc) - 0.054 * log(alk) * log(mwc) - 0.203 * log(recovery) * log(mwc));
+    term = wtp_exp(14.602 - 1.667 * wtp_log(mwc) - 0.054 * wtp_log(alk) * wtp_log(mwc) - 0.203 * wtp_log(recovery) * wtp_log(mwc));
     removal = 1 / (term + 1.0);
 
     effluent_term = treat_fraction * recovery / 100.0 * alk * (1.0 - removal);
@@ -197,7 +199,7 @@ void nf_rmv(struct UnitProcess *unit)
 
   /*  Assume pH does not change through membrane. Use new alk. and inf. pH to
       calculate new total carbonate concentration */
-  H = pow(10.0, -(pH));
+  H = wtp_exp10(-(pH));
   co3_term = ((k1 * H) + (2 * k1 * k2)) / ((H * H) + (k1 * H) + (k1 * k2));
   co3 = (alk_equ - kw / H + H) / co3_term;
 
@@ -12,7 +12,8 @@ int open_wtp(
 *  Purpose: Read process train data from a file into 'train'.
 *
 *  Input:
-*    file_name : Must be a valid existing file.
+*    file_name : Must be a valid existing file, a text .wtp file or a
+*                binary snapshot of save_snapshot().
 *
 *  Return:
 *    TRUE : file was successfully loaded into train.
@@ -35,7 +36,7 @@ int open_wtp(
 
   if (file_name != NULL && strlen(file_name) > 0)
   {
-    fp = fopen(file_name, "r");
+    fp = fopen(file_name, "rb");
     if (fp == NULL)
     {
       if (fout != NULL)
@@ -123,13 +123,13 @@ void ozonate(struct UnitProcess *unit)
 
     if (o3_dose > 0.0 && eff_time > inf_time)
     {
-      term1 = pow(o3_dose, 1.312);
-      term2 = pow((o3_dose / uv), -0.386);
-      term3 = pow(tsuva, -0.184);
-      term4 = pow(alk, 0.023);
-      term5 = pow(pH, 0.229);
-      term6 = pow(temp, 0.087);
-      term7 = pow(eff_time, 0.068) - pow(inf_time, 0.068);
+      term1 = wtp_pow(o3_dose, 1.312);
+      term2 = wtp_pow((o3_dose / uv), -0.386);
+      term3 = wtp_pow(tsuva, -0.184);
+      term4 = wtp_pow(alk, 0.023);
+      term5 = wtp_pow(pH, 0.229);
+      term6 = wtp_pow(temp, 0.087);
+      term7 = wtp_pow(eff_time, 0.068) - wtp_pow(inf_time, 0.068);
       o3_demand = 0.996 * term1 * term2 * term3 * term4 * term5 * term6 * term7;
       K_o3_decay = o3_demand / term7; //to support CT calc.
     }
@@ -166,72 +166,75 @@ void ozonate(struct UnitProcess *unit)
 
     /*************************BEGIN Bromate Calculations *********************************/
 
-    /* Estimate effluent bromate concentration from this process based upon
-     bromate and WQ at last point of ozonation and in unit process.  Model for
-     bromate from Jinsik Sohn, Univ. of Colorado, 1998.  Model for ozone
-     demand from G. Solarik, 2001 */
-
-    if (br > 0.0 && t_mean > 0.0 && o3_dose > 0.0 && o3_eff > 0.0)
-    { /* Bromate can form */
-
-      /* First, calculate the estimate based on the model with ammonia */
-      term1 = pow(uv, -0.593);
-      term2 = pow(pH, 5.81);
-      term3 = pow(o3_dose, 1.28);
-      term4 = pow(br, 0.94);
-      term5 = pow(alk, -0.167);
-      term6 = pow(1.035, (temp - 20));
-      term7 = pow(nh3_n, -0.051);
-      term8 = pow(eff_time, 0.337) - pow(inf_time, 0.337);
-      delta_bro3_wnh3 = 8.71 * pow(10, -8.0) * term1 * term2 * term3 * term4 * term5 * term6 * term7 * term8;
-
-      /* Next, calculate the estimate based on the model without ammonia */
-      term1 = pow(uv, -0.623);
-      term2 = pow(pH, 5.68);
-      term3 = pow(o3_dose, 1.31);
-      term4 = pow(br, 0.96);
-      term5 = pow(alk, -0.201);
-      term6 = pow(1.035, (temp - 20));
-      term7 = pow(eff_time, 0.336) - pow(inf_time, 0.336);
-      delta_bro3_wonh3 = 1.19 * pow(10, -7.0) * term1 * term2 * term3 * term4 * term5 * term6 * term7;
-
-      if (nh3_n > 0.1)
-      { /* Use "Model with ammonia" only if it gives a lower bromate result than the
-	     "Model without ammonia" */
-        if (delta_bro3_wnh3 < delta_bro3_wonh3)
-          delta_bro3 = delta_bro3_wnh3;
+    if ((eff->ctx->need & WTP_OUT_BROMATE) != 0)
+    { /* Skipped when neither asked for nor read downstream, see out_need() */
+      /* Estimate effluent bromate concentration from this process based upon
+       bromate and WQ at last point of ozonation and in unit process.  Model for
+       bromate from Jinsik Sohn, Univ. of Colorado, 1998.  Model for ozone
+       demand from G. Solarik, 2001 */
+
+      if (br > 0.0 && t_mean > 0.0 && o3_dose > 0.0 && o3_eff > 0.0)
+      { /* Bromate can form */
+
+        /* First, calculate the estimate based on the model with ammonia */
+        term1 = wtp_pow(uv, -0.593);
+        term2 = wtp_pow(pH, 5.81);
+        term3 = wtp_pow(o3_dose, 1.28);
+        term4 = wtp_pow(br, 0.94);
+        term5 = wtp_pow(alk, -0.167);
+        term6 = wtp_pow(1.035, (temp - 20));
+        term7 = wtp_pow(nh3_n, -0.051);
+        term8 = wtp_pow(eff_time, 0.337) - wtp_pow(inf_time, 0.337);
+        delta_bro3_wnh3 = 8.71 * pow(10, -8.0) * term1 * term2 * term3 * term4 * term5 * term6 * term7 * term8;
+
+        /* Next, calculate the estimate based on the model without ammonia */
+        term1 = wtp_pow(uv, -0.623);
+        term2 = wtp_pow(pH, 5.68);
+        term3 = wtp_pow(o3_dose, 1.31);
+        term4 = wtp_pow(br, 0.96);
+        term5 = wtp_pow(alk, -0.201);
+        term6 = wtp_pow(1.035, (temp - 20));
+        term7 = wtp_pow(eff_time, 0.336) - wtp_pow(inf_time, 0.336);
+        delta_bro3_wonh3 = 1.19 * pow(10, -7.0) * term1 * term2 * term3 * term4 * term5 * term6 * term7;
+
+        if (nh3_n > 0.1)
+        { /* Use "Model with ammonia" only if it gives a lower bromate result than the
+  	     "Model without ammonia" */
+          if (delta_bro3_wnh3 < delta_bro3_wonh3)
+            delta_bro3 = delta_bro3_wnh3;
+          else
+            delta_bro3 = delta_bro3_wonh3;
+        }
         else
+        { /* Use "Model without ammonia" */
           delta_bro3 = delta_bro3_wonh3;
-      }
-      else
-      { /* Use "Model without ammonia" */
-        delta_bro3 = delta_bro3_wonh3;
-      } /* End "if/else (nh3_n > 0.1)" */
+        } /* End "if/else (nh3_n > 0.1)" */
 
-      //   Apply bromate correction factor based on Spyros' and Zaid's pilot data analysis
-      delta_bro3 /= 2.52; /* R^2=0.80 */
+        //   Apply bromate correction factor based on Spyros' and Zaid's pilot data analysis
+        delta_bro3 /= 2.52; /* R^2=0.80 */
 
-      //Calculate first estimate of effluent bromate concentration
-      bro3_out = bro3_in + delta_bro3;
+        //Calculate first estimate of effluent bromate concentration
+        bro3_out = bro3_in + delta_bro3;
 
-      // Set stoichiometric max. based on bromide available to convert
-      if ((bro3_out * 0.625) > br)
-        bro3_out = (br / 0.625);
+        // Set stoichiometric max. based on bromide available to convert
+        if ((bro3_out * 0.625) > br)
+          bro3_out = (br / 0.625);
 
-      //Make sure result is reasonable
-      if (bro3_out < bro3_in)
-        bro3_out = bro3_in;
+        //Make sure result is reasonable
+        if (bro3_out < bro3_in)
+          bro3_out = bro3_in;
 
-    } /* End "if(br > 0.0 && time > 0.0 && o3_dose > 0.0)" */
+      } /* End "if(br > 0.0 && time > 0.0 && o3_dose > 0.0)" */
 
-    //Update UnitProcess data structure
-    eff->BrO3 = bro3_out;
+      //Update UnitProcess data structure
+      eff->BrO3 = bro3_out;
 
-    /* Estimate effluent bromide concentration in process effluent and enforce limits*/
-    br_out = br_in - 0.625 * delta_bro3;
-    if (br_out < 0.0)
-      br_out = 0.0;
-    eff->Br = br_out / 1000.0 / MW_Br; /* Convert from ug/L to Moles/L */
+      /* Estimate effluent bromide concentration in process effluent and enforce limits*/
+      br_out = br_in - 0.625 * delta_bro3;
+      if (br_out < 0.0)
+        br_out = 0.0;
+      eff->Br = br_out / 1000.0 / MW_Br; /* Convert from ug/L to Moles/L */
+    }
 
     //***************************************End Bromate Calcs*********************************************
 
@@ -1,6 +1,531 @@
 /* pHChange.c -- September 2, 1993 */
 #include "wtp.h"
 
+#define PH_LO 3.0      /* pH search range                               */
+#define PH_HI 13.0
+#define PH_TOL 1.0e-8  /* Convergence of the pH iteration               */
+#define PH_MAX_ITER 100
+#define PH_NKEY 13     /* Inputs memoized, see ph_key()                 */
+#define PH_NOUT 8      /* Outputs memoized                              */
+
+struct PhSpecies
+{                     /* Charge balance at one pH                      */
+  double H;           /* [H+]                                 (Mole/L) */
+  double OH;          /* [OH-]                                (Mole/L) */
+  double CO3;         /* [CO3--]                              (Mole/L) */
+  double HCO3;        /* [HCO3-]                              (Mole/L) */
+  double Ca_aq;       /* Dissolved calcium after precipitation (Mole/L) */
+  double Mg_aq;       /* Dissolved magnesium                  (Mole/L) */
+  double CO3_aq;      /* Dissolved carbonate                  (Mole/L) */
+  double CaCO3_floc;  /* CaCO3 floc                           (Mole/L) */
+  double MgOH2_floc;  /* Mg(OH)2 floc                         (Mole/L) */
+  double f;           /* cations - anions                      (equ/L) */
+  double df;          /* d(f)/d(pH)                            (equ/L) */
+};
+
+struct PhSpeciesLanes
+{ /* struct PhSpecies of each lane of a batch, see solve_pH_lanes() */
+  double H[WTP_LANES];
+  double OH[WTP_LANES];
+  double CO3[WTP_LANES];
+  double HCO3[WTP_LANES];
+  double Ca_aq[WTP_LANES];
+  double Mg_aq[WTP_LANES];
+  double CO3_aq[WTP_LANES];
+  double CaCO3_floc[WTP_LANES];
+  double MgOH2_floc[WTP_LANES];
+  double f[WTP_LANES];
+  double df[WTP_LANES];
+};
+
+struct ThermoLanes
+{ /* struct ThermoCoef of each lane of a batch */
+  double kw[WTP_LANES], k1[WTP_LANES], k2[WTP_LANES], k_hocl[WTP_LANES], k_nh3[WTP_LANES];
+  double k_mgoh[WTP_LANES], k_mgoh2[WTP_LANES], k_mgoh2aq[WTP_LANES];
+  double k_caoh[WTP_LANES], k_caco3[WTP_LANES], k_caoh2aq[WTP_LANES];
+};
+
+static void store_phcache(struct PhCache *c, const struct Effluent *eff)
+{
+  c->pH = eff->pH;
+  c->DegK = eff->DegK;
+  c->Ca_aq = eff->Ca_aq;
+  c->Ca_solid = eff->Ca_solid;
+  c->Mg_aq = eff->Mg_aq;
+  c->Mg_solid = eff->Mg_solid;
+  c->CO2_aq = eff->CO2_aq;
+  c->NH3 = eff->NH3;
+  c->FreeCl2 = eff->FreeCl2;
+  c->CBminusCA = eff->CBminusCA;
+}
+
+static void ph_key(double key[PH_NKEY], short flag, short limesoftening, int softflag,
+                   double pH, double DegK, double Ca_aq, double Ca_solid,
+                   double Mg_aq, double Mg_solid, double CO2_aq,
+                   double NH3, double FreeCl2, double CBminusCA)
+/*
+*  Purpose: Collect the inputs of phchange() for memo_find().  The outputs
+*           are kept in the order Alk, pH, Ca_aq, Ca_solid, Mg_aq,
+*           Mg_solid, CO2_aq, CBminusCA.
+*/
+{
+  key[0] = flag;
+  key[1] = limesoftening;
+  key[2] = softflag; /* Read by f_adj_pH() */
+  key[3] = pH;
+  key[4] = DegK;
+  key[5] = Ca_aq;
+  key[6] = Ca_solid;
+  key[7] = Mg_aq;
+  key[8] = Mg_solid;
+  key[9] = CO2_aq;
+  key[10] = NH3;
+  key[11] = FreeCl2;
+  key[12] = CBminusCA;
+}
+
+static void charge_balance(const struct ThermoCoef *k, double pH,
+                           double Ca_total, double Mg_total, double CO3_total,
+                           double NH3, double FreeCl2, double CBminusCA,
+                           int precip, struct PhSpecies *s)
+/*
+*  Purpose: Speciate the water at 'pH' and return the charge balance and
+*           its derivative with respect to pH in 's'.
+*
+*  Inputs:
+*    Ca_total, Mg_total, CO3_total = Mass balances including floc (Mole/L)
+*    precip = TRUE to precipitate CaCO3 and Mg(OH)2 when their solubility
+*             products are exceeded.
+*
+*  Notes:
+*   1. Any floc is assumed dissolved, then the solubility products are
+*      checked (eq A-70 through A-78).
+*   2. The derivatives are taken with respect to h=[H+] term by term and
+*      converted with d(h)/d(pH) = -ln(10)*h.  They include the dependence
+*      of the dissolved calcium, magnesium, and carbonate on pH when a
+*      solid precipitates.
+*/
+{
+  double h = wtp_exp10(-pH);
+  double h2 = h * h;
+  double D, dD;           /* [H2CO3*]/CT denominator and d/dh   */
+  double a_CO3, da_CO3;   /* [CO3--]/CT                        */
+  double a_HCO3, da_HCO3; /* [HCO3-]/CT                        */
+  double E, dE;
+  double a_Ca, da_Ca;     /* [Ca++]/Ca_aq                      */
+  double a_Mg, da_Mg;     /* [Mg++]/Mg_aq                      */
+  double CO3_aq, dCO3_aq, Ca_aq, dCa_aq, Mg_aq, dMg_aq;
+  double Ca, dCa, Mg, dMg, dCO3, dHCO3, dOH;
+  double CaOH, dCaOH, MgOH, dMgOH, OCl, dOCl, NH4, dNH4;
+  double b, c, p, dp, r;
+
+  /* These are a function of pH and temperature.. Not concentrations. */
+  D = h2 + k->k1 * h + k->k1 * k->k2;
+  dD = 2.0 * h + k->k1;
+  a_CO3 = k->k1 * k->k2 / D; /* A-30 */
+  da_CO3 = -a_CO3 * dD / D;
+  a_HCO3 = k->k1 * h / D; /* A-30 */
+  da_HCO3 = (k->k1 - a_HCO3 * dD) / D;
+
+  E = 1.0 + k->k_caoh / h + k->k_caoh2aq / h2; /* A-48 */
+  dE = -k->k_caoh / h2 - 2.0 * k->k_caoh2aq / (h2 * h);
+  a_Ca = 1.0 / E;
+  da_Ca = -a_Ca * a_Ca * dE;
+
+  E = 1.0 + k->k_mgoh / h + k->k_mgoh2aq / h2; /* Eq A-52 */
+  dE = -k->k_mgoh / h2 - 2.0 * k->k_mgoh2aq / (h2 * h);
+  a_Mg = 1.0 / E;
+  da_Mg = -a_Mg * a_Mg * dE;
+
+  s->H = h;
+  s->OH = k->kw / h;
+  dOH = -s->OH / h;
+
+  /* Determine if CaCO3 controls solubility of [Ca++] and [CO3--]. */
+  CO3_aq = CO3_total;
+  Ca_aq = Ca_total;
+  dCO3_aq = 0.0;
+  dCa_aq = 0.0;
+  s->CaCO3_floc = 0.0;
+  if (precip == TRUE && (Ca_aq * a_Ca) * (CO3_aq * a_CO3) > k->k_caco3)
+  { /* Estimate CO3_aq using eq A-70 through A-73. */
+    p = a_CO3 * a_Ca;
+    dp = da_CO3 * a_Ca + a_CO3 * da_Ca;
+    b = Ca_total - CO3_total;
+    c = -k->k_caco3 / p;
+    r = sqrt((b * b) - (4 * c));
+    CO3_aq = (-b + r) / 2.0;
+    dCO3_aq = -(k->k_caco3 * dp / (p * p)) / r;
+    s->CaCO3_floc = CO3_total - CO3_aq;
+    Ca_aq = Ca_total - s->CaCO3_floc;
+    dCa_aq = dCO3_aq;
+  }
+  s->CO3 = CO3_aq * a_CO3;
+  dCO3 = dCO3_aq * a_CO3 + CO3_aq * da_CO3;
+  Ca = Ca_aq * a_Ca;
+  dCa = dCa_aq * a_Ca + Ca_aq * da_Ca;
+
+  /* Determine if Mg(OH)2 controls solubility of magnesium. */
+  Mg_aq = Mg_total;
+  dMg_aq = 0.0;
+  s->MgOH2_floc = 0.0;
+  if (precip == TRUE && (Mg_aq * a_Mg / h2) > k->k_mgoh2) /* Eq A-75 */
+  {
+    Mg_aq = k->k_mgoh2 * (h2 + h * k->k_mgoh + k->k_mgoh2aq); /* Eq A-78 */
+    dMg_aq = k->k_mgoh2 * (2.0 * h + k->k_mgoh);
+    s->MgOH2_floc = Mg_total - Mg_aq;
+  }
+  Mg = Mg_aq * a_Mg;
+  dMg = dMg_aq * a_Mg + Mg_aq * da_Mg;
+
+  /* Other Ions tracked by WTP */
+  s->HCO3 = CO3_aq * a_HCO3; /* A-30 */
+  dHCO3 = dCO3_aq * a_HCO3 + CO3_aq * da_HCO3;
+  CaOH = Ca * k->k_caoh / h; /* A-40 */
+  dCaOH = k->k_caoh * (dCa - Ca / h) / h;
+  MgOH = Mg * k->k_mgoh / h; /* A-41 */
+  dMgOH = k->k_mgoh * (dMg - Mg / h) / h;
+  OCl = FreeCl2 / (1 + (h / k->k_hocl)); /* A-56 */
+  dOCl = -OCl / (k->k_hocl + h);
+  NH4 = NH3 / (1 + (k->k_nh3 / h)); /* A-60 */
+  dNH4 = NH4 * k->k_nh3 / (h * (h + k->k_nh3));
+
+  s->Ca_aq = Ca_aq;
+  s->Mg_aq = Mg_aq;
+  s->CO3_aq = CO3_aq;
+
+  /* cations - anions (equ/L) */
+  s->f = (CBminusCA + h + 2 * Ca + CaOH + 2 * Mg + MgOH + NH4) -
+         (s->OH + s->HCO3 + 2 * s->CO3 + OCl);
+  s->df = (1.0 + 2 * dCa + dCaOH + 2 * dMg + dMgOH + dNH4 -
+           dOH - dHCO3 - 2 * dCO3 - dOCl) *
+          (-log(10.0) * h);
+}
+
+static double solve_pH(const struct ThermoCoef *k, double seed,
+                       double Ca_total, double Mg_total, double CO3_total,
+                       double NH3, double FreeCl2, double CBminusCA,
+                       int precip, struct PhSpecies *s)
+/*
+*  Purpose: Find the pH between PH_LO and PH_HI at which the charge balance
+*           is zero.  Returns the pH; 's' holds the speciation at that pH.
+*
+*  Method:
+*    Newton-Raphson in pH (= -log[H+]) with the analytic derivative from
+*    charge_balance(), started from 'seed', normally the pH of the
+*    previous unit process.  Every evaluation narrows the bracket
+*    [lo_pH,hi_pH] by the sign of the charge balance, which falls as pH
+*    rises, and a bisection step of the bracket is taken in place of any
+*    Newton step that leaves the bracket or does not halve the step before
+*    it.  The precipitation of CaCO3 and Mg(OH)2 makes the charge balance
+*    kinked where a solid appears; those cases fall back to bisection
+*    until Newton takes hold again.  If there is no root in the range the
+*    bracket collapses onto PH_LO or PH_HI, as the bisection search did.
+*/
+{
+  double lo_pH = PH_LO, hi_pH = PH_HI;
+  double pH, next, dx, dx_old = PH_HI - PH_LO;
+  int iter;
+
+  pH = (seed > lo_pH && seed < hi_pH) ? seed : (lo_pH + hi_pH) / 2;
+
+  for (iter = 0; iter < PH_MAX_ITER; iter++)
+  {
+    charge_balance(k, pH, Ca_total, Mg_total, CO3_total, NH3, FreeCl2, CBminusCA, precip, s);
+    if (s->f == 0.0)
+      break;
+    if (s->f > 0)
+      lo_pH = pH;
+    else
+      hi_pH = pH;
+
+    dx = s->df < 0.0 ? -s->f / s->df : 0.0;
+    next = pH + dx;
+    if (s->df >= 0.0 || next <= lo_pH || next >= hi_pH || fabs(2.0 * dx) > fabs(dx_old))
+    { /* Bisect */
+      next = (lo_pH + hi_pH) / 2;
+      dx = next - pH;
+    }
+    if (fabs(dx) < PH_TOL || (hi_pH - lo_pH) < PH_TOL)
+      break;
+    dx_old = dx;
+    pH = next;
+  }
+
+  return (pH);
+}
+
+static void charge_balance_lanes(const struct ThermoLanes *k, int n, const double pH[],
+                                 const double Ca_total[], const double Mg_total[], const double CO3_total[],
+                                 const double NH3[], const double FreeCl2[], const double CBminusCA[],
+                                 const int precip[], struct PhSpeciesLanes *s)
+/*
+*  Purpose: charge_balance() for lanes 0 to n-1 of a batch.
+*
+*  Notes:
+*   1. The branches of charge_balance() where CaCO3 or Mg(OH)2 precipitate
+*      are computed in every lane and selected by a lane mask, so the loop
+*      has no branch.  g++ vectorizes it, and the Newton step of
+*      solve_pH_lanes(), with -O3 -mavx2 -fno-math-errno -fno-trapping-math
+*      (sqrt() may set errno, and a division may not be moved out of a
+*      branch unless traps are off).  The operations
+*      are those of charge_balance() in the same order, so each lane gets
+*      the bits of charge_balance().
+*   2. [H+] is computed by wtp_exp10_n(), which returns the values of
+*      wtp_exp10().
+*/
+{
+  double x[WTP_LANES], h_lane[WTP_LANES];
+  int l;
+
+  for (l = 0; l < n; l++)
+    x[l] = -pH[l];
+  wtp_exp10_n(n, x, h_lane);
+
+  for (l = 0; l < n; l++)
+  {
+    double h = h_lane[l];
+    double h2 = h * h;
+    double D, dD, a_CO3, da_CO3, a_HCO3, da_HCO3, E, dE, a_Ca, da_Ca, a_Mg, da_Mg;
+    double CO3_aq, dCO3_aq, Ca_aq, dCa_aq, Mg_aq, dMg_aq, CaCO3_floc, MgOH2_floc;
+    double Ca, dCa, Mg, dMg, CO3, dCO3, HCO3, dHCO3, OH, dOH;
+    double CaOH, dCaOH, MgOH, dMgOH, OCl, dOCl, NH4, dNH4;
+    double b, c, p, dp, r, f, df;
+    int caco3, mgoh2; /* Lane masks of the precipitation */
+
+    D = h2 + k->k1[l] * h + k->k1[l] * k->k2[l];
+    dD = 2.0 * h + k->k1[l];
+    a_CO3 = k->k1[l] * k->k2[l] / D; /* A-30 */
+    da_CO3 = -a_CO3 * dD / D;
+    a_HCO3 = k->k1[l] * h / D; /* A-30 */
+    da_HCO3 = (k->k1[l] - a_HCO3 * dD) / D;
+
+    E = 1.0 + k->k_caoh[l] / h + k->k_caoh2aq[l] / h2; /* A-48 */
+    dE = -k->k_caoh[l] / h2 - 2.0 * k->k_caoh2aq[l] / (h2 * h);
+    a_Ca = 1.0 / E;
+    da_Ca = -a_Ca * a_Ca * dE;
+
+    E = 1.0 + k->k_mgoh[l] / h + k->k_mgoh2aq[l] / h2; /* Eq A-52 */
+    dE = -k->k_mgoh[l] / h2 - 2.0 * k->k_mgoh2aq[l] / (h2 * h);
+    a_Mg = 1.0 / E;
+    da_Mg = -a_Mg * a_Mg * dE;
+
+    OH = k->kw[l] / h;
+    dOH = -OH / h;
+
+    /* CaCO3 controls [Ca++] and [CO3--]: eq A-70 through A-73 */
+    caco3 = (precip[l] == TRUE) & ((Ca_total[l] * a_Ca) * (CO3_total[l] * a_CO3) > k->k_caco3[l]);
+    p = a_CO3 * a_Ca;
+    dp = da_CO3 * a_Ca + a_CO3 * da_Ca;
+    b = Ca_total[l] - CO3_total[l];
+    c = -k->k_caco3[l] / p;
+    r = sqrt((b * b) - (4 * c));
+    CO3_aq = (-b + r) / 2.0;
+    dCO3_aq = -(k->k_caco3[l] * dp / (p * p)) / r;
+    CaCO3_floc = CO3_total[l] - CO3_aq;
+    CO3_aq = caco3 ? CO3_aq : CO3_total[l];
+    dCO3_aq = caco3 ? dCO3_aq : 0.0;
+    CaCO3_floc = caco3 ? CaCO3_floc : 0.0;
+    Ca_aq = Ca_total[l] - CaCO3_floc;
+    Ca_aq = caco3 ? Ca_aq : Ca_total[l];
+    dCa_aq = dCO3_aq;
+    CO3 = CO3_aq * a_CO3;
+    dCO3 = dCO3_aq * a_CO3 + CO3_aq * da_CO3;
+    Ca = Ca_aq * a_Ca;
+    dCa = dCa_aq * a_Ca + Ca_aq * da_Ca;
+
+    /* Mg(OH)2 controls magnesium: eq A-75 through A-78 */
+    mgoh2 = (precip[l] == TRUE) & ((Mg_total[l] * a_Mg / h2) > k->k_mgoh2[l]);
+    Mg_aq = k->k_mgoh2[l] * (h2 + h * k->k_mgoh[l] + k->k_mgoh2aq[l]);
+    dMg_aq = k->k_mgoh2[l] * (2.0 * h + k->k_mgoh[l]);
+    MgOH2_floc = Mg_total[l] - Mg_aq;
+    Mg_aq = mgoh2 ? Mg_aq : Mg_total[l];
+    dMg_aq = mgoh2 ? dMg_aq : 0.0;
+    MgOH2_floc = mgoh2 ? MgOH2_floc : 0.0;
+    Mg = Mg_aq * a_Mg;
+    dMg = dMg_aq * a_Mg + Mg_aq * da_Mg;
+
+    HCO3 = CO3_aq * a_HCO3; /* A-30 */
+    dHCO3 = dCO3_aq * a_HCO3 + CO3_aq * da_HCO3;
+    CaOH = Ca * k->k_caoh[l] / h; /* A-40 */
+    dCaOH = k->k_caoh[l] * (dCa - Ca / h) / h;
+    MgOH = Mg * k->k_mgoh[l] / h; /* A-41 */
+    dMgOH = k->k_mgoh[l] * (dMg - Mg / h) / h;
+    OCl = FreeCl2[l] / (1 + (h / k->k_hocl[l])); /* A-56 */
+    dOCl = -OCl / (k->k_hocl[l] + h);
+    NH4 = NH3[l] / (1 + (k->k_nh3[l] / h)); /* A-60 */
+    dNH4 = NH4 * k->k_nh3[l] / (h * (h + k->k_nh3[l]));
+
+    f = (CBminusCA[l] + h + 2 * Ca + CaOH + 2 * Mg + MgOH + NH4) -
+        (OH + HCO3 + 2 * CO3 + OCl);
+    df = (1.0 + 2 * dCa + dCaOH + 2 * dMg + dMgOH + dNH4 -
+          dOH - dHCO3 - 2 * dCO3 - dOCl) *
+         (-log(10.0) * h);
+
+    s->H[l] = h;
+    s->OH[l] = OH;
+    s->CO3[l] = CO3;
+    s->HCO3[l] = HCO3;
+    s->Ca_aq[l] = Ca_aq;
+    s->Mg_aq[l] = Mg_aq;
+    s->CO3_aq[l] = CO3_aq;
+    s->CaCO3_floc[l] = CaCO3_floc;
+    s->MgOH2_floc[l] = MgOH2_floc;
+    s->f[l] = f;
+    s->df[l] = df;
+  }
+}
+
+static void solve_pH_lanes(const struct ThermoLanes *k, struct EffluentLanes *w, struct PhSpeciesLanes *s)
+/*
+*  Purpose: solve_pH() for the lanes of 'w' with mask[] TRUE.  w->pH holds
+*           the seeds on entry and the roots on return; 's' holds the
+*           speciation at the roots.
+*
+*  Method:
+*    The iteration of solve_pH() runs in all lanes at once.  Each lane has
+*    its own bracket and step, and leaves the iteration (active[] FALSE)
+*    where solve_pH() would break out of it, after which its pH is left as
+*    it is.  Its charge balance is still evaluated with the others, at the
+*    same pH, which gives the same speciation.  The iteration ends when no
+*    lane is active or after PH_MAX_ITER steps, so every lane takes the
+*    steps of solve_pH() and gets its result, bit for bit.
+*/
+{
+  double Ca_total[WTP_LANES], Mg_total[WTP_LANES], CO3_total[WTP_LANES];
+  double lo_pH[WTP_LANES], hi_pH[WTP_LANES], dx_old[WTP_LANES];
+  int precip[WTP_LANES], active[WTP_LANES];
+  int n = w->n, n_active = n, iter, l;
+
+  for (l = 0; l < n; l++)
+  {
+    Ca_total[l] = w->Ca_aq[l] + w->Ca_solid[l];
+    Mg_total[l] = w->Mg_aq[l] + w->Mg_solid[l];
+    CO3_total[l] = w->CO2_aq[l] + w->Ca_solid[l];
+    precip[l] = w->limesoftening[l] == TRUE;
+    lo_pH[l] = PH_LO;
+    hi_pH[l] = PH_HI;
+    dx_old[l] = PH_HI - PH_LO;
+    w->pH[l] = (w->pH[l] > lo_pH[l] && w->pH[l] < hi_pH[l]) ? w->pH[l] : (lo_pH[l] + hi_pH[l]) / 2;
+    active[l] = w->mask[l];
+  }
+
+  for (iter = 0; iter < PH_MAX_ITER && n_active > 0; iter++)
+  {
+    charge_balance_lanes(k, n, w->pH, Ca_total, Mg_total, CO3_total, w->NH3, w->FreeCl2, w->CBminusCA,
+                         precip, s);
+    n_active = 0;
+    for (l = 0; l < n; l++)
+    {
+      double f = s->f[l], df = s->df[l], pH = w->pH[l], lo = lo_pH[l], hi = hi_pH[l];
+      double next, dx, mid;
+      int go = active[l] & (f != 0.0), bisect;
+
+      lo = (go & (f > 0)) ? pH : lo;
+      hi = (go & !(f > 0)) ? pH : hi;
+
+      dx = -f / df;
+      dx = df < 0.0 ? dx : 0.0;
+      next = pH + dx;
+      bisect = (df >= 0.0) | (next <= lo) | (next >= hi) | (fabs(2.0 * dx) > fabs(dx_old[l]));
+      mid = (lo + hi) / 2;
+      next = bisect ? mid : next;
+      mid = next - pH;
+      dx = bisect ? mid : dx;
+      go = go & !((fabs(dx) < PH_TOL) | ((hi - lo) < PH_TOL));
+
+      lo_pH[l] = lo;
+      hi_pH[l] = hi;
+      dx_old[l] = go ? dx : dx_old[l];
+      w->pH[l] = go ? next : pH;
+      active[l] = go;
+      n_active += go;
+    }
+  }
+}
+
+static int ph_recall(struct UnitProcess *unit, short flag, double key[PH_NKEY])
+/*
+*  Purpose: The checks of phchange() before it solves the charge balance.
+*           Returns TRUE if the inputs in unit->eff are those of the last
+*           call in the context (note 4) or of an earlier call for the
+*           unit (note 6), with the outputs in unit->eff.  Otherwise
+*           returns FALSE with the memo key of the inputs in 'key'.
+*/
+{
+  struct Effluent *eff = &unit->eff;
+  struct PhCache *old = &eff->ctx->ph_cache; /* Used to test changes in input parameters */
+  const double *memo;
+
+  /* Check if any of the inputs have changed.  */
+  if (eff->pH == old->pH &&
+      eff->DegK == old->DegK &&
+      eff->Ca_aq == old->Ca_aq &&
+      eff->Ca_solid == old->Ca_solid &&
+      eff->Mg_aq == old->Mg_aq &&
+      eff->Mg_solid == old->Mg_solid &&
+      eff->CO2_aq == old->CO2_aq &&
+      eff->NH3 == old->NH3 &&
+      eff->FreeCl2 == old->FreeCl2 &&
+      eff->CBminusCA == old->CBminusCA &&
+      flag == TRUE)
+  {
+    return (TRUE); /* The inputs have not changed. */
+  }
+
+  ph_key(key, flag, eff->limesoftening, eff->ctx->softflag, eff->pH, eff->DegK,
+         eff->Ca_aq, eff->Ca_solid, eff->Mg_aq, eff->Mg_solid, eff->CO2_aq,
+         eff->NH3, eff->FreeCl2, eff->CBminusCA);
+  if ((memo = memo_find(unit, MEMO_PHCHANGE, key, PH_NKEY)) != NULL)
+  { /* Same inputs as an earlier call for this unit */
+    eff->Alk = memo[0];
+    eff->pH = memo[1];
+    eff->Ca_aq = memo[2];
+    eff->Ca_solid = memo[3];
+    eff->Mg_aq = memo[4];
+    eff->Mg_solid = memo[5];
+    eff->CO2_aq = memo[6];
+    eff->CBminusCA = memo[7];
+    store_phcache(old, eff);
+    return (TRUE);
+  }
+  return (FALSE);
+}
+
+static void ph_store(struct UnitProcess *unit, const double key[PH_NKEY], const struct PhSpecies *s,
+                     double pH, double CBminusCA)
+/*
+*  Purpose: Copy the speciation 's' at 'pH' to unit->eff, and keep the
+*           outputs in the memo of the unit and the cache of the context.
+*/
+{
+  struct Effluent *eff = &unit->eff;
+  double out[PH_NOUT];
+
+  /* Copy outputs to UnitProcess data structure */
+  eff->Alk = s->HCO3 + 2 * s->CO3 + s->OH - s->H;
+  eff->pH = f_adj_pH(pH, unit);
+  eff->Ca_aq = s->Ca_aq;
+  eff->Ca_solid = s->CaCO3_floc;
+  eff->Mg_aq = s->Mg_aq;
+  eff->Mg_solid = s->MgOH2_floc;
+  eff->CO2_aq = s->CO3_aq;
+  eff->CBminusCA = CBminusCA;
+
+  out[0] = eff->Alk;
+  out[1] = eff->pH;
+  out[2] = eff->Ca_aq;
+  out[3] = eff->Ca_solid;
+  out[4] = eff->Mg_aq;
+  out[5] = eff->Mg_solid;
+  out[6] = eff->CO2_aq;
+  out[7] = eff->CBminusCA;
+  memo_store(unit, MEMO_PHCHANGE, key, PH_NKEY, out, PH_NOUT);
+
+  /* Update 'old' */
+  store_phcache(&eff->ctx->ph_cache, eff);
+}
+
 void phchange(struct UnitProcess *unit, short flag)
 /*
 *  Purpose:
@@ -43,346 +568,134 @@ void phchange(struct UnitProcess *unit, short flag)
 *      CBminusCA.  I am not sure this logic is valid.
 *   4. This routine checks for changes in the inputs before starting the
 *      intensive calculations.
+*   5. The pH is found by solve_pH(), a safeguarded Newton iteration
+*      started from the pH of the influent of the unit.  It replaces a
+*      bisection of pH 3 to 13 to 0.00001 that took 20 iterations.
+*   6. The check of note 4 only remembers the last call in the context.
+*      Each unit also memoizes its own calls, see memo_wtp.cpp.
 *
 *  Michael D. Cummins
 *    May 13, 1993
 */
 {
-  //FILE *fptr;
-  //iter = 0;
-  /* Inputs not changed: *****************************************************/
-  double DegK;    /* Temperature                                 (Deg K) */
-  double NH3;     /* Ammonia                                    (Mole/L) */
-  double FreeCl2; /* [HOCl]+[OCl]                               (Mole/L) */
-
-  /* Inputs changes: *********************************************************/
   double pH;         /*                                                 (-) */
-  double Ca_aq;      /* Dissolved calcium   [Ca]+[CaOH]+[Ca(OH)2aq] (Mole/L) */
-  double Mg_aq;      /* Dissolved manesium [Mg]+[MgOH]+[Mg(OH)2aq] (Mole/L) */
-  double CO3_aq;     /* Dissolved carbonate   [H2CO3]+[HCO3]+[CO3] (Mole/L) */
-  double CaCO3_floc; /* CaCO3 floc                                 (Mole/L) */
-  double MgOH2_floc; /* Mg(OH)2 floc                               (Mole/L) */
   double CBminusCA;  /* Remainder of charge balance                 (equ/L) */
+  double Ca_total;   /* Total calcium including floc              (Mole/L) */
+  double Mg_total;   /* Total magnesium including floc            (Mole/L) */
+  double CO3_total;  /* Total carbonate including floc            (Mole/L) */
+  struct PhSpecies s;
+  struct Effluent *eff = &unit->eff;
+  const struct ThermoCoef *coef;
+  double key[PH_NKEY];
 
-  /* Internal: *************************************************************/
-  double Ca_total;     /* Total calcium including floc              (Mole/L) */
-  double Mg_total;     /* Total magnesium including floc            (Mole/L) */
-  double CO3_total;    /* Total carbonate including floc            (Mole/L) */
-  double lo_pH, hi_pH; /* pH iteration range                             (-) */
-                       /* Ions tracked by WTP:                               */
-  double H;            /* [H+]                                      (Mole/L) */
-  double OH;           /* [OH-]                                     (Mole/L) */
-  double CO3;          /* [CO3--]                                   (Mole/L) */
-  double HCO3;         /* [HCO3-]                                   (Mole/L) */
-  double Ca;           /* [Ca++]                                    (Mole/L) */
-  double CaOH;         /* [CaOH+]                                   (Mole/L) */
-  double Mg;           /* [Mg++]                                    (Mole/L) */
-  double MgOH;         /* [MgOH+]                                   (Mole/L) */
-  double NH4;          /* [NH4+]                                    (Mole/L) */
-  double OCl;          /* [OCl-]                                    (Mole/L) */
-  double cations;      /* Sum of postive ions                        (equ/L) */
-  double anions;       /* Sum of negative ions                       (equ/L) */
-
-  double alpha_CO3; /* [CO3--]/[CO3_aq]                        (Fraction) */
-  double alpha_Ca;  /* [Ca++]/[Ca_aq]                          (Fraction) */
-  double alpha_Mg;  /* [Mg++]/[Mg_aq]                          (Fraction) */
-
-  double error = 0.00001; /* acceptable error between hi and lo guesses to end iterative search */
-
-  double b, c;
-  struct Effluent *eff;
-
-  /* Temperature dependent coefficients are static variables and recomputed
-  *  only if the temperature changes.
-  */
-  static double kw;        /* Ionization coeffieient of water               */
-  static double k1, k2;    /* Ionization coeffieients of carbonic acid      */
-  static double k_hocl;    /* Ionization coeffieient of chlorine            */
-  static double k_nh3;     /* Ionization coeffieient of ammonia.            */
-  static double k_mgoh;    /* Ionization coeffieient of magnesium hydroxide.*/
-  static double k_mgoh2;   /* Solubility of magnesium                       */
-  static double k_mgoh2aq; /* Solubility of magnesium hydroxide.            */
-  static double k_caoh;    /* Ionization of calcium hydroxide.              */
-  static double k_caco3;   /* Solubility of calcium carbonate.              */
-  static double k_caoh2aq; /* Solubility of calcium hydroxide.              */
-
-  static struct Effluent old; /* Used to test changes in input parameters */
-
-  /* Get inputs from UnitProcess data structure */
-  eff = &unit->eff;
-  pH = eff->pH;
-  DegK = eff->DegK;
-  Ca_aq = eff->Ca_aq;
-  CaCO3_floc = eff->Ca_solid;
-  Mg_aq = eff->Mg_aq;
-  MgOH2_floc = eff->Mg_solid;
-  CO3_aq = eff->CO2_aq;
-  NH3 = eff->NH3;
-  FreeCl2 = eff->FreeCl2;
-  CBminusCA = eff->CBminusCA;
-
-  /* Check if any of the inputs have changed.  */
-  if (pH == old.pH &&
-      DegK == old.DegK &&
-      Ca_aq == old.Ca_aq &&
-      CaCO3_floc == old.Ca_solid &&
-      Mg_aq == old.Mg_aq &&
-      MgOH2_floc == old.Mg_solid &&
-      CO3_aq == old.CO2_aq &&
-      NH3 == old.NH3 &&
-      FreeCl2 == old.FreeCl2 &&
-      CBminusCA == old.CBminusCA &&
-      flag == TRUE)
-  {
-    return; /* The inputs have not changed. */
-  }
+  /* Check if any of the inputs have changed, see notes 4 and 6 */
+  if (ph_recall(unit, flag, key) == TRUE)
+    return;
 
-  /* Temperature dependent coefficients: */
-  if (DegK != old.DegK)
-  {
-    /* Temperature has changed... Recompute coefficients. */
-    kw = Kw(DegK);
-    k1 = K_HCO3(DegK);
-    k2 = K_CO3(DegK);
-    k_hocl = K_HOCl(DegK);
-    k_nh3 = K_NH3(DegK);
-    k_mgoh = K_MgOH(DegK);
-    k_mgoh2 = K_MgOH2(DegK);
-    k_mgoh2aq = K_MgOH2aq(DegK);
-    k_caoh = K_CaOH(DegK);
-    k_caco3 = K_CaCO3(DegK);
-    k_caoh2aq = K_CaOH2aq(DegK);
-  }
-
-  /* Initial values */
-  lo_pH = 3.0;
-  hi_pH = 13.0;
+  coef = thermo_coef(eff->ctx, eff->DegK);
 
   /*
   *  Ca_total, Mg_total, and CO3_total are mass balances and do not change
   *  by adjusting pH.
   */
-  Ca_total = Ca_aq + CaCO3_floc;
-  Mg_total = Mg_aq + MgOH2_floc;
-  CO3_total = CO3_aq + CaCO3_floc;
-
-#define CHECK FALSE
-
-#if CHECK
-  fptr = fopen("pHdata.dat", "a+");
-  fprintf(fptr, "Module: %d  bottom \n", unit->type);
-  fprintf(fptr, "phchange():\n");
-  fprintf(fptr, "flag      :%d\n", flag);
-  fprintf(fptr, "DegK      :%f\n", DegK);
-  fprintf(fptr, "NH3       :%e\n", NH3);
-  fprintf(fptr, "FreeCl2   :%e\n", FreeCl2);
-  fprintf(fptr, "CBminusCA :%e\n", CBminusCA);
-  fprintf(fptr, "Alk       :%e\n", eff->Alk);
-  fprintf(fptr, "kw        :%e\n", kw);
-  fprintf(fptr, "k_hco3    :%e\n", k1);
-  fprintf(fptr, "k_co3     :%e\n", k2);
-  fprintf(fptr, "k_hocl    :%e\n", k_hocl);
-  fprintf(fptr, "k_nh3     :%e\n", k_nh3);
-  fprintf(fptr, "k_mgoh    :%e\n", k_mgoh);
-  fprintf(fptr, "k_mgoh2   :%e\n", k_mgoh2);
-  fprintf(fptr, "k_mgoh2aq :%e\n", k_mgoh2aq);
-  fprintf(fptr, "k_caoh    :%e\n", k_caoh);
-  fprintf(fptr, "k_caco3   :%e\n", k_caco3);
-  fprintf(fptr, "k_caoh2aq :%e\n", k_caoh2aq);
-  fprintf(fptr, "Ca_total  :%e\n", Ca_total);
-  fprintf(fptr, "Mg_total  :%e\n", Mg_total);
-  fprintf(fptr, "CO3_total :%e\n", CO3_total);
-#endif
-
-  /* pH iteration loop */
-  while ((hi_pH - lo_pH) > error) // changed by WJR to get more accurate estimate (6/17)
-  {
-    //   iter++;
-    if (flag == TRUE)
-      pH = (lo_pH + hi_pH) / 2;
-    H = pow(10.0, -(pH));
-    OH = kw / H;
-
-    /*Assume any floc is dissolved then check solubility products.
-      */
-    CO3_aq = CO3_total;
-    Ca_aq = Ca_total;
-    Mg_aq = Mg_total;
-    CaCO3_floc = 0.0;
-    MgOH2_floc = 0.0;
-
-    /* These are a function of pH and temperature.. Not concentrations. */
-    alpha_CO3 = (k1 * k2) / ((H * H) + (k1 * H) + (k1 * k2));    /* A-30 */
-    alpha_Ca = 1.0 / (1 + (k_caoh / H) + (k_caoh2aq / (H * H))); /* A-48 */
-    alpha_Mg = 1.0 / (1 + (k_mgoh / H) + (k_mgoh2aq / (H * H))); /* Eq A-52 */
-#if CHECK
-    fprintf(fptr, "\n");
-    fprintf(fptr, "pH        :%f\n", pH);
-    fprintf(fptr, "H         :%e\n", H);
-    fprintf(fptr, "OH        :%e\n", OH);
-    fprintf(fptr, "alpha_CO3 :%e\n", alpha_CO3);
-    fprintf(fptr, "alpha_Ca  :%e\n", alpha_Ca);
-    fprintf(fptr, "alpha_Mg  :%e\n", alpha_Mg);
-#endif
-
-    /*
-      * Determine if CaCO3 controls solubility of [Ca++] and [CO3--].
-      * If so, calculate new calcium and carbonate distributions.
-      *
-      * The following [Ca++] and [CO3--] include any floc.
-      */
-    CO3 = CO3_aq * alpha_CO3;
-    Ca = Ca_aq * alpha_Ca;
-#if CHECK
-    fprintf(fptr, "Before precipitation\n");
-    fprintf(fptr, "CO3       :%e\n", CO3);
-    fprintf(fptr, "Ca        :%e\n", Ca);
-#endif
-
-    /*if (unit->type == INFLUENT && flag == FALSE)
-{
-fptr=fopen("pHdata.dat","a+");
-fprintf(fptr,"COLDFLAG: %d  \n",coldflag);
-fprintf(fptr,"Module: %d  \n",unit->type);
-fprintf(fptr,"phchange():\n");
-fprintf(fptr,"Ca*CO3      :%e\n", Ca*CO3      );
-fprintf(fptr,"k_caco3      :%e\n", k_caco3      );
-fprintf(fptr,"ratio      :%f\n", Ca*CO3/k_caco3      );
-fclose(fptr);
-}   */
-
-    if ((Ca * CO3) > (k_caco3) && flag == TRUE && unit->eff.limesoftening == TRUE)
-    { /*
-          * Solubility product of CaCO3 is exceded. Estimate CO3_aq
-          * using eq A-70 through A-73.
-          */
-      b = Ca_total - CO3_total;
-      c = -k_caco3 / (alpha_CO3 * alpha_Ca);
-      CO3_aq = (-b + sqrt((b * b) - (4 * c))) / 2.0;
-      CaCO3_floc = CO3_total - CO3_aq;
-      Ca_aq = Ca_total - CaCO3_floc;
-
-      /* Update [CO3] and [Ca] */
-      CO3 = CO3_aq * alpha_CO3;
-      Ca = Ca_aq * alpha_Ca;
-
-      /*
-if (unit->type == INFLUENT)
-{
-fptr=fopen("pHdata.dat","a+");
-fprintf(fptr,"Module: %d  \n",unit->type);
-fprintf(fptr,"in precip statement:\n");
-fprintf(fptr,"ratio      :%e\n", Ca*CO3/k_caco3      );
-fprintf(fptr,"pH      :%f\n", pH      );
-fprintf(fptr,"lo_pH      :%f\n", lo_pH      );
-fprintf(fptr,"hi_pH      :%f\n", hi_pH      );
-fclose(fptr);
-}
- */
-    }
-
-    /*
-      * Determine if Mg(OH)2 controls solubility of magnesium.
-      * If so, calculate new magnesium dissolved and floc concentrations.
-      */
-    Mg = Mg_aq * alpha_Mg;
-#if CHECK
-    fprintf(fptr, "Mg        :%e\n", Mg);
-#endif
-
-    if ((Mg / (H * H)) > k_mgoh2 && flag == TRUE && unit->eff.limesoftening == TRUE) /* Eq A-75 */
-    {
-      Mg_aq = k_mgoh2 * ((H * H) + (H * k_mgoh) + k_mgoh2aq); /* Eq A-78 */
-      MgOH2_floc = Mg_total - Mg_aq;
-
-      /* Update [Mg++] */
-      Mg = Mg_aq * alpha_Mg;
-    }
+  Ca_total = eff->Ca_aq + eff->Ca_solid;
+  Mg_total = eff->Mg_aq + eff->Mg_solid;
+  CO3_total = eff->CO2_aq + eff->Ca_solid;
+  CBminusCA = eff->CBminusCA;
 
-    /* Other Ions tracked by WTP */
-    HCO3 = CO3_aq * (k1 * H) / ((H * H) + (k1 * H) + (k1 * k2)); /* A-30 */
-    CaOH = Ca * k_caoh / H;                                      /* A-40 */
-    MgOH = Mg * k_mgoh / H;                                      /* A-41 */
-    OCl = FreeCl2 / (1 + (H / k_hocl));                          /* A-56 */
-    NH4 = NH3 / (1 + (k_nh3 / H));                               /* A-60 */
-
-    cations = CBminusCA + H + 2 * Ca + CaOH + 2 * Mg + MgOH + NH4; /* equ/L */
-    anions = OH + HCO3 + 2 * CO3 + OCl;                            /* equ/L */
-
-#if CHECK
-    fprintf(fptr, "After precipitation\n");
-    fprintf(fptr, "CO3       :%e\n", CO3);
-    fprintf(fptr, "Ca        :%e\n", Ca);
-    fprintf(fptr, "Mg        :%e\n", Mg);
-    fprintf(fptr, "CO3_aq    :%e\n", CO3_aq);
-    fprintf(fptr, "Ca_aq     :%e\n", Ca_aq);
-    fprintf(fptr, "CaCO3_floc:%e\n", CaCO3_floc);
-    fprintf(fptr, "Mg_aq     :%e\n", Mg_aq);
-    fprintf(fptr, "MgOH2_floc:%e\n", MgOH2_floc);
-
-    fprintf(fptr, "HCO3      :%e\n", HCO3);
-    fprintf(fptr, "CaOH      :%e\n", CaOH);
-    fprintf(fptr, "MgOH      :%e\n", MgOH);
-    fprintf(fptr, "OCl       :%e\n", OCl);
-    fprintf(fptr, "NH4       :%e\n", NH4);
-
-    fprintf(fptr, "cations   :%e\n", cations);
-    fprintf(fptr, "anions    :%e\n", anions);
-#endif
-
-    if (flag == TRUE)
-    { /* Adjust pH */
-      if ((cations - anions) > 0)
-        lo_pH = pH;
-      else
-        hi_pH = pH;
-    }
-    else
-    { /* Adjust CBminusCA such that cations==anions */
-      CBminusCA -= (cations - anions);
-      lo_pH = pH;
-      hi_pH = pH;
-    }
+  if (flag == TRUE)
+  { /* Adjust pH */
+    pH = solve_pH(coef, eff->pH, Ca_total, Mg_total, CO3_total, eff->NH3, eff->FreeCl2,
+                  CBminusCA, eff->limesoftening == TRUE, &s);
   }
-  /*
-if (unit->type == LIME && coldflag == FALSE)
-{
-fptr=fopen("pHdata.dat","a+");
-fprintf(fptr,"Module: %d  \n",unit->type);
-fprintf(fptr,"iter:            :%d\n",iter);
-fprintf(fptr,"CO3_aq (CT)      :%e\n", CO3_aq);
-fprintf(fptr,"CO3              :%e\n", CO3);
-fprintf(fptr,"HCO3             :%e\n", HCO3);
-fprintf(fptr,"OH	       :%e\n", OH);
-fprintf(fptr,"kw	       :%e\n", kw);
-fprintf(fptr,"Alk              :%e\n", (HCO3 + 2*CO3 + OH - H));
-fprintf(fptr,"CT based on CO3  :%e\n", CO3/alpha_CO3);
-fprintf(fptr,"CT based on Alk  :%e\n", CO3);
-fprintf(fptr,"Ca               :%e\n", Ca);
-fprintf(fptr,"Ca_aq            :%e\n", Ca_aq);
-fprintf(fptr,"pH         :%f\n", pH      );
-fprintf(fptr,"lo_pH      :%f\n", lo_pH      );
-fprintf(fptr,"hi_pH      :%f\n\n", hi_pH      );
-fclose(fptr);
+  else
+  { /* Adjust CBminusCA such that cations==anions, without precipitation */
+    pH = eff->pH;
+    charge_balance(coef, pH, Ca_total, Mg_total, CO3_total, eff->NH3, eff->FreeCl2,
+                   CBminusCA, FALSE, &s);
+    CBminusCA -= s.f;
+  }
+
+  ph_store(unit, key, &s, pH, CBminusCA);
 }
-*/
 
-  /* Copy outputs to UnitProcess data structure */
-  eff->Alk = HCO3 + 2 * CO3 + OH - H;
-  eff->pH = f_adj_pH(pH);
-  eff->Ca_aq = Ca_aq;
-  eff->Ca_solid = CaCO3_floc;
-  eff->Mg_aq = Mg_aq;
-  eff->Mg_solid = MgOH2_floc;
-  eff->CO2_aq = CO3_aq;
-  eff->CBminusCA = CBminusCA;
+void phchange_lanes(struct UnitProcess *unit[], int n)
+/*
+*  Purpose: phchange(unit[l], TRUE) for the n lanes of a batch, l < n <=
+*           WTP_LANES.
+*
+*  Notes:
+*   1. Each lane is checked as in phchange() (notes 4 and 6).  The lanes
+*      left are gathered into a struct EffluentLanes and their pH is
+*      solved for all of them at once by solve_pH_lanes(), with a lane mask
+*      for those still iterating.
+*   2. The results are identical to phchange() lane by lane; test_lanes.cpp
+*      checks this for runmodel_lanes().
+*/
+{
+  struct EffluentLanes w;
+  struct ThermoLanes k;
+  struct PhSpeciesLanes s;
+  struct PhSpecies sl;
+  struct UnitProcess *solve[WTP_LANES];
+  const struct ThermoCoef *coef;
+  double key[WTP_LANES][PH_NKEY];
+  int l, m = 0;
+
+  for (l = 0; l < n; l++)
+  {
+    struct Effluent *eff = &unit[l]->eff;
+
+    if (ph_recall(unit[l], TRUE, key[m]) == TRUE)
+      continue;
+
+    coef = thermo_coef(eff->ctx, eff->DegK);
+    k.kw[m] = coef->kw;
+    k.k1[m] = coef->k1;
+    k.k2[m] = coef->k2;
+    k.k_hocl[m] = coef->k_hocl;
+    k.k_nh3[m] = coef->k_nh3;
+    k.k_mgoh[m] = coef->k_mgoh;
+    k.k_mgoh2[m] = coef->k_mgoh2;
+    k.k_mgoh2aq[m] = coef->k_mgoh2aq;
+    k.k_caoh[m] = coef->k_caoh;
+    k.k_caco3[m] = coef->k_caco3;
+    k.k_caoh2aq[m] = coef->k_caoh2aq;
+
+    w.mask[m] = TRUE;
+    w.limesoftening[m] = eff->limesoftening;
+    w.pH[m] = eff->pH;
+    w.DegK[m] = eff->DegK;
+    w.Ca_aq[m] = eff->Ca_aq;
+    w.Ca_solid[m] = eff->Ca_solid;
+    w.Mg_aq[m] = eff->Mg_aq;
+    w.Mg_solid[m] = eff->Mg_solid;
+    w.CO2_aq[m] = eff->CO2_aq;
+    w.NH3[m] = eff->NH3;
+    w.FreeCl2[m] = eff->FreeCl2;
+    w.NH2Cl[m] = eff->NH2Cl;
+    w.CBminusCA[m] = eff->CBminusCA;
+    solve[m++] = unit[l];
+  }
+  if (m == 0)
+    return;
+  w.n = m;
 
-#if CHECK
-  fprintf(fptr, "CBminusCA :%e\n", CBminusCA);
-  fprintf(fptr, "end phchange()\n");
-  fclose(fptr);
-#endif
+  solve_pH_lanes(&k, &w, &s);
 
-  /* Update 'old' */
-  old = *eff;
+  for (l = 0; l < m; l++)
+  {
+    sl.H = s.H[l];
+    sl.OH = s.OH[l];
+    sl.CO3 = s.CO3[l];
+    sl.HCO3 = s.HCO3[l];
+    sl.Ca_aq = s.Ca_aq[l];
+    sl.Mg_aq = s.Mg_aq[l];
+    sl.CO3_aq = s.CO3_aq[l];
+    sl.CaCO3_floc = s.CaCO3_floc[l];
+    sl.MgOH2_floc = s.MgOH2_floc[l];
+    sl.f = s.f[l];
+    sl.df = s.df[l];
+    ph_store(solve[l], key[l], &sl, w.pH[l], w.CBminusCA[l]);
+  }
 }
@@ -0,0 +1,793 @@
+/* Plan_wtp.c -- Compiled execution plan for runmodel()
+*
+*  The flag setting passes at the top of runmodel() depend only on the
+*  order of the unit processes, the sign of the coagulant doses, the lime
+*  purpose, and the pathogen credit data of the filters.  None of these
+*  change while auto_dose() searches for a dose, so the passes are run once
+*  by compile_plan() and the resulting flag values of train->ctx are saved
+*  in a struct TrainPlan attached to the process train.  The plan also holds the
+*  model function for each unit, the type of the following unit (needed by
+*  the rapid mix logic), and marks the units that can not change the water
+*  quality so that runmodel() skips them.
+*
+*  Each step also carries the outputs (WTP_OUT_...) its unit must compute:
+*  those the caller asked for in ctx.outputs, what they are derived from
+*  (out_deps[]), and the bromide taken up by DBPs and bromate wherever a
+*  later unit reads it.  The DBP, ozone, CT, and EC models skip the rest.
+*
+*  The following functions are in this file:
+*    compile_plan()
+*    FreeTrainPlan()
+*    plan_current()
+*    load_plan()
+*    invalidate_plan()
+*    out_need()
+*/
+#include "wtp.h"
+
+/* Outputs each output is computed from, by bit of WTP_OUT_... */
+static const unsigned out_deps[WTP_NOUTPUTS] = {
+    0,                   /* TTHM                                        */
+    WTP_OUT_HAA_SPECIES, /* HAA5 = HAA6 - proportioned BCAA             */
+    WTP_OUT_TTHM,        /* THM species, proportioned by TTHM           */
+    WTP_OUT_HAA5,        /* HAA6 species, proportioned by HAA6          */
+    WTP_OUT_HAA5,        /* HAA9 = HAA6 + proportioned HAA9 species     */
+    0,                   /* TOX                                         */
+    WTP_OUT_THM_SPECIES | WTP_OUT_HAA_SPECIES | WTP_OUT_HAA9 |
+        WTP_OUT_BROMATE, /* Bromide, by stoichiometry of the above      */
+    0,                   /* Bromate                                     */
+    0,                   /* Solids                                      */
+    0,                   /* Enhanced coagulation                        */
+    0};                  /* CT                                          */
+
+/* Outputs every run computes: auto_dose() reads TTHM and HAA5 */
+#define OUT_ALWAYS (WTP_OUT_TTHM | WTP_OUT_HAA5)
+
+unsigned out_need(unsigned outputs)
+/*
+*  Purpose: Return 'outputs' with everything they are computed from.
+*/
+{
+  unsigned need = (outputs | OUT_ALWAYS) & WTP_OUT_ALL;
+  unsigned last;
+  int i;
+
+  do
+  {
+    last = need;
+    for (i = 0; i < WTP_NOUTPUTS; i++)
+      if (need & (1u << i))
+        need |= out_deps[i];
+  } while (need != last);
+
+  return (need);
+}
+
+static int reads_bromide(short type)
+/*
+*  Purpose: TRUE if a unit process reads the bromide left by the units
+*           before it (chloradd() and ozonate()).
+*/
+{
+  return (type == CHLORINE || type == HYPOCHLORITE || type == O3_CONTACTOR);
+}
+
+static short plan_key(struct UnitProcess *unit)
+/*
+*  Purpose: Return the part of the unit process data that decides the
+*           global flags or whether the unit is a no-op.  A plan is stale
+*           when this key changes for any unit.
+*
+*  Return:
+*    -1/0/1 = sign of the dose for chemical additions, plus 2 for a lime
+*             softening dose.  Unit specific switches for the other types.
+*/
+{
+  double dose = 0.0;
+
+  switch (unit->type)
+  {
+  case ALUM:
+    dose = unit->data.alum->dose;
+    break;
+  case IRON:
+    dose = unit->data.iron->dose;
+    break;
+  case LIME:
+    dose = unit->data.lime->dose;
+    break;
+  case CHLORINE_DIOXIDE:
+    dose = unit->data.clo2->dose;
+    break;
+  case SULFURIC_ACID:
+    dose = unit->data.chemical->h2so4;
+    break;
+  case SODIUM_HYDROXIDE:
+    dose = unit->data.chemical->naoh;
+    break;
+  case SODA_ASH:
+    dose = unit->data.chemical->soda;
+    break;
+  case AMMONIA:
+  case AMMONIUM_SULFATE:
+    dose = unit->data.chemical->nh3;
+    break;
+  case PERMANGANATE:
+    dose = unit->data.chemical->kmno4;
+    break;
+  case CARBON_DIOXIDE:
+    dose = unit->data.chemical->co2;
+    break;
+  case SULFUR_DIOXIDE:
+    dose = unit->data.chemical->so2;
+    break;
+
+  case FILTER:
+    return (short)((unit->data.filter->cfe_turb_flag == TRUE) +
+                   2 * (unit->data.filter->ife_turb_flag == TRUE));
+  case NF_UP:
+    return (short)(unit->data.nf->treat_fraction >= 1.0);
+  case PRESED_BASIN:
+    return (short)(unit->data.presed->eligible_lt2 == TRUE);
+  case BANK_FILTER:
+    return (short)((unit->data.bankf->eligible_lt2 == TRUE) +
+                   2 * (unit->data.bankf->distance >= 25.0) +
+                   4 * (unit->data.bankf->distance >= 50.0));
+
+  default:
+    return 0;
+  }
+
+  if (unit->type == LIME && unit->data.lime->purpose == 'S')
+    return (short)(2 + (dose > 0.0) - (dose < 0.0));
+  return (short)((dose > 0.0) - (dose < 0.0));
+}
+
+static short plan_elide(struct UnitProcess *unit, short key)
+/*
+*  Purpose: Decide if a unit process leaves its influent unchanged.
+*
+*  Notes:
+*   1. The influent of every unit has already been through breakpt() and
+*      phchange(), so both return without a change when the unit itself
+*      does nothing.  runmodel() only copies the effluent for these units.
+*   2. Chlorine and ozone are never elided because runmodel() tracks the
+*      DBP model in effect at these points even when the dose is zero.
+*/
+{
+  switch (unit->type)
+  {
+  case UV_DIS:
+  case BANK_FILTER:
+    return TRUE;
+
+  case ALUM:
+  case IRON:
+  case LIME:
+  case CHLORINE_DIOXIDE:
+  case SULFURIC_ACID:
+  case SODIUM_HYDROXIDE:
+  case SODA_ASH:
+  case AMMONIA:
+  case AMMONIUM_SULFATE:
+  case PERMANGANATE:
+  case CARBON_DIOXIDE:
+  case SULFUR_DIOXIDE:
+    return (short)(key == 0); /* Zero dose, and not a lime softening point */
+
+  default:
+    return FALSE;
+  }
+}
+
+struct TrainPlan *compile_plan(struct ProcessTrain *train)
+/*
+*  Purpose: Build the execution plan of a process train.  The primary and
+*           secondary flags of train->ctx are set here exactly as runmodel()
+*           used to set them on every call, then saved in the plan.
+*
+*  Inputs:
+*    *train = The process train controlling structure.
+*
+*  Return:
+*    Pointer to the plan, also stored in train->plan, or NULL if memory
+*    could not be allocated.
+*
+*  Notes:
+*   1. filt_stage of the filter data structures is set as a side effect,
+*      as before.
+*/
+{
+  struct WtpContext *ctx = &train->ctx;
+  struct TrainPlan *plan;
+  struct UnitProcess *unit;
+  struct PlanStep *step;
+  unsigned need;
+  int i, n = 0;
+  int sed_cntr = 0;			 /* counter for sed basins in process train      */
+  int soft_cntr = 0;		 /* approx. counter for coagulant or lime soft. doses
+                                        that are in unique softening stages in train */
+  int coag_cntr = 0;		 /* counter for coag. add. pts. in process train */
+  int presedflag = FALSE;  //Presed with no coag in front - helps to deter-
+									 //mine whether or not pre-ozonation exists
+
+  train->plan = FreeTrainPlan(train->plan);
+
+  for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit))
+    n++;
+
+  if ((plan = (struct TrainPlan *)calloc(1, sizeof(struct TrainPlan))) == NULL)
+    return (NULL);
+  if (n > 0 && (plan->steps = (struct PlanStep *)calloc(n, sizeof(struct PlanStep))) == NULL)
+  {
+    free(plan);
+    return (NULL);
+  }
+  plan->n_steps = n;
+
+  for (unit = FirstUnitProcess(train), step = plan->steps; unit; unit = NextUnitProcess(unit), step++)
+  {
+    step->unit = unit;
+    step->type = unit->type;
+    step->sign = plan_key(unit);
+    step->next_type = NextUnitProcess(unit) != NULL ? NextUnitProcess(unit)->type : (short)VACANT;
+    step->elide = plan_elide(unit, step->sign);
+    step->exec = run_step(step->type, step->elide);
+  }
+
+	/* Initialize Globals: I don't think these should be in globals.c - WJS, 11/98*/
+	ctx->gw_virus_flag = FALSE;
+	ctx->coagflag = FALSE;
+	ctx->conv_filtflag = FALSE;
+	ctx->filtflag = FALSE;
+	ctx->filt2flag = FALSE;
+	ctx->softflag = FALSE;
+	ctx->soft2flag = FALSE;
+	ctx->floccflag = FALSE;
+	ctx->sedflag = FALSE;
+	ctx->sedconvflag = FALSE;
+	ctx->gacflag = FALSE;
+	ctx->mfufflag = FALSE;
+	ctx->nfflag = FALSE;
+	ctx->ssfflag = FALSE;
+	ctx->defflag = FALSE;
+	ctx->bagfflag = FALSE;
+	ctx->cartfflag = FALSE;
+	ctx->bankfflag = FALSE;
+	ctx->granf2flag = FALSE;
+	ctx->gac2flag = FALSE;
+	ctx->mfuf2flag = FALSE;
+	ctx->nf2flag = FALSE;
+	ctx->ssf2flag = FALSE;
+	ctx->def2flag = FALSE;
+	ctx->bagf2flag = FALSE;
+	ctx->cartf2flag = FALSE;
+	ctx->cfeflag = FALSE;
+	ctx->ifeflag = FALSE;
+	ctx->uvflag = FALSE;
+	ctx->lt2_wscp_flag = FALSE;
+	ctx->o3flag = FALSE;
+	ctx->clo2flag = FALSE;
+	ctx->pre_o3flag = FALSE;
+	ctx->int_o3flag = FALSE;
+	ctx->post_o3flag = FALSE;
+	ctx->dir_filtflag = FALSE;
+	ctx->lt2presedflag = FALSE;
+	ctx->nonconv_discredit = 0.0;
+	ctx->tot_crypto_lr = 0.0;
+	ctx->tot_giardia_lr = 0.0;
+	ctx->tot_virus_lr = 0.0;
+
+	/* SET PRIMARY GLOBAL FLAGS
+   (and global variables related to pathogen log removal */
+
+	for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit))
+	{
+		switch (unit->type)
+		{
+		case ALUM:
+			if (unit->data.alum->dose > 0.0)
+				ctx->coagflag = TRUE;
+			if (soft_cntr > 0 && ctx->sedconvflag == TRUE)
+				soft_cntr += 1;
+			break;
+
+		case FILTER:
+			if (ctx->filtflag == TRUE && ctx->filt2flag == FALSE) //2ND STAGE FILTRATION - GRANULAR MEDIA
+			{
+				ctx->filt2flag = TRUE;
+				ctx->granf2flag = TRUE;
+				ctx->tot_crypto_lr += unit->data.filter->crypto_lr_2;
+				unit->data.filter->filt_stage = 2;
+			}
+			if (ctx->filtflag == FALSE && ctx->coagflag == TRUE && ctx->floccflag == TRUE && ctx->sedconvflag == TRUE)
+			{ //PRIMARY FILTRATION - CONVENTIONAL
+				ctx->filtflag = TRUE;
+				ctx->conv_filtflag = TRUE;
+				ctx->tot_giardia_lr += unit->data.filter->giardia_lr_conv;
+				ctx->tot_virus_lr += unit->data.filter->virus_lr_conv;
+				ctx->tot_crypto_lr += unit->data.filter->crypto_lr_conv;
+				if (unit->data.filter->cfe_turb_flag == TRUE)
+					ctx->tot_crypto_lr += 0.5;
+				if (unit->data.filter->ife_turb_flag == TRUE &&
+					 unit->data.filter->cfe_turb_flag == TRUE)
+					ctx->tot_crypto_lr += 0.5;
+				if (unit->data.filter->ife_turb_flag == TRUE &&
+					 unit->data.filter->cfe_turb_flag == FALSE)
+					ctx->tot_crypto_lr += 1.0;
+				unit->data.filter->filt_stage = 1;
+			}
+			if (ctx->filtflag == FALSE && ctx->coagflag == TRUE && (ctx->sedconvflag == FALSE || (ctx->sedconvflag == TRUE && ctx->floccflag == FALSE)))
+			{ //PRIMARY FILTRATION - DIRECT
+				ctx->filtflag = TRUE;
+				ctx->dir_filtflag = TRUE;
+				ctx->tot_giardia_lr += unit->data.filter->giardia_lr_df;
+				ctx->tot_virus_lr += unit->data.filter->virus_lr_df;
+				ctx->tot_crypto_lr += unit->data.filter->crypto_lr_df;
+				if (unit->data.filter->cfe_turb_flag == TRUE)
+					ctx->tot_crypto_lr += 0.5;
+				if (unit->data.filter->ife_turb_flag == TRUE &&
+					 unit->data.filter->cfe_turb_flag == TRUE)
+					ctx->tot_crypto_lr += 0.5;
+				if (unit->data.filter->ife_turb_flag == TRUE &&
+					 unit->data.filter->cfe_turb_flag == FALSE)
+					ctx->tot_crypto_lr += 1.0;
+				unit->data.filter->filt_stage = 1;
+			}
+			break;
+
+		case IRON:
+			if (unit->data.iron->dose > 0.0)
+				ctx->coagflag = TRUE;
+			if (soft_cntr > 0 && ctx->sedconvflag == TRUE)
+				soft_cntr += 1;
+			break;
+
+		case LIME:
+			if (unit->data.lime->purpose == 'S')
+			{
+				ctx->coagflag = TRUE;
+				ctx->softflag = TRUE;
+				if (soft_cntr == 0)
+					soft_cntr = 1;
+				else if (ctx->sedconvflag == TRUE)
+					soft_cntr += 1;
+				else
+					;
+			}
+			break;
+
+		case SLOW_MIX:
+			ctx->floccflag = TRUE;
+			break;
+
+		case SETTLING_BASIN:
+			ctx->sedflag = TRUE;
+			if (ctx->sedconvflag == TRUE && soft_cntr > 1) //2-STAGE PRECIP. SOFTENING
+			{
+				ctx->soft2flag = TRUE;
+				ctx->tot_crypto_lr += 0.5; //This assumes that the user will put filters downstream
+			}
+			if (ctx->coagflag == TRUE && ctx->filtflag == FALSE)
+				ctx->sedconvflag = TRUE;
+			break;
+
+		case GAC:
+			ctx->gacflag = TRUE;
+			if (ctx->filtflag == TRUE && ctx->filt2flag == FALSE) //2ND STAGE FILTRATION - GAC MEDIA
+			{
+				ctx->filt2flag = TRUE;
+				ctx->gac2flag = TRUE;
+				ctx->tot_crypto_lr += unit->data.gac->crypto_lr_2;
+				unit->data.gac->filt_stage = 2;
+			}
+			break;
+
+		case MFUF_UP:
+			if (ctx->filtflag == TRUE && ctx->filt2flag == FALSE) //2ND STAGE FILTRATION - MFUF
+			{
+				ctx->filt2flag = TRUE;
+				ctx->mfuf2flag = TRUE;
+				ctx->tot_crypto_lr += unit->data.mfuf->crypto_lr_2;
+				unit->data.mfuf->filt_stage = 2;
+				ctx->nonconv_discredit += unit->data.mfuf->crypto_lr_2;
+			}
+			if (ctx->filtflag == FALSE)
+			{ //PRIMARY FILTRATION - MFUF
+				ctx->filtflag = TRUE;
+				ctx->mfufflag = TRUE;
+				ctx->tot_giardia_lr += unit->data.mfuf->giardia_lr;
+				ctx->tot_virus_lr += unit->data.mfuf->virus_lr;
+				ctx->tot_crypto_lr += unit->data.mfuf->crypto_lr_1;
+				unit->data.mfuf->filt_stage = 1;
+				ctx->nonconv_discredit += unit->data.mfuf->crypto_lr_1;
+			}
+			break;
+
+		case NF_UP:
+			if (ctx->filtflag == TRUE && ctx->filt2flag == FALSE && unit->data.nf->treat_fraction >= 1.0)
+			{ //2ND STAGE FILTRATION - NF
+				ctx->filt2flag = TRUE;
+				ctx->nf2flag = TRUE;
+				ctx->tot_crypto_lr += unit->data.nf->crypto_lr;
+				unit->data.nf->filt_stage = 2;
+				ctx->nonconv_discredit += unit->data.nf->crypto_lr;
+			}
+			if (ctx->filtflag == FALSE && unit->data.nf->treat_fraction >= 1.0)
+			{ //PRIMARY FILTRATION - NF
+				ctx->filtflag = TRUE;
+				ctx->nfflag = TRUE;
+				ctx->tot_giardia_lr += unit->data.nf->giardia_lr;
+				ctx->tot_virus_lr += unit->data.nf->virus_lr;
+				ctx->tot_crypto_lr += unit->data.nf->crypto_lr;
+				unit->data.nf->filt_stage = 1;
+				ctx->nonconv_discredit += unit->data.nf->crypto_lr;
+			}
+			break;
+
+		case SLOW_FILTER:
+			if (ctx->filtflag == TRUE && ctx->filt2flag == FALSE)
+			{ //2ND STAGE FILTRATION - SLOW SAND FILTER
+				ctx->filt2flag = TRUE;
+				ctx->ssf2flag = TRUE;
+				ctx->tot_crypto_lr += unit->data.ssf->crypto_lr_2;
+				unit->data.ssf->filt_stage = 2;
+			}
+			if (ctx->filtflag == FALSE)
+			{ //PRIMARY FILTRATION - SLOW SAND FILTER
+				ctx->filtflag = TRUE;
+				ctx->ssfflag = TRUE;
+				ctx->tot_giardia_lr += unit->data.ssf->giardia_lr;
+				ctx->tot_virus_lr += unit->data.ssf->virus_lr;
+				ctx->tot_crypto_lr += unit->data.ssf->crypto_lr_1;
+				unit->data.ssf->filt_stage = 1;
+			}
+			break;
+
+		case DE_FILTER:
+			if (ctx->filtflag == TRUE && ctx->filt2flag == FALSE)
+			{ //2ND STAGE FILTRATION - DE FILTER
+				ctx->filt2flag = TRUE;
+				ctx->def2flag = TRUE;
+				ctx->tot_crypto_lr += unit->data.def->crypto_lr_2;
+				unit->data.def->filt_stage = 1;
+			}
+			if (ctx->filtflag == FALSE)
+			{ //PRIMARY FILTRATION - DE FILTER
+				ctx->filtflag = TRUE;
+				ctx->defflag = TRUE;
+				ctx->tot_giardia_lr += unit->data.def->giardia_lr;
+				ctx->tot_virus_lr += unit->data.def->virus_lr;
+				ctx->tot_crypto_lr += unit->data.def->crypto_lr_1;
+				unit->data.def->filt_stage = 1;
+			}
+			break;
+
+		case BAG_FILTER:
+			if (ctx->filtflag == TRUE && ctx->filt2flag == FALSE)
+			{ //2ND STAGE FILTRATION - BAG FILTER
+				ctx->filt2flag = TRUE;
+				ctx->bagf2flag = TRUE;
+				ctx->tot_crypto_lr += unit->data.altf->crypto_lr_2;
+				unit->data.altf->filt_stage = 2;
+				ctx->nonconv_discredit += unit->data.altf->crypto_lr_2;
+			}
+			if (ctx->filtflag == FALSE)
+			{ //PRIMARY FILTRATION - BAG FILTER
+				ctx->filtflag = TRUE;
+				ctx->bagfflag = TRUE;
+				ctx->tot_giardia_lr += unit->data.altf->giardia_lr;
+				ctx->tot_virus_lr += unit->data.altf->virus_lr;
+				ctx->tot_crypto_lr += unit->data.altf->crypto_lr_1;
+				unit->data.altf->filt_stage = 1;
+				ctx->nonconv_discredit += unit->data.altf->crypto_lr_1;
+			}
+			break;
+
+		case CART_FILTER:
+			if (ctx->filtflag == TRUE && ctx->filt2flag == FALSE)
+			{ //2ND STAGE FILTRATION - CARTRIDGE FILTER
+				ctx->filt2flag = TRUE;
+				ctx->cartf2flag = TRUE;
+				ctx->tot_crypto_lr += unit->data.altf->crypto_lr_2;
+				unit->data.altf->filt_stage = 2;
+				ctx->nonconv_discredit += unit->data.altf->crypto_lr_2;
+			}
+			if (ctx->filtflag == FALSE)
+			{ //PRIMARY FILTRATION - CARTRIDGE FILTER
+				ctx->filtflag = TRUE;
+				ctx->cartfflag = TRUE;
+				ctx->tot_giardia_lr += unit->data.altf->giardia_lr;
+				ctx->tot_virus_lr += unit->data.altf->virus_lr;
+				ctx->tot_crypto_lr += unit->data.altf->crypto_lr_1;
+				unit->data.altf->filt_stage = 1;
+				ctx->nonconv_discredit += unit->data.altf->crypto_lr_1;
+			}
+			break;
+
+		case BANK_FILTER:
+			if (ctx->bankfflag == 0 && unit->data.bankf->eligible_lt2 == TRUE)
+			{ //BANK FILTRATION TOOLBOX OPTION
+				if (unit->data.bankf->distance >= 25.0 && unit->data.bankf->distance < 50.0)
+				{
+					ctx->bankfflag = 1;
+					ctx->tot_crypto_lr += unit->data.bankf->crypto_lr_close;
+					ctx->nonconv_discredit += unit->data.bankf->crypto_lr_close;
+				}
+				if (unit->data.bankf->distance >= 50.0)
+				{
+					ctx->bankfflag = 2;
+					ctx->tot_crypto_lr += unit->data.bankf->crypto_lr_far;
+					ctx->nonconv_discredit += unit->data.bankf->crypto_lr_far;
+				}
+			}
+			break;
+
+		case PRESED_BASIN:
+			if (ctx->lt2presedflag == FALSE && ctx->coagflag == TRUE &&
+				 ctx->filtflag == FALSE && unit->data.presed->eligible_lt2 == TRUE)
+			{ //PRESED TOOLBOX OPTION
+				ctx->lt2presedflag = TRUE;
+				ctx->tot_crypto_lr += unit->data.presed->crypto_lr;
+			}
+			break;
+
+		case UV_DIS:
+			ctx->uvflag = TRUE;
+			ctx->tot_giardia_lr += unit->data.uvdis->giardia_li;
+			ctx->tot_virus_lr += unit->data.uvdis->virus_li;
+			ctx->tot_crypto_lr += unit->data.uvdis->crypto_li;
+			ctx->nonconv_discredit += unit->data.uvdis->crypto_li;
+			break;
+
+		case OZONE:
+			ctx->o3flag = TRUE;
+			ctx->pre_o3flag = TRUE; // Pre-ozonation is assumed true until location
+			break;				 // of ozonation set in next loop */
+
+		case CHLORINE_DIOXIDE:
+			ctx->clo2flag = TRUE;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	// Some protection against giving 2nd stage softening credit with no filters in the train
+	//  (not that this protects against there being 2nd stage softening after 1st stage filters
+	//   and no 2nd stage filters in the train)
+	if (ctx->soft2flag == TRUE && ctx->filtflag == FALSE)
+		ctx->tot_crypto_lr -= 0.5;
+
+	/* SET SECONDARY GLOBAL FLAGS (based on process order and Primary Global Flag values */
+
+	/* This code determines if pre-sedimentation exists by checking if sedimentation
+   has occurred before any coagulation */
+	for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit))
+	{
+		if (unit->type == ALUM && unit->data.alum->dose > 0.0)
+			coag_cntr += 1;
+		if (unit->type == IRON && unit->data.iron->dose > 0.0)
+			coag_cntr += 1;
+		if (unit->type == LIME && unit->data.lime->purpose == 'S')
+			coag_cntr += 1;
+		if (unit->type == SETTLING_BASIN && coag_cntr == 0)
+			presedflag = TRUE;
+	} /* End pre_sedflag determination loop */
+
+	/* The following code section sets the ozonation flags by seeing what processes
+   precede ozonation - WJS 10/98 */
+	if (ctx->o3flag == TRUE)
+	{ /* ozone exists, so update flag values */
+		if (presedflag == FALSE)
+		{ /* presedimentation does not exist, so step thru train
+	               			     to find a sed basin or filter before ozone*/
+			for (unit = FirstUnitProcess(train); unit->type != OZONE; unit = NextUnitProcess(unit))
+			{
+				if (unit->type == SETTLING_BASIN)
+				{ /* a sed basin precedes ozone, so int-ozone exists */
+					ctx->pre_o3flag = FALSE;
+					ctx->int_o3flag = TRUE;
+				}
+				if (unit->type == FILTER || unit->type == GAC)
+				{ /* filtration (or GAC) precedes ozone,
+		  			   so post-ozone exists */
+					ctx->pre_o3flag = FALSE;
+					ctx->int_o3flag = FALSE;
+					ctx->post_o3flag = TRUE;
+				}
+			} /* END of FOR loop through process train */
+		}
+		else
+		{ /* Pre-sedimentation exists, so look for more than one
+	   				    sed basin, or a filter before ozone*/
+			for (unit = FirstUnitProcess(train); unit->type != OZONE; unit = NextUnitProcess(unit))
+			{
+				if (unit->type == SETTLING_BASIN)
+				{
+					sed_cntr += 1;
+					if (sed_cntr > 1)
+					{ /* If only one basin precedes ozonation, then it must
+					    be the pre-sed basin, so pre-ozonation exists.  If
+					    more than one basin precedes ozonation, then
+					    intermediate-ozonation might exist */
+						ctx->pre_o3flag = FALSE;
+						ctx->int_o3flag = TRUE;
+					}
+				}
+				if (unit->type == FILTER || unit->type == GAC)
+				{ /* If a filter (or GAC) precedes ozonation,
+		                            then post-ozonation exists */
+					ctx->pre_o3flag = FALSE;
+					ctx->int_o3flag = FALSE;
+					ctx->post_o3flag = TRUE;
+				}
+			} /* End of FOR loop through process train */
+
+		} /* End of IF-ELSE for pre-sed condition */
+	}
+	/* End of IF for o3flag == TRUE */
+
+  /* Outputs of each unit, from the last unit up */
+  plan->outputs = ctx->outputs;
+  need = out_need(ctx->outputs);
+  for (i = n - 1; i >= 0; i--)
+  {
+    plan->steps[i].need = need;
+    if (reads_bromide(plan->steps[i].type) == TRUE)
+      need = out_need(need | WTP_OUT_BROMIDE);
+  }
+
+  /* Save the flags */
+  plan->gw_virus_flag = ctx->gw_virus_flag;
+  plan->coagflag = ctx->coagflag;
+  plan->conv_filtflag = ctx->conv_filtflag;
+  plan->filtflag = ctx->filtflag;
+  plan->filt2flag = ctx->filt2flag;
+  plan->softflag = ctx->softflag;
+  plan->soft2flag = ctx->soft2flag;
+  plan->floccflag = ctx->floccflag;
+  plan->sedflag = ctx->sedflag;
+  plan->sedconvflag = ctx->sedconvflag;
+  plan->gacflag = ctx->gacflag;
+  plan->mfufflag = ctx->mfufflag;
+  plan->nfflag = ctx->nfflag;
+  plan->ssfflag = ctx->ssfflag;
+  plan->defflag = ctx->defflag;
+  plan->bagfflag = ctx->bagfflag;
+  plan->cartfflag = ctx->cartfflag;
+  plan->bankfflag = ctx->bankfflag;
+  plan->granf2flag = ctx->granf2flag;
+  plan->gac2flag = ctx->gac2flag;
+  plan->mfuf2flag = ctx->mfuf2flag;
+  plan->nf2flag = ctx->nf2flag;
+  plan->ssf2flag = ctx->ssf2flag;
+  plan->def2flag = ctx->def2flag;
+  plan->bagf2flag = ctx->bagf2flag;
+  plan->cartf2flag = ctx->cartf2flag;
+  plan->lt2presedflag = ctx->lt2presedflag;
+  plan->cfeflag = ctx->cfeflag;
+  plan->ifeflag = ctx->ifeflag;
+  plan->uvflag = ctx->uvflag;
+  plan->lt2_wscp_flag = ctx->lt2_wscp_flag;
+  plan->o3flag = ctx->o3flag;
+  plan->pre_o3flag = ctx->pre_o3flag;
+  plan->int_o3flag = ctx->int_o3flag;
+  plan->post_o3flag = ctx->post_o3flag;
+  plan->clo2flag = ctx->clo2flag;
+  plan->dir_filtflag = ctx->dir_filtflag;
+  plan->nonconv_discredit = ctx->nonconv_discredit;
+  plan->tot_crypto_lr = ctx->tot_crypto_lr;
+  plan->tot_giardia_lr = ctx->tot_giardia_lr;
+  plan->tot_virus_lr = ctx->tot_virus_lr;
+
+  train->plan = plan;
+  return (plan);
+}
+
+struct TrainPlan *FreeTrainPlan(struct TrainPlan *plan)
+/*
+*  Purpose: Deallocate an execution plan.  Returns NULL.
+*/
+{
+  if (plan)
+  {
+    free(plan->steps);
+    free(plan);
+  }
+  return (NULL);
+}
+
+int plan_current(struct ProcessTrain *train)
+/*
+*  Purpose: Check that train->plan still describes the process train.
+*
+*  Return:
+*    TRUE if the units, their order, and every plan_key() are unchanged.
+*    FALSE if there is no plan or it is stale.
+*
+*  Notes:
+*   1. Only the dose signs are checked for chemical additions, so
+*      auto_dose() can change dose values without recompiling the plan.
+*   2. Edits to the pathogen credit data of a unit are not detected.
+*      Call invalidate_plan() after changing those.
+*   3. A plan built for other train->ctx.outputs is stale.
+*/
+{
+  struct TrainPlan *plan = train->plan;
+  struct UnitProcess *unit;
+  struct PlanStep *step;
+  int n = 0;
+
+  if (plan == NULL || plan->outputs != train->ctx.outputs)
+    return (FALSE);
+
+  for (unit = FirstUnitProcess(train), step = plan->steps; unit; unit = NextUnitProcess(unit), step++)
+  {
+    if (++n > plan->n_steps ||
+        step->unit != unit ||
+        step->type != unit->type ||
+        step->sign != plan_key(unit))
+      return (FALSE);
+  }
+
+  return (n == plan->n_steps);
+}
+
+void load_plan(struct TrainPlan *plan, struct WtpContext *ctx)
+/*
+*  Purpose: Set the primary and secondary flags of a context from a plan.
+*/
+{
+  ctx->gw_virus_flag = plan->gw_virus_flag;
+  ctx->coagflag = plan->coagflag;
+  ctx->conv_filtflag = plan->conv_filtflag;
+  ctx->filtflag = plan->filtflag;
+  ctx->filt2flag = plan->filt2flag;
+  ctx->softflag = plan->softflag;
+  ctx->soft2flag = plan->soft2flag;
+  ctx->floccflag = plan->floccflag;
+  ctx->sedflag = plan->sedflag;
+  ctx->sedconvflag = plan->sedconvflag;
+  ctx->gacflag = plan->gacflag;
+  ctx->mfufflag = plan->mfufflag;
+  ctx->nfflag = plan->nfflag;
+  ctx->ssfflag = plan->ssfflag;
+  ctx->defflag = plan->defflag;
+  ctx->bagfflag = plan->bagfflag;
+  ctx->cartfflag = plan->cartfflag;
+  ctx->bankfflag = plan->bankfflag;
+  ctx->granf2flag = plan->granf2flag;
+  ctx->gac2flag = plan->gac2flag;
+  ctx->mfuf2flag = plan->mfuf2flag;
+  ctx->nf2flag = plan->nf2flag;
+  ctx->ssf2flag = plan->ssf2flag;
+  ctx->def2flag = plan->def2flag;
+  ctx->bagf2flag = plan->bagf2flag;
+  ctx->cartf2flag = plan->cartf2flag;
+  ctx->lt2presedflag = plan->lt2presedflag;
+  ctx->cfeflag = plan->cfeflag;
+  ctx->ifeflag = plan->ifeflag;
+  ctx->uvflag = plan->uvflag;
+  ctx->lt2_wscp_flag = plan->lt2_wscp_flag;
+  ctx->o3flag = plan->o3flag;
+  ctx->pre_o3flag = plan->pre_o3flag;
+  ctx->int_o3flag = plan->int_o3flag;
+  ctx->post_o3flag = plan->post_o3flag;
+  ctx->clo2flag = plan->clo2flag;
+  ctx->dir_filtflag = plan->dir_filtflag;
+  ctx->nonconv_discredit = plan->nonconv_discredit;
+  ctx->tot_crypto_lr = plan->tot_crypto_lr;
+  ctx->tot_giardia_lr = plan->tot_giardia_lr;
+  ctx->tot_virus_lr = plan->tot_virus_lr;
+}
+
+void invalidate_plan(struct ProcessTrain *train)
+/*
+*  Purpose: Discard the execution plan.  The next runmodel() recompiles it.
+*/
+{
+  if (train)
+    train->plan = FreeTrainPlan(train->plan);
+}
@@ -1,76 +1,339 @@
-/* Read_WTP.c  -- September 20, 1993 */
+/* Read_WTP.c  -- September 20, 1993
+*
+*  Reads process train data files:
+*
+*    U.S. EPA WTP Model:...     Optional title line, as written by writewtp()
+*    # comment                  Comment and blank lines are skipped
+*    Influent                   Name of a unit process in UnitProcessTable[]
+*      pH      =   7.96         Data element 'id = value' of its DataID table
+*      ...
+*      End
+*    Alum
+*      ...
+*
+*  The whole file is parsed from one buffer in a single pass.  Lines and
+*  tokens are located in the buffer rather than copied, and unit process
+*  names and data IDs are found through perfect hash tables built once
+*  from UnitProcessTable[] (wtp_keywords()), so nothing is static but the
+*  tables and trains can be read on several threads at once.
+*
+*  read_wtp() also loads the binary snapshot files of save_snapshot().
+*
+*  The following functions are in this file:
+*    parse_wtp()
+*    read_wtp()
+*/
 
 #include "wtp.h"
 
-int strip_buffer(char buffer[], FILE *fout)
+#define WTP_TITLE "U.S. EPA WTP Model:" /* Start of the title of writewtp() */
+#define WTP_VALUE_LEN 80                /* Longest value passed to read()   */
+
+struct KeywordHash
+{                       /* Perfect hash of a NULL terminated name list */
+  unsigned seed;        /*   Seed of hash_keyword() without collisions  */
+  unsigned mask;        /*   Table size - 1, a power of 2 - 1           */
+  short *slot;          /*   Index into the list or -1                  */
+  const char **name;    /*   The names, see find_keyword()              */
+};
+
+struct WtpKeywords
+{
+  struct KeywordHash units; /* UnitProcessTable[].name           */
+  struct KeywordHash *data; /* UnitProcessTable[type].data[].id  */
+};
+
+static unsigned hash_keyword(const char *s, size_t n, unsigned seed)
+/*
+*  Purpose: FNV-1a hash of s[0..n-1].
+*/
 {
+  unsigned h = 2166136261u ^ seed;
+  size_t i;
+
+  for (i = 0; i < n; i++)
+  {
+    h ^= (unsigned char)s[i];
+    h *= 16777619u;
+  }
+  return (h ^ (h >> 15));
+}
 
-    /* Purpose: remove comments, whitespace, and return characters from buffer.
-     *
-     * Inputs:
-     *  buffer - character array which contains name of unit process or simulation mode.
-     *  fout - where to print.
-     *
-     * Return:
-     *  continue - when exiting strip_buffer() issue a 'continue' statement to the for-loop.
-     *
-     */
-
-    int cont = FALSE;
-    char *ptr;
-
-    /* Eliminate whitespace */
-    while ((*buffer == ' ') || (*buffer == '\t'))
-        buffer++;
-
-    /* Skip any lines with comments (signified by '#') */
-    if (buffer[0] == '#')
+static void build_hash(struct KeywordHash *hash, const char **name, int n)
+/*
+*  Purpose: Find a seed for which the n names hash to different slots.
+*
+*  Notes:
+*   1. The table has at least 4*n slots, so a few seeds are normally
+*      enough; the table is doubled if a thousand seeds are not.
+*   2. A name repeated in the list keeps its first index, as a linear
+*      search would.
+*/
+{
+  unsigned size = 4, seed;
+  int i, j, ok;
+
+  while (size < 4 * (unsigned)n)
+    size *= 2;
+  hash->name = name;
+  for (;; size *= 2)
+  {
+    hash->slot = (short *)realloc(hash->slot, size * sizeof(short));
+    hash->mask = size - 1;
+    for (seed = 0; seed < 1000; seed++)
     {
-        return cont = TRUE;
+      for (j = 0; j < (int)size; j++)
+        hash->slot[j] = -1;
+      for (i = 0, ok = TRUE; i < n && ok; i++)
+      {
+        j = hash_keyword(name[i], strlen(name[i]), seed) & hash->mask;
+        if (hash->slot[j] < 0)
+          hash->slot[j] = (short)i;
+        else if (strcmp(name[hash->slot[j]], name[i]) != 0)
+          ok = FALSE;
+      }
+      if (ok)
+      {
+        hash->seed = seed;
+        return;
+      }
     }
+  }
+}
 
-    /* Skip any blank lines*/
-    if (buffer[0] == '\n')
-    { // blank lines
-        return cont = TRUE;
-    }
+static int find_keyword(const struct KeywordHash *hash, const char *s, size_t n)
+/*
+*  Purpose: Index of s[0..n-1] in the name list of 'hash', or -1.
+*/
+{
+  int i = hash->slot[hash_keyword(s, n, hash->seed) & hash->mask];
 
-    /* Strip out any '\n' character(s) */
-    ptr = strchr(buffer, '\n');
-    if (ptr != NULL)
-    { /* If '\n' is found... */
-        *ptr = '\0';
-    }
+  if (i >= 0 && strncmp(hash->name[i], s, n) == 0 && hash->name[i][n] == '\0')
+    return (i);
+  return (-1);
+}
+
+static const struct WtpKeywords *build_keywords(void)
+/*
+*  Purpose: Perfect hash tables of the unit process names and of the
+*           data IDs of each unit process.
+*/
+{
+  struct WtpKeywords *k;
+  const char **name;
+  int n_types, type, n;
+
+  for (n_types = 0; UnitProcessTable[n_types].name != NULL; n_types++)
+    ;
+  k = (struct WtpKeywords *)calloc(1, sizeof(struct WtpKeywords));
+  k->data = (struct KeywordHash *)calloc(n_types, sizeof(struct KeywordHash));
+
+  name = (const char **)calloc(n_types + 1, sizeof(const char *));
+  for (type = 0; type < n_types; type++)
+    name[type] = UnitProcessTable[type].name;
+  build_hash(&k->units, name, n_types);
+
+  for (type = 0; type < n_types; type++)
+  {
+    for (n = 0; UnitProcessTable[type].data != NULL && UnitProcessTable[type].data[n].id != NULL; n++)
+      ;
+    name = (const char **)calloc(n + 1, sizeof(const char *));
+    for (n = 0; UnitProcessTable[type].data != NULL && UnitProcessTable[type].data[n].id != NULL; n++)
+      name[n] = UnitProcessTable[type].data[n].id;
+    build_hash(&k->data[type], name, n);
+  }
+  return (k);
+}
+
+static const struct WtpKeywords *wtp_keywords(void)
+/*
+*  Purpose: The tables of build_keywords(), built on first use.
+*
+*  Notes:
+*   1. C++ initializes a local static once, even when several threads
+*      call at the same time.  The tables live as long as the program.
+*/
+{
+  static const struct WtpKeywords *keywords = build_keywords();
+
+  return (keywords);
+}
 
-    /* Strip out any comments */
-    if (strchr(buffer, '#') != NULL)
-    { /* If '#' is found... */
-        ptr = strchr(buffer, '#');
-        *ptr = '\0';
+static const char *trim_left(const char *s, const char *end)
+{
+  while (s < end && (*s == ' ' || *s == '\t'))
+    s++;
+  return (s);
+}
+
+static const char *trim_right(const char *s, const char *end)
+{
+  while (end > s && (unsigned char)end[-1] <= ' ')
+    end--;
+  return (end);
+}
+
+int parse_wtp(
+    const char *text,           /* Process train data              */
+    size_t size,                /* Characters in text              */
+    struct ProcessTrain *train, /* Process train control structure */
+    FILE *fout                  /* stdout or NULL                  */
+)
+/*
+*  Purpose: Read process train and unit treatment process data from a
+*           buffer into a process train control structure.  Any existing
+*           data in the process train control structure are lost.
+*
+*  Inputs:
+*    text, size = Contents of a process train data file; not changed and
+*                 need not be '\0' terminated.
+*    fout       = where to print loading status & error messages.  Can be
+*                 NULL; errors then go to stderr.
+*
+*  Return:
+*    TRUE  = success, *train contains new data
+*    FALSE = read error... *train will contain as much as possible.
+*
+*  Notes:
+*   1. Errors give the line of the data file, named by train->file_name.
+*   2. An unknown unit process name ends the program, as it always has:
+*      the rest of the file could not be read as intended.
+*   3. Each value is copied into a '\0' terminated buffer of
+*      WTP_VALUE_LEN characters for the read() function of the unit.  It
+*      runs from after the '=' to the end of the line, as read_line()
+*      used to pass it.
+*   4. Comment and blank lines may also appear between the data of a
+*      unit process.
+*/
+{
+  const struct WtpKeywords *keywords = wtp_keywords();
+  const char *end = text + size;
+  const char *line, *eol, *s, *e, *id, *id_end, *val;
+  char value[WTP_VALUE_LEN];
+  struct UnitProcess *unit = NULL;
+  FILE *ferr = (fout != NULL) ? fout : stderr;
+  int success = TRUE, ok = TRUE, first = TRUE, line_no = 0;
+  int type, i;
+  size_t n;
+
+  /* self protection */
+  if (text == NULL || train == NULL)
+  {
+    fprintf(ferr, "Error: failed self-protection in read_wtp()\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* Initialize process train to an empty list. */
+  while (FirstUnitProcess(train))
+    RemoveUnitProcess(FirstUnitProcess(train));
+
+  /* Log progress */
+  if (fout != NULL)
+  {
+    fprintf(fout, "Treatment train processes:\n");
+  }
+
+  for (line = text; line < end; line = eol + 1)
+  {
+    line_no++;
+    if ((eol = (const char *)memchr(line, '\n', end - line)) == NULL)
+      eol = end;
+    s = trim_left(line, eol);
+    e = trim_right(s, eol);
+    if (s == e || *s == '#')
+      continue; /* Blank or comment line */
+
+    if (unit == NULL)
+    {
+      /* Name of the next unit process, without a trailing comment */
+      if ((id_end = (const char *)memchr(s, '#', e - s)) != NULL)
+        e = trim_right(s, id_end);
+      n = e - s;
+      if (first && n >= strlen(WTP_TITLE) && strncmp(s, WTP_TITLE, strlen(WTP_TITLE)) == 0)
+      {
+        first = FALSE;
+        continue; /* Title line of writewtp() */
+      }
+      first = FALSE;
+      if (fout != NULL)
+      {
+        fprintf(fout, "%.*s\n", (int)n, s);
+      }
+
+      if ((type = find_keyword(&keywords->units, s, n)) < 0 || (unit = AddUnitProcess(train, type)) == NULL)
+      {
+        fprintf(ferr, "Error: unknown unit process name '%.*s' found in %s line %d\n", (int)n, s, train->file_name, line_no);
+        exit(EXIT_FAILURE); /* error handling added by WJR, 8/17 */
+      }
+      ok = TRUE;
+      if (UnitProcessTable[type].read == NULL && type != WTP_EFFLUENT)
+      { /* WTP_EFFLUENT caveat needed because it now has no inputs */
+        /* Oops, a program development error. */
+        fprintf(ferr, "read function not installed in UnitProcessTable[] for %s.\n", UnitProcessTable[type].name);
+        success = FALSE;
+      }
+      continue;
     }
 
-    /* Remove any trailing symbols from right to left until it reaches a letter or a period (for abbreviations) */
-    while (isalpha(*ptr) == 0 && (*ptr != '.'))
+    /* Data line of 'unit': id, then '=' or blanks and '=', then the value */
+    id = s;
+    for (id_end = id; id_end < e && *id_end != ' ' && *id_end != '\t' && *id_end != '='; id_end++)
+      ;
+    if (id_end - id == 3 && strncmp(id, "End", 3) == 0)
     {
-        *ptr = '\0';
-        ptr--;
+      if (ok == FALSE)
+      {
+        fprintf(ferr, "%s has corrupt %s data.\n", train->file_name, UnitProcessTable[unit->type].name);
+        success = FALSE;
+      }
+      unit = NULL; /* Normal end of data packet. */
+      continue;
+    }
+    for (val = id_end; val < e && *val != '='; val++)
+      ;
+    if (val < e)
+      val++;
+    while (val < e && (unsigned char)*val <= ' ')
+      val++;
+    if (val == e)
+    {
+      fprintf(ferr, "%s line %d: no value for %.*s\n", train->file_name, line_no, (int)(id_end - id), id);
+      ok = FALSE;
+      continue;
     }
 
-    /* Echo modified buffer */
-    if (fout != NULL)
+    /* Determine which data element. */
+    if ((i = find_keyword(&keywords->data[unit->type], id, id_end - id)) < 0)
     {
-        fprintf(fout, "%s\n", buffer);
+      /* Incorrect ID in data file. */
+      fprintf(ferr, "%.*s not member of %s\n", (int)(id_end - id), id, UnitProcessTable[unit->type].name);
+      ok = FALSE;
     }
+    else if (UnitProcessTable[unit->type].read != NULL)
+    {
+      n = e - val;
+      if (n >= sizeof(value))
+        n = sizeof(value) - 1;
+      memcpy(value, val, n);
+      value[n] = '\0';
+      UnitProcessTable[unit->type].read(value, (short)i, unit);
+    }
+  }
+
+  if (unit != NULL)
+  {
+    fprintf(ferr, "Unexpected end of file in %s.\n", train->file_name);
+    fprintf(ferr, "%s has corrupt %s data.\n", train->file_name, UnitProcessTable[unit->type].name);
+    success = FALSE;
+  }
 
-    return cont = FALSE;
+  return (success);
 }
 
 int read_wtp(
     FILE *fin,                  /* Process Train data file         */
     struct ProcessTrain *train, /* Process train control structure */
     FILE *fout                  /* stdout or NULL                  */
-                                //   void             (*wait)(char *msg),/* User intrface function          */
-    // long max_line_count         /* Lines the crt will display      */
 )
 /*
 *  Purpose: Read process train and unit treatment process data from a file
@@ -81,208 +344,49 @@ int read_wtp(
 *    fin  = The calling routine must fopen(..."r") the file containg
 *           process train data.
 *    fout = where to print loading status & error messages. Can be NULL.
-*    wait = User interface call back function that is called when
-*           'max_line_count' lines have been sent to fout.  read_wtp()
-*           supplies a 'msg' to wait() that states if the listing is
-*           complete or there is more to come.
-*    max_line_count
-*           Number of line that can be displayed on the CRT.
+*
 *  Return:
 *    TRUE  = success, *train contains new data
 *    FALSE = read error... *train will contain as much as possible.
 *
 *  Note:
 *    1. This function is intended to support open_wtp().
-*    2. This function will identify previously used unit process names
-*       in a data file and convert to the current name.
-*    3. Any error messages are sent to 'fout'.
+*    2. The rest of 'fin' is read into memory and given to parse_wtp(),
+*       or to load_snapshot() if it is a binary snapshot (SNAPSHOT_MAGIC).
+*       Binary files need fopen(..."rb") where that differs from "r".
 *
 *  Michael D. Cummins
 *     July 1993
 */
 {
-    int type;    /* Unit process type */
-    int i;       /* Data element index */
-                 //  int                 mm=0;      /* mm: Printed line counter */
-    int success; /* returned value */
-    int ok;
-    int done;
-    int found;
-
-    char *id;
-    char *val;
-    struct UnitProcess *unit;
-    FILE *ferr; /* send error messages to *fout or *stderr */
-    struct DataID *data;
-    int max_unit_types;
-    char buffer[256];
-    register char *unit_name;
-
-    /* Determine how many entries in UnitProcessTable */
-    max_unit_types = 0;
-    while (UnitProcessTable[max_unit_types].name != NULL)
-        max_unit_types++;
-
-    /* clear memory on stack */
-    memset(buffer, 0, sizeof(buffer));
-
-    /* This may change. */
-    ferr = fout;
-
-    /* self protection */
-    if (fin == NULL || train == NULL)
-    {
-        fprintf(ferr, "Error: failed self-protection in read_wtp()\n");
-        exit(EXIT_FAILURE);
-    }
-
-    /* Initialize process train to an empty list. */
-    while (FirstUnitProcess(train))
-        RemoveUnitProcess(FirstUnitProcess(train));
-
-    /* The following is the code to the current version of the reader. */
-    if (fout != NULL)
-    {
-        fprintf(fout, "%s", buffer); /* Echo Title line from data file. */
-                                     //      mm++;
-    }
+  char *text = NULL, *more;
+  size_t size = 0, capacity = 0, n;
+  int success;
 
-    success = TRUE;
+  if (fin == NULL || train == NULL)
+    return (parse_wtp(NULL, 0, train, fout));
 
-    /* Log progress */
-    if (fout != NULL)
+  do
+  {
+    if (size == capacity)
     {
-        fprintf(fout, "Treatment train processes:\n");
+      capacity = (capacity == 0) ? 8192 : 2 * capacity;
+      if ((more = (char *)realloc(text, capacity)) == NULL)
+      {
+        fprintf(fout != NULL ? fout : stderr, "Error: cannot allocate memory for %s\n", train->file_name);
+        free(text);
+        return (FALSE);
+      }
+      text = more;
     }
-
-    while (!feof(fin))
-    {
-        /* Read name of unit process. */
-        if (fgets(buffer, 120, fin) != NULL)
-        {
-            unit_name = buffer;
-            if (strip_buffer(unit_name, fout) == TRUE)
-            { /* Remove comments, whitespace, and returns from buffer */
-                continue;
-            }
-
-            /* Identify unit process and add to end of process train. */
-            type = 0;
-            unit = NULL;
-            while (type < max_unit_types && unit == NULL)
-            {
-                if (strcmp(unit_name, UnitProcessTable[type].name) == 0)
-                {
-                    unit = AddUnitProcess(train, type);
-                }
-                else
-                {
-                    type++;
-                }
-            }
-
-            type = 0; /* use 'unit->type' */
-
-            if (unit == NULL)
-            {
-                fprintf(ferr, "Error: unknown unit process name '%s' found in %s\n", unit_name, train->file_name);
-                exit(EXIT_FAILURE); /* error handling added by WJR, 8/17 */
-                                    //                success = FALSE; /* Unknown unit process. */
-            }
-            else
-            {
-
-                /* Unit Process is valid... Read the unit process data. */
-                type = unit->type;
-
-                if (UnitProcessTable[type].read == NULL && unit->type != WTP_EFFLUENT)
-                { /* WTP_EFFLUENT caveat needed because it now has no inputs */
-                    /* Oops, a program development error. */
-                    if (ferr != NULL)
-                    {
-                        fprintf(ferr,
-                                "read function not installed in UnitProcessTable[] for %s.\n",
-                                UnitProcessTable[type].name);
-                    }
-
-                    success = FALSE;
-                }
-                else
-                { /* read function exists... read data packet. */
-                    done = FALSE;
-                    ok = TRUE;
-
-                    while (!done) /* Iterate through unit process data entries */
-                    {
-                        if (read_line(fin, &id, &val) != TRUE)
-                        {
-                            /* This should not happen. */
-                            if (ferr != NULL)
-                            {
-                                fprintf(ferr,
-                                        "Unexpected end of file or blank line.\n");
-                            }
-                            done = TRUE; /* End of file or read error. */
-                            ok = FALSE;
-                        }
-                        else
-                        {
-                            /* We have a valid line of data... now process it */
-                            if (strcmp(id, "End") == 0)
-                            {
-                                done = TRUE; /* Normal end of data packet. */
-                            }
-                            else
-                            {
-                                /* Determine which data element. */
-                                found = FALSE;
-                                i = 0;
-                                for (data = UnitProcessTable[type].data; data->id && !found; data++)
-                                {
-                                    if (strcmp(data->id, id) == 0)
-                                        found = TRUE;
-                                    else
-                                        i++;
-                                }
-
-                                /* At this point 'i' is an index to the data element */
-
-                                if (found)
-                                {
-                                    UnitProcessTable[type].read(val, i, unit);
-                                }
-                                else
-                                {
-                                    /* Incorrect ID in data file. */
-                                    if (ferr != NULL)
-                                    {
-                                        ok = FALSE;
-                                        fprintf(ferr, "%s not member of %s\n", id, UnitProcessTable[type].name);
-                                    }
-                                }
-                            } /* End of else ( strcmp( id, "End")==0 ) */
-                        }     /* End of else (read_line(fin, &id, &val)!=TRUE) */
-                    }         /* End of while(!done) */
-                }             /* End of else (UnitProcessTable[type].read==NULL && unit->type!=WTP_EFFLUENT) */
-
-                if (ok == FALSE)
-                {
-                    fprintf(ferr, "%s has corrupt %s data.\n", train->file_name, UnitProcessTable[unit->type].name);
-                    success = FALSE;
-                }
-
-            } /* End of else ( unit == NULL ) */
-
-            //          /* Check line count */
-            //          if( (fout!=NULL) && (wait!=NULL) && (mm>=max_line_count) )
-            //            {
-            //              mm = 0;
-            //              wait( "Press Continue" );
-            //            }
-        }
-    } /* End of while(!eof(fin)) */
-
-    //   if( wait != NULL ) wait("Listing complete");
-
-    return (success);
-}
\ No newline at end of file
+    n = fread(text + size, 1, capacity - size, fin);
+    size += n;
+  } while (n > 0);
+
+  if (is_snapshot(text, size) == TRUE)
+    success = load_snapshot(text, size, train, fout != NULL ? fout : stderr);
+  else
+    success = parse_wtp(text, size, train, fout);
+  free(text);
+  return (success);
+}
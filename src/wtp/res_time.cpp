@@ -8,6 +8,7 @@ void res_time(struct UnitProcess *unit)
 *   variables in Unit Process data structure
 */
 {
+	struct WtpContext *ctx = unit->eff.ctx;
 	register struct Effluent *eff;
 
 	eff = &unit->eff;
@@ -17,12 +18,12 @@ void res_time(struct UnitProcess *unit)
 			       theoretical res. time                                      */
 	double peak_factor = 1.0; /* Used when coldflag == TRUE to implement peak flow scenario */
 
-	if (coldflag == TRUE)
+	if (ctx->coldflag == TRUE)
 		peak_factor = eff->Peak / eff->influent->data.influent->avg_flow;
 
 	if (unit->type == GAC)
 	{
-		if (unit->data.gac->config == 'S' && coldflag == TRUE)
+		if (unit->data.gac->config == 'S' && ctx->coldflag == TRUE)
 			eff->processtime = unit->data.gac->ebct / 60.0 / peak_factor;
 		else
 			eff->processtime = unit->data.gac->ebct / 60.0;
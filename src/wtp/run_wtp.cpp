@@ -33,6 +33,7 @@ int run_wtp(
 *    July 1993
 */
 {
+  struct WtpContext *ctx = &train->ctx;
   int e = 0; /* fprintf() error flag */
   // int i;
   int bankclosed = FALSE; /*Ensures that output for bankfilter credit shows only once*/
@@ -67,7 +68,7 @@ int run_wtp(
   if (train == NULL || fout == NULL)
     return (FALSE);
 
-  coldflag = FALSE;
+  ctx->coldflag = FALSE;
 
   if (runmodel(train) == FALSE)
     return (FALSE);
@@ -169,12 +170,12 @@ int run_wtp(
       count += 2;
     }
     //CT Ratio Outputs
-    if (swflag == FALSE /*influent->log_required_g == 999999.0*/ && gw_virus_flag == FALSE)
+    if (ctx->swflag == FALSE /*influent->log_required_g == 999999.0*/ && ctx->gw_virus_flag == FALSE)
     {
       e |= fprintf(fout, "CT Ratios Not Applicable - Groundwater Is Source\r\n");
       count += 1;
     }
-    else if (swflag == TRUE)
+    else if (ctx->swflag == TRUE)
     {
       //   if(influent->log_required
       e |= fprintf(fout, "CT Ratios                        \r\n");
@@ -228,12 +229,12 @@ int run_wtp(
       count += 1;
     }
     //CT Ratio Outputs
-    if (swflag == FALSE /*influent->log_required_g == 999999.0*/ && gw_virus_flag == FALSE)
+    if (ctx->swflag == FALSE /*influent->log_required_g == 999999.0*/ && ctx->gw_virus_flag == FALSE)
     {
       e |= fprintf(fout, "CT Ratios Not Applicable - Groundwater Is Source\r\n");
       count += 1;
     }
-    else if (swflag == TRUE)
+    else if (ctx->swflag == TRUE)
     {
       //   if(influent->log_required
       e |= fprintf(fout, "CT Ratios                        \r\n");
@@ -295,12 +296,12 @@ int run_wtp(
       count += 2;
     }
     //CT Ratio Outputs
-    if (swflag == FALSE /*influent->log_required_g == 999999.0*/ && gw_virus_flag == FALSE)
+    if (ctx->swflag == FALSE /*influent->log_required_g == 999999.0*/ && ctx->gw_virus_flag == FALSE)
     {
       e |= fprintf(fout, "CT Ratios Not Applicable - Groundwater Is Source\r\n");
       count += 1;
     }
-    else if (swflag == TRUE)
+    else if (ctx->swflag == TRUE)
     {
       //   if(influent->log_required
       e |= fprintf(fout, "CT Ratios                        \r\n");
@@ -362,12 +363,12 @@ int run_wtp(
       count += 2;
     }
     //CT Ratio Outputs
-    if (swflag == FALSE /*influent->log_required_g == 999999.0*/ && gw_virus_flag == FALSE)
+    if (ctx->swflag == FALSE /*influent->log_required_g == 999999.0*/ && ctx->gw_virus_flag == FALSE)
     {
       e |= fprintf(fout, "CT Ratios Not Applicable - Groundwater Is Source\r\n");
       count += 1;
     }
-    else if (swflag == TRUE)
+    else if (ctx->swflag == TRUE)
     {
       //   if(influent->log_required
       e |= fprintf(fout, "CT Ratios                        \r\n");
@@ -429,12 +430,12 @@ int run_wtp(
       count += 2;
     }
     //CT Ratio Outputs
-    if (swflag == FALSE /*influent->log_required_g == 999999.0*/ && gw_virus_flag == FALSE)
+    if (ctx->swflag == FALSE /*influent->log_required_g == 999999.0*/ && ctx->gw_virus_flag == FALSE)
     {
       e |= fprintf(fout, "CT Ratios Not Applicable - Groundwater Is Source\r\n");
       count += 1;
     }
-    else if (swflag == TRUE)
+    else if (ctx->swflag == TRUE)
     {
       //   if(influent->log_required
       e |= fprintf(fout, "CT Ratios                        \r\n");
@@ -503,48 +504,48 @@ int run_wtp(
     e |= fprintf(fout, "     Peak Hourly%34.3f  (mgd)\r\n", FirstUnitProcess(train)->data.influent->peak_flow);
     e |= fprintf(fout, "\r\n");
     e |= fprintf(fout, "DISINFECTION INPUTS/CALCULATED VALUES\r\n");
-    if (swflag == TRUE)
+    if (ctx->swflag == TRUE)
       e |= fprintf(fout, "Surface Water Plant?                           TRUE\r\n");
     else
       e |= fprintf(fout, "Surface Water Plant?                          FALSE\r\n");
 
-    if (swflag == FALSE && gw_virus_flag == TRUE)
+    if (ctx->swflag == FALSE && ctx->gw_virus_flag == TRUE)
       e |= fprintf(fout, "Groundwater Disinfection Required?             TRUE\r\n");
-    else if (swflag == TRUE) /*do nothing*/
+    else if (ctx->swflag == TRUE) /*do nothing*/
       ;
     else
       e |= fprintf(fout, "Groundwater Disinfection Required?            FALSE\r\n");
 
-    if (swflag == TRUE || (swflag == FALSE && gw_virus_flag == TRUE))
+    if (ctx->swflag == TRUE || (ctx->swflag == FALSE && ctx->gw_virus_flag == TRUE))
     {
-      e |= fprintf(fout, "Giardia: Total Disinfection Credit Required%7.1f  (logs)\r\n", tot_dis_req_g);
-      e |= fprintf(fout, "Giardia: Credit Achieved (other than by CT)%7.1f  (logs)\r\n", tot_giardia_lr);
-      if (tot_dis_req_g - tot_giardia_lr >= 0.0)
-        e |= fprintf(fout, "Giardia: Inactivation Credit by CT Required%7.1f  (logs)\r\n", tot_dis_req_g - tot_giardia_lr);
+      e |= fprintf(fout, "Giardia: Total Disinfection Credit Required%7.1f  (logs)\r\n", ctx->tot_dis_req_g);
+      e |= fprintf(fout, "Giardia: Credit Achieved (other than by CT)%7.1f  (logs)\r\n", ctx->tot_giardia_lr);
+      if (ctx->tot_dis_req_g - ctx->tot_giardia_lr >= 0.0)
+        e |= fprintf(fout, "Giardia: Inactivation Credit by CT Required%7.1f  (logs)\r\n", ctx->tot_dis_req_g - ctx->tot_giardia_lr);
       else
         e |= fprintf(fout, "Giardia: Inactivation Credit by CT Required%7.1f  (logs)\r\n", 0.0);
       e |= fprintf(fout, "\r\n");
 
-      e |= fprintf(fout, "Virus: Total Disinfection Credit Required%9.1f  (logs)\r\n", tot_dis_req_v);
-      e |= fprintf(fout, "Virus: Credit Achieved (other than by CT)%9.1f  (logs)\r\n", tot_virus_lr);
-      if (tot_dis_req_v - tot_virus_lr >= 0.0)
-        e |= fprintf(fout, "Virus: Inactivation Credit by CT Required%9.1f  (logs)\r\n", tot_dis_req_v - tot_virus_lr);
+      e |= fprintf(fout, "Virus: Total Disinfection Credit Required%9.1f  (logs)\r\n", ctx->tot_dis_req_v);
+      e |= fprintf(fout, "Virus: Credit Achieved (other than by CT)%9.1f  (logs)\r\n", ctx->tot_virus_lr);
+      if (ctx->tot_dis_req_v - ctx->tot_virus_lr >= 0.0)
+        e |= fprintf(fout, "Virus: Inactivation Credit by CT Required%9.1f  (logs)\r\n", ctx->tot_dis_req_v - ctx->tot_virus_lr);
       else
         e |= fprintf(fout, "Virus: Inactivation Credit by CT Required%9.1f  (logs)\r\n", 0.0);
       e |= fprintf(fout, "\r\n");
 
       if (FirstUnitProcess(train)->data.influent->lt2_wscp_flag == TRUE)
         lt2_wscp_credit = 0.5;
-      e |= fprintf(fout, "Crypto.: Total Disinfection Credit Required%7.1f  (logs)\r\n", tot_dis_req_c);
-      e |= fprintf(fout, "Crypto.: Credit Achieved (other than by CT)%7.1f  (logs)\r\n", tot_crypto_lr + lt2_wscp_credit);
+      e |= fprintf(fout, "Crypto.: Total Disinfection Credit Required%7.1f  (logs)\r\n", ctx->tot_dis_req_c);
+      e |= fprintf(fout, "Crypto.: Credit Achieved (other than by CT)%7.1f  (logs)\r\n", ctx->tot_crypto_lr + lt2_wscp_credit);
 
-      if ((tot_dis_req_c - tot_crypto_lr - lt2_wscp_credit) >= 0.0 && bin34_inactreqd == 0.0)
-        e |= fprintf(fout, "Crypto.: Inactivation Credit by CT Required%7.1f  (logs)\r\n", tot_dis_req_c - tot_crypto_lr - lt2_wscp_credit);
-      else if ((tot_dis_req_c - tot_crypto_lr - lt2_wscp_credit) < 0.0 && bin34_inactreqd == 0.0)
+      if ((ctx->tot_dis_req_c - ctx->tot_crypto_lr - lt2_wscp_credit) >= 0.0 && ctx->bin34_inactreqd == 0.0)
+        e |= fprintf(fout, "Crypto.: Inactivation Credit by CT Required%7.1f  (logs)\r\n", ctx->tot_dis_req_c - ctx->tot_crypto_lr - lt2_wscp_credit);
+      else if ((ctx->tot_dis_req_c - ctx->tot_crypto_lr - lt2_wscp_credit) < 0.0 && ctx->bin34_inactreqd == 0.0)
         e |= fprintf(fout, "Crypto.: Inactivation Credit by CT Required%7.1f  (logs)\r\n", 0.0);
       else //(bin34_inactreqd > 0.0)
       {
-        e |= fprintf(fout, "Crypto.: Inactivation Credit by CT Required%7.1f  (logs)\r\n", bin34_inactreqd);
+        e |= fprintf(fout, "Crypto.: Inactivation Credit by CT Required%7.1f  (logs)\r\n", ctx->bin34_inactreqd);
         e |= fprintf(fout, "Crypto. CT Credit Set by 1.0-log Requirement of Bins 3,4\r\n");
         count++;
       }
@@ -573,13 +574,13 @@ int run_wtp(
     switch (unit->type)
     {
     case FILTER: //////////////////////////////////////////////////////////////FILTER////////////////////
-      if (unit->data.filter->filt_stage == 1 && conv_filtflag == TRUE)
+      if (unit->data.filter->filt_stage == 1 && ctx->conv_filtflag == TRUE)
       {
         e |= fprintf(fout, "%-16s%23.1f  %9.1f    %8.1f\r\n", UnitProcessTable[unit->type].name,
                      unit->data.filter->giardia_lr_conv, unit->data.filter->virus_lr_conv, unit->data.filter->crypto_lr_conv);
         count++;
       }
-      else if (unit->data.filter->filt_stage == 1 && dir_filtflag == TRUE)
+      else if (unit->data.filter->filt_stage == 1 && ctx->dir_filtflag == TRUE)
       {
         e |= fprintf(fout, "%-16s%23.1f  %9.1f    %8.1f\r\n", UnitProcessTable[unit->type].name,
                      unit->data.filter->giardia_lr_df, unit->data.filter->virus_lr_df, unit->data.filter->crypto_lr_df);
@@ -697,13 +698,13 @@ int run_wtp(
       break;
 
     case BANK_FILTER: ///////////////////////////////////////////////////////////BANK_FILTER//////////////
-      if (bankfflag == 1 && bankclosed == FALSE)
+      if (ctx->bankfflag == 1 && bankclosed == FALSE)
       {
         e |= fprintf(fout, "%-16s%23.1f  %9.1f    %8.1f\r\n", UnitProcessTable[unit->type].name,
                      zero_lr, zero_lr, unit->data.bankf->crypto_lr_close);
         count++;
       }
-      else if (bankfflag == 2 && bankclosed == FALSE)
+      else if (ctx->bankfflag == 2 && bankclosed == FALSE)
       {
         e |= fprintf(fout, "%-16s%23.1f  %9.1f    %8.1f\r\n", UnitProcessTable[unit->type].name,
                      zero_lr, zero_lr, unit->data.bankf->crypto_lr_far);
@@ -724,7 +725,7 @@ int run_wtp(
       break;
 
     case PRESED_BASIN: /////////////////////////////////////////////////////////PRESED_BASIN//////////////
-      if (lt2presedflag == TRUE && presed_cntr < 1)
+      if (ctx->lt2presedflag == TRUE && presed_cntr < 1)
       {
         e |= fprintf(fout, "%-16s%23.1f  %9.1f    %8.1f\r\n", UnitProcessTable[unit->type].name,
                      zero_lr, zero_lr, unit->data.presed->crypto_lr);
@@ -734,7 +735,7 @@ int run_wtp(
       break;
 
     case SETTLING_BASIN: ///////////////////////////////////////////////2ND STAGE SOFTENING//////////////
-      if (soft2flag == TRUE && soft2_cntr < 1)
+      if (ctx->soft2flag == TRUE && soft2_cntr < 1)
       {
         e |= fprintf(fout, "%-17s%22.1f  %9.1f    %8.1f\r\n", soft2basin,
                      zero_lr, zero_lr, soft2_credit);
@@ -1171,13 +1172,13 @@ int run_wtp(
     e |= fdoublef(fout, "%7.2f", eff->o3_res);
     e |= fprintf(fout, "%7.2f", eff->clo2_res);
     /* e |= fdoublef(fout,"%7.2f", eff->processtime        );  */
-    if (influent->log_required_g == 999999.0 && gw_virus_flag == FALSE) //groundwater w/o virus dis. req'd.
+    if (influent->log_required_g == 999999.0 && ctx->gw_virus_flag == FALSE) //groundwater w/o virus dis. req'd.
     {
       e |= fprintf(fout, "    na");
       e |= fprintf(fout, "     na");
       e |= fprintf(fout, "    na");
     }
-    else if (influent->log_required_g == 999999.0 && gw_virus_flag == TRUE) //groundwater w/virus dis. req'd.
+    else if (influent->log_required_g == 999999.0 && ctx->gw_virus_flag == TRUE) //groundwater w/virus dis. req'd.
     {
       e |= fprintf(fout, "    na");
       e |= fdoublef(fout, "%8.1f", eff->ct_ratio_v);
@@ -1362,25 +1363,25 @@ int run_wtp(
 */
 
   /* RUN MODEL AGAIN and Print Inactivation at Min Temp & Max Flow */
-  coldflag = TRUE;
+  ctx->coldflag = TRUE;
   if (runmodel(train) == FALSE)
     return (FALSE);
-  coldflag = FALSE;
+  ctx->coldflag = FALSE;
 
-  if (swflag == TRUE)
+  if (ctx->swflag == TRUE)
     strcpy(buffer, "for Surface Water Plant ");
   else
     strcpy(buffer, "for Groundwater Plant ");
-  if (coagflag)
+  if (ctx->coagflag)
   {
-    if (filtflag)
+    if (ctx->filtflag)
       strcat(buffer, "with Coagulation and Filtration");
     else
       strcat(buffer, "with Coagulation");
   }
   else
   {
-    if (filtflag)
+    if (ctx->filtflag)
       strcat(buffer, "with Filtration");
     else
       strcat(buffer, ""); /* without coagulation or filtration. */
@@ -1412,13 +1413,13 @@ int run_wtp(
     e |= fdoublef(fout, "%7.2f", eff->o3_res);
     e |= fprintf(fout, "%7.2f", eff->clo2_res);
     /* e |= fdoublef(fout,"%7.2f", eff->processtime        );    */
-    if (influent->log_required_g == 999999.0 && gw_virus_flag == FALSE) //groundwater w/virus dis. req'd.
+    if (influent->log_required_g == 999999.0 && ctx->gw_virus_flag == FALSE) //groundwater w/virus dis. req'd.
     {
       e |= fprintf(fout, "    na");
       e |= fprintf(fout, "     na");
       e |= fprintf(fout, "    na");
     }
-    else if (influent->log_required_g == 999999.0 && gw_virus_flag == TRUE) //groundwater w/virus dis. req'd.
+    else if (influent->log_required_g == 999999.0 && ctx->gw_virus_flag == TRUE) //groundwater w/virus dis. req'd.
     {
       e |= fprintf(fout, "    na");
       e |= fdoublef(fout, "%8.1f", eff->ct_ratio_v);
@@ -1,7 +1,7 @@
 /* save_wtp.c */
 #include "wtp.h"
 
-int save_wtp(char *file_name, struct ProcessTrain *train, FILE *ferr)
+int save_wtp(const char *file_name, struct ProcessTrain *train, FILE *ferr)
 /*
 *  Purpose: Save process train data to a data file..
 *
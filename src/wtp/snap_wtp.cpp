@@ -0,0 +1,622 @@
+/* Snap_wtp.c -- Snapshots of a process train and its model context
+*
+*  A snapshot holds a copy of every unit process (data packet and
+*  effluent) and of the model context of the train, so that a process
+*  train can be rolled back or cloned.  The UnitProcess pointers in struct
+*  Effluent (influent, wtp_effluent, last_rm_inf, last_o3_inf) are saved
+*  as unit indices and relocated to the units of the train being restored;
+*  eff.ctx is pointed at the context of that train.
+*
+*  Unit copies are kept in reference counted blocks.  A snapshot taken
+*  with a base snapshot shares the blocks of the units that have not
+*  changed since the base was taken, so a sequence of snapshots of one
+*  train costs only the units that changed.
+*
+*  A snapshot can be written to a binary file (write_snapshot()), the
+*  compact counterpart of the text .wtp file: unit types and data packets,
+*  and optionally the effluents and model context.  read_wtp() loads either
+*  format.  The data packets are copied as they are, so a train converted
+*  between the two formats keeps every value.
+*
+*  The following functions are in this file:
+*    snapshot_train()
+*    restore_train()
+*    clone_train()
+*    FreeTrainSnapshot()
+*    write_snapshot()
+*    parse_snapshot()
+*    is_snapshot()
+*    save_snapshot()
+*    load_snapshot()
+*/
+#include "wtp.h"
+#include <stdint.h>
+
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+
+struct SnapshotHeader
+{                          /* Start of a snapshot file               */
+  char magic[8];           /*   SNAPSHOT_MAGIC                       */
+  uint32_t version;        /*   SNAPSHOT_VERSION                     */
+  uint32_t byte_order;     /*   SNAPSHOT_BYTE_ORDER as written       */
+  uint32_t n_units;        /*   Number of unit processes             */
+  uint32_t state;          /*   TRUE=effluents and context follow    */
+  uint32_t effluent_size;  /*   sizeof(struct Effluent) if state     */
+  uint32_t context_size;   /*   sizeof(struct WtpContext) if state   */
+};
+
+struct SnapshotUnit
+{                          /* Start of one unit in a snapshot file   */
+  int16_t type;            /*   Unit process type                    */
+  int16_t rel[4];          /*   UnitBlock.rel                        */
+  int16_t dbpmodel;        /*   Index+1 in dbp_model_names[], 0=NULL */
+  uint32_t size;           /*   Size of the data packet that follows */
+};
+
+/*
+*  The values runmodel() and influent() give eff.dbpmodel.  Files hold the
+*  index of the name, which is pointed back at this table when read.
+*/
+static const char *dbp_model_names[] = {
+    "Raw Water Model",
+    "Ozonated Water Model",
+    "Coagulated Water Model",
+    "GAC/Membrane-Treated Water Model",
+    "Raw Water Model (PRE-RM chlorination modified)",
+    "Raw Water Model (POST-RM chlorination modified)",
+    NULL};
+
+struct UnitBlock
+{                          /* Saved copy of one unit process        */
+  int refs;                /*   Number of snapshots using the block */
+  short type;              /*   Unit process type                   */
+  short rel[4];            /*   Index+1 of influent, wtp_effluent,  */
+                           /*   last_rm_inf, last_o3_inf; 0=NULL    */
+  size_t size;             /*   Size of data                        */
+  void *data;              /*   Copy of the data packet             */
+  struct Effluent eff;     /*   Effluent with the pointers cleared  */
+};
+
+static short unit_rel(struct UnitProcess **units, int n, struct UnitProcess *unit)
+/*
+*  Purpose: Return index+1 of 'unit' in units[], 0 if unit is NULL or not
+*           in the train.
+*/
+{
+  int i;
+
+  if (unit == NULL)
+    return (0);
+  for (i = 0; i < n; i++)
+    if (units[i] == unit)
+      return ((short)(i + 1));
+  return (0);
+}
+
+static struct UnitBlock *FreeUnitBlock(struct UnitBlock *block)
+{
+  if (block != NULL && --block->refs <= 0)
+  {
+    free(block->data);
+    free(block);
+  }
+  return (NULL);
+}
+
+static struct UnitBlock *save_unit(struct UnitProcess *unit, struct UnitProcess **units, int n,
+                                   struct UnitBlock *base)
+/*
+*  Purpose: Return a block holding 'unit'.  'base' is returned with its
+*           reference count incremented if it already holds the same unit.
+*/
+{
+  struct UnitBlock *block;
+  short rel[4];
+  struct Effluent eff;
+
+  rel[0] = unit_rel(units, n, unit->eff.influent);
+  rel[1] = unit_rel(units, n, unit->eff.wtp_effluent);
+  rel[2] = unit_rel(units, n, unit->eff.last_rm_inf);
+  rel[3] = unit_rel(units, n, unit->eff.last_o3_inf);
+
+  eff = unit->eff;
+  eff.influent = NULL;
+  eff.wtp_effluent = NULL;
+  eff.last_rm_inf = NULL;
+  eff.last_o3_inf = NULL;
+  eff.ctx = NULL;
+
+  if (base != NULL &&
+      base->type == unit->type &&
+      memcmp(base->rel, rel, sizeof(rel)) == 0 &&
+      memcmp(base->data, unit->data.ptr, base->size) == 0 &&
+      memcmp(&base->eff, &eff, sizeof(struct Effluent)) == 0)
+  {
+    base->refs++;
+    return (base);
+  }
+
+  if ((block = (struct UnitBlock *)calloc(1, sizeof(struct UnitBlock))) == NULL)
+    return (NULL);
+  block->refs = 1;
+  block->type = unit->type;
+  memcpy(block->rel, rel, sizeof(rel));
+  block->size = UnitDataSize(unit->type);
+  if ((block->data = malloc(block->size > 0 ? block->size : 1)) == NULL)
+  {
+    free(block);
+    return (NULL);
+  }
+  if (block->size > 0)
+    memcpy(block->data, unit->data.ptr, block->size);
+  memcpy(&block->eff, &eff, sizeof(struct Effluent));
+
+  return (block);
+}
+
+struct TrainSnapshot *snapshot_train(struct ProcessTrain *train, struct TrainSnapshot *base)
+/*
+*  Purpose: Save the state of a process train and its model context.
+*
+*  Inputs:
+*    train = Process train to save.
+*    base  = An earlier snapshot of the same train or NULL.  Units that
+*            are unchanged since 'base' share its blocks.
+*
+*  Return:
+*    The snapshot, or NULL if memory could not be allocated.  Release
+*    with FreeTrainSnapshot().
+*/
+{
+  struct TrainSnapshot *snap;
+  struct UnitProcess **units;
+  struct UnitProcess *unit;
+  int i, n = 0;
+
+  for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit))
+    n++;
+
+  if ((snap = (struct TrainSnapshot *)calloc(1, sizeof(struct TrainSnapshot))) == NULL)
+    return (NULL);
+  units = (struct UnitProcess **)calloc(n > 0 ? n : 1, sizeof(struct UnitProcess *));
+  snap->blocks = (struct UnitBlock **)calloc(n > 0 ? n : 1, sizeof(struct UnitBlock *));
+  if (units == NULL || snap->blocks == NULL)
+  {
+    free(units);
+    return (FreeTrainSnapshot(snap));
+  }
+
+  for (unit = FirstUnitProcess(train), i = 0; unit; unit = NextUnitProcess(unit), i++)
+    units[i] = unit;
+
+  for (i = 0; i < n; i++)
+  {
+    snap->blocks[i] = save_unit(units[i], units, n,
+                                (base != NULL && i < base->n_units) ? base->blocks[i] : NULL);
+    snap->n_units = i + 1;
+    if (snap->blocks[i] == NULL)
+    {
+      free(units);
+      return (FreeTrainSnapshot(snap));
+    }
+  }
+  free(units);
+
+  strncpy(snap->file_name, train->file_name, sizeof(snap->file_name) - 1);
+  snap->state = TRUE;
+  snap->ctx = train->ctx;
+
+  return (snap);
+}
+
+int restore_train(struct ProcessTrain *train, struct TrainSnapshot *snap)
+/*
+*  Purpose: Return a process train and its model context to the state
+*           saved in a snapshot.
+*
+*  Inputs:
+*    train = Process train to restore.  It need not be the train the
+*            snapshot was taken from.
+*    snap  = Snapshot from snapshot_train().
+*
+*  Return:
+*    TRUE/FALSE for success/fail.
+*
+*  Notes:
+*   1. If the unit types of 'train' match the snapshot the units are
+*      restored in place, otherwise the units of 'train' are rebuilt.
+*   2. A snapshot read from a file without state (see write_snapshot())
+*      restores the data packets only.  The effluents are cleared as in a
+*      new unit and the model context of 'train' is kept.
+*/
+{
+  struct UnitProcess **units;
+  struct UnitProcess *unit;
+  struct UnitBlock *block;
+  int i, n = 0, same = TRUE;
+
+  for (unit = FirstUnitProcess(train), i = 0; unit; unit = NextUnitProcess(unit), i++)
+  {
+    if (i >= snap->n_units || unit->type != snap->blocks[i]->type)
+      same = FALSE;
+    n++;
+  }
+  if (n != snap->n_units)
+    same = FALSE;
+
+  if (same == FALSE)
+  { /* Rebuild the list of units */
+    while ((unit = FirstUnitProcess(train)) != NULL)
+    {
+      MoveUnitProcess(NULL, unit);
+      FreeUnitProcess(unit);
+    }
+    train->plan = FreeTrainPlan(train->plan);
+    for (i = 0; i < snap->n_units; i++)
+      if (AddUnitProcess(train, snap->blocks[i]->type) == NULL)
+        return (FALSE);
+  }
+
+  if ((units = (struct UnitProcess **)calloc(snap->n_units > 0 ? snap->n_units : 1,
+                                             sizeof(struct UnitProcess *))) == NULL)
+    return (FALSE);
+  for (unit = FirstUnitProcess(train), i = 0; unit; unit = NextUnitProcess(unit), i++)
+    units[i] = unit;
+
+  for (i = 0; i < snap->n_units; i++)
+  {
+    block = snap->blocks[i];
+    unit = units[i];
+    if (block->size > 0)
+      memcpy(unit->data.ptr, block->data, block->size);
+    if (snap->state == FALSE)
+    {
+      memset(&unit->eff, 0, sizeof(struct Effluent));
+      unit->eff.ctx = &train->ctx;
+      continue;
+    }
+    unit->eff = block->eff;
+    unit->eff.influent = block->rel[0] ? units[block->rel[0] - 1] : NULL;
+    unit->eff.wtp_effluent = block->rel[1] ? units[block->rel[1] - 1] : NULL;
+    unit->eff.last_rm_inf = block->rel[2] ? units[block->rel[2] - 1] : NULL;
+    unit->eff.last_o3_inf = block->rel[3] ? units[block->rel[3] - 1] : NULL;
+    unit->eff.ctx = &train->ctx;
+  }
+  free(units);
+
+  strncpy(train->file_name, snap->file_name, sizeof(train->file_name) - 1);
+  if (snap->state == TRUE)
+    train->ctx = snap->ctx;
+
+  return (TRUE);
+}
+
+struct ProcessTrain *clone_train(struct ProcessTrain *train)
+/*
+*  Purpose: Return a new process train with the same units, data, and
+*           effluent as 'train'.  Effluent pointers refer to the units of
+*           the clone, which gets a copy of the model context and the
+*           evaluator of 'train'.  The distribution network of 'train',
+*           if any, is not cloned; see open_network().
+*/
+{
+  struct ProcessTrain *clone;
+  struct TrainSnapshot *snap;
+
+  if ((snap = snapshot_train(train, NULL)) == NULL)
+    return (NULL);
+  if ((clone = AllocProcessTrain()) != NULL && restore_train(clone, snap) == FALSE)
+    clone = FreeProcessTrain(clone);
+  if (clone != NULL)
+    clone->evaluator = train->evaluator;
+  FreeTrainSnapshot(snap);
+
+  return (clone);
+}
+
+struct TrainSnapshot *FreeTrainSnapshot(struct TrainSnapshot *snap)
+/*
+*  Purpose: Release a snapshot.  Blocks shared with other snapshots are
+*           kept until their last snapshot is released.  Returns NULL.
+*/
+{
+  int i;
+
+  if (snap)
+  {
+    for (i = 0; i < snap->n_units; i++)
+      FreeUnitBlock(snap->blocks[i]);
+    free(snap->blocks);
+    free(snap);
+  }
+  return (NULL);
+}
+
+static int dbp_model_index(const char *name)
+/*
+*  Purpose: Return index+1 of 'name' in dbp_model_names[], 0 for NULL and
+*           -1 for a name that is not in the table.
+*/
+{
+  int i;
+
+  if (name == NULL)
+    return (0);
+  for (i = 0; dbp_model_names[i] != NULL; i++)
+    if (name == dbp_model_names[i] || strcmp(name, dbp_model_names[i]) == 0)
+      return (i + 1);
+  return (-1);
+}
+
+int write_snapshot(FILE *fout, struct TrainSnapshot *snap, int state, FILE *ferr)
+/*
+*  Purpose: Write a snapshot to a binary file.
+*
+*  Inputs:
+*    fout  = The calling routine must fopen(..."wb") the file.
+*    snap  = Snapshot from snapshot_train().
+*    state = TRUE to write the effluents and model context as well as the
+*            unit types and data packets.  Ignored if 'snap' holds no state.
+*    ferr  = Where to print error messages.  Can be NULL.
+*
+*  Return:
+*    TRUE/FALSE for success/fail.
+*
+*  Notes:
+*   1. The file is written in native byte order:
+*        struct SnapshotHeader
+*        struct WtpContext              if state
+*        for each unit process:
+*          struct SnapshotUnit
+*          data packet                  SnapshotUnit.size bytes
+*          struct Effluent              if state, pointers cleared
+*      The version, byte order and the sizes of the structures are
+*      checked by parse_snapshot(); change SNAPSHOT_VERSION when the
+*      layout of a data packet changes.
+*   2. eff.dbpmodel is saved as its index in dbp_model_names[].  It and
+*      SnapshotUnit.rel are 0 without state, so that a train loaded from
+*      the file writes the same file again.
+*/
+{
+  struct SnapshotHeader header;
+  struct SnapshotUnit rec;
+  struct UnitBlock *block;
+  struct Effluent eff;
+  int i, model, ok;
+
+  state = (state == TRUE && snap->state == TRUE) ? TRUE : FALSE;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = SNAPSHOT_VERSION;
+  header.byte_order = SNAPSHOT_BYTE_ORDER;
+  header.n_units = (uint32_t)snap->n_units;
+  header.state = (uint32_t)state;
+  header.effluent_size = state ? sizeof(struct Effluent) : 0;
+  header.context_size = state ? sizeof(struct WtpContext) : 0;
+
+  ok = (fwrite(&header, sizeof(header), 1, fout) == 1);
+  if (ok && state)
+    ok = (fwrite(&snap->ctx, sizeof(struct WtpContext), 1, fout) == 1);
+
+  for (i = 0; ok && i < snap->n_units; i++)
+  {
+    block = snap->blocks[i];
+    if ((model = dbp_model_index(block->eff.dbpmodel)) < 0)
+    {
+      if (ferr != NULL)
+        fprintf(ferr, "Error: unit %d has an unknown DBP model \"%s\"\n", i + 1, block->eff.dbpmodel);
+      return (FALSE);
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    rec.type = block->type;
+    if (state)
+      memcpy(rec.rel, block->rel, sizeof(rec.rel));
+    rec.dbpmodel = (int16_t)(state ? model : 0);
+    rec.size = (uint32_t)block->size;
+    ok = (fwrite(&rec, sizeof(rec), 1, fout) == 1 &&
+          (block->size == 0 || fwrite(block->data, block->size, 1, fout) == 1));
+    if (ok && state)
+    {
+      eff = block->eff;
+      eff.dbpmodel = NULL;
+      ok = (fwrite(&eff, sizeof(eff), 1, fout) == 1);
+    }
+  }
+
+  if (!ok && ferr != NULL)
+    fprintf(ferr, "Error: could not write snapshot\n");
+  return (ok ? TRUE : FALSE);
+}
+
+int is_snapshot(const void *buf, size_t size)
+/*
+*  Purpose: Return TRUE if 'buf' starts with SNAPSHOT_MAGIC.
+*/
+{
+  return (size >= sizeof(struct SnapshotHeader) &&
+          memcmp(buf, SNAPSHOT_MAGIC, 8) == 0) ? TRUE : FALSE;
+}
+
+struct TrainSnapshot *parse_snapshot(const void *buf, size_t size, FILE *ferr)
+/*
+*  Purpose: Return the snapshot held in the 'size' bytes of 'buf', as
+*           written by write_snapshot().
+*
+*  Inputs:
+*    ferr = Where to print error messages.  Can be NULL.
+*
+*  Return:
+*    The snapshot, or NULL if 'buf' is not a valid snapshot of this
+*    version and machine or memory could not be allocated.  Release with
+*    FreeTrainSnapshot().  file_name is empty.
+*/
+{
+  const char *p = (const char *)buf;
+  const char *end = p + size;
+  struct SnapshotHeader header;
+  struct SnapshotUnit rec;
+  struct TrainSnapshot *snap;
+  struct UnitBlock *block;
+  int i, j, n_models;
+
+  for (n_models = 0; dbp_model_names[n_models] != NULL; n_models++)
+    ;
+
+  if (is_snapshot(buf, size) == FALSE)
+  {
+    if (ferr != NULL)
+      fprintf(ferr, "Error: not a process train snapshot\n");
+    return (NULL);
+  }
+  memcpy(&header, p, sizeof(header));
+  p += sizeof(header);
+  if (header.byte_order != SNAPSHOT_BYTE_ORDER || header.version != SNAPSHOT_VERSION ||
+      (header.state != FALSE && header.state != TRUE) ||
+      header.effluent_size != (header.state ? sizeof(struct Effluent) : 0) ||
+      header.context_size != (header.state ? sizeof(struct WtpContext) : 0))
+  {
+    if (ferr != NULL)
+      fprintf(ferr, "Error: not a version %d process train snapshot of this program\n", SNAPSHOT_VERSION);
+    return (NULL);
+  }
+  if (header.n_units > (uint32_t)(size / sizeof(struct SnapshotUnit)))
+  {
+    if (ferr != NULL)
+      fprintf(ferr, "Error: process train snapshot is truncated\n");
+    return (NULL);
+  }
+
+  if ((snap = (struct TrainSnapshot *)calloc(1, sizeof(struct TrainSnapshot))) == NULL ||
+      (snap->blocks = (struct UnitBlock **)calloc(header.n_units > 0 ? header.n_units : 1,
+                                                  sizeof(struct UnitBlock *))) == NULL)
+  {
+    if (ferr != NULL)
+      fprintf(ferr, "Error: cannot allocate memory for snapshot\n");
+    return (FreeTrainSnapshot(snap));
+  }
+  snap->state = (int)header.state;
+  if (snap->state)
+  {
+    if ((size_t)(end - p) < sizeof(struct WtpContext))
+      goto truncated;
+    memcpy(&snap->ctx, p, sizeof(struct WtpContext));
+    p += sizeof(struct WtpContext);
+  }
+
+  for (i = 0; i < (int)header.n_units; i++)
+  {
+    if ((size_t)(end - p) < sizeof(rec))
+      goto truncated;
+    memcpy(&rec, p, sizeof(rec));
+    p += sizeof(rec);
+
+    /* The data packet must be that of a known unit type */
+    if (rec.size == 0 || rec.size != UnitDataSize(rec.type) ||
+        rec.dbpmodel < 0 || rec.dbpmodel > n_models)
+    {
+      if (ferr != NULL)
+        fprintf(ferr, "Error: snapshot unit %d is not valid\n", i + 1);
+      return (FreeTrainSnapshot(snap));
+    }
+    for (j = 0; j < 4; j++)
+      if (rec.rel[j] < 0 || rec.rel[j] > (int)header.n_units)
+      {
+        if (ferr != NULL)
+          fprintf(ferr, "Error: snapshot unit %d refers to a missing unit\n", i + 1);
+        return (FreeTrainSnapshot(snap));
+      }
+    if ((size_t)(end - p) < rec.size + header.effluent_size)
+      goto truncated;
+
+    if ((block = (struct UnitBlock *)calloc(1, sizeof(struct UnitBlock))) == NULL ||
+        (block->data = malloc(rec.size)) == NULL)
+    {
+      free(block);
+      if (ferr != NULL)
+        fprintf(ferr, "Error: cannot allocate memory for snapshot\n");
+      return (FreeTrainSnapshot(snap));
+    }
+    block->refs = 1;
+    block->type = rec.type;
+    memcpy(block->rel, rec.rel, sizeof(block->rel));
+    block->size = rec.size;
+    memcpy(block->data, p, rec.size);
+    p += rec.size;
+    if (snap->state)
+    {
+      memcpy(&block->eff, p, sizeof(struct Effluent));
+      p += sizeof(struct Effluent);
+      block->eff.dbpmodel = rec.dbpmodel ? dbp_model_names[rec.dbpmodel - 1] : NULL;
+    }
+    snap->blocks[i] = block;
+    snap->n_units = i + 1;
+  }
+  return (snap);
+
+truncated:
+  if (ferr != NULL)
+    fprintf(ferr, "Error: process train snapshot is truncated\n");
+  return (FreeTrainSnapshot(snap));
+}
+
+int save_snapshot(const char *file_name, struct ProcessTrain *train, int state, FILE *ferr)
+/*
+*  Purpose: Save a process train to a binary file, the counterpart of
+*           save_wtp().  See write_snapshot() for 'state'.
+*
+*  Return:
+*    TRUE/FALSE for success/fail.  train->file_name is set on success.
+*/
+{
+  struct TrainSnapshot *snap;
+  FILE *fp;
+  int success;
+
+  if (file_name == NULL || strlen(file_name) == 0)
+    return (FALSE);
+  if ((snap = snapshot_train(train, NULL)) == NULL)
+  {
+    if (ferr != NULL)
+      fprintf(ferr, "Error: cannot allocate memory for snapshot\n");
+    return (FALSE);
+  }
+  if ((fp = fopen(file_name, "wb")) == NULL)
+  {
+    if (ferr != NULL)
+      fprintf(ferr, "Could not open %s\n", file_name);
+    FreeTrainSnapshot(snap);
+    return (FALSE);
+  }
+
+  success = write_snapshot(fp, snap, state, ferr);
+  if (fclose(fp) != 0)
+    success = FALSE;
+  if (success == TRUE)
+    strncpy(train->file_name, file_name, sizeof(train->file_name) - 1);
+  FreeTrainSnapshot(snap);
+
+  return (success);
+}
+
+int load_snapshot(const void *buf, size_t size, struct ProcessTrain *train, FILE *ferr)
+/*
+*  Purpose: Replace the units of 'train' with the snapshot held in the
+*           'size' bytes of 'buf'.  train->file_name is kept.
+*
+*  Return:
+*    TRUE/FALSE for success/fail.
+*/
+{
+  struct TrainSnapshot *snap;
+  int success;
+
+  if ((snap = parse_snapshot(buf, size, ferr)) == NULL)
+    return (FALSE);
+  strncpy(snap->file_name, train->file_name, sizeof(snap->file_name) - 1);
+  success = restore_train(train, snap);
+  FreeTrainSnapshot(snap);
+
+  return (success);
+}
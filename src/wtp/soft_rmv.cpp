@@ -50,15 +50,15 @@ void soft_rmv(struct UnitProcess *unit)
   { /* This is the only place TOC/UV removal will take place for softening */
 
     /* Estimate TOC Removal*/
-    term1 = pow(raw_toc, 1.3843);
-    term2 = pow(pH_soft, 2.2387);
-    term3 = pow(lime_dose, 0.1707);
-    term4 = pow((1.0 + coag_dose), 2.4402);
+    term1 = wtp_pow(raw_toc, 1.3843);
+    term2 = wtp_pow(pH_soft, 2.2387);
+    term3 = wtp_pow(lime_dose, 0.1707);
+    term4 = wtp_pow((1.0 + coag_dose), 2.4402);
     toc_removed = 0.0004657 * term1 * term2 * term3 * term4;
 
     /* Estimate UV-254 Removal*/
-    term1 = pow(toc_removed, 0.8367);
-    term2 = pow(suva_raw, 1.2501);
+    term1 = wtp_pow(toc_removed, 0.8367);
+    term2 = wtp_pow(suva_raw, 1.2501);
     uv_removed = 0.01685 * term1 * term2;
 
     /*Update Data Structure*/
@@ -9,6 +9,7 @@
 *
 *  Memory management functions for struct UnitProcess:
 *    AllocUnitProcess()
+*    UnitDataSize()
 *    FreeUnitProcess()
 *
 *  Functions which support building a process train:
@@ -47,6 +48,7 @@ struct ProcessTrain *AllocProcessTrain(void)
 
     /*clear memory*/
     memset(train->file_name, 0, sizeof(train->file_name));
+    InitWtpContext(&train->ctx);
 
     /* Let InitProcessTrain() do its thing. */
     InitProcessTrain(train);
@@ -72,6 +74,8 @@ struct ProcessTrain *FreeProcessTrain(register struct ProcessTrain *train)
       FreeUnitProcess(unit);
     }
 
+    FreeTrainPlan(train->plan);
+    FreeDistNetwork(train->network);
     free(train);
   }
 
@@ -85,6 +89,7 @@ struct ProcessTrain *InitProcessTrain(register struct ProcessTrain *train)
 *    1. Remove and deallocate all unit processes from process train.
 *    2. Add 'influent' unit process.
 *    3. train->file_name is not changes.
+*    4. Discard the execution plan, see plan_wtp.cpp.
 */
 {
   register struct UnitProcess *unit;
@@ -98,6 +103,7 @@ struct ProcessTrain *InitProcessTrain(register struct ProcessTrain *train)
       MoveUnitProcess(NULL, unit); /* Delink unit */
       FreeUnitProcess(unit);
     }
+    train->plan = FreeTrainPlan(train->plan);
 
     /* First unit process must be raw water */
     AddUnitProcess(train, INFLUENT);
@@ -421,6 +427,77 @@ struct UnitProcess *AllocUnitProcess(register short type)
   return (unit);
 }
 
+/*****************   UnitDataSize  ****************************************/
+size_t UnitDataSize(register short type)
+/*
+*  Purpose: Return the size of the unit process data packet allocated by
+*           AllocUnitProcess() for 'type', or 0 for an unknown type.
+*/
+{
+  switch (type)
+  {
+  case INFLUENT:
+    return (sizeof(struct Influent));
+  case ALUM:
+    return (sizeof(struct Alum));
+  case GAC:
+    return (sizeof(struct Gac));
+  case FILTER:
+    return (sizeof(struct Filter));
+  case BASIN:
+  case O3_CONTACTOR:
+  case RAPID_MIX:
+  case SLOW_MIX:
+  case SETTLING_BASIN:
+  case CONTACT_TANK:
+  case CLEARWELL:
+    return (sizeof(struct Basin));
+  case MFUF_UP:
+    return (sizeof(struct Mfuf));
+  case NF_UP:
+    return (sizeof(struct Nf));
+  case BANK_FILTER:
+    return (sizeof(struct Bankf));
+  case PRESED_BASIN:
+    return (sizeof(struct Presed));
+  case UV_DIS:
+    return (sizeof(struct Uvdis));
+  case SLOW_FILTER:
+    return (sizeof(struct Ssf));
+  case DE_FILTER:
+    return (sizeof(struct Def));
+  case BAG_FILTER:
+  case CART_FILTER:
+    return (sizeof(struct Altf));
+  case IRON:
+    return (sizeof(struct Iron));
+  case CHLORINE_DIOXIDE:
+    return (sizeof(struct clo2));
+  case LIME:
+    return (sizeof(struct lime));
+  case CHLORINE:
+  case SULFURIC_ACID:
+  case SODA_ASH:
+  case AMMONIA:
+  case AMMONIUM_SULFATE:
+  case PERMANGANATE:
+  case CARBON_DIOXIDE:
+  case OZONE:
+  case SODIUM_HYDROXIDE:
+  case HYPOCHLORITE:
+  case SULFUR_DIOXIDE:
+    return (sizeof(struct chemical));
+  case WTP_EFFLUENT:
+  case AVG_TAP:
+  case LOCATION_1:
+    return (sizeof(struct Avg_tap));
+  case END_OF_SYSTEM:
+    return (sizeof(struct End_of_system));
+  default:
+    return (0);
+  }
+}
+
 /*****************   FreeUnitProcess  ********************************/
 struct UnitProcess *FreeUnitProcess(register struct UnitProcess *unit)
 /*
@@ -434,6 +511,7 @@ struct UnitProcess *FreeUnitProcess(register struct UnitProcess *unit)
       MoveUnitProcess(NULL, unit);
     if (unit->data.ptr != NULL)
       free(unit->data.ptr);
+    FreeUnitMemo(unit->memo);
     free(unit);
   }
 
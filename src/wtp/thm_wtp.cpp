@@ -24,6 +24,7 @@ int thm_wtp(
 *     April 1993
 */
 {
+  struct WtpContext *ctx = &train->ctx;
   int numprocs;
   double *CT_saved;
   double log_required_init;
@@ -51,7 +52,7 @@ int thm_wtp(
   CT_saved = (double *)calloc(3 * numprocs + 10, sizeof(double));
   CT_index = 0;
 
-  coldflag = TRUE;
+  ctx->coldflag = TRUE;
 
   runmodel(train);
   for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit))
@@ -71,7 +72,7 @@ int thm_wtp(
     CT_index++;
   }
 
-  coldflag = FALSE;
+  ctx->coldflag = FALSE;
   if (runmodel(train) == FALSE)
     return (FALSE);
 
@@ -35,7 +35,7 @@ int writewtp(FILE *fp, struct ProcessTrain *train, FILE *ferr)
   short tab = 0;
   struct DataID *data;
   int max_unit_types;
-  char buffer[80];
+  char buffer[WTP_WRITE_LEN];
 
   if (fp == NULL || train == NULL)
     return (FALSE);
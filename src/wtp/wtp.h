@@ -42,110 +42,234 @@ char *strlwr(char *string); /*   "      "     "  lower  "   */
 /* Mathematical constants */
 #define PI acos(-1.0)
 
-/****************  WTP Global variables located in Globals.c  *************/
+/****************  WTP Model context, see Globals.c  *********************/
 
-extern int coldflag; /* TRUE=Run model at low temperature  (TRUE/FALSE) */
+struct PhCache
+{ /* phchange() inputs of its last call, see phchange() note 4 */
+  double pH, DegK, Ca_aq, Ca_solid, Mg_aq, Mg_solid, CO2_aq;
+  double NH3, FreeCl2, CBminusCA;
+};
+
+struct ThermoCoef
+{ /* Temperature dependent coefficients at k_DegK, see thermo_coef() */
+  double k_DegK;
+  double kw, k1, k2, k_hocl, k_nh3;
+  double k_mgoh, k_mgoh2, k_mgoh2aq, k_caoh, k_caco3, k_caoh2aq;
+};
+
+struct Cl2DecayCoef
+{ /* Chlorine decay parameters of a water, see cl2decay_start() */
+  double free_a1; /* alpha1 for free chlorine     (mg/L)  */
+  double free_a2; /* alpha2 for free chlorine (mg/L/hr)   */
+  double comb_a1; /* alpha1 for chloramine        (mg/L)  */
+  double comb_a2; /* alpha2 for chloramine    (mg/L/hr)   */
+};
+
+struct DistStart
+{ /* Plant effluent entering the distribution system, see dist_dbp() */
+  int valid;                 /* TRUE=set by a sampling point of this run   */
+  double pH, Alk, CBminusCA; /* Effluent after phchange() and breakpt()    */
+  double Ca_aq, Ca_solid, Mg_aq, Mg_solid, CO2_aq;
+  double FreeCl2, NH3, NH2Cl, NHCl2;
+  struct PhCache ph_cache;   /* ctx->ph_cache at the same point            */
+  struct Cl2DecayCoef coef;  /* From cl2decay_start()                      */
+
+  /* One trajectory for all points, ctx->dist_trajectory=TRUE */
+  double cfstr_time;          /* CFSTR time of the trajectory        (hrs) */
+  int n_cl2;                  /* CFSTRs run for chlorine so far            */
+  double FreeCl2_n, NH2Cl_n;  /* Residuals after n_cl2 CFSTRs              */
+  double hours_n;
+  int n_clo2;                 /* CFSTRs run for ClO2 so far                */
+  double clo2_res_n, clo2_minutes_n;
+};
+
+/* Kernels memoized per unit process, see memo_wtp.cpp */
+#define MEMO_PHCHANGE 0
+#define MEMO_ALUM_RMV 1
+#define MEMO_EC_COMPLY 2
+#define MEMO_CT 3
+#define MEMO_NKERNELS 4
+#define MEMO_WAYS 3     /* Input/output pairs kept per kernel and unit    */
+#define MEMO_MAX_IN 28  /* Max. inputs of a memoized kernel               */
+#define MEMO_MAX_OUT 10 /* Max. outputs of a memoized kernel              */
+
+struct MemoStats
+{ /* Calls and memo hits of each kernel, see print_memo_stats() */
+  long calls[MEMO_NKERNELS];
+  long hits[MEMO_NKERNELS];
+};
+
+#define DBP_NPOWERS 36 /* Max. distinct time exponents of a DBP model    */
+#define DBP_NCARRY 4   /* Contact times kept by dbp_formation()          */
+#define DBP_NSPECIES 18 /* Species of a DBP model, DBP_... below          */
+
+struct DbpPowers
+{ /* Powers of a contact time in a DBP model, see dbp_formation() note 3 */
+  int model;                /* DBP_..._MODEL                            */
+  double hours;             /* Contact time, 0.0 = empty                */
+  double t[DBP_NPOWERS];    /* hours^e for the exponents of the model   */
+};
+
+struct DbpCoefs
+{ /* Species terms of the last water of dbp_formation(), see its note 4 */
+  int model;                /* DBP_..._MODEL                            */
+  unsigned rows;            /* Species evaluated, see dbp_rows()        */
+  double in[6];             /* doc, uv, cl2dose, br, DegC, pH; 0=empty  */
+  double k[DBP_NSPECIES];   /* k[s] of dbp_formation()                  */
+};
+
+/* Outputs of runmodel() that can be left out, see plan_wtp.cpp */
+#define WTP_OUT_TTHM 0x0001        /* TTHM                                    */
+#define WTP_OUT_HAA5 0x0002        /* HAA5 and HAA6                           */
+#define WTP_OUT_THM_SPECIES 0x0004 /* CHCl3, CHBrCl2, CHBr2Cl, CHBr3          */
+#define WTP_OUT_HAA_SPECIES 0x0008 /* MCAA, DCAA, TCAA, MBAA, DBAA, BCAA      */
+#define WTP_OUT_HAA9 0x0010        /* HAA9, TBAA, DBCAA, BDCAA                */
+#define WTP_OUT_TOX 0x0020         /* tox                                     */
+#define WTP_OUT_BROMIDE 0x0040     /* Br taken up by DBPs and bromate         */
+#define WTP_OUT_BROMATE 0x0080     /* BrO3                                    */
+#define WTP_OUT_SOLIDS 0x0100      /* solids                                  */
+#define WTP_OUT_EC 0x0200          /* ec_meeting_step1, ec_exempt             */
+#define WTP_OUT_CT 0x0400          /* ct_ratio, ct_ratio_v, ct_ratio_c, and   */
+                                   /* the CT and log inactivation totals      */
+#define WTP_NOUTPUTS 11
+#define WTP_OUT_ALL 0x07ff
+#define WTP_OUT_OBJECTIVES (WTP_OUT_TTHM | WTP_OUT_HAA5 | WTP_OUT_SOLIDS | \
+                            WTP_OUT_EC | WTP_OUT_CT) /* Read by wtp() */
 
 /*
-*  swflag, coagflag and filtflag
-*
-*  Version 1.4 does not estimate giardia or virus inactivation through
-*  the process train.  Instead, a term named 'ct_ratio' is computed.  The
-*  ct_ratio is intended to express the level of inactivation relative to
-*  the SWTR.  A ct_ratio less than 1.0 indicates that the treatment process
-*  is out of compliance, a value greater than 1.0 indicates compliance.
-*
-*  The 'swflag' is used to indicate if giardia or virus inactivation should
-*  be used to determine the required CT.  The flag is needed at the first
-*  point of chlorination and does not change through the process train.
-*
-*  'coagflag' and 'filtflag' are used to indicate that CT credits
-*  should be given for coagulation and filtration.  In version 1.4, the
-*  flags are cleared and re-set in runmodel() and processed by ct().
-*
-*  'coagflag' and 'filtflag' could not be implemented in the Effluent data
-*  structure because the required CT needs coagflag and filtflag at the
-*  first point of chlorination which may be before coagulation and
-*  filtration.
-*
-*  Planned change:
-*    1. Track Giardia and virus inactivation/removal through the treatment
-*       process and eliminate ct_ratio.
-*    2. Re-examine if coagflag and filtflag are needed.
+*  struct WtpContext holds everything one evaluation of a process train
+*  changes outside of its UnitProcess data: the flags that describe the
+*  train, the flags and totals that change as runmodel() moves down the
+*  train, and the caches of phchange().  Each ProcessTrain owns one, and
+*  runmodel() hands it to the unit process models through eff.ctx, so
+*  trains on different threads share no writable state.
 */
-extern int swflag;        // TRUE=Surface Water                                     (TRUE/FALSE) */
-extern int gw_virus_flag; // TRUE=Groundwater with virus disinfection required (TRUE/FALSE)*/
-extern int coagflag;      //* TRUE=Process train has alum, iron, or lime coagulation (TRUE/FALSE) */
-extern int conv_filtflag; //* TRUE=Process train has conv. filtration, coag/flocc/sed/filt, as
-                          //    1st filtration stage (TRUE/FALSE) */
-extern int filtflag;      //* TRUE=conv_filtflag, dir_filtflag, bagfflag, cartfflag, ssfflag, defflag, OR
-                          //	nfflag is TRUE */
-extern int filt2flag;     // TRUE= There is a second stage of some kind of filtration
-extern int softflag;      //* TRUE=Process train has a lime dose with softening purpose (T/F) */
-extern int soft2flag;     //* TRUE=Process train has a 2nd stage of softening (T/F) */
-extern int floccflag;     //* TRUE=Process train has flocculation basin      (TRUE/FALSE) */
-extern int sedflag;       //* TRUE=Process train has sedimentation           (TRUE/FALSE) */
-extern int sedconvflag;   //* TRUE=Process train has sedimentation after coagflag is TRUE before filtflag is TRUE
-extern int gacflag;       //* TRUE=Process train has GAC                     (TRUE/FALSE) */
-extern int mfufflag;      //* TRUE=Process train has an MF/UF as 1st filter stage (TRUE/FALSE) */
-extern int nfflag;        //* TRUE=Process train has an NF as 1st filter stage (TRUE/FALSE) */
-extern int ssfflag;       //* TRUE=Process train has a slow sand filter as 1st filter stage (TRUE/FALSE) */
-extern int defflag;       //* TRUE=Process train has a diatomaceous earth as 1st filter stage (TRUE/FALSE) */
-extern int bagfflag;      //* TRUE=Process train has a bag filter as 1st filter stage (TRUE/FALSE) */
-extern int cartfflag;     //* TRUE=Process train has a cartridge filter as 1st filter stage (TRUE/FALSE) */
-extern int bankfflag;     //* 0=No bank filtration, 1=bank filtration for small credit, 2=bank filt for large credit */
-extern int granf2flag;    //* TRUE=Process train has FILTER as 2nd filter stage (TRUE/FALSE) */
-extern int gac2flag;      //* TRUE=Process train has GAC as second filter stage (TRUE/FALSE) */
-extern int mfuf2flag;     //* TRUE=Process train has an MF/UF as 2nd filter stage (TRUE/FALSE) */
-extern int nf2flag;       //* TRUE=Process train has an NF as 2nd filter stage (TRUE/FALSE) */
-extern int ssf2flag;      //* TRUE=Process train has a slow sand filter as 2nd filter stage (TRUE/FALSE) */
-extern int def2flag;      //* TRUE=Process train has a diatomaceous earth as 2nd filter stage (TRUE/FALSE) */
-extern int bagf2flag;     //* TRUE=Process train has a bag filter as 2nd filter stage (TRUE/FALSE) */
-extern int cartf2flag;    //* TRUE=Process train has a cartridge filter as 2nd filter stage (TRUE/FALSE) */
-extern int lt2presedflag; //* TRUE=Process train has a lt2 toolbox presed basin with coag. (TRUE/FALSE) */
-extern int cfeflag;       //* TRUE=First stage conv./direct filter meets CFE criterion for toolbox (T/F) */
-extern int ifeflag;       //* TRUE=First stage conv./direct filter meets IFE criterion for toolbox (T/F) */
-extern int uvflag;        //* TRUE=Process train has a UV process            (TRUE/FALSE) */
-extern int lt2_wscp_flag; //* TRUE=Credit for 0.5-log Crypto reduction from watershed control granted */
-extern int o3flag;        //* TRUE=Process train has ozonation               (TRUE/FALSE) */
-extern int pre_o3flag;    //* TRUE=Process train has pre-ozonation           (TRUE/FALSE) */
-extern int int_o3flag;    //* TRUE=Process train has int-ozonation           (TRUE/FALSE) */
-extern int post_o3flag;   //* TRUE=Process train has post-ozonation          (TRUE/FALSE) */
-extern int clo2flag;      //* TRUE=Process train has chlorine dioxide        (TRUE/FALSE) */
-extern int dir_filtflag;  //* TRUE=Process train has coag and filtration as 1st filter stage (TRUE/FALSE) */
-extern int bio_filtflag;  //* TRUE=Process train has biofiltration           (TRUE/FALSE) */
-                          //* These flags determine what DBP formation model is in effect for each
-                          //   process in the train as the main loop is executed in runmodel */
-extern int rwdbpflag;     //* TRUE=use raw water DBP formation model for current process  */
-extern int owdbpflag;     //* TRUE=use ozonated water DBP formation model for current process  */
-extern int coagdbpflag;   //* TRUE=use coagulated water DBP formation model for current process  */
-extern int modrw1dbpflag; //* TRUE=use raw water DBP formation model
-                          //       modified with Pre-RM factor for current process  */
-extern int modrw2dbpflag; //* TRUE=use raw water DBP formation model
-                          //	   modified with Post-RM factor for current process  */
-extern int gacmemdbpflag; //* TRUE=use gac-/nf(membrane)-treated water model for current process */
-
-extern double nonconv_discredit; //sum of the UV inactivation and membrane, bankfilt, bagfilt, cartfilt
-                                 // removal credits for LT2 compliance checking
-extern double bin34_inactreqd;   //Amount of Crypto CT required based on the 1.0-log requirement for various techs. controlling
-
-/* Global time counter and chlorine variable for modrw2dbp() */
-extern double modrw2dbptime; /* =0 if no chlorine before RM; = RM mean det. time (hrs.) if
+struct WtpContext
+{
+  int coldflag; /* TRUE=Run model at low temperature  (TRUE/FALSE) */
+
+  /*
+  *  swflag, coagflag and filtflag
+  *
+  *  Version 1.4 does not estimate giardia or virus inactivation through
+  *  the process train.  Instead, a term named 'ct_ratio' is computed.  The
+  *  ct_ratio is intended to express the level of inactivation relative to
+  *  the SWTR.  A ct_ratio less than 1.0 indicates that the treatment process
+  *  is out of compliance, a value greater than 1.0 indicates compliance.
+  *
+  *  The 'swflag' is used to indicate if giardia or virus inactivation should
+  *  be used to determine the required CT.  The flag is needed at the first
+  *  point of chlorination and does not change through the process train.
+  *
+  *  'coagflag' and 'filtflag' are used to indicate that CT credits
+  *  should be given for coagulation and filtration.  In version 1.4, the
+  *  flags are cleared and re-set in runmodel() and processed by ct().
+  *
+  *  'coagflag' and 'filtflag' could not be implemented in the Effluent data
+  *  structure because the required CT needs coagflag and filtflag at the
+  *  first point of chlorination which may be before coagulation and
+  *  filtration.
+  *
+  *  Planned change:
+  *    1. Track Giardia and virus inactivation/removal through the treatment
+  *       process and eliminate ct_ratio.
+  *    2. Re-examine if coagflag and filtflag are needed.
+  */
+  int swflag;        // TRUE=Surface Water                                     (TRUE/FALSE) */
+  int gw_virus_flag; // TRUE=Groundwater with virus disinfection required (TRUE/FALSE)*/
+  int coagflag;      //* TRUE=Process train has alum, iron, or lime coagulation (TRUE/FALSE) */
+  int conv_filtflag; //* TRUE=Process train has conv. filtration, coag/flocc/sed/filt, as
+                     //    1st filtration stage (TRUE/FALSE) */
+  int filtflag;      //* TRUE=conv_filtflag, dir_filtflag, bagfflag, cartfflag, ssfflag, defflag, OR
+                     //	nfflag is TRUE */
+  int filt2flag;     // TRUE= There is a second stage of some kind of filtration
+  int softflag;      //* TRUE=Process train has a lime dose with softening purpose (T/F) */
+  int soft2flag;     //* TRUE=Process train has a 2nd stage of softening (T/F) */
+  int floccflag;     //* TRUE=Process train has flocculation basin      (TRUE/FALSE) */
+  int sedflag;       //* TRUE=Process train has sedimentation           (TRUE/FALSE) */
+  int sedconvflag;   //* TRUE=Process train has sedimentation after coagflag is TRUE before filtflag is TRUE
+  int gacflag;       //* TRUE=Process train has GAC                     (TRUE/FALSE) */
+  int mfufflag;      //* TRUE=Process train has an MF/UF as 1st filter stage (TRUE/FALSE) */
+  int nfflag;        //* TRUE=Process train has an NF as 1st filter stage (TRUE/FALSE) */
+  int ssfflag;       //* TRUE=Process train has a slow sand filter as 1st filter stage (TRUE/FALSE) */
+  int defflag;       //* TRUE=Process train has a diatomaceous earth as 1st filter stage (TRUE/FALSE) */
+  int bagfflag;      //* TRUE=Process train has a bag filter as 1st filter stage (TRUE/FALSE) */
+  int cartfflag;     //* TRUE=Process train has a cartridge filter as 1st filter stage (TRUE/FALSE) */
+  int bankfflag;     //* 0=No bank filtration, 1=bank filtration for small credit, 2=bank filt for large credit */
+  int granf2flag;    //* TRUE=Process train has FILTER as 2nd filter stage (TRUE/FALSE) */
+  int gac2flag;      //* TRUE=Process train has GAC as second filter stage (TRUE/FALSE) */
+  int mfuf2flag;     //* TRUE=Process train has an MF/UF as 2nd filter stage (TRUE/FALSE) */
+  int nf2flag;       //* TRUE=Process train has an NF as 2nd filter stage (TRUE/FALSE) */
+  int ssf2flag;      //* TRUE=Process train has a slow sand filter as 2nd filter stage (TRUE/FALSE) */
+  int def2flag;      //* TRUE=Process train has a diatomaceous earth as 2nd filter stage (TRUE/FALSE) */
+  int bagf2flag;     //* TRUE=Process train has a bag filter as 2nd filter stage (TRUE/FALSE) */
+  int cartf2flag;    //* TRUE=Process train has a cartridge filter as 2nd filter stage (TRUE/FALSE) */
+  int lt2presedflag; //* TRUE=Process train has a lt2 toolbox presed basin with coag. (TRUE/FALSE) */
+  int cfeflag;       //* TRUE=First stage conv./direct filter meets CFE criterion for toolbox (T/F) */
+  int ifeflag;       //* TRUE=First stage conv./direct filter meets IFE criterion for toolbox (T/F) */
+  int uvflag;        //* TRUE=Process train has a UV process            (TRUE/FALSE) */
+  int lt2_wscp_flag; //* TRUE=Credit for 0.5-log Crypto reduction from watershed control granted */
+  int o3flag;        //* TRUE=Process train has ozonation               (TRUE/FALSE) */
+  int pre_o3flag;    //* TRUE=Process train has pre-ozonation           (TRUE/FALSE) */
+  int int_o3flag;    //* TRUE=Process train has int-ozonation           (TRUE/FALSE) */
+  int post_o3flag;   //* TRUE=Process train has post-ozonation          (TRUE/FALSE) */
+  int clo2flag;      //* TRUE=Process train has chlorine dioxide        (TRUE/FALSE) */
+  int dir_filtflag;  //* TRUE=Process train has coag and filtration as 1st filter stage (TRUE/FALSE) */
+  int bio_filtflag;  //* TRUE=Process train has biofiltration           (TRUE/FALSE) */
+                     //* These flags determine what DBP formation model is in effect for each
+                     //   process in the train as the main loop is executed in runmodel */
+  int rwdbpflag;     //* TRUE=use raw water DBP formation model for current process  */
+  int owdbpflag;     //* TRUE=use ozonated water DBP formation model for current process  */
+  int coagdbpflag;   //* TRUE=use coagulated water DBP formation model for current process  */
+  int modrw1dbpflag; //* TRUE=use raw water DBP formation model
+                     //       modified with Pre-RM factor for current process  */
+  int modrw2dbpflag; //* TRUE=use raw water DBP formation model
+                     //	   modified with Post-RM factor for current process  */
+  int gacmemdbpflag; //* TRUE=use gac-/nf(membrane)-treated water model for current process */
+
+  double nonconv_discredit; //sum of the UV inactivation and membrane, bankfilt, bagfilt, cartfilt
+                            // removal credits for LT2 compliance checking
+  double bin34_inactreqd;   //Amount of Crypto CT required based on the 1.0-log requirement for various techs. controlling
+
+  /* Global time counter and chlorine variable for modrw2dbp() */
+  double modrw2dbptime; /* =0 if no chlorine before RM; = RM mean det. time (hrs.) if
 					chlorine before RM; set in runmodel(), used in
 					modrw2dbp()*/
-extern double modrw2dbpcl2;
+  double modrw2dbpcl2;
 
-/* Globals added for pathogen removal by filtration/membranes used in ct()*/
+  /* Globals added for pathogen removal by filtration/membranes used in ct()*/
 
-//These contain the total amount of disinfection required in logs before any credits for
-// treatment, source water protection, etc., are granted
-extern double tot_dis_req_g;
-extern double tot_dis_req_c;
-extern double tot_dis_req_v;
+  //These contain the total amount of disinfection required in logs before any credits for
+  // treatment, source water protection, etc., are granted
+  double tot_dis_req_g;
+  double tot_dis_req_c;
+  double tot_dis_req_v;
 
-extern double tot_crypto_lr;
-extern double tot_giardia_lr;
-extern double tot_virus_lr;
+  double tot_crypto_lr;
+  double tot_giardia_lr;
+  double tot_virus_lr;
+
+  /* Caches of phchange(), thermo_coef() and dbp_formation() */
+  struct PhCache ph_cache;
+  struct ThermoCoef thermo;
+  struct DbpPowers dbp_powers[DBP_NCARRY];
+  int dbp_next; /* Next dbp_powers[] to replace */
+  struct DbpCoefs dbp_coefs;
+
+  /* Unit kernel memos, see memo_wtp.cpp */
+  int memo; /* TRUE=memoize phchange(), alum_rmv(), ec_comply(), ct() */
+  struct MemoStats memo_stats;
+
+  /* Distribution system sampling points, see dist_dbp() */
+  int dist_trajectory; /* TRUE=evaluate all points on one trajectory */
+  struct DistStart dist;
+
+  /* Outputs of runmodel(), see out_need() */
+  unsigned outputs; /* WTP_OUT_... wanted by the caller, WTP_OUT_ALL = all */
+  unsigned need;    /* WTP_OUT_... the unit being run must compute        */
+
+  int run_number; /* Number of auto_dose() model runs */
+};
 
 /************  Data structures for Water Treatment Plant ***************/
 
@@ -277,6 +401,12 @@ struct Effluent
     */
   struct UnitProcess *wtp_effluent;
 
+  /*
+    *  ctx is set by runmodel() to the context of the process train being
+    *  run, see struct WtpContext.
+    */
+  struct WtpContext *ctx;
+
   /* The following variable needs to be documented.  */
   double cl2dose; /* Appears to be total chlorine residual.
 		     *  (mg/L) as Cl2.  Check out decay.c     */
@@ -346,6 +476,45 @@ struct ProcessTrain
   struct UnitProcess *null; /*   Always NULL                         */
   struct UnitProcess *tail; /*   Last UnitProcess in ProcessTrain    */
   char file_name[120];      /*   Full path and extension             */
+  struct TrainPlan *plan;   /*   Compiled execution plan or NULL     */
+  struct WtpContext ctx;    /*   Model flags and caches of the train */
+  int (*evaluator)(struct ProcessTrain *train); /* gen_wtp() runmodel or NULL */
+  struct DistNetwork *network; /* Sampling nodes or NULL, see open_network() */
+};                          /*****************************************/
+
+/*****************************************/
+struct RunState;            /* Per-run counters, see runmodel()      */
+struct PlanStep;
+typedef int (*RUN_STEP)(struct UnitProcess *unit, const struct PlanStep *step,
+                        struct RunState *state);
+
+struct PlanStep
+{                           /* One compiled step of runmodel()       */
+  struct UnitProcess *unit; /*   Unit process evaluated by this step */
+  short type;               /*   unit->type when compiled            */
+  short sign;               /*   Dose sign/purpose key, see plan_key */
+  short next_type;          /*   Type of next unit, VACANT at tail   */
+  short elide;              /*   TRUE=unit can not change the water  */
+  unsigned need;            /*   WTP_OUT_... this unit must compute  */
+  RUN_STEP exec;            /*   Model function for this unit        */
+};                          /*****************************************/
+
+struct TrainPlan
+{                           /* Compiled runmodel() execution plan    */
+  int n_steps;              /*   Number of unit processes            */
+  struct PlanStep *steps;   /*   One step per unit process           */
+  unsigned outputs;         /*   ctx.outputs the plan was built for  */
+
+  /* Context flags after the flag setting passes of runmodel()        */
+  int gw_virus_flag, coagflag, conv_filtflag, filtflag, filt2flag;
+  int softflag, soft2flag, floccflag, sedflag, sedconvflag, gacflag;
+  int mfufflag, nfflag, ssfflag, defflag, bagfflag, cartfflag, bankfflag;
+  int granf2flag, gac2flag, mfuf2flag, nf2flag, ssf2flag, def2flag;
+  int bagf2flag, cartf2flag, lt2presedflag, cfeflag, ifeflag, uvflag;
+  int lt2_wscp_flag, o3flag, pre_o3flag, int_o3flag, post_o3flag;
+  int clo2flag, dir_filtflag;
+  double nonconv_discredit;
+  double tot_crypto_lr, tot_giardia_lr, tot_virus_lr;
 };                          /*****************************************/
 
 struct UnitProcess
@@ -378,6 +547,7 @@ struct UnitProcess
   } data;
 
   struct Effluent eff;
+  struct UnitMemo *memo; /* Kernel memos of the unit, see memo_wtp.cpp */
 };
 
 /********** Data structures for simulation parameters **********/
@@ -731,6 +901,10 @@ struct UnitInfo
   int (*write)(char *buffer, short i, struct UnitProcess *unit);
 };
 
+/* Size of the buffer given to write(): "%lf" of -DBL_MAX is 317
+   characters, and parse_wtp() accepts any double */
+#define WTP_WRITE_LEN 320
+
 /*
 *  UnitProcessTable[] is the controlling structure that contains text
 *  describing all unit process known by WTP model and the data elements.
@@ -806,6 +980,7 @@ int writewtp(FILE *fout, struct ProcessTrain *train, FILE *ferr);
 
 int open_wtp(const char *file_name, struct ProcessTrain *train, FILE *fout);
 int read_wtp(FILE *fin, struct ProcessTrain *train, FILE *fout);
+int parse_wtp(const char *text, size_t size, struct ProcessTrain *train, FILE *fout);
 
 int list_wtp(struct ProcessTrain *train, FILE *fout);
 int run_wtp(struct ProcessTrain *train, FILE *fout);
@@ -890,13 +1065,139 @@ int write_so2(char *buffer, short i, struct UnitProcess *unit);
 
 /* Supporting I/O functions */
 int ftab(FILE *fp, register short tab);
-int read_line(FILE *fp, char **id, char **value);
 int fdoublef(FILE *fp, const char *fmt, double x);
-int strip_buffer(char buffer[], FILE *fout);
 
 /****************  Model functions **************************/
 
 int runmodel(struct ProcessTrain *train);
+int run_plan(struct ProcessTrain *train);
+RUN_STEP run_step(short type, short elide);
+void finish_unit(struct UnitProcess *unit);
+void reset_run_context(struct WtpContext *ctx);
+
+/* Specialized runmodel() for one process train: gen_wtp.cpp */
+int gen_wtp(FILE *fout, struct ProcessTrain *train, const char *name, FILE *ferr);
+
+/* Lane-batched execution of WTP_LANES process trains: runmodel.cpp,
+   phchange.cpp and breakpt.cpp */
+#ifndef WTP_LANES
+#define WTP_LANES 8
+#endif
+
+struct EffluentLanes
+{ /* Structure of arrays of the Effluent terms of breakpt() and phchange() */
+  int n;                          /* Number of lanes in use           */
+  int mask[WTP_LANES];            /* TRUE=lane takes part in a kernel */
+  short limesoftening[WTP_LANES];
+  double pH[WTP_LANES];
+  double DegK[WTP_LANES];
+  double Ca_aq[WTP_LANES];
+  double Ca_solid[WTP_LANES];
+  double Mg_aq[WTP_LANES];
+  double Mg_solid[WTP_LANES];
+  double CO2_aq[WTP_LANES];
+  double NH3[WTP_LANES];
+  double FreeCl2[WTP_LANES];
+  double NH2Cl[WTP_LANES];
+  double CBminusCA[WTP_LANES];
+};
+
+int runmodel_lanes(struct ProcessTrain *train[], int n);
+void breakpt_lanes(struct EffluentLanes *lanes);
+void phchange_lanes(struct UnitProcess *unit[], int n);
+
+/* Process train snapshots: located in snap_wtp.cpp */
+struct UnitBlock;
+struct TrainSnapshot
+{                              /* Saved process train, see snap_wtp.cpp */
+  int n_units;                 /*   Number of unit processes            */
+  struct UnitBlock **blocks;   /*   Saved unit processes, shared        */
+  char file_name[120];         /*   train->file_name                    */
+  int state;                   /*   TRUE=effluents and ctx are saved    */
+  struct WtpContext ctx;       /*   train->ctx                          */
+};
+
+struct TrainSnapshot *snapshot_train(struct ProcessTrain *train, struct TrainSnapshot *base);
+int restore_train(struct ProcessTrain *train, struct TrainSnapshot *snap);
+struct ProcessTrain *clone_train(struct ProcessTrain *train);
+struct TrainSnapshot *FreeTrainSnapshot(struct TrainSnapshot *snap);
+
+/* Binary process train files: located in snap_wtp.cpp */
+#define SNAPSHOT_MAGIC "WTPSNAP" /* First 8 bytes of a snapshot file       */
+#define SNAPSHOT_VERSION 1       /* Layout of snapshot files, see write_snapshot() */
+int write_snapshot(FILE *fout, struct TrainSnapshot *snap, int state, FILE *ferr);
+struct TrainSnapshot *parse_snapshot(const void *buf, size_t size, FILE *ferr);
+int is_snapshot(const void *buf, size_t size);
+int save_snapshot(const char *file_name, struct ProcessTrain *train, int state, FILE *ferr);
+int load_snapshot(const void *buf, size_t size, struct ProcessTrain *train, FILE *ferr);
+
+/* Compiled execution plan: located in plan_wtp.cpp */
+struct TrainPlan *compile_plan(struct ProcessTrain *train);
+struct TrainPlan *FreeTrainPlan(struct TrainPlan *plan);
+int plan_current(struct ProcessTrain *train);
+void load_plan(struct TrainPlan *plan, struct WtpContext *ctx);
+void invalidate_plan(struct ProcessTrain *train);
+unsigned out_need(unsigned outputs);
+
+/* Unit kernel memos: located in memo_wtp.cpp */
+struct UnitMemo;
+const double *memo_find(struct UnitProcess *unit, int kernel, const double *in, int n_in);
+void memo_store(struct UnitProcess *unit, int kernel, const double *in, int n_in,
+                const double *out, int n_out);
+struct UnitMemo *FreeUnitMemo(struct UnitMemo *memo);
+void print_memo_stats(FILE *fp, struct WtpContext *ctx);
+
+/* Distribution networks: located in network_wtp.cpp */
+#define NODE_NAME_LEN 32       /* Max. length of a node name + 1             */
+#define NODE_MAX_BINS 16       /* Max. bins of a residence time distribution */
+#define NODE_QUARTERS 4        /* Quarters of a running annual average       */
+#define NETWORK_MAX_CSTRS 1000 /* Max. CFSTRs of the network trajectory      */
+
+struct DistNode
+{                               /* Sampling node of a distribution network */
+  char name[NODE_NAME_LEN];     /*   From the network file                 */
+  int n_bins;                   /*   1=single residence time               */
+  double days[NODE_MAX_BINS];   /*   Residence time of each bin     (days) */
+  double weight[NODE_MAX_BINS]; /*   Fraction of the flow in each bin      */
+                                /* Results of dist_network():              */
+  double hours;                 /*   Contact time                    (hrs) */
+  double FreeCl2;               /*   Free chlorine             (Mole/Liter) */
+  double NH2Cl;                 /*   Monochloramine            (Mole/Liter) */
+  double clo2_res;              /*   Chlorine dioxide         (mg ClO2/L)  */
+  double TTHM;                  /*   Total THM                 (ug/Liter)  */
+  double HAA5;                  /*   HAA5                      (ug/Liter)  */
+                                /* Running annual average, see             */
+                                /* dist_network_quarter():                 */
+  double q_TTHM[NODE_QUARTERS]; /*   TTHM of the last quarters             */
+  double q_HAA5[NODE_QUARTERS]; /*   HAA5 of the last quarters             */
+  int n_quarters;               /*   Quarters recorded                     */
+  double lraa_TTHM;             /*   LRAA once n_quarters >= NODE_QUARTERS */
+  double lraa_HAA5;
+};
+
+struct NetworkPoint
+{               /* One bin of one node, see open_network() */
+  double days;  /*   Residence time (days)                 */
+  double weight;
+  int node;     /*   Index of the node                     */
+};
+
+struct DistNetwork
+{                              /* Sampling nodes fed by one plant effluent */
+  char file_name[120];         /*   Network file                           */
+  int n_nodes;
+  struct DistNode *node;
+  int n_points;                /*   Bins of all nodes ...                  */
+  struct NetworkPoint *point;  /*   ... in order of residence time         */
+  struct UnitProcess *sample;  /*   Sampling point used by dist_network()  */
+};
+
+int open_network(const char *file_name, struct ProcessTrain *train, FILE *fout);
+struct DistNetwork *FreeDistNetwork(struct DistNetwork *net);
+int dist_network(struct ProcessTrain *train);
+void dist_network_quarter(struct DistNetwork *net);
+void dist_network_reset(struct DistNetwork *net);
+int print_network(FILE *fout, struct DistNetwork *net);
 
 /* Water Chemistry functions */
 double Kw(double DegK);        /* Ionization of water.               */
@@ -910,6 +1211,30 @@ double K_MgOH2aq(double DegK); /* Solubility of magnesium hydorxide. */
 double K_CaOH(double DegK);    /* Ionization of Calcium hydroxide.   */
 double K_CaOH2aq(double DegK); /* Solubility of Calcium hydroxide.   */
 double K_CaCO3(double DegK);   /* Solubility of Calcium carbonate.   */
+const struct ThermoCoef *thermo_coef(struct WtpContext *ctx, double DegK);
+
+/* Math of the model kernels: math_wtp.cpp.  The C library unless built
+   with -DWTP_FAST_MATH=1 */
+#ifndef WTP_FAST_MATH
+#define WTP_FAST_MATH 0
+#endif
+#if WTP_FAST_MATH
+double wtp_exp(double x);
+double wtp_log(double x);
+double wtp_log10(double x);
+double wtp_exp10(double x);
+double wtp_pow(double x, double y);
+#else
+#define wtp_exp(x) exp(x)
+#define wtp_log(x) log(x)
+#define wtp_log10(x) log10(x)
+#define wtp_exp10(x) pow(10.0, (x))
+#define wtp_pow(x, y) pow((x), (y))
+#endif
+void wtp_exp_n(int n, const double *x, double *y);
+void wtp_log_n(int n, const double *x, double *y);
+void wtp_exp10_n(int n, const double *x, double *y);
+void wtp_pow_n(int n, const double *x, const double *y, double *z);
 
 void phchange(struct UnitProcess *unit, short flag);
 void cl2decay(struct UnitProcess *unit, double rxnhours);
@@ -948,6 +1273,12 @@ void filt_dbp(struct UnitProcess *unit);
 /* D/DBP formation equations */
 void dist_dbp(struct UnitProcess *unit);
 
+/* Default of ctx->dist_trajectory.  Build with -DWTP_DIST_TRAJECTORY=1 to
+   evaluate the sampling points on one trajectory, see dist_dbp() */
+#ifndef WTP_DIST_TRAJECTORY
+#define WTP_DIST_TRAJECTORY 0
+#endif
+
 /* New subroutines added by WJS, 10/98 */
 void choose_dbpmodel(struct UnitProcess *unit);
 void modrw1dbp(struct UnitProcess *unit);
@@ -956,14 +1287,58 @@ void rwdbp(struct UnitProcess *unit);
 void owdbp(struct UnitProcess *unit);
 void coagdbp(struct UnitProcess *unit);
 void gacmbdbp(struct UnitProcess *unit);
+
+/* Species equations of the empirical DBP models: dbp_wtp.cpp */
+#define DBP_RAW_MODEL 0   /* Raw water: rwdbp(), modrw1dbp(), modrw2dbp() */
+#define DBP_OZONE_MODEL 1 /* Ozonated raw water: owdbp()                  */
+#define DBP_COAG_MODEL 2  /* Coagulated water: coagdbp(), gacmbdbp()      */
+#define DBP_GAC_MODEL 3   /* GAC-treated water, TOC <= 2: gacmbdbp()      */
+#define DBP_NMODELS 4
+
+#define DBP_TTHM 0
+#define DBP_CHCL3 1
+#define DBP_CHBRCL2 2
+#define DBP_CHBR2CL 3
+#define DBP_CHBR3 4
+#define DBP_HAA6 5
+#define DBP_MCAA 6
+#define DBP_MBAA 7
+#define DBP_DCAA 8
+#define DBP_TCAA 9
+#define DBP_DBAA 10
+#define DBP_BCAA 11
+#define DBP_TBAA 12
+#define DBP_DBCAA 13
+#define DBP_BDCAA 14
+#define DBP_HAA9 15
+#define DBP_HAA6_9 16 /* HAA6 for HAA9 */
+#define DBP_TOX 17
+
+struct DbpTerms
+{                              /* Species equations, see dbp_formation() */
+  double k[DBP_NSPECIES];      /*   All terms but time                   */
+  double te[DBP_NSPECIES];     /*   eff_hours^e                          */
+  double ti[DBP_NSPECIES];     /*   inf_hours^e, 0 if inf_hours <= 0     */
+  double delta[DBP_NSPECIES];  /*   k * (te - ti)               (ug/L)   */
+};
+
+void dbp_formation(struct WtpContext *ctx, int model, double doc, double uv,
+                   double cl2dose, double br, double DegC, double pH,
+                   double eff_hours, double inf_hours, struct DbpTerms *dbp);
+int dbp_forms(const struct DbpTerms *dbp, int first, int last);
+
 void biofilt_rmv(struct UnitProcess *unit);
 //void biogac_rmv     ( struct UnitProcess *unit );
 void ozonate(struct UnitProcess *unit);
 void res_time(struct UnitProcess *unit);
 void clo2_decay(struct UnitProcess *unit, double cfstr_time);
+double clo2_cascade(struct UnitProcess *unit, int ncstrs, double cfstr_time);
 void nf_rmv(struct UnitProcess *unit);
 void mfuf_rmv(struct UnitProcess *unit);
 void new_cl2decay(struct UnitProcess *unit, double res_time);
+void cl2decay_cascade(struct UnitProcess *unit, int ncstrs, double cfstr_time);
+void cl2decay_start(struct UnitProcess *unit, struct Cl2DecayCoef *coef);
+void cl2decay_tanks(struct Effluent *eff, const struct Cl2DecayCoef *coef, int ncstrs, double cfstr_time);
 void ec_comply(struct UnitProcess *unit);
 
 /******************* Structure functions ****************************/
@@ -971,8 +1346,10 @@ void ec_comply(struct UnitProcess *unit);
 struct ProcessTrain *AllocProcessTrain(void);
 struct ProcessTrain *FreeProcessTrain(struct ProcessTrain *train);
 struct ProcessTrain *InitProcessTrain(struct ProcessTrain *train);
+void InitWtpContext(struct WtpContext *ctx);
 
 struct UnitProcess *AllocUnitProcess(short type);
+size_t UnitDataSize(short type);
 struct UnitProcess *FreeUnitProcess(struct UnitProcess *unit);
 struct UnitProcess *AddUnitProcess(struct ProcessTrain *train, short type);
 struct UnitProcess *RemoveUnitProcess(struct UnitProcess *unit);
@@ -988,7 +1365,7 @@ int GetUnitIndex(struct ProcessTrain *train, struct UnitProcess *unit);
 int unit_type(char *name);
 
 /* Adjustment functions based on fitting ICR data */
-double f_adj_pH(double pH);
+double f_adj_pH(double pH, struct UnitProcess *unit);
 double f_adj_toc(double toc, struct UnitProcess *unit);
 
 #endif
@@ -0,0 +1,388 @@
+/* batch_sim.cpp */
+/* Purpose: this file contains the batch simulation mode, which runs the single simulation (with
+    automatic chemical dosing) of many influent/operations pairs in one program and writes one
+    table of results, a row per pair.
+
+   The pairs are the cross product of the influent and operations files matching two patterns, or
+   the pairs listed in a manifest file. Each file is read once. The pairs are evaluated on a pool
+   of worker processes (see run_worker_pool()), each pair starting from a snapshot of the train as
+   it was read (see snapshot_train()), so a pair for which auto_dose() exits fails alone.
+
+   The following functions are in this file:
+     train_influent()
+     batch_sim()
+     batch_sim_mode()
+*/
+
+#include "wtp_optimize.h"
+#include "auto_dose.h"
+#include <map>
+#include <glob.h>
+
+/* Result columns of a pair, see batch_sim() */
+const char *batch_columns[N_BATCH_COLS] = {
+    "alk_setpt", "pH_setpt", "DBPsf", "lime_dose", "co2_dose", "alum_dose", "naocl_dose",
+    "eff_pH", "eff_alk", "eos_cl2", "eos_TTHM", "eos_HAA5", "solids", "toc_removal",
+    "ec_exempt", "ec_step1", "ct_ratio", "ct_ratio_c", "ct_ratio_v"};
+
+struct BatchPair
+{
+    std::string influent;                  // file name in the influent directory
+    std::string operations;                // file name in the operations directory
+    const std::vector<double> *influent_wq;  // values of the influent file, in INF_ order
+    const std::vector<double> *setpoints;  // values of the operations file, in operations_columns order
+};
+
+struct BatchTask
+{   // what the workers read, see batch_task()
+    struct ProcessTrain *train;
+    struct TrainSnapshot *start;           // train as read
+    std::vector<BatchPair> *pairs;
+};
+
+/**
+ * Lists the files of a directory that match a pattern.
+ * @param dir: directory, ending with '/'.
+ * @param pattern: glob(3) pattern of file names, relative to dir.
+ * @param names: receives the matching file names, relative to dir, in sorted order.
+ * @return TRUE if at least one file matches.
+ */
+static int glob_files(const std::string &dir, const char *pattern, std::vector<std::string> &names)
+{
+    glob_t found;
+    size_t i;
+
+    if (glob((dir + pattern).c_str(), 0, NULL, &found) != 0)
+        return (FALSE);
+    for (i = 0; i < found.gl_pathc; i++)
+        names.push_back(std::string(found.gl_pathv[i]).substr(dir.size()));
+    globfree(&found);
+    return (TRUE);
+}
+
+/**
+ * Reads the pairs of a manifest file: one "influent file,operations file" per line, with names
+ * relative to the influent and operations directories. Blank lines, lines starting with '#' and
+ * a first line "influent,operations" are skipped.
+ * @return TRUE/FALSE for success/fail.
+ */
+static int read_manifest(const char *filename, std::vector<BatchPair> &pairs, FILE *ferr)
+{
+    std::ifstream fin(filename);
+    std::string line, influent, operations;
+    size_t comma;
+    int line_number = 0;
+
+    if (!fin)
+    {
+        fprintf(ferr, "Error: could not read file %s\n", filename);
+        return (FALSE);
+    }
+    while (std::getline(fin, line))
+    {
+        line_number++;
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        line.erase(0, line.find_first_not_of(" \t"));
+        if (line.empty() || line[0] == '#' || (line_number == 1 && line == "influent,operations"))
+            continue;
+        if ((comma = line.find(',')) == std::string::npos || line.find(',', comma + 1) != std::string::npos)
+        {
+            fprintf(ferr, "Error: %s line %d: expected \"influent file,operations file\"\n", filename, line_number);
+            return (FALSE);
+        }
+        influent = line.substr(0, comma);
+        operations = line.substr(comma + 1);
+        influent.erase(influent.find_last_not_of(" \t") + 1);
+        operations.erase(0, operations.find_first_not_of(" \t"));
+        pairs.push_back(BatchPair());
+        pairs.back().influent = influent;
+        pairs.back().operations = operations;
+    }
+    return (TRUE);
+}
+
+/**
+ * Gets the influent water quality of a train, as given by its .wtp file.
+ * @param influent_wq: receives the N_SCENARIO_PARAMS values in INF_ order.
+ * @return TRUE/FALSE if the train has an influent or not.
+ */
+int train_influent(struct ProcessTrain *train, double *influent_wq)
+{
+    struct UnitProcess *unit;
+
+    for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit))
+    {
+        if (unit->type == INFLUENT)
+        {
+            influent_wq[INF_ALKALINITY] = unit->data.influent->alkalinity;
+            influent_wq[INF_AMMONIA] = unit->data.influent->nh3;
+            influent_wq[INF_BROMIDE] = unit->data.influent->bromide;
+            influent_wq[INF_CALCIUM_HARDNESS] = unit->data.influent->calcium;
+            influent_wq[INF_TOTAL_HARDNESS] = unit->data.influent->hardness;
+            influent_wq[INF_PH] = unit->data.influent->pH;
+            influent_wq[INF_TEMPERATURE] = unit->data.influent->temp;
+            influent_wq[INF_TOTAL_ORGANIC_CARBON] = unit->data.influent->toc;
+            influent_wq[INF_TURBIDITY] = unit->data.influent->ntu;
+            influent_wq[INF_UV254] = unit->data.influent->uv254;
+            return (TRUE);
+        }
+    }
+    return (FALSE);
+}
+
+/**
+ * Runs the single simulation of one influent/operations pair: the train is restored to its state
+ * as read, given the influent water quality and dosed by auto_dose() to the set points.
+ * @param start: snapshot of the train as read, see snapshot_train().
+ * @param influent_wq: influent water quality, in INF_ order.
+ * @param operations: set points, in the order of operations_columns.
+ * @param values: receives the results, in the order of batch_columns.
+ * Notes:
+ *  1. auto_dose() exits the program if it cannot meet the set points.
+ */
+void batch_sim(struct ProcessTrain *train, struct TrainSnapshot *start,
+               const double *influent_wq, const double *operations, double *values)
+{
+    struct UnitProcess *unit;
+    struct Effluent *influent = NULL;
+    struct Effluent *effluent = NULL;
+    struct Effluent *eos = NULL;
+    double cl2_setpt = 0.2;   // as single_sim_mode()
+    double pH_setpt_2 = 8.0;
+    int c;
+
+    restore_train(train, start);
+    train->ctx.coldflag = FALSE;
+    runmodel(train); // as single_sim_mode(), before the influent is changed
+    for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit))
+    {
+        if (unit->type == INFLUENT)
+        {
+            unit->data.influent->alkalinity = influent_wq[INF_ALKALINITY];
+            unit->data.influent->nh3 = influent_wq[INF_AMMONIA];
+            unit->data.influent->bromide = influent_wq[INF_BROMIDE];
+            unit->data.influent->calcium = influent_wq[INF_CALCIUM_HARDNESS];
+            unit->data.influent->hardness = influent_wq[INF_TOTAL_HARDNESS];
+            unit->data.influent->pH = influent_wq[INF_PH];
+            unit->data.influent->temp = influent_wq[INF_TEMPERATURE];
+            unit->data.influent->toc = influent_wq[INF_TOTAL_ORGANIC_CARBON];
+            unit->data.influent->ntu = influent_wq[INF_TURBIDITY];
+            unit->data.influent->uv254 = influent_wq[INF_UV254];
+        }
+    }
+
+    auto_dose(train, operations[PH_SETPT], operations[ALKALINITY_SETPT], cl2_setpt, pH_setpt_2,
+              operations[DBP_SAFETY_FACTOR], NULL);
+
+    for (c = 0; c < N_BATCH_COLS; c++)
+        values[c] = 0.0;
+    values[0] = operations[ALKALINITY_SETPT];
+    values[1] = operations[PH_SETPT];
+    values[2] = operations[DBP_SAFETY_FACTOR];
+    for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit))
+    {
+        switch (unit->type)
+        {
+        case INFLUENT:
+            influent = &unit->eff;
+            break;
+        case LIME:
+            values[3] += unit->data.lime->dose;
+            break;
+        case CARBON_DIOXIDE:
+            values[4] += unit->data.chemical->co2;
+            break;
+        case ALUM:
+            values[5] += unit->data.alum->dose;
+            break;
+        case HYPOCHLORITE:
+            values[6] += unit->data.chemical->naocl;
+            break;
+        case WTP_EFFLUENT:
+            effluent = &unit->eff;
+            break;
+        case END_OF_SYSTEM:
+            eos = &unit->eff;
+            break;
+        default:
+            break;
+        }
+    }
+    if (effluent != NULL)
+    {
+        values[7] = effluent->pH;
+        values[8] = effluent->Alk * MW_CaCO3 / 2;
+        if (influent != NULL && influent->TOC > 0.0)
+            values[13] = (influent->TOC - effluent->TOC) / influent->TOC * 100.0;
+        values[14] = effluent->ec_exempt;
+        values[15] = effluent->ec_meeting_step1;
+    }
+    if (eos != NULL)
+    {
+        values[9] = (eos->FreeCl2 + eos->NH2Cl) * MW_Cl2;
+        values[10] = eos->TTHM;
+        values[11] = eos->HAA5;
+        values[12] = eos->solids;
+        values[16] = eos->ct_ratio;
+        values[17] = eos->ct_ratio_c;
+        values[18] = eos->ct_ratio_v;
+    }
+}
+
+// purpose: evaluate pair p in a worker, see run_worker_pool()
+static void batch_task(long p, double *values, void *arg)
+{
+    struct BatchTask *task = (struct BatchTask *)arg;
+    const struct BatchPair &pair = (*task->pairs)[p];
+
+    batch_sim(task->train, task->start, &(*pair.influent_wq)[0], &(*pair.setpoints)[0], values);
+}
+
+/**
+ * Writes a field of the result table, quoted if it holds a comma, quote or line end.
+ */
+static int write_csv_field(FILE *fout, const std::string &field)
+{
+    std::string quoted;
+    size_t i;
+
+    if (field.find_first_of(",\"\n\r") == std::string::npos)
+        return (fprintf(fout, "%s", field.c_str()) < 0);
+    quoted = "\"";
+    for (i = 0; i < field.size(); i++)
+    {
+        if (field[i] == '"')
+            quoted += '"';
+        quoted += (field[i] == '\n' || field[i] == '\r') ? ' ' : field[i];
+    }
+    quoted += '"';
+    return (fprintf(fout, "%s", quoted.c_str()) < 0);
+}
+
+/**
+ * Batch simulation mode (with automatic chemical dosing).
+ * @param train: process train as read, the starting point of every pair.
+ * @param params: pairs, input directories and number of workers.
+ * @param fout: stream for the result table, a CSV file with a row per pair: the influent and
+ *              operations file names, status ("ok" or why the pair failed), then batch_columns
+ *              (NA for a failed pair).
+ * @return the number of pairs that failed, or -1 if no pairs could be set up.
+ * Notes:
+ *  1. Each pair gives the results that "-r simulate" gives for it: the train is restored to its
+ *     state as read before every pair, as a separate run of the program would start.
+ *  2. The rows are written in the order of the pairs, whatever the order of evaluation.
+ *  3. The distribution network, if any, is not evaluated.
+ */
+int batch_sim_mode(struct ProcessTrain *train, struct BatchParameters *params, FILE *fout)
+{
+    std::vector<BatchPair> pairs;
+    std::vector<std::string> influents, operations, status;
+    std::vector<double> values;
+    std::map<std::string, std::vector<double> > influent_data, operations_data;
+    std::map<std::string, std::string> read_errors;
+    std::string influent_dir = params->influent_dir, operations_dir = params->operations_dir;
+    struct BatchTask task;
+    size_t i, j;
+    long n, p;
+    int n_failed, e = 0, c;
+
+    /* Pairs to evaluate */
+    if (params->manifest_filename != NULL)
+    {
+        if (read_manifest(params->manifest_filename, pairs, stderr) == FALSE)
+            return (-1);
+    }
+    else
+    {
+        if (!glob_files(influent_dir, params->influent_pattern, influents))
+        {
+            fprintf(stderr, "Error: no influent file of %s matches \"%s\"\n", influent_dir.c_str(), params->influent_pattern);
+            return (-1);
+        }
+        if (!glob_files(operations_dir, params->operations_pattern, operations))
+        {
+            fprintf(stderr, "Error: no operations file of %s matches \"%s\"\n", operations_dir.c_str(), params->operations_pattern);
+            return (-1);
+        }
+        for (i = 0; i < influents.size(); i++)
+        {
+            for (j = 0; j < operations.size(); j++)
+            {
+                pairs.push_back(BatchPair());
+                pairs.back().influent = influents[i];
+                pairs.back().operations = operations[j];
+            }
+        }
+    }
+    if ((n = (long)pairs.size()) == 0)
+    {
+        fprintf(stderr, "Error: the batch has no influent/operations pairs\n");
+        return (-1);
+    }
+
+    /* Read each input file once; keys are "i" or "o" and the file name */
+    status.resize(n);
+    for (p = 0; p < n; p++)
+    {
+        std::string ikey = "i" + pairs[p].influent, okey = "o" + pairs[p].operations;
+        if (influent_data.count(ikey) == 0 && read_errors.count(ikey) == 0 &&
+            !read_single_file(influent_dir + pairs[p].influent, influent_columns, N_SCENARIO_PARAMS, influent_data[ikey], read_errors[ikey]))
+            influent_data.erase(ikey);
+        if (operations_data.count(okey) == 0 && read_errors.count(okey) == 0 &&
+            !read_single_file(operations_dir + pairs[p].operations, operations_columns, N_OPERATIONS_COLS, operations_data[okey], read_errors[okey]))
+            operations_data.erase(okey);
+        if (influent_data.count(ikey) == 0)
+            status[p] = "failed: " + read_errors[ikey]; // not evaluated
+        else if (operations_data.count(okey) == 0)
+            status[p] = "failed: " + read_errors[okey];
+        else
+        {
+            pairs[p].influent_wq = &influent_data[ikey];
+            pairs[p].setpoints = &operations_data[okey];
+        }
+    }
+
+    /* Worker pool */
+    task.train = train;
+    task.pairs = &pairs;
+    if ((task.start = snapshot_train(train, NULL)) == NULL)
+    {
+        fprintf(stderr, "Error: cannot allocate memory for the batch.\n");
+        return (-1);
+    }
+    values.resize(n * N_BATCH_COLS);
+    n_failed = run_worker_pool(n, N_BATCH_COLS, params->n_workers, batch_task, &task, &values[0], status);
+    FreeTrainSnapshot(task.start);
+    if (n_failed < 0)
+        return (-1);
+
+    /* Result table */
+    e |= fprintf(fout, "influent,operations,status") < 0;
+    for (c = 0; c < N_BATCH_COLS; c++)
+        e |= fprintf(fout, ",%s", batch_columns[c]) < 0;
+    e |= fprintf(fout, "\n") < 0;
+    for (p = 0; p < n; p++)
+    {
+        e |= write_csv_field(fout, pairs[p].influent);
+        e |= fprintf(fout, ",") < 0;
+        e |= write_csv_field(fout, pairs[p].operations);
+        e |= fprintf(fout, ",") < 0;
+        e |= write_csv_field(fout, status[p]);
+        for (c = 0; c < N_BATCH_COLS; c++)
+        {
+            if (status[p] == "ok")
+                e |= fprintf(fout, ",%.17g", values[p * N_BATCH_COLS + c]) < 0;
+            else
+                e |= fprintf(fout, ",NA") < 0;
+        }
+        e |= fprintf(fout, "\n") < 0;
+    }
+
+    if (e)
+    {
+        fprintf(stderr, "Error: could not write the batch results.\n");
+        return (-1);
+    }
+    printf("Batch of %ld pairs: %d failed\n", n, n_failed);
+    return (n_failed);
+}
@@ -1,119 +1,472 @@
 #include <string>
 #include <vector>
-#include <sstream>  //istringstream
 #include <iostream> // cout
-#include <fstream>  // ifstream
+#include <thread>
 #include <cstdlib>
-#include <stdexcept>      // std::invalid_argument
+#include <cstdio>
+#include <cstring>
+#include <clocale>  // localeconv
+#include "wtp_optimize.h"
 
 using namespace std;
 
 /* read_csv.cpp */
 /* Purpose: this file contains functions which support reading .csv (comma separated value) input
     files for different run modes. This includes single and multi-simulation modes and Monte Carlo
-    influent scenarios. 
+    influent scenarios.
+
+   All of them go through read_csv_table(), which reads a header line of column names and rows of
+   numbers. The file is read whole and cut into chunks at line ends that are parsed on separate
+   threads. Numbers are parsed at double precision whatever the locale of the program: decimal
+   numbers of up to 15 significant digits and a power of ten of at most 22 are converted with a
+   single rounding (exact), the others by strtod(), which rounds correctly. Columns are found by
+   name (csv_columns()), so their order in the file does not matter.
+
+   The following functions are in this file:
+     read_csv_table()
+     csv_columns()
+     read_single_row()
+     read_single_file()
+     read_single_sim()
+     read_montecarlo()
 */
 
 // define macros about Monte Carlo simulation of influent water quality input data
-#define N_YEARS 11            // number of years on record
-#define N_QUARTERS_PER_YEAR 4 // number of quarters in a year
-#define MAX_N_SIMS 5000       // maximum number of simulations that the user can run
+#define MAX_N_SIMS 5000            // maximum number of simulations that the user can run
+#define CSV_CHUNK_BYTES (1 << 20)  // smallest part of a file parsed on a thread of its own
+#define CSV_MAX_THREADS 16         // most threads used to parse a file
+
+/* Column names of the input files */
+const char *montecarlo_columns[N_MONTECARLO_COLS] = {
+    "sim", "year", "quarter",
+    "alk", "ammonia", "bromide", "calcium", "hard", "pH", "temp", "toc", "turb", "uv254"};
+const char *const *influent_columns = montecarlo_columns + 3;
+const char *operations_columns[N_OPERATIONS_COLS] = {"alk_setpt", "pH_setpt", "DBPsf"};
+
+static const double exact_powers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22}; // 10^k exact in a double
 
 /**
- * Reads csv file for single simulation mode containing decision variables for a single quarter. 
- * source: https://waterprogramming.wordpress.com/2017/08/20/reading-csv-files-in-c/
- * @param inputFileName: input file name (full path).
- * @param header: skip 1st row of text which contains column names? (true/false)
- * @return data as vector of doubles.
+ * Parses the number in [s, end), with no surrounding blanks.
+ * @return TRUE and *value, or FALSE if the text is not a decimal number.
+ * Notes:
+ *  1. With at most 15 significant digits the digits are an exact integer m < 2^53, and m * 10^e
+ *     or m / 10^-e for |e| <= 22 is one correctly rounded operation on exact operands.
+ *  2. Other numbers go to strtod() with the decimal point of the current locale, so that
+ *     setlocale() elsewhere in the program does not change what is read.
  */
-
-vector<double> read_single_sim(string filename, bool header)
+static int parse_double(const char *s, const char *end, double *value)
 {
-    std::ifstream file(filename.c_str());
-    vector<double> data;
-    string str;  // string read from file
+    const char *p = s;
+    unsigned long long m = 0;
+    int negative = FALSE, digits = 0, significant = 0, exp10 = 0, exp_sign = 1, exp_value = 0, any = FALSE;
 
-    /* Define maximum number of lines that can be read */
-    int max_nlines = 1;
-    if (header == true)
+    if (p < end && (*p == '+' || *p == '-'))
+    {
+        negative = (*p == '-');
+        p++;
+    }
+    for (; p < end && *p >= '0' && *p <= '9'; p++, any = TRUE)
+    {
+        if (m == 0 && *p == '0')
+            continue; // leading zero
+        if (significant < 19)
+            m = 10 * m + (*p - '0');
+        else
+            exp10++;
+        significant++;
+    }
+    if (p < end && *p == '.')
     {
-        max_nlines++;
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, any = TRUE)
+        {
+            if (m == 0 && *p == '0')
+            {
+                exp10--;
+                continue;
+            }
+            if (significant < 19)
+            {
+                m = 10 * m + (*p - '0');
+                exp10--;
+            }
+            significant++;
+        }
     }
+    if (any == FALSE)
+        return (FALSE);
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        p++;
+        if (p < end && (*p == '+' || *p == '-'))
+        {
+            exp_sign = (*p == '-') ? -1 : 1;
+            p++;
+        }
+        for (digits = 0; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+        {
+            if (exp_value < 100000)
+                exp_value = 10 * exp_value + (*p - '0');
+        }
+        if (digits == 0)
+            return (FALSE);
+        exp10 += exp_sign * exp_value;
+    }
+    if (p != end)
+        return (FALSE);
 
-    /* Error handling */
-    if (!file)
+    if (significant <= 15 && exp10 >= -22 && exp10 <= 22)
+    { /* Exact operands, one rounding */
+        *value = (exp10 >= 0) ? (double)m * exact_powers[exp10] : (double)m / exact_powers[-exp10];
+        if (negative)
+            *value = -*value;
+    }
+    else
     {
-        cerr << "Could not read file " << filename << "\n";
-        exit(EXIT_FAILURE);
+        std::string text(s, end - s);
+        const char *point = localeconv()->decimal_point;
+        size_t dot = text.find('.');
+        char *tail;
+
+        if (dot != std::string::npos && point != NULL && strcmp(point, ".") != 0)
+            text.replace(dot, 1, point);
+        *value = strtod(text.c_str(), &tail);
+        if (*tail != '\0' || !isfinite(*value))
+            return (FALSE);
     }
+    return (TRUE);
+}
 
-    /* Define number of lines to be read based on number of simulations */
-    int nlines = max_nlines;
-    int line = 0; // initialize current line number
-    string buffer;
+struct CsvChunk
+{ // part of a file parsed by one thread
+    const char *begin, *end;   // whole lines
+    std::vector<double> values;
+    std::vector<long> lines;   // line of each row, counted from the start of the chunk
+    long n_lines;              // lines in the chunk
+    long error_line;           // line of the first error (from the start of the chunk), or -1
+    int error_col;             // column of the first error (1 based)
+    std::string error;         // what is wrong
+};
 
-    while (line <= nlines)
+/**
+ * Parses the rows of a chunk, each of n_cols numbers.
+ */
+static void parse_chunk(struct CsvChunk *chunk, int n_cols)
+{
+    const char *p = chunk->begin, *eol, *field, *stop, *b, *e;
+    long line = 0;
+    int col;
+    double value;
+
+    chunk->n_lines = 0;
+    chunk->error_line = -1;
+    for (; p < chunk->end; p = eol + 1, line++)
     {
-        line++; // add count to current line number
+        eol = (const char *)memchr(p, '\n', chunk->end - p);
+        if (eol == NULL)
+            eol = chunk->end;
+        chunk->n_lines = line + 1;
+
+        /* Skip blank lines */
+        for (b = p; b < eol && (*b == ' ' || *b == '\t' || *b == '\r'); b++)
+            ;
+        if (b == eol)
+            continue;
 
-        // Read each line of text into a buffer
-        if (!getline(file, buffer))
+        for (field = p, col = 0; field <= eol; field = stop + 1, col++)
         {
+            stop = (const char *)memchr(field, ',', eol - field);
+            if (stop == NULL)
+                stop = eol;
+            if (col == n_cols)
+            {
+                chunk->error = "more values than the header has columns";
+                break;
+            }
+            for (b = field; b < stop && (*b == ' ' || *b == '\t'); b++)
+                ;
+            for (e = stop; e > b && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r'); e--)
+                ;
+            if (parse_double(b, e, &value) == FALSE)
+            {
+                chunk->error = "\"" + std::string(b, e - b) + "\" is not a number";
+                break;
+            }
+            chunk->values.push_back(value);
+        }
+        if (chunk->error.empty() && col < n_cols)
+            chunk->error = "fewer values than the header has columns";
+        if (!chunk->error.empty())
+        {
+            chunk->error_line = line;
+            chunk->error_col = col + 1;
+            chunk->n_lines = line + 1;
+            return;
+        }
+        chunk->lines.push_back(line);
+    }
+}
+
+/**
+ * Reads a csv file of a header line of column names and rows of numbers.
+ * @param filename: input file name (full path).
+ * @param table: receives the column names and the values.
+ * @param ferr: stream for error messages.
+ * @return TRUE/FALSE for success/fail; the first error is reported with its line and column.
+ * Notes:
+ *  1. Blank lines are skipped, and blanks and a \r around the values are ignored. Column names
+ *     may be quoted (as R writes them); the values may not.
+ *  2. Files larger than CSV_CHUNK_BYTES are parsed on up to CSV_MAX_THREADS threads.
+ */
+int read_csv_table(const char *filename, struct CsvTable *table, FILE *ferr)
+{
+    FILE *fin;
+    std::vector<char> text;
+    std::vector<struct CsvChunk> chunks;
+    std::vector<std::thread> threads;
+    const char *p, *eol, *stop, *body, *end;
+    long size, line;
+    int n_threads, t, col;
+
+    table->filename = filename;
+    table->names.clear();
+    table->values.clear();
+    table->lines.clear();
+    table->n_cols = 0;
+    table->n_rows = 0;
+
+    /* Read the whole file */
+    if ((fin = fopen(filename, "rb")) == NULL || fseek(fin, 0, SEEK_END) != 0 || (size = ftell(fin)) < 0 ||
+        fseek(fin, 0, SEEK_SET) != 0)
+    {
+        fprintf(ferr, "Error: could not read file %s\n", filename);
+        if (fin != NULL)
+            fclose(fin);
+        return (FALSE);
+    }
+    text.resize(size + 1);
+    if (size > 0 && fread(&text[0], 1, size, fin) != (size_t)size)
+    {
+        fprintf(ferr, "Error: could not read file %s\n", filename);
+        fclose(fin);
+        return (FALSE);
+    }
+    fclose(fin);
+    end = &text[0] + size;
+
+    /* Header line */
+    p = &text[0];
+    if ((eol = (const char *)memchr(p, '\n', end - p)) == NULL)
+        eol = end;
+    body = (eol < end) ? eol + 1 : end;
+    for (col = 1;; p = stop + 1, col++)
+    {
+        const char *b, *e;
+
+        if ((stop = (const char *)memchr(p, ',', eol - p)) == NULL)
+            stop = eol;
+        for (b = p; b < stop && (*b == ' ' || *b == '\t' || *b == '"'); b++)
+            ;
+        for (e = stop; e > b && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r' || e[-1] == '"'); e--)
+            ;
+        if (b == e)
+        {
+            fprintf(ferr, "Error: %s line 1 column %d: missing column name\n", filename, col);
+            return (FALSE);
+        }
+        table->names.push_back(std::string(b, e - b));
+        if (stop == eol)
             break;
+    }
+    table->n_cols = (int)table->names.size();
+
+    /* Cut the rows into chunks of whole lines */
+    n_threads = (int)std::thread::hardware_concurrency();
+    if (n_threads > CSV_MAX_THREADS)
+        n_threads = CSV_MAX_THREADS;
+    if (n_threads > (end - body) / CSV_CHUNK_BYTES)
+        n_threads = (int)((end - body) / CSV_CHUNK_BYTES);
+    if (n_threads < 1)
+        n_threads = 1;
+    chunks.resize(n_threads);
+    for (t = 0, p = body; t < n_threads; t++)
+    {
+        chunks[t].begin = p;
+        if (t == n_threads - 1)
+            p = end;
+        else
+        {
+            p = body + (end - body) * (t + 1) / n_threads;
+            if (p < chunks[t].begin)
+                p = chunks[t].begin;
+            if ((eol = (const char *)memchr(p, '\n', end - p)) != NULL)
+                p = eol + 1;
+            else
+                p = end;
         }
-        istringstream stream_buffer(buffer);
+        chunks[t].end = p;
+    }
+
+    /* Parse them */
+    if (n_threads == 1)
+        parse_chunk(&chunks[0], table->n_cols);
+    else
+    {
+        for (t = 0; t < n_threads; t++)
+            threads.push_back(std::thread(parse_chunk, &chunks[t], table->n_cols));
+        for (t = 0; t < n_threads; t++)
+            threads[t].join();
+    }
 
-        // If there is a header, skip the first line
-        if (header == true && line == 1)
+    /* Join them, numbering the lines from the start of the file */
+    for (t = 0, line = 2; t < n_threads; t++)
+    {
+        if (chunks[t].error_line >= 0)
         {
-            continue;
+            fprintf(ferr, "Error: %s line %ld column %d", filename, line + chunks[t].error_line, chunks[t].error_col);
+            if (chunks[t].error_col <= table->n_cols)
+                fprintf(ferr, " (%s)", table->names[chunks[t].error_col - 1].c_str());
+            fprintf(ferr, ": %s\n", chunks[t].error.c_str());
+            table->names.clear();
+            table->n_cols = 0;
+            return (FALSE);
         }
+        table->values.insert(table->values.end(), chunks[t].values.begin(), chunks[t].values.end());
+        for (size_t r = 0; r < chunks[t].lines.size(); r++)
+            table->lines.push_back(line + chunks[t].lines[r]);
+        line += chunks[t].n_lines;
+        std::vector<double>().swap(chunks[t].values);
+    }
+    table->n_rows = (long)table->lines.size();
+    return (TRUE);
+}
+
+/**
+ * Finds columns of a table by name.
+ * @param table: table of read_csv_table().
+ * @param names: names of the columns wanted.
+ * @param n: number of names.
+ * @param index: receives the column of table of each name.
+ * @param ferr: stream for error messages.
+ * @return TRUE/FALSE if all/not all of the names are columns of the table.
+ */
+int csv_columns(const struct CsvTable *table, const char *const *names, int n, int *index, FILE *ferr)
+{
+    int i, c, ok = TRUE;
 
-        // Read each comma-separated value of the line
-        while (stream_buffer)
+    for (i = 0; i < n; i++)
+    {
+        for (c = 0, index[i] = -1; c < table->n_cols; c++)
         {
-            string value_str;
-            if (!getline(stream_buffer, value_str, ','))
+            if (table->names[c].compare(names[i]) == 0)
             {
+                index[i] = c;
                 break;
             }
-            try
-            {
-                data.push_back(stof(value_str));
-            }
-            catch (const std::invalid_argument e)
-            {
-                cout << "NaN found in file " << filename << " line " << line << endl;
-                e.what();
-            }
+        }
+        if (index[i] < 0)
+        {
+            fprintf(ferr, "Error: %s has no column \"%s\"\n", table->filename.c_str(), names[i]);
+            ok = FALSE;
         }
     }
-
-    return data;
+    return (ok);
 }
 
 /**
- * Reads csv file into table, exported as a vector of vector of doubles.
- * source: https://waterprogramming.wordpress.com/2017/08/20/reading-csv-files-in-c/
- * @param inputFileName: input file name (full path).
- * @param header: skip 1st row of text which contains column names? (true/false)
- * @return data as vector of vector of doubles.
+ * Reads the first row of a csv file holding the values of a single quarter.
+ * @param filename: input file name (full path).
+ * @param names: columns to read, found by the names of the header line.
+ * @param n: number of names.
+ * @param values: receives the n values in the order of names.
+ * @param ferr: stream for error messages.
+ * @return TRUE/FALSE for success/fail.
  */
+int read_single_row(const char *filename, const char *const *names, int n, double *values, FILE *ferr)
+{
+    struct CsvTable table;
+    vector<int> index(n);
+    int i;
+
+    if (read_csv_table(filename, &table, ferr) == FALSE || csv_columns(&table, names, n, &index[0], ferr) == FALSE)
+    {
+        return (FALSE);
+    }
+    if (table.n_rows < 1)
+    {
+        fprintf(ferr, "Error: %s has no values\n", filename);
+        return (FALSE);
+    }
 
-vector< vector<double> > read_montecarlo(string filename, bool header, int nsims)
+    for (i = 0; i < n; i++)
+    {
+        values[i] = table.values[index[i]];
+    }
+    return (TRUE);
+}
+
+/**
+ * Reads the first row of a single quarter file as read_single_row() does, keeping the error message.
+ * @param values: receives the n values in the order of names.
+ * @param error: receives the error message if the file cannot be read.
+ * @return TRUE/FALSE for success/fail.
+ */
+int read_single_file(const string &filename, const char *const *names, int n, vector<double> &values, string &error)
 {
+    char *message = NULL;
+    size_t size = 0;
+    FILE *ferr;
+    int ok;
 
-    vector< vector<double> > data;
-    std::ifstream file(filename.c_str());
-    
-    string str;  // string read from file
+    values.resize(n);
+    if ((ferr = open_memstream(&message, &size)) == NULL)
+    {
+        return (read_single_row(filename.c_str(), names, n, &values[0], stderr));
+    }
+    ok = read_single_row(filename.c_str(), names, n, &values[0], ferr);
+    fclose(ferr);
+    error = message;
+    free(message);
+    error.erase(error.find_last_not_of("\n") + 1);
+    return (ok);
+}
+
+/**
+ * Reads csv file for single simulation mode containing values for a single quarter.
+ * @param filename: input file name (full path).
+ * @param names: columns to read, found by the names of the header line.
+ * @param n: number of names.
+ * @return the values of the first row in the order of names. Exits on error.
+ */
+
+vector<double> read_single_sim(string filename, const char *const *names, int n)
+{
+    vector<double> data(n);
 
-    /* Define maximum number of lines that can be read */
-    int max_nlines = N_YEARS * N_QUARTERS_PER_YEAR * MAX_N_SIMS;
-    if (header == true)
+    if (read_single_row(filename.c_str(), names, n, &data[0], stderr) == FALSE)
     {
-        max_nlines++;
+        exit(EXIT_FAILURE);
     }
+    return data;
+}
+
+/**
+ * Reads the Monte Carlo influent scenario csv file into table, exported as a vector of vector of doubles.
+ * @param filename: input file name (full path).
+ * @param nsims: number of simulations to read.
+ * @return nsims * N_TIMESTEPS rows, each of the N_MONTECARLO_COLS columns in the order of
+ *         montecarlo_columns, whatever their order in the file. Exits on error.
+ */
+
+vector< vector<double> > read_montecarlo(string filename, int nsims)
+{
+    struct CsvTable table;
+    vector< vector<double> > data;
+    int index[N_MONTECARLO_COLS];
+    long nrows = (long)N_TIMESTEPS * nsims, r;
+    int c;
+
     /* Error handling */
     if (nsims > MAX_N_SIMS)
     {
@@ -123,57 +476,27 @@ vector< vector<double> > read_montecarlo(string filename, bool header, int nsims
         exit(EXIT_FAILURE);
     }
 
-    /* Error handling */
-    if (!file)
+    if (read_csv_table(filename.c_str(), &table, stderr) == FALSE ||
+        csv_columns(&table, montecarlo_columns, N_MONTECARLO_COLS, index, stderr) == FALSE)
     {
-        cerr << "Could not read file " << filename << "\n";
         exit(EXIT_FAILURE);
     }
-
-    /* Define number of lines to be read based on number of simulations */
-    int nlines = N_YEARS * N_QUARTERS_PER_YEAR * nsims;
-    int line = 0; // initialize current line number
-    string buffer;
-
-    while (line <= nlines)
+    if (table.n_rows < nrows)
     {
-        line++; // add count to current line number
-
-        // Read each line of text into a buffer
-        if (!getline(file, buffer))
-        {
-            break;
-        }
-        istringstream stream_buffer(buffer);
-        vector<double> record;
+        cerr << "Error: " << filename << " holds " << table.n_rows << " rows, " << nrows
+             << " are needed for " << nsims << " simulations\n";
+        exit(EXIT_FAILURE);
+    }
 
-        // If there is a header, skip the first line
-        if (header == true && line == 1)
+    data.resize(nrows);
+    for (r = 0; r < nrows; r++)
+    {
+        data[r].resize(N_MONTECARLO_COLS);
+        for (c = 0; c < N_MONTECARLO_COLS; c++)
         {
-            continue;
+            data[r][c] = table.values[r * table.n_cols + index[c]];
         }
-
-        // Read each comma-separated value of the line
-        while (stream_buffer)
-        {
-            string value_str;
-            if (!getline(stream_buffer, value_str, ','))
-            {
-                break;
-            }
-            try
-            {
-                record.push_back(stof(value_str));
-            }
-            catch (const std::invalid_argument &e)
-            {
-                cout << "NaN found in file " << filename << " line " << line << endl;
-                e.what();
-            }
-        }
-
-        data.push_back(record);
     }
 
     return data;
-}
\ No newline at end of file
+}
@@ -0,0 +1,236 @@
+/* scenario_store.cpp */
+/* Purpose: this file contains functions which write and read Monte Carlo influent scenario stores.
+    A scenario store is a binary copy of the Monte Carlo influent CSV file (see read_montecarlo()):
+    one contiguous array of doubles per water quality parameter, validated once when the store is
+    written and memory mapped read-only by wtp(). Processes that map the same store share its pages.
+
+   File layout (native byte order, version SCENARIO_VERSION):
+     struct ScenarioHeader      magic, version, byte order mark, dimensions and column names
+     column INF_ALKALINITY      n_sims * N_YEARS * N_QUARTERS_PER_YEAR doubles
+     ...
+     column INF_UV254
+   Within a column the value of simulation k, year i, quarter j (0 based) is at
+   j + i * N_QUARTERS_PER_YEAR + k * N_TIMESTEPS, the row of the CSV file without its header.
+
+   The following functions are in this file:
+     write_scenario_store()
+     open_scenario_store()
+     close_scenario_store()
+     scenario_value()
+*/
+
+#include "wtp_optimize.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SCENARIO_BYTE_ORDER 0x01020304u
+
+/**
+ * Checks a value of the CSV file as wtp() does for the CSV file itself.
+ * @return TRUE if the value of parameter p (INF_...) is physical.
+ */
+static int scenario_in_bounds(int p, double value)
+{
+    switch (p)
+    {
+    case INF_PH:
+        return (value >= 0.0 && value <= 14.0);
+    case INF_TEMPERATURE:
+        return (value >= 0.0 && value <= 100.0);
+    default:
+        return (value >= 0.0);
+    }
+}
+
+/**
+ * Converts a Monte Carlo influent CSV file into a scenario store.
+ * @param csv_filename: CSV file with the montecarlo_columns, in any order (see read_montecarlo()).
+ * @param store_filename: scenario store to write.
+ * @param nsims: number of simulations to convert, 0 for all of the file.
+ * @param ferr: stream for error messages.
+ * @return TRUE/FALSE for success/fail.
+ * Notes:
+ *  1. The file is read by read_csv_table(). The rows must run through simulations 1..nsims,
+ *     years 1..N_YEARS and quarters 1..N_QUARTERS_PER_YEAR in that order, and the values must
+ *     pass the bounds checks of wtp(); the first error is reported by line and column.
+ *  2. The store is written to a temporary file that is renamed on success, so a store that
+ *     other processes have mapped is never seen half written.
+ */
+int write_scenario_store(const char *csv_filename, const char *store_filename, int nsims, FILE *ferr)
+{
+    struct ScenarioHeader header;
+    struct CsvTable table;
+    std::vector<double> column[N_SCENARIO_PARAMS];
+    std::string tmp_filename = std::string(store_filename) + ".tmp";
+    int index[N_MONTECARLO_COLS];
+    double value;
+    long n_rows, r, expected[3];
+    int c, p, ok;
+    FILE *fout;
+
+    if (read_csv_table(csv_filename, &table, ferr) == FALSE ||
+        csv_columns(&table, montecarlo_columns, N_MONTECARLO_COLS, index, ferr) == FALSE)
+        return (FALSE);
+
+    n_rows = (nsims > 0) ? (long)nsims * N_TIMESTEPS : table.n_rows - table.n_rows % N_TIMESTEPS;
+    if (n_rows == 0 || table.n_rows < n_rows)
+    {
+        fprintf(ferr, "Error: %s holds %ld complete simulations of %d quarters", csv_filename, table.n_rows / N_TIMESTEPS, N_TIMESTEPS);
+        if (nsims > 0)
+            fprintf(ferr, ", %d requested", nsims);
+        fprintf(ferr, "\n");
+        return (FALSE);
+    }
+
+    for (p = 0; p < N_SCENARIO_PARAMS; p++)
+        column[p].resize(n_rows);
+    for (r = 0; r < n_rows; r++)
+    {
+        /* Rows run through simulations, years and quarters in order */
+        expected[0] = r / N_TIMESTEPS + 1;
+        expected[1] = (r % N_TIMESTEPS) / N_QUARTERS_PER_YEAR + 1;
+        expected[2] = r % N_QUARTERS_PER_YEAR + 1;
+        for (c = 0; c < N_MONTECARLO_COLS; c++)
+        {
+            value = table.values[r * table.n_cols + index[c]];
+            if (c < 3)
+                ok = (value == (double)expected[c]);
+            else
+                ok = scenario_in_bounds(c - 3, value);
+            if (!ok)
+            {
+                fprintf(ferr, "Error: %s line %ld column %d (%s): %g is ", csv_filename, table.lines[r], index[c] + 1, montecarlo_columns[c], value);
+                if (c < 3)
+                    fprintf(ferr, "out of sequence, expected %ld\n", expected[c]);
+                else
+                    fprintf(ferr, "beyond the allowable bounds\n");
+                return (FALSE);
+            }
+            if (c >= 3)
+                column[c - 3][r] = value;
+        }
+    }
+
+    /* Write the header and the columns */
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SCENARIO_MAGIC, sizeof(header.magic));
+    header.version = SCENARIO_VERSION;
+    header.byte_order = SCENARIO_BYTE_ORDER;
+    header.n_sims = (uint32_t)(n_rows / N_TIMESTEPS);
+    header.n_years = N_YEARS;
+    header.n_quarters = N_QUARTERS_PER_YEAR;
+    header.n_params = N_SCENARIO_PARAMS;
+    for (p = 0; p < N_SCENARIO_PARAMS; p++)
+        strncpy(header.names[p], influent_columns[p], SCENARIO_NAME_LEN - 1);
+
+    if ((fout = fopen(tmp_filename.c_str(), "wb")) == NULL)
+    {
+        fprintf(ferr, "Error: could not write file %s\n", tmp_filename.c_str());
+        return (FALSE);
+    }
+    ok = (fwrite(&header, sizeof(header), 1, fout) == 1);
+    for (p = 0; ok && p < N_SCENARIO_PARAMS; p++)
+        ok = (fwrite(column[p].data(), sizeof(double), n_rows, fout) == (size_t)n_rows);
+    if (fclose(fout) != 0)
+        ok = FALSE;
+    if (!ok || rename(tmp_filename.c_str(), store_filename) != 0)
+    {
+        fprintf(ferr, "Error: could not write file %s\n", store_filename);
+        remove(tmp_filename.c_str());
+        return (FALSE);
+    }
+    return (TRUE);
+}
+
+/**
+ * Maps a scenario store read-only.
+ * @param filename: scenario store written by write_scenario_store().
+ * @param ferr: stream for error messages.
+ * @return the store, or NULL if the file cannot be mapped or is not a scenario store of this
+ *         version, byte order and dimensions. Release it with close_scenario_store().
+ */
+struct ScenarioStore *open_scenario_store(const char *filename, FILE *ferr)
+{
+    struct ScenarioStore *store;
+    const struct ScenarioHeader *header;
+    struct stat st;
+    size_t n_values;
+    void *map;
+    int fd, p;
+
+    if ((fd = open(filename, O_RDONLY)) < 0 || fstat(fd, &st) != 0)
+    {
+        fprintf(ferr, "Error: could not read file %s\n", filename);
+        if (fd >= 0)
+            close(fd);
+        return (NULL);
+    }
+    if ((size_t)st.st_size < sizeof(struct ScenarioHeader))
+    {
+        fprintf(ferr, "Error: %s is not a scenario store\n", filename);
+        close(fd);
+        return (NULL);
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        fprintf(ferr, "Error: could not map file %s\n", filename);
+        return (NULL);
+    }
+
+    header = (const struct ScenarioHeader *)map;
+    n_values = (size_t)header->n_sims * N_TIMESTEPS;
+    if (memcmp(header->magic, SCENARIO_MAGIC, sizeof(header->magic)) != 0 ||
+        header->byte_order != SCENARIO_BYTE_ORDER || header->version != SCENARIO_VERSION)
+    {
+        fprintf(ferr, "Error: %s is not a version %d scenario store of this machine\n", filename, SCENARIO_VERSION);
+        munmap(map, st.st_size);
+        return (NULL);
+    }
+    if (header->n_years != N_YEARS || header->n_quarters != N_QUARTERS_PER_YEAR ||
+        header->n_params != N_SCENARIO_PARAMS || header->n_sims == 0 ||
+        (size_t)st.st_size != sizeof(struct ScenarioHeader) + N_SCENARIO_PARAMS * n_values * sizeof(double))
+    {
+        fprintf(ferr, "Error: the dimensions of scenario store %s do not match its size or this program\n", filename);
+        munmap(map, st.st_size);
+        return (NULL);
+    }
+
+    if ((store = (struct ScenarioStore *)calloc(1, sizeof(struct ScenarioStore))) == NULL)
+    {
+        fprintf(ferr, "Error: cannot allocate memory for scenario store.\n");
+        munmap(map, st.st_size);
+        return (NULL);
+    }
+    store->header = header;
+    store->n_sims = (int)header->n_sims;
+    for (p = 0; p < N_SCENARIO_PARAMS; p++)
+        store->column[p] = (const double *)(header + 1) + p * n_values;
+    store->map = map;
+    store->map_size = st.st_size;
+    return (store);
+}
+
+/**
+ * Unmaps and frees a scenario store of open_scenario_store(). NULL is ignored.
+ */
+void close_scenario_store(struct ScenarioStore *store)
+{
+    if (store == NULL)
+        return;
+    munmap(store->map, store->map_size);
+    free(store);
+}
+
+/**
+ * @return the value of parameter p (INF_...) in simulation k, year i and quarter j (0 based).
+ * Notes:
+ *  1. The indices are not checked; wtp() stays within the n_sims of the store.
+ */
+double scenario_value(const struct ScenarioStore *store, int p, int k, int i, int j)
+{
+    return (store->column[p][j + i * N_QUARTERS_PER_YEAR + k * N_TIMESTEPS]);
+}
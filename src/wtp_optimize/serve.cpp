@@ -0,0 +1,642 @@
+/* serve.cpp */
+/* Purpose: this file contains the server mode, which keeps the process train, the influent and
+    operations files and the Monte Carlo scenario store in memory and answers single simulation
+    requests on a local (Unix domain) socket, so that a what-if query costs one auto_dose() run
+    instead of a program start.
+
+   Protocol: text lines, one request per line and one response per request. Fields are separated
+   by blanks; <id> is any word chosen by the client and is copied into the response, since the
+   responses of requests sent without waiting (pipelined) may come back in another order.
+
+     <id> ping                                   ->  <id> ok
+     <id> shutdown                               ->  <id> ok, then the server stops
+     <id> simulate name=value ...                ->  <id> ok name=value ...   (the batch_columns)
+                                                     <id> timeout
+                                                     <id> error <message>
+
+   The names of simulate are:
+     influent=<file>      influent file of the influent directory (otherwise the influent of the train)
+     scenario=<s>,<y>,<q> influent of simulation s, year y and quarter q of the scenario store
+     operations=<file>    operations file of the operations directory
+     alk, ammonia, ...    influent water quality, see influent_columns (override the above)
+     alk_setpt, pH_setpt, DBPsf  set points, see operations_columns (override operations=)
+     timeout_ms=<ms>      time limit of the request (SERVE_TIMEOUT_MS by default)
+
+   Requests are run by a pool of worker processes, each starting from a snapshot of the train as
+   read (see batch_sim()). A worker that exits (auto_dose() cannot meet a set point) or runs past
+   the time limit of its request is replaced, and only that request fails.
+
+   The following functions are in this file:
+     serve_mode()
+*/
+
+#include "wtp_optimize.h"
+#include <deque>
+#include <map>
+#include <thread>
+#include <cmath>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SERVE_MAX_LINE 4096       // longest request line
+#define SERVE_TIMEOUT_MS 10000    // time limit of a request without timeout_ms
+#define SERVE_N_INPUTS (N_SCENARIO_PARAMS + N_OPERATIONS_COLS)  // influent in INF_ order, then set points
+
+struct ServeJob
+{   // simulate request
+    long client;                     // serial number of the client
+    std::string id;
+    double input[SERVE_N_INPUTS];    // sent to the worker
+    int timeout_ms;
+};
+
+struct ServeClient
+{
+    int fd;
+    std::string in;                  // received, not yet a full line
+    std::string out;                 // responses not yet sent
+    int eof;                         // TRUE once the client has sent everything
+    long pending;                    // simulate requests without a response
+};
+
+struct ServeWorker
+{
+    pid_t pid;
+    int fd;                          // SOCK_SEQPACKET socket to the worker
+    int busy;                        // TRUE while it runs job
+    struct ServeJob job;
+    long long deadline;              // time limit of job, see now_ms()
+};
+
+struct ServeState
+{
+    struct ProcessTrain *train;
+    struct TrainSnapshot *start;     // train as read
+    struct ServeParameters *params;
+    struct ScenarioStore *scenarios; // or NULL
+    double influent[N_SCENARIO_PARAMS];  // influent of the train as read
+    std::map<std::string, std::vector<double> > files;  // input files read, by "i" or "o" and name
+    std::map<long, struct ServeClient> clients;
+    std::deque<struct ServeJob> queue;
+    std::vector<struct ServeWorker> workers;
+    int listen_fd;
+    long next_client;
+    int stop;
+};
+
+static volatile sig_atomic_t serve_signal = 0;
+
+static void serve_on_signal(int sig)
+{
+    serve_signal = sig;
+}
+
+static long long now_ms()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((long long)t.tv_sec * 1000 + t.tv_nsec / 1000000);
+}
+
+// purpose: run the requests sent by the server on socket fd, until the server closes it
+static void serve_worker(struct ServeState *st, int fd)
+{
+    double input[SERVE_N_INPUTS];
+    double values[N_BATCH_COLS];
+
+    while (recv(fd, input, sizeof(input), 0) == (ssize_t)sizeof(input))
+    {
+        batch_sim(st->train, st->start, input, input + N_SCENARIO_PARAMS, values);
+        if (send(fd, values, sizeof(values), 0) != (ssize_t)sizeof(values))
+            break;
+    }
+    fflush(NULL);
+    _exit(EXIT_SUCCESS);
+}
+
+// purpose: start worker w. Returns TRUE/FALSE for success/fail.
+static int start_worker(struct ServeState *st, int w)
+{
+    int sv[2];
+    pid_t pid;
+    size_t i;
+    std::map<long, struct ServeClient>::iterator c;
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0)
+    {
+        perror("socketpair");
+        return (FALSE);
+    }
+    fflush(NULL);
+    if ((pid = fork()) < 0)
+    {
+        perror("fork");
+        close(sv[0]);
+        close(sv[1]);
+        return (FALSE);
+    }
+    if (pid == 0)
+    { // worker: keep only its own socket
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        close(sv[0]);
+        close(st->listen_fd);
+        for (c = st->clients.begin(); c != st->clients.end(); ++c)
+            close(c->second.fd);
+        for (i = 0; i < st->workers.size(); i++)
+        {
+            if ((int)i != w && st->workers[i].fd >= 0)
+                close(st->workers[i].fd);
+        }
+        serve_worker(st, sv[1]);
+    }
+    close(sv[1]);
+    st->workers[w].pid = pid;
+    st->workers[w].fd = sv[0];
+    st->workers[w].busy = FALSE;
+    return (TRUE);
+}
+
+// purpose: queue a response line for the client of a request, if it is still connected
+static void respond(struct ServeState *st, long client, const std::string &line, int pending)
+{
+    std::map<long, struct ServeClient>::iterator c = st->clients.find(client);
+
+    if (c == st->clients.end())
+        return;
+    c->second.out += line + "\n";
+    c->second.pending -= pending;
+}
+
+// purpose: stop worker w after it failed or ran out of time, answer its request and start another
+static void replace_worker(struct ServeState *st, int w, int timed_out)
+{
+    struct ServeWorker *worker = &st->workers[w];
+    char reason[64];
+    int status = 0;
+
+    if (timed_out)
+        kill(worker->pid, SIGKILL);
+    close(worker->fd);
+    worker->fd = -1;
+    waitpid(worker->pid, &status, 0);
+    if (worker->busy)
+    {
+        if (timed_out)
+            snprintf(reason, sizeof(reason), "timeout");
+        else if (WIFSIGNALED(status))
+            snprintf(reason, sizeof(reason), "error failed: signal %d", WTERMSIG(status));
+        else
+            snprintf(reason, sizeof(reason), "error failed: exit status %d", WEXITSTATUS(status));
+        respond(st, worker->job.client, worker->job.id + " " + reason, 1);
+        worker->busy = FALSE;
+    }
+    if (start_worker(st, w) == FALSE)
+    {
+        fprintf(stderr, "Error: cannot start a worker, stopping the server\n");
+        st->stop = TRUE;
+    }
+}
+
+// purpose: give the queued requests to the idle workers
+static void dispatch(struct ServeState *st)
+{
+    size_t w;
+
+    for (w = 0; w < st->workers.size() && !st->queue.empty(); w++)
+    {
+        struct ServeWorker *worker = &st->workers[w];
+        if (worker->busy || worker->fd < 0)
+            continue;
+        worker->job = st->queue.front();
+        st->queue.pop_front();
+        worker->busy = TRUE;
+        worker->deadline = now_ms() + worker->job.timeout_ms;
+        if (send(worker->fd, worker->job.input, sizeof(worker->job.input), 0) != (ssize_t)sizeof(worker->job.input))
+            replace_worker(st, (int)w, FALSE);
+    }
+}
+
+// purpose: read a number of a request. Returns TRUE/FALSE for success/fail.
+static int parse_number(const std::string &text, double *value)
+{
+    char *tail;
+
+    *value = strtod(text.c_str(), &tail);
+    return (!text.empty() && *tail == '\0' && std::isfinite(*value));
+}
+
+// purpose: values of an influent or operations file, read once. Returns NULL and sets error on fail.
+static const std::vector<double> *input_file(struct ServeState *st, const std::string &name, int influent, std::string &error)
+{
+    std::string key = (influent ? "i" : "o") + name;
+    std::vector<double> values;
+
+    if (st->files.count(key) != 0)
+        return (&st->files[key]);
+    if (name.find('/') != std::string::npos)
+    {
+        error = "file names cannot hold '/'";
+        return (NULL);
+    }
+    if (influent && !read_single_file(st->params->influent_dir + name, influent_columns, N_SCENARIO_PARAMS, values, error))
+        return (NULL);
+    if (!influent && !read_single_file(st->params->operations_dir + name, operations_columns, N_OPERATIONS_COLS, values, error))
+        return (NULL);
+    st->files[key] = values;
+    return (&st->files[key]);
+}
+
+/**
+ * Reads the names of a simulate request into a job.
+ * @return the error message, empty on success.
+ */
+static std::string parse_simulate(struct ServeState *st, const std::vector<std::string> &words, struct ServeJob *job)
+{
+    std::string name, text, error;
+    const std::vector<double> *values;
+    double *setpoints = job->input + N_SCENARIO_PARAMS;
+    double value;
+    size_t w, eq;
+    int pass, p, found, k, i, j;
+
+    memcpy(job->input, st->influent, sizeof(st->influent));
+    for (p = 0; p < N_OPERATIONS_COLS; p++)
+        setpoints[p] = NAN;
+    job->timeout_ms = SERVE_TIMEOUT_MS;
+
+    for (pass = 0; pass < 2; pass++) // files and scenarios first, then the values that override them
+    {
+        for (w = 2; w < words.size(); w++)
+        {
+            if ((eq = words[w].find('=')) == std::string::npos)
+                return ("expected name=value, not \"" + words[w] + "\"");
+            name = words[w].substr(0, eq);
+            text = words[w].substr(eq + 1);
+            found = (name == "influent" || name == "operations" || name == "scenario");
+            if (pass == 0 && found)
+            {
+                if (name == "scenario")
+                {
+                    if (st->scenarios == NULL)
+                        return ("the server has no scenario store");
+                    if (sscanf(text.c_str(), "%d,%d,%d", &k, &i, &j) != 3 || k < 1 || k > st->scenarios->n_sims ||
+                        i < 1 || i > N_YEARS || j < 1 || j > N_QUARTERS_PER_YEAR)
+                        return ("scenario must be <simulation>,<year>,<quarter> of the scenario store");
+                    for (p = 0; p < N_SCENARIO_PARAMS; p++)
+                        job->input[p] = scenario_value(st->scenarios, p, k - 1, i - 1, j - 1);
+                }
+                else if ((values = input_file(st, text, name == "influent", error)) == NULL)
+                    return (error);
+                else if (name == "influent")
+                    memcpy(job->input, &(*values)[0], N_SCENARIO_PARAMS * sizeof(double));
+                else
+                    memcpy(setpoints, &(*values)[0], N_OPERATIONS_COLS * sizeof(double));
+            }
+            if (pass == 0 || found)
+                continue;
+            if (name == "timeout_ms")
+            {
+                if (!parse_number(text, &value) || value < 1 || value > 86400000)
+                    return ("timeout_ms must be a number of milliseconds");
+                job->timeout_ms = (int)value;
+                continue;
+            }
+            for (p = 0; p < N_SCENARIO_PARAMS && name != influent_columns[p]; p++)
+                ;
+            if (p < N_SCENARIO_PARAMS)
+            {
+                if (!parse_number(text, &job->input[p]))
+                    return ("bad number for " + name);
+                continue;
+            }
+            for (p = 0; p < N_OPERATIONS_COLS && name != operations_columns[p]; p++)
+                ;
+            if (p == N_OPERATIONS_COLS)
+                return ("unknown name " + name);
+            if (!parse_number(text, &setpoints[p]))
+                return ("bad number for " + name);
+        }
+    }
+    for (p = 0; p < N_OPERATIONS_COLS; p++)
+    {
+        if (std::isnan(setpoints[p]))
+            return (std::string("no value for ") + operations_columns[p]);
+    }
+    return ("");
+}
+
+// purpose: answer or queue one request line of a client
+static void handle_request(struct ServeState *st, long client, const std::string &line)
+{
+    std::vector<std::string> words;
+    std::string word, error;
+    struct ServeJob job;
+    size_t i = 0, n;
+
+    while (i < line.size())
+    { // split on blanks
+        i = line.find_first_not_of(" \t\r", i);
+        if (i == std::string::npos)
+            break;
+        n = line.find_first_of(" \t\r", i);
+        words.push_back(line.substr(i, n == std::string::npos ? std::string::npos : n - i));
+        i = (n == std::string::npos) ? line.size() : n;
+    }
+    if (words.empty())
+        return;
+    if (words.size() < 2)
+        respond(st, client, words[0] + " error expected <id> <command>", 0);
+    else if (words[1] == "ping")
+        respond(st, client, words[0] + " ok", 0);
+    else if (words[1] == "shutdown")
+    {
+        respond(st, client, words[0] + " ok", 0);
+        st->stop = TRUE;
+    }
+    else if (words[1] != "simulate")
+        respond(st, client, words[0] + " error unknown command " + words[1], 0);
+    else if (!(error = parse_simulate(st, words, &job)).empty())
+        respond(st, client, words[0] + " error " + error, 0);
+    else
+    {
+        job.client = client;
+        job.id = words[0];
+        st->clients[client].pending++;
+        st->queue.push_back(job);
+    }
+}
+
+// purpose: read what a client has sent and handle its full lines
+static void read_client(struct ServeState *st, long client)
+{
+    struct ServeClient *c = &st->clients[client];
+    char buffer[4096];
+    ssize_t n;
+    size_t end;
+
+    while ((n = recv(c->fd, buffer, sizeof(buffer), 0)) > 0)
+        c->in.append(buffer, n);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+    {
+        c->eof = TRUE;
+        if (!c->in.empty())
+            c->in += "\n"; // last line without a line end
+    }
+    while ((end = c->in.find('\n')) != std::string::npos)
+    {
+        std::string line = c->in.substr(0, end);
+        c->in.erase(0, end + 1);
+        handle_request(st, client, line);
+        c = &st->clients[client];
+    }
+    if (c->in.size() > SERVE_MAX_LINE)
+    {
+        c->in.clear();
+        c->out += "- error request line too long\n";
+        c->eof = TRUE;
+    }
+}
+
+// purpose: open the listening socket. Returns its descriptor, or -1 on error.
+static int open_socket(const char *filename)
+{
+    struct sockaddr_un address;
+    struct stat info;
+    int fd;
+
+    if (strlen(filename) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "Error: socket path %s is too long\n", filename);
+        return (-1);
+    }
+    if (stat(filename, &info) == 0 && S_ISSOCK(info.st_mode))
+        unlink(filename); // left by a server that did not stop cleanly
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, filename);
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+        bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, 64) < 0)
+    {
+        fprintf(stderr, "Error: cannot listen on %s: %s\n", filename, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return (-1);
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return (fd);
+}
+
+/**
+ * Server mode: answers single simulation requests on a Unix domain socket until a shutdown
+ * request, SIGINT or SIGTERM.
+ * @param train: process train as read, the starting point of every request.
+ * @param params: socket, input directories, scenario store and number of workers.
+ * @return TRUE/FALSE for success/fail.
+ * Notes:
+ *  1. A request gives the results of "-r batch" for the same influent and set points.
+ *  2. Requests still queued or running when the server stops are answered with an error.
+ */
+int serve_mode(struct ProcessTrain *train, struct ServeParameters *params)
+{
+    struct ServeState st;
+    std::vector<struct pollfd> fds;
+    std::vector<long> fd_client;  // client of each entry of fds, -1 for the others
+    std::map<long, struct ServeClient>::iterator c;
+    struct pollfd pfd = {};       // revents stays 0 in every entry pushed into fds
+    long long now, next_deadline;
+    int n_workers = params->n_workers, fd, timeout, ok = TRUE;
+    size_t w, f;
+    ssize_t n;
+    double values[N_BATCH_COLS];
+    char number[32];
+
+    st.train = train;
+    st.params = params;
+    st.scenarios = NULL;
+    st.next_client = 0;
+    st.stop = FALSE;
+    if (train_influent(train, st.influent) == FALSE)
+    {
+        fprintf(stderr, "Error: the process train has no influent\n");
+        return (FALSE);
+    }
+    if (params->scenario_filename != NULL && (st.scenarios = open_scenario_store(params->scenario_filename, stderr)) == NULL)
+        return (FALSE);
+    if ((st.start = snapshot_train(train, NULL)) == NULL)
+    {
+        fprintf(stderr, "Error: cannot allocate memory for the server.\n");
+        close_scenario_store(st.scenarios);
+        return (FALSE);
+    }
+    if ((st.listen_fd = open_socket(params->socket_filename)) < 0)
+    {
+        FreeTrainSnapshot(st.start);
+        close_scenario_store(st.scenarios);
+        return (FALSE);
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, serve_on_signal);
+    signal(SIGTERM, serve_on_signal);
+    if (n_workers <= 0)
+        n_workers = (int)std::thread::hardware_concurrency();
+    if (n_workers <= 0)
+        n_workers = 1;
+    st.workers.resize(n_workers);
+    for (w = 0; w < st.workers.size(); w++)
+        st.workers[w].fd = -1;
+    for (w = 0; w < st.workers.size() && ok; w++)
+        ok = start_worker(&st, (int)w);
+    if (ok)
+        printf("Serving %s on %s with %d workers\n", train->file_name, params->socket_filename, n_workers);
+    fflush(stdout);
+
+    while (ok && !st.stop && !serve_signal)
+    {
+        /* Wait for a connection, a request, a result, room to send, or the next time limit */
+        fds.clear();
+        fd_client.clear();
+        pfd.fd = st.listen_fd;
+        pfd.events = POLLIN;
+        fds.push_back(pfd);
+        fd_client.push_back(-1);
+        for (c = st.clients.begin(); c != st.clients.end(); ++c)
+        {
+            pfd.fd = c->second.fd;
+            pfd.events = (c->second.eof ? 0 : POLLIN) | (c->second.out.empty() ? 0 : POLLOUT);
+            fds.push_back(pfd);
+            fd_client.push_back(c->first);
+        }
+        next_deadline = -1;
+        for (w = 0; w < st.workers.size(); w++)
+        {
+            pfd.fd = st.workers[w].fd;
+            pfd.events = POLLIN;
+            fds.push_back(pfd);
+            fd_client.push_back(-1);
+            if (st.workers[w].busy && (next_deadline < 0 || st.workers[w].deadline < next_deadline))
+                next_deadline = st.workers[w].deadline;
+        }
+        now = now_ms();
+        timeout = (next_deadline < 0) ? -1 : (int)std::max(0LL, next_deadline - now);
+        if (poll(&fds[0], fds.size(), timeout) < 0)
+        {
+            if (errno == EINTR)
+                continue; // revents not set; a signal stops the server at the top of the loop
+            perror("poll");
+            ok = FALSE;
+            break;
+        }
+
+        /* Results and failures of the workers */
+        now = now_ms();
+        for (w = 0; w < st.workers.size(); w++)
+        {
+            struct ServeWorker *worker = &st.workers[w];
+            f = 1 + st.clients.size() + w;
+            if (fds[f].revents & (POLLIN | POLLHUP | POLLERR))
+            {
+                n = recv(worker->fd, values, sizeof(values), 0);
+                if (n == (ssize_t)sizeof(values) && worker->busy)
+                {
+                    std::string line = worker->job.id + " ok";
+                    for (int v = 0; v < N_BATCH_COLS; v++)
+                    {
+                        snprintf(number, sizeof(number), "%.17g", values[v]);
+                        line += std::string(" ") + batch_columns[v] + "=" + number;
+                    }
+                    worker->busy = FALSE;
+                    respond(&st, worker->job.client, line, 1);
+                }
+                else
+                    replace_worker(&st, (int)w, FALSE);
+            }
+            else if (worker->busy && now >= worker->deadline)
+                replace_worker(&st, (int)w, TRUE);
+        }
+
+        /* Requests and responses of the clients */
+        for (f = 1; f < 1 + fd_client.size() && f < fds.size(); f++)
+        {
+            if (fd_client[f] < 0 || st.clients.count(fd_client[f]) == 0)
+                continue;
+            if (fds[f].revents & (POLLIN | POLLHUP | POLLERR))
+                read_client(&st, fd_client[f]);
+        }
+        for (c = st.clients.begin(); c != st.clients.end();)
+        {
+            struct ServeClient *client = &c->second;
+            while (!client->out.empty() && (n = send(client->fd, client->out.data(), client->out.size(), 0)) > 0)
+                client->out.erase(0, n);
+            if (!client->out.empty() && n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            { // the client has gone
+                client->out.clear();
+                client->eof = TRUE;
+                client->pending = 0;
+            }
+            if (client->eof && client->pending <= 0 && client->out.empty())
+            {
+                close(client->fd);
+                st.clients.erase(c++);
+            }
+            else
+                ++c;
+        }
+
+        /* New connections */
+        if (fds[0].revents & POLLIN)
+        {
+            while ((fd = accept(st.listen_fd, NULL, NULL)) >= 0)
+            {
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                struct ServeClient &client = st.clients[st.next_client++];
+                client.fd = fd;
+                client.eof = FALSE;
+                client.pending = 0;
+            }
+        }
+
+        dispatch(&st);
+    }
+
+    /* Stop: answer the requests not run, send what is left to send, then stop the workers */
+    for (w = 0; w < st.workers.size(); w++)
+    {
+        if (st.workers[w].busy)
+            respond(&st, st.workers[w].job.client, st.workers[w].job.id + " error the server stopped", 1);
+    }
+    for (; !st.queue.empty(); st.queue.pop_front())
+        respond(&st, st.queue.front().client, st.queue.front().id + " error the server stopped", 1);
+    for (c = st.clients.begin(); c != st.clients.end(); ++c)
+    {
+        fcntl(c->second.fd, F_SETFL, 0);
+        if (!c->second.out.empty())
+            send(c->second.fd, c->second.out.data(), c->second.out.size(), 0);
+        close(c->second.fd);
+    }
+    for (w = 0; w < st.workers.size(); w++)
+    {
+        if (st.workers[w].fd < 0)
+            continue;
+        if (st.workers[w].busy)
+            kill(st.workers[w].pid, SIGKILL);
+        close(st.workers[w].fd);
+        waitpid(st.workers[w].pid, NULL, 0);
+    }
+    close(st.listen_fd);
+    unlink(params->socket_filename);
+    FreeTrainSnapshot(st.start);
+    close_scenario_store(st.scenarios);
+    printf("Server stopped\n");
+    return (ok);
+}
@@ -0,0 +1,340 @@
+/* stream_dose.cpp */
+/* Purpose: this file contains the streaming dosing mode, which reads influent measurements as
+    they arrive (from stdin, a FIFO fed by the plant, or a file of historic records to replay) and
+    writes the chemical doses that meet the set points for each record as soon as they are found.
+
+   Records: a CSV header line, then one line per record. The columns are named as in the influent
+   files (see influent_columns) and optionally the operations files (see operations_columns); a
+   column "time" is copied to the results and the other columns are ignored. A column that is
+   missing takes the value of the .wtp file (influent) or of the operations file (set points), and
+   an empty field keeps the value of the previous record. Blank lines and lines starting with '#'
+   are skipped.
+
+   Each record is dosed by auto_dose() in a worker process that stays warm between records: it
+   keeps the train as read and the memos of its unit kernels (see memo_wtp.cpp), and starts every
+   record from the doses of the .wtp file (see batch_sim()). The doses found for the previous record
+   are not a usable starting point: auto_dose() only raises the lime dose and settles on other doses
+   than from the .wtp file, so the results would depend on the records before. A record that takes
+   longer than the time limit is reported as "timeout", and a record for which auto_dose() exits as
+   failed; in both cases the worker is replaced.
+
+   The following functions are in this file:
+     stream_mode()
+*/
+
+#include "wtp_optimize.h"
+#include <algorithm>
+#include <cmath>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define STREAM_N_INPUTS (N_SCENARIO_PARAMS + N_OPERATIONS_COLS)  // influent in INF_ order, then set points
+
+struct StreamWorker
+{
+    pid_t pid;
+    int fd;      // SOCK_SEQPACKET socket to the worker
+    long n_records;  // number of records dosed by the worker
+};
+
+static double now_ms()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (t.tv_sec * 1000.0 + t.tv_nsec / 1e6);
+}
+
+// purpose: dose the records sent by the parent on socket fd, until the parent closes it
+static void stream_worker(struct ProcessTrain *train, struct TrainSnapshot *start, int fd)
+{
+    double input[STREAM_N_INPUTS];
+    double values[N_BATCH_COLS];
+
+    while (recv(fd, input, sizeof(input), 0) == (ssize_t)sizeof(input))
+    {
+        batch_sim(train, start, input, input + N_SCENARIO_PARAMS, values);
+        if (send(fd, values, sizeof(values), 0) != (ssize_t)sizeof(values))
+            break;
+    }
+    fflush(NULL);
+    _exit(EXIT_SUCCESS);
+}
+
+// purpose: start a worker from the train as read. Returns TRUE/FALSE for success/fail.
+static int start_worker(struct ProcessTrain *train, struct TrainSnapshot *start, FILE *stream, struct StreamWorker *worker)
+{
+    int sv[2];
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0)
+    {
+        perror("socketpair");
+        return (FALSE);
+    }
+    fflush(NULL);
+    if ((worker->pid = fork()) < 0)
+    {
+        perror("fork");
+        close(sv[0]);
+        close(sv[1]);
+        return (FALSE);
+    }
+    if (worker->pid == 0)
+    {
+        close(sv[0]);
+        close(fileno(stream)); // not fclose(), which would move the read offset of the parent
+        stream_worker(train, start, sv[1]);
+    }
+    close(sv[1]);
+    worker->fd = sv[0];
+    worker->n_records = 0;
+    return (TRUE);
+}
+
+// purpose: stop a worker, killing it if kill_it. Returns its wait() status.
+static int stop_worker(struct StreamWorker *worker, int kill_it)
+{
+    int status = 0;
+
+    if (kill_it)
+        kill(worker->pid, SIGKILL);
+    close(worker->fd);
+    worker->fd = -1;
+    waitpid(worker->pid, &status, 0);
+    return (status);
+}
+
+// purpose: split a CSV line into its fields, without quotes
+static void split_fields(const std::string &line, std::vector<std::string> &fields)
+{
+    size_t begin = 0, end;
+
+    fields.clear();
+    for (;;)
+    {
+        end = line.find(',', begin);
+        std::string field = line.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+        field.erase(0, field.find_first_not_of(" \t\r"));
+        field.erase(field.find_last_not_of(" \t\r") + 1);
+        fields.push_back(field);
+        if (end == std::string::npos)
+            break;
+        begin = end + 1;
+    }
+}
+
+/**
+ * Doses one record: sends it to the worker and waits for the doses until the time limit.
+ * @param input: influent and set points of the record, see STREAM_N_INPUTS.
+ * @param values: receives the results, in the order of batch_columns.
+ * @param warm: receives TRUE/FALSE if the worker had dosed records before or was started for this one.
+ * @return "ok", "timeout" or why the record failed.
+ */
+static std::string dose_record(struct ProcessTrain *train, struct TrainSnapshot *start, FILE *stream,
+                               struct StreamWorker *worker, const double *input, double deadline,
+                               double *values, int *warm)
+{
+    struct pollfd pfd;
+    char reason[64];
+    int status, n;
+
+    if (worker->fd < 0 && start_worker(train, start, stream, worker) == FALSE)
+        return ("failed: cannot start a worker");
+    *warm = (worker->n_records > 0);
+    if (send(worker->fd, input, STREAM_N_INPUTS * sizeof(double), 0) == (ssize_t)(STREAM_N_INPUTS * sizeof(double)))
+    {
+        pfd.fd = worker->fd;
+        pfd.events = POLLIN;
+        do
+        {
+            n = poll(&pfd, 1, (int)std::max(0.0, ceil(deadline - now_ms())));
+        } while (n < 0 && errno == EINTR);
+        if (n == 0)
+        { // the worker has run past the time limit of the record
+            stop_worker(worker, TRUE);
+            return ("timeout");
+        }
+        if (n > 0 && recv(worker->fd, values, N_BATCH_COLS * sizeof(double), 0) == (ssize_t)(N_BATCH_COLS * sizeof(double)))
+        {
+            worker->n_records++;
+            return ("ok");
+        }
+    }
+    status = stop_worker(worker, FALSE);
+    if (WIFSIGNALED(status))
+        snprintf(reason, sizeof(reason), "failed: signal %d", WTERMSIG(status));
+    else
+        snprintf(reason, sizeof(reason), "failed: exit status %d", WEXITSTATUS(status));
+    return (reason);
+}
+
+/**
+ * Streaming dosing mode: doses influent records as they arrive and writes the results of each
+ * record at once.
+ * @param train: process train as read.
+ * @param params: stream, default set points and time limit.
+ * @param fout: results, a CSV line per record.
+ * @return the number of records that failed or timed out, or -1 on error.
+ * Notes:
+ *  1. The results are those of "-r batch" for the same influent and set points. The column "start"
+ *     tells if the record was dosed by a warm worker or one started for it, which is slower.
+ *  2. The latency of a record is measured from the time its line is read until its results are
+ *     written, so it does not include the time waiting for the record.
+ */
+int stream_mode(struct ProcessTrain *train, struct StreamParameters *params, FILE *fout)
+{
+    FILE *stream = stdin;
+    struct TrainSnapshot *start;
+    struct StreamWorker worker;
+    std::vector<std::string> fields;
+    std::vector<int> column;   // input of each field (0..STREAM_N_INPUTS-1), -1 for "time", -2 ignored
+    std::vector<double> latency;
+    std::string line, status, error, time;
+    double input[STREAM_N_INPUTS], record_input[STREAM_N_INPUTS], values[N_BATCH_COLS];
+    double t0, sum = 0.0;
+    char *buffer = NULL, *tail;
+    size_t size = 0;
+    ssize_t length;
+    long record = 0, n_timeout = 0, n_failed = 0;
+    int header = FALSE, has_time = FALSE, warm = FALSE, c, p;
+
+    if (train_influent(train, input) == FALSE)
+    {
+        fprintf(stderr, "Error: the process train has no influent\n");
+        return (-1);
+    }
+    memcpy(input + N_SCENARIO_PARAMS, params->setpoints, N_OPERATIONS_COLS * sizeof(double));
+    if (params->stream_filename != NULL && (stream = fopen(params->stream_filename, "r")) == NULL)
+    {
+        fprintf(stderr, "Error: cannot open %s: %s\n", params->stream_filename, strerror(errno));
+        return (-1);
+    }
+    if ((start = snapshot_train(train, NULL)) == NULL)
+    {
+        fprintf(stderr, "Error: cannot allocate memory for the stream.\n");
+        if (stream != stdin)
+            fclose(stream);
+        return (-1);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    worker.pid = 0;
+    worker.fd = -1;
+    worker.n_records = 0;
+
+    while ((length = getline(&buffer, &size, stream)) >= 0)
+    {
+        line.assign(buffer, length);
+        line.erase(line.find_last_not_of("\r\n") + 1);
+        if (line.find_first_not_of(" \t") == std::string::npos || line[line.find_first_not_of(" \t")] == '#')
+            continue;
+        split_fields(line, fields);
+
+        /* Header: find the inputs of the columns */
+        if (header == FALSE)
+        {
+            column.assign(fields.size(), -2);
+            for (c = 0; c < (int)fields.size(); c++)
+            {
+                for (p = 0; p < STREAM_N_INPUTS; p++)
+                {
+                    if (fields[c] == (p < N_SCENARIO_PARAMS ? influent_columns[p] : operations_columns[p - N_SCENARIO_PARAMS]))
+                        column[c] = p;
+                }
+                if (fields[c] == "time")
+                {
+                    column[c] = -1;
+                    has_time = TRUE;
+                }
+            }
+            for (p = 0; p < N_OPERATIONS_COLS; p++)
+            {
+                if (std::isnan(input[N_SCENARIO_PARAMS + p]) && std::find(column.begin(), column.end(), N_SCENARIO_PARAMS + p) == column.end())
+                {
+                    fprintf(stderr, "Error: the stream has no column %s and no operations file gives it\n", operations_columns[p]);
+                    FreeTrainSnapshot(start);
+                    if (stream != stdin)
+                        fclose(stream);
+                    free(buffer);
+                    return (-1);
+                }
+            }
+            fprintf(fout, "record,%sstatus,start,latency_ms", has_time ? "time," : "");
+            for (c = 0; c < N_BATCH_COLS; c++)
+                fprintf(fout, ",%s", batch_columns[c]);
+            fprintf(fout, "\n");
+            fflush(fout);
+            header = TRUE;
+            continue;
+        }
+
+        /* Record */
+        t0 = now_ms();
+        record++;
+        error.clear();
+        time.clear();
+        memcpy(record_input, input, sizeof(input));
+        for (c = 0; c < (int)fields.size() && c < (int)column.size(); c++)
+        {
+            if (column[c] == -1)
+                time = fields[c];
+            if (column[c] < 0 || fields[c].empty())
+                continue;
+            record_input[column[c]] = strtod(fields[c].c_str(), &tail);
+            if (*tail != '\0' || !std::isfinite(record_input[column[c]]))
+            {
+                error = std::string("failed: bad value for ") + (column[c] < N_SCENARIO_PARAMS ?
+                        influent_columns[column[c]] : operations_columns[column[c] - N_SCENARIO_PARAMS]);
+                break;
+            }
+        }
+        if (!error.empty())
+        {
+            status = error;
+            warm = -1; // not sent to the worker
+        }
+        else
+        {
+            memcpy(input, record_input, sizeof(input)); // the values of the next empty fields
+            status = dose_record(train, start, stream, &worker, input, t0 + params->timeout_ms, values, &warm);
+        }
+        latency.push_back(now_ms() - t0);
+        sum += latency.back();
+
+        fprintf(fout, "%ld,%s%s,%s,%.3f", record, has_time ? (time + ",").c_str() : "", status.c_str(),
+                warm < 0 ? "-" : (warm ? "warm" : "cold"), latency.back());
+        for (c = 0; c < N_BATCH_COLS; c++)
+        {
+            if (status == "ok")
+                fprintf(fout, ",%.17g", values[c]);
+            else
+                fprintf(fout, ",NA");
+        }
+        fprintf(fout, "\n");
+        fflush(fout); // at once, for whoever reads the results as they come
+        if (status == "timeout")
+            n_timeout++;
+        else if (status != "ok")
+            n_failed++;
+    }
+
+    if (worker.fd >= 0)
+        stop_worker(&worker, FALSE);
+    FreeTrainSnapshot(start);
+    if (stream != stdin)
+        fclose(stream);
+    free(buffer);
+
+    printf("%ld records: %ld ok, %ld timed out, %ld failed\n", record, record - n_timeout - n_failed, n_timeout, n_failed);
+    if (record > 0)
+    {
+        std::sort(latency.begin(), latency.end());
+        printf("latency (ms): mean %.3f, median %.3f, 95th percentile %.3f, maximum %.3f\n", sum / record,
+               latency[(record - 1) / 2], latency[(size_t)ceil(0.95 * record) - 1], latency.back());
+    }
+    return ((int)(n_timeout + n_failed));
+}
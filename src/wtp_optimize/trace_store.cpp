@@ -0,0 +1,332 @@
+/* trace_store.cpp */
+/* Purpose: this file contains functions which write and read trace files: one row of numbers per
+    evaluated cell (for wtp(), one scenario x quarter of a function evaluation), stored column by
+    column for post-processing, see trace_main.cpp.
+
+   Rows are appended by trace_append() into a bounded lock-free queue (a ring of row slots, each
+   with a sequence number, so several threads may append at once) and written by a background
+   thread, so the evaluating thread never waits on the file unless the queue is full. The writer
+   thread collects TRACE_BLOCK_ROWS rows at a time and writes them as one row group.
+
+   File layout (native byte order, version TRACE_VERSION):
+     struct TraceHeader             magic, version, byte order mark, n_cols, rows per group, n_rows
+     n_cols names                   TRACE_NAME_LEN characters each, zero padded
+     row group                      uint32_t n, uint32_t 0, then n doubles of each column in turn
+     ...
+   n_rows is TRACE_OPEN until close_trace() has written the last row group.
+
+   The following functions are in this file:
+     open_trace()
+     trace_append()
+     close_trace()
+     read_trace_table()
+*/
+
+#include "wtp_optimize.h"
+#include <stddef.h>  // offsetof
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#define TRACE_BYTE_ORDER 0x01020304u
+#define TRACE_OPEN UINT64_MAX          // n_rows of a file that has not been closed
+
+struct TraceHeader
+{   // start of a trace file
+    char magic[8];          // TRACE_MAGIC
+    uint32_t version;       // TRACE_VERSION
+    uint32_t byte_order;    // TRACE_BYTE_ORDER in the byte order of the writer
+    uint32_t n_cols;        // number of columns
+    uint32_t block_rows;    // rows of a full row group
+    uint64_t n_rows;        // number of rows, TRACE_OPEN while being written
+};
+
+struct TraceWriter
+{
+    FILE *fout;
+    std::string filename;
+    int n_cols;
+    std::vector<std::atomic<size_t> > seq;  // sequence number of each slot of the queue
+    std::vector<double> slots;              // TRACE_QUEUE_ROWS rows of n_cols values
+    std::atomic<size_t> head;               // next slot to append to
+    size_t tail;                            // next slot to write, writer thread only
+    std::vector<double> block;              // row group being collected, column by column
+    int block_n;                            // rows in block
+    uint64_t n_rows;                        // rows written
+    std::atomic<int> stop;                  // TRUE when close_trace() has been called
+    std::atomic<int> error;                 // TRUE after a failed write
+    std::atomic<long> full;                 // times trace_append() found the queue full
+    std::thread thread;
+
+    TraceWriter(int n) : n_cols(n), seq(TRACE_QUEUE_ROWS), slots((size_t)TRACE_QUEUE_ROWS * n),
+                         head(0), tail(0), block((size_t)TRACE_BLOCK_ROWS * n), block_n(0),
+                         n_rows(0), stop(FALSE), error(FALSE), full(0) {}
+};
+
+/**
+ * Writes the collected rows of the writer thread as one row group.
+ */
+static void write_block(struct TraceWriter *trace)
+{
+    uint32_t n[2] = {(uint32_t)trace->block_n, 0};
+    int c;
+
+    if (trace->block_n == 0)
+        return;
+    if (fwrite(n, sizeof(n), 1, trace->fout) != 1)
+        trace->error = TRUE;
+    for (c = 0; c < trace->n_cols; c++)
+        if (fwrite(&trace->block[(size_t)c * TRACE_BLOCK_ROWS], sizeof(double), trace->block_n, trace->fout) != (size_t)trace->block_n)
+            trace->error = TRUE;
+    trace->n_rows += trace->block_n;
+    trace->block_n = 0;
+}
+
+/**
+ * Body of the writer thread: moves rows from the queue into row groups until close_trace().
+ * Notes:
+ *  1. The thread polls the queue, so that trace_append() makes no system calls. A row is
+ *     taken once its slot's sequence number shows it complete; the slot is then handed back
+ *     to the appenders one lap of the ring later.
+ */
+static void trace_writer(struct TraceWriter *trace)
+{
+    const size_t mask = TRACE_QUEUE_ROWS - 1;
+    size_t slot;
+    int c, stopping;
+
+    for (;;)
+    {
+        stopping = trace->stop.load(std::memory_order_acquire);
+        while (trace->seq[slot = trace->tail & mask].load(std::memory_order_acquire) == trace->tail + 1)
+        {
+            for (c = 0; c < trace->n_cols; c++)
+                trace->block[(size_t)c * TRACE_BLOCK_ROWS + trace->block_n] = trace->slots[slot * trace->n_cols + c];
+            trace->seq[slot].store(trace->tail + TRACE_QUEUE_ROWS, std::memory_order_release);
+            trace->tail++;
+            if (++trace->block_n == TRACE_BLOCK_ROWS)
+                write_block(trace);
+        }
+        if (stopping)
+            break; // every row appended before close_trace() has been taken
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    write_block(trace);
+}
+
+/**
+ * Creates a trace file and starts its writer thread.
+ * @param filename: trace file to write.
+ * @param names: names of the n_cols columns, at most TRACE_NAME_LEN - 1 characters each.
+ * @param ferr: stream for error messages.
+ * @return the trace, or NULL if the file cannot be written. Finish it with close_trace().
+ */
+struct TraceWriter *open_trace(const char *filename, const std::vector<std::string> &names, FILE *ferr)
+{
+    struct TraceWriter *trace;
+    struct TraceHeader header;
+    char name[TRACE_NAME_LEN];
+    size_t i;
+    FILE *fout;
+
+    for (i = 0; i < names.size(); i++)
+    {
+        if (names[i].empty() || names[i].size() >= TRACE_NAME_LEN)
+        {
+            fprintf(ferr, "Error: trace column name \"%s\" is empty or longer than %d characters\n", names[i].c_str(), TRACE_NAME_LEN - 1);
+            return (NULL);
+        }
+    }
+    if (names.empty() || (fout = fopen(filename, "wb")) == NULL)
+    {
+        fprintf(ferr, "Error: could not write file %s\n", filename);
+        return (NULL);
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.byte_order = TRACE_BYTE_ORDER;
+    header.n_cols = (uint32_t)names.size();
+    header.block_rows = TRACE_BLOCK_ROWS;
+    header.n_rows = TRACE_OPEN;
+    int ok = (fwrite(&header, sizeof(header), 1, fout) == 1);
+    for (i = 0; ok && i < names.size(); i++)
+    {
+        memset(name, 0, sizeof(name));
+        memcpy(name, names[i].c_str(), names[i].size());
+        ok = (fwrite(name, sizeof(name), 1, fout) == 1);
+    }
+    if (!ok)
+    {
+        fprintf(ferr, "Error: could not write file %s\n", filename);
+        fclose(fout);
+        return (NULL);
+    }
+
+    trace = new TraceWriter((int)names.size());
+    trace->fout = fout;
+    trace->filename = filename;
+    for (i = 0; i < TRACE_QUEUE_ROWS; i++)
+        trace->seq[i].store(i, std::memory_order_relaxed);
+    trace->thread = std::thread(trace_writer, trace);
+    return (trace);
+}
+
+/**
+ * Appends a row to a trace. May be called from several threads at once.
+ * @param values: the n_cols values of the row, in the order of the names given to open_trace().
+ * Notes:
+ *  1. A slot is claimed by advancing head when the slot's sequence number equals head, and
+ *     published by setting it to head + 1 once the row is copied in. If the writer thread has
+ *     fallen a whole queue behind, the caller yields until a slot is free.
+ */
+void trace_append(struct TraceWriter *trace, const double *values)
+{
+    const size_t mask = TRACE_QUEUE_ROWS - 1;
+    size_t pos = trace->head.load(std::memory_order_relaxed);
+    size_t slot, seq;
+
+    for (;;)
+    {
+        slot = pos & mask;
+        seq = trace->seq[slot].load(std::memory_order_acquire);
+        if (seq == pos)
+        {
+            if (trace->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if ((ptrdiff_t)(seq - pos) < 0)
+        { // queue full
+            trace->full.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::yield();
+            pos = trace->head.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            pos = trace->head.load(std::memory_order_relaxed);
+        }
+    }
+
+    memcpy(&trace->slots[slot * trace->n_cols], values, trace->n_cols * sizeof(double));
+    trace->seq[slot].store(pos + 1, std::memory_order_release);
+}
+
+/**
+ * Writes the remaining rows of a trace, completes its header and frees it. NULL is ignored.
+ * @param ferr: stream for error messages.
+ * @return TRUE/FALSE for success/fail.
+ * Notes:
+ *  1. Rows must not be appended once close_trace() has been called.
+ */
+int close_trace(struct TraceWriter *trace, FILE *ferr)
+{
+    uint64_t n_rows;
+    int ok;
+
+    if (trace == NULL)
+        return (TRUE);
+    trace->stop.store(TRUE, std::memory_order_release);
+    trace->thread.join();
+
+    n_rows = trace->n_rows;
+    ok = (trace->error == FALSE && fseek(trace->fout, offsetof(struct TraceHeader, n_rows), SEEK_SET) == 0 &&
+          fwrite(&n_rows, sizeof(n_rows), 1, trace->fout) == 1);
+    if (fclose(trace->fout) != 0)
+        ok = FALSE;
+    if (!ok)
+        fprintf(ferr, "Error: could not write file %s\n", trace->filename.c_str());
+    if (trace->full > 0)
+        fprintf(ferr, "Note: trace %s: the queue was full %ld times\n", trace->filename.c_str(), trace->full.load());
+    delete trace;
+    return (ok ? TRUE : FALSE);
+}
+
+/**
+ * Reads a trace file into a table, row by row as read_csv_table() does.
+ * @param filename: trace file written by open_trace().
+ * @param table: receives the column names and values; lines holds the row number (1 based).
+ * @param ferr: stream for error messages.
+ * @return TRUE/FALSE for success/fail.
+ * Notes:
+ *  1. A file that was not closed (e.g. the program was stopped) is read up to its last whole
+ *     row group, with a note on ferr.
+ */
+int read_trace_table(const char *filename, struct CsvTable *table, FILE *ferr)
+{
+    struct TraceHeader header;
+    char name[TRACE_NAME_LEN];
+    std::vector<double> column;
+    uint32_t n[2];
+    long r0;
+    int c;
+    size_t r;
+    FILE *fin;
+
+    if ((fin = fopen(filename, "rb")) == NULL)
+    {
+        fprintf(ferr, "Error: could not read file %s\n", filename);
+        return (FALSE);
+    }
+    if (fread(&header, sizeof(header), 1, fin) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.byte_order != TRACE_BYTE_ORDER || header.version != TRACE_VERSION || header.n_cols == 0)
+    {
+        fprintf(ferr, "Error: %s is not a version %d trace file of this machine\n", filename, TRACE_VERSION);
+        fclose(fin);
+        return (FALSE);
+    }
+
+    table->filename = filename;
+    table->n_cols = (int)header.n_cols;
+    table->n_rows = 0;
+    table->names.clear();
+    table->values.clear();
+    table->lines.clear();
+    for (c = 0; c < table->n_cols; c++)
+    {
+        if (fread(name, sizeof(name), 1, fin) != 1)
+        {
+            fprintf(ferr, "Error: %s is truncated\n", filename);
+            fclose(fin);
+            return (FALSE);
+        }
+        name[TRACE_NAME_LEN - 1] = '\0';
+        table->names.push_back(name);
+    }
+
+    while (fread(n, sizeof(n), 1, fin) == 1)
+    {
+        if (n[0] == 0 || n[0] > header.block_rows)
+            break;
+        r0 = table->n_rows;
+        table->values.resize((size_t)(r0 + n[0]) * table->n_cols);
+        column.resize(n[0]);
+        for (c = 0; c < table->n_cols; c++)
+        {
+            if (fread(column.data(), sizeof(double), n[0], fin) != n[0])
+                break;
+            for (r = 0; r < n[0]; r++)
+                table->values[(r0 + r) * table->n_cols + c] = column[r];
+        }
+        if (c < table->n_cols)
+        {
+            table->values.resize((size_t)r0 * table->n_cols);
+            break; // partial row group
+        }
+        table->n_rows += n[0];
+        for (r = 0; r < n[0]; r++)
+            table->lines.push_back(r0 + r + 1);
+    }
+    fclose(fin);
+
+    if (header.n_rows == TRACE_OPEN)
+    {
+        fprintf(ferr, "Note: %s was not closed, %ld rows of whole row groups read\n", filename, table->n_rows);
+    }
+    else if ((uint64_t)table->n_rows != header.n_rows)
+    {
+        fprintf(ferr, "Error: %s holds %ld of its %llu rows\n", filename, table->n_rows, (unsigned long long)header.n_rows);
+        return (FALSE);
+    }
+    return (TRUE);
+}
@@ -0,0 +1,179 @@
+/* worker_pool.cpp */
+/* Purpose: this file contains a pool of worker processes for the run modes that evaluate many
+    independent items (influent/operations pairs, archived decision vectors, ...).
+
+   The pool is forked after the caller has read its inputs, so the workers share them. A worker
+   takes the next item from a counter in shared memory, evaluates it and writes its values into a
+   shared slot. auto_dose() and the root finder exit the program when they fail, so the items are
+   evaluated in processes rather than threads: a worker that ends while it holds an item marks
+   only that item as failed, and another worker is started for the items that remain. Only the
+   pool's own workers are waited for, by their pids, so other children of the caller (e.g. those
+   of serve mode) are left to it.
+
+   The following functions are in this file:
+     run_worker_pool()
+*/
+
+#include "wtp_optimize.h"
+#include <atomic>
+#include <errno.h>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define POOL_PENDING 0   // item not evaluated yet
+#define POOL_RUNNING 1   // item taken by a worker
+#define POOL_DONE 2      // values written
+#define POOL_FAILED 3    // not evaluated, or its worker ended in it
+#define POOL_POLL_US 2000 // microseconds between polls of the workers
+
+struct PoolSlot
+{   // state of one item, in memory shared with the workers
+    int state;           // POOL_...
+    pid_t pid;           // worker that took the item
+};
+
+// purpose: wait for one of the workers to end and remove it from workers. Returns its pid, with
+//  its wait() status in *wstatus (-1 if it was reaped elsewhere), or -1 if there are no workers.
+static pid_t wait_worker(std::vector<pid_t> &workers, int *wstatus)
+{
+    pid_t pid, r;
+    size_t w;
+
+    while (!workers.empty())
+    {
+        for (w = 0; w < workers.size(); w++)
+        {
+            pid = workers[w];
+            if ((r = waitpid(pid, wstatus, WNOHANG)) == pid || (r < 0 && errno == ECHILD))
+            {
+                if (r < 0)
+                    *wstatus = -1;
+                workers.erase(workers.begin() + w);
+                return (pid);
+            }
+        }
+        usleep(POOL_POLL_US);
+    }
+    return (-1);
+}
+
+/**
+ * Evaluates items on a pool of worker processes.
+ * @param n_items: number of items.
+ * @param n_values: number of values of an item.
+ * @param n_workers: number of worker processes, 0 for one per processor.
+ * @param task: evaluates item i into its n_values values, in a worker.
+ * @param arg: passed to task.
+ * @param values: receives the n_items x n_values values, item by item, for the items evaluated.
+ * @param status: status of each item. Items with a status on entry (e.g. why their inputs could
+ *                not be read) are not evaluated. On return it is "ok" for the items evaluated, or
+ *                why they failed.
+ * @return the number of items that failed, or -1 if the pool cannot be started.
+ * Notes:
+ *  1. Each worker is a copy of the caller at the time of the call: task may read anything the
+ *     caller has set up, but what it changes outside values is lost.
+ *  2. stdout and stderr are flushed before forking, so nothing buffered is written twice.
+ */
+int run_worker_pool(long n_items, int n_values, int n_workers, PoolTask task, void *arg,
+                    double *values, std::vector<std::string> &status)
+{
+    struct PoolSlot *slots;
+    std::atomic<long> *next;   // next item to evaluate
+    double *shared_values;
+    void *map;
+    size_t map_size;
+    std::vector<pid_t> workers;   // pids of the running workers
+    long i, n_failed = 0;
+    int wstatus;
+    pid_t pid;
+    char reason[64];
+
+    status.resize(n_items);
+    if (n_items == 0)
+        return (0);
+
+    map_size = sizeof(std::atomic<long>) + n_items * (sizeof(struct PoolSlot) + n_values * sizeof(double));
+    if ((map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+    {
+        perror("mmap");
+        return (-1);
+    }
+    next = new (map) std::atomic<long>(0);
+    shared_values = (double *)((char *)map + sizeof(std::atomic<long>));
+    slots = (struct PoolSlot *)(shared_values + n_items * n_values);
+    for (i = 0; i < n_items; i++)
+    {
+        slots[i].state = POOL_PENDING;
+        slots[i].pid = 0;
+    }
+
+    if (n_workers <= 0)
+        n_workers = (int)std::thread::hardware_concurrency();
+    if (n_workers <= 0)
+        n_workers = 1;
+    if (n_workers > n_items)
+        n_workers = (int)n_items;
+    fflush(NULL);
+
+    for (;;)
+    {
+        while ((int)workers.size() < n_workers && next->load() < n_items)
+        {
+            if ((pid = fork()) < 0)
+            {
+                perror("fork");
+                break;
+            }
+            if (pid == 0)
+            { // worker
+                while ((i = next->fetch_add(1)) < n_items)
+                {
+                    if (!status[i].empty())
+                        continue;
+                    slots[i].pid = getpid();
+                    slots[i].state = POOL_RUNNING;
+                    task(i, shared_values + i * n_values, arg);
+                    slots[i].state = POOL_DONE;
+                }
+                fflush(NULL);
+                _exit(EXIT_SUCCESS);
+            }
+            workers.push_back(pid);
+        }
+        if ((pid = wait_worker(workers, &wstatus)) < 0)
+            break; // no workers left, and none could be started
+        for (i = 0; i < n_items; i++)
+        {
+            if (slots[i].state == POOL_RUNNING && slots[i].pid == pid)
+            { // the worker ended in this item
+                if (wstatus == -1)
+                    snprintf(reason, sizeof(reason), "failed: worker lost");
+                else if (WIFSIGNALED(wstatus))
+                    snprintf(reason, sizeof(reason), "failed: signal %d", WTERMSIG(wstatus));
+                else
+                    snprintf(reason, sizeof(reason), "failed: exit status %d", WEXITSTATUS(wstatus));
+                status[i] = reason;
+                slots[i].state = POOL_FAILED;
+            }
+        }
+    }
+
+    // All workers have ended: the items never taken (fork() failed) or abandoned are failed
+    for (i = 0; i < n_items; i++)
+    {
+        if (slots[i].state == POOL_DONE)
+        {
+            status[i] = "ok";
+            memcpy(values + i * n_values, shared_values + i * n_values, n_values * sizeof(double));
+            continue;
+        }
+        if (status[i].empty())
+            status[i] = (slots[i].state == POOL_RUNNING) ? "failed: worker lost" : "failed: not evaluated";
+        slots[i].state = POOL_FAILED;
+        n_failed++;
+    }
+    munmap(map, map_size);
+    return ((int)n_failed);
+}
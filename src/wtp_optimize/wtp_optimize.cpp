@@ -12,9 +12,13 @@
 * - single simulation (with automatic chemical dosing)
 * - multi-simulation (with automatic chemical dosing)
 * - simulation-optimization (with automatic chemical dosing)
+* - re-evaluation of the Pareto archive of a simulation-optimization
 * - validation
 */
 
+/* Header of the Pareto archive files of sim_opt_mode() and reevaluate_mode() */
+static const char *borg_header = "alk_Q1 pH_Q1 DBPsf_Q1 alk_Q2 pH_Q2 DBPsf_Q2 alk_Q3 pH_Q3 DBPsf_Q3 alk_Q4 pH_Q4 DBPsf_Q4 wc_freq_TTHM wc_freq_HAA5 expect_solids expect_lime expect_co2 lraa_const toc_const ct_const \n";
+
 /* Single simulation mode (with automatic chemical dosing) */
 int single_sim_mode(struct ProcessTrain *train,               /* Process train control structure    */
                     struct OperationalParameters *operations, // operational parameters
@@ -42,6 +46,7 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
 *    July 1993
 */
 {
+    struct WtpContext *ctx = &train->ctx;
     int e = 0;              /* fprintf() error flag */
     int bankclosed = FALSE; /*Ensures that output for bankfilter credit shows only once*/
     int presed_cntr = 0;    /* Ensures that output for presed credit shows only once */
@@ -78,7 +83,7 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
     if (train == NULL || fout == NULL)
         return (FALSE);
 
-    coldflag = FALSE;
+    ctx->coldflag = FALSE;
 
     if (runmodel(train) == FALSE)
         return (FALSE);
@@ -214,12 +219,12 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
                 count += 2;
             }
             //CT Ratio Outputs
-            if (swflag == FALSE /*influent->log_required_g == 999999.0*/ && gw_virus_flag == FALSE)
+            if (ctx->swflag == FALSE /*influent->log_required_g == 999999.0*/ && ctx->gw_virus_flag == FALSE)
             {
                 e |= fprintf(fout, "CT Ratios Not Applicable - Groundwater Is Source\r\n");
                 count += 1;
             }
-            else if (swflag == TRUE)
+            else if (ctx->swflag == TRUE)
             {
                 //   if(influent->log_required
                 e |= fprintf(fout, "CT Ratios                        \r\n");
@@ -273,12 +278,12 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
                 count += 1;
             }
             //CT Ratio Outputs
-            if (swflag == FALSE /*influent->log_required_g == 999999.0*/ && gw_virus_flag == FALSE)
+            if (ctx->swflag == FALSE /*influent->log_required_g == 999999.0*/ && ctx->gw_virus_flag == FALSE)
             {
                 e |= fprintf(fout, "CT Ratios Not Applicable - Groundwater Is Source\r\n");
                 count += 1;
             }
-            else if (swflag == TRUE)
+            else if (ctx->swflag == TRUE)
             {
                 //   if(influent->log_required
                 e |= fprintf(fout, "CT Ratios                        \r\n");
@@ -340,12 +345,12 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
                 count += 2;
             }
             //CT Ratio Outputs
-            if (swflag == FALSE /*influent->log_required_g == 999999.0*/ && gw_virus_flag == FALSE)
+            if (ctx->swflag == FALSE /*influent->log_required_g == 999999.0*/ && ctx->gw_virus_flag == FALSE)
             {
                 e |= fprintf(fout, "CT Ratios Not Applicable - Groundwater Is Source\r\n");
                 count += 1;
             }
-            else if (swflag == TRUE)
+            else if (ctx->swflag == TRUE)
             {
                 //   if(influent->log_required
                 e |= fprintf(fout, "CT Ratios                        \r\n");
@@ -407,12 +412,12 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
                 count += 2;
             }
             //CT Ratio Outputs
-            if (swflag == FALSE /*influent->log_required_g == 999999.0*/ && gw_virus_flag == FALSE)
+            if (ctx->swflag == FALSE /*influent->log_required_g == 999999.0*/ && ctx->gw_virus_flag == FALSE)
             {
                 e |= fprintf(fout, "CT Ratios Not Applicable - Groundwater Is Source\r\n");
                 count += 1;
             }
-            else if (swflag == TRUE)
+            else if (ctx->swflag == TRUE)
             {
                 //   if(influent->log_required
                 e |= fprintf(fout, "CT Ratios                        \r\n");
@@ -474,12 +479,12 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
                 count += 2;
             }
             //CT Ratio Outputs
-            if (swflag == FALSE /*influent->log_required_g == 999999.0*/ && gw_virus_flag == FALSE)
+            if (ctx->swflag == FALSE /*influent->log_required_g == 999999.0*/ && ctx->gw_virus_flag == FALSE)
             {
                 e |= fprintf(fout, "CT Ratios Not Applicable - Groundwater Is Source\r\n");
                 count += 1;
             }
-            else if (swflag == TRUE)
+            else if (ctx->swflag == TRUE)
             {
                 //   if(influent->log_required
                 e |= fprintf(fout, "CT Ratios                        \r\n");
@@ -524,6 +529,14 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
             count += 1;
         }
 
+        /* Sampling nodes of the distribution network, see open_network() */
+        if (train->network != NULL && dist_network(train) == TRUE)
+        {
+            if (print_network(fout, train->network) == FALSE)
+                e = -1;
+            count += train->network->n_nodes + 6;
+        }
+
         // if( (wait_gui!=NULL) && (count > (max_line_count - 10)) )
         //   {
         //     wait_gui("Press Continue");
@@ -548,48 +561,48 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
             e |= fprintf(fout, "     Peak Hourly%34.3f  (mgd)\r\n", FirstUnitProcess(train)->data.influent->peak_flow);
             e |= fprintf(fout, "\r\n");
             e |= fprintf(fout, "DISINFECTION INPUTS/CALCULATED VALUES\r\n");
-            if (swflag == TRUE)
+            if (ctx->swflag == TRUE)
                 e |= fprintf(fout, "Surface Water Plant?                           TRUE\r\n");
             else
                 e |= fprintf(fout, "Surface Water Plant?                          FALSE\r\n");
 
-            if (swflag == FALSE && gw_virus_flag == TRUE)
+            if (ctx->swflag == FALSE && ctx->gw_virus_flag == TRUE)
                 e |= fprintf(fout, "Groundwater Disinfection Required?             TRUE\r\n");
-            else if (swflag == TRUE) /*do nothing*/
+            else if (ctx->swflag == TRUE) /*do nothing*/
                 ;
             else
                 e |= fprintf(fout, "Groundwater Disinfection Required?            FALSE\r\n");
 
-            if (swflag == TRUE || (swflag == FALSE && gw_virus_flag == TRUE))
+            if (ctx->swflag == TRUE || (ctx->swflag == FALSE && ctx->gw_virus_flag == TRUE))
             {
-                e |= fprintf(fout, "Giardia: Total Disinfection Credit Required%7.1f  (logs)\r\n", tot_dis_req_g);
-                e |= fprintf(fout, "Giardia: Credit Achieved (other than by CT)%7.1f  (logs)\r\n", tot_giardia_lr);
-                if (tot_dis_req_g - tot_giardia_lr >= 0.0)
-                    e |= fprintf(fout, "Giardia: Inactivation Credit by CT Required%7.1f  (logs)\r\n", tot_dis_req_g - tot_giardia_lr);
+                e |= fprintf(fout, "Giardia: Total Disinfection Credit Required%7.1f  (logs)\r\n", ctx->tot_dis_req_g);
+                e |= fprintf(fout, "Giardia: Credit Achieved (other than by CT)%7.1f  (logs)\r\n", ctx->tot_giardia_lr);
+                if (ctx->tot_dis_req_g - ctx->tot_giardia_lr >= 0.0)
+                    e |= fprintf(fout, "Giardia: Inactivation Credit by CT Required%7.1f  (logs)\r\n", ctx->tot_dis_req_g - ctx->tot_giardia_lr);
                 else
                     e |= fprintf(fout, "Giardia: Inactivation Credit by CT Required%7.1f  (logs)\r\n", 0.0);
                 e |= fprintf(fout, "\r\n");
 
-                e |= fprintf(fout, "Virus: Total Disinfection Credit Required%9.1f  (logs)\r\n", tot_dis_req_v);
-                e |= fprintf(fout, "Virus: Credit Achieved (other than by CT)%9.1f  (logs)\r\n", tot_virus_lr);
-                if (tot_dis_req_v - tot_virus_lr >= 0.0)
-                    e |= fprintf(fout, "Virus: Inactivation Credit by CT Required%9.1f  (logs)\r\n", tot_dis_req_v - tot_virus_lr);
+                e |= fprintf(fout, "Virus: Total Disinfection Credit Required%9.1f  (logs)\r\n", ctx->tot_dis_req_v);
+                e |= fprintf(fout, "Virus: Credit Achieved (other than by CT)%9.1f  (logs)\r\n", ctx->tot_virus_lr);
+                if (ctx->tot_dis_req_v - ctx->tot_virus_lr >= 0.0)
+                    e |= fprintf(fout, "Virus: Inactivation Credit by CT Required%9.1f  (logs)\r\n", ctx->tot_dis_req_v - ctx->tot_virus_lr);
                 else
                     e |= fprintf(fout, "Virus: Inactivation Credit by CT Required%9.1f  (logs)\r\n", 0.0);
                 e |= fprintf(fout, "\r\n");
 
                 if (FirstUnitProcess(train)->data.influent->lt2_wscp_flag == TRUE)
                     lt2_wscp_credit = 0.5;
-                e |= fprintf(fout, "Crypto.: Total Disinfection Credit Required%7.1f  (logs)\r\n", tot_dis_req_c);
-                e |= fprintf(fout, "Crypto.: Credit Achieved (other than by CT)%7.1f  (logs)\r\n", tot_crypto_lr + lt2_wscp_credit);
+                e |= fprintf(fout, "Crypto.: Total Disinfection Credit Required%7.1f  (logs)\r\n", ctx->tot_dis_req_c);
+                e |= fprintf(fout, "Crypto.: Credit Achieved (other than by CT)%7.1f  (logs)\r\n", ctx->tot_crypto_lr + lt2_wscp_credit);
 
-                if ((tot_dis_req_c - tot_crypto_lr - lt2_wscp_credit) >= 0.0 && bin34_inactreqd == 0.0)
-                    e |= fprintf(fout, "Crypto.: Inactivation Credit by CT Required%7.1f  (logs)\r\n", tot_dis_req_c - tot_crypto_lr - lt2_wscp_credit);
-                else if ((tot_dis_req_c - tot_crypto_lr - lt2_wscp_credit) < 0.0 && bin34_inactreqd == 0.0)
+                if ((ctx->tot_dis_req_c - ctx->tot_crypto_lr - lt2_wscp_credit) >= 0.0 && ctx->bin34_inactreqd == 0.0)
+                    e |= fprintf(fout, "Crypto.: Inactivation Credit by CT Required%7.1f  (logs)\r\n", ctx->tot_dis_req_c - ctx->tot_crypto_lr - lt2_wscp_credit);
+                else if ((ctx->tot_dis_req_c - ctx->tot_crypto_lr - lt2_wscp_credit) < 0.0 && ctx->bin34_inactreqd == 0.0)
                     e |= fprintf(fout, "Crypto.: Inactivation Credit by CT Required%7.1f  (logs)\r\n", 0.0);
                 else //(bin34_inactreqd > 0.0)
                 {
-                    e |= fprintf(fout, "Crypto.: Inactivation Credit by CT Required%7.1f  (logs)\r\n", bin34_inactreqd);
+                    e |= fprintf(fout, "Crypto.: Inactivation Credit by CT Required%7.1f  (logs)\r\n", ctx->bin34_inactreqd);
                     e |= fprintf(fout, "Crypto. CT Credit Set by 1.0-log Requirement of Bins 3,4\r\n");
                     count++;
                 }
@@ -618,13 +631,13 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
             switch (unit->type)
             {
             case FILTER: //////////////////////////////////////////////////////////////FILTER////////////////////
-                if (unit->data.filter->filt_stage == 1 && conv_filtflag == TRUE)
+                if (unit->data.filter->filt_stage == 1 && ctx->conv_filtflag == TRUE)
                 {
                     e |= fprintf(fout, "%-16s%23.1f  %9.1f    %8.1f\r\n", UnitProcessTable[unit->type].name,
                                  unit->data.filter->giardia_lr_conv, unit->data.filter->virus_lr_conv, unit->data.filter->crypto_lr_conv);
                     count++;
                 }
-                else if (unit->data.filter->filt_stage == 1 && dir_filtflag == TRUE)
+                else if (unit->data.filter->filt_stage == 1 && ctx->dir_filtflag == TRUE)
                 {
                     e |= fprintf(fout, "%-16s%23.1f  %9.1f    %8.1f\r\n", UnitProcessTable[unit->type].name,
                                  unit->data.filter->giardia_lr_df, unit->data.filter->virus_lr_df, unit->data.filter->crypto_lr_df);
@@ -742,13 +755,13 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
                 break;
 
             case BANK_FILTER: ///////////////////////////////////////////////////////////BANK_FILTER//////////////
-                if (bankfflag == 1 && bankclosed == FALSE)
+                if (ctx->bankfflag == 1 && bankclosed == FALSE)
                 {
                     e |= fprintf(fout, "%-16s%23.1f  %9.1f    %8.1f\r\n", UnitProcessTable[unit->type].name,
                                  zero_lr, zero_lr, unit->data.bankf->crypto_lr_close);
                     count++;
                 }
-                else if (bankfflag == 2 && bankclosed == FALSE)
+                else if (ctx->bankfflag == 2 && bankclosed == FALSE)
                 {
                     e |= fprintf(fout, "%-16s%23.1f  %9.1f    %8.1f\r\n", UnitProcessTable[unit->type].name,
                                  zero_lr, zero_lr, unit->data.bankf->crypto_lr_far);
@@ -769,7 +782,7 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
                 break;
 
             case PRESED_BASIN: /////////////////////////////////////////////////////////PRESED_BASIN//////////////
-                if (lt2presedflag == TRUE && presed_cntr < 1)
+                if (ctx->lt2presedflag == TRUE && presed_cntr < 1)
                 {
                     e |= fprintf(fout, "%-16s%23.1f  %9.1f    %8.1f\r\n", UnitProcessTable[unit->type].name,
                                  zero_lr, zero_lr, unit->data.presed->crypto_lr);
@@ -779,7 +792,7 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
                 break;
 
             case SETTLING_BASIN: ///////////////////////////////////////////////2ND STAGE SOFTENING//////////////
-                if (soft2flag == TRUE && soft2_cntr < 1)
+                if (ctx->soft2flag == TRUE && soft2_cntr < 1)
                 {
                     e |= fprintf(fout, "%-17s%22.1f  %9.1f    %8.1f\r\n", soft2basin,
                                  zero_lr, zero_lr, soft2_credit);
@@ -1220,13 +1233,13 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
             e |= fprintf(fout, "%7.2f", eff->o3_res);
             e |= fprintf(fout, "%7.2f", eff->clo2_res);
             /* e |= fprintf(fout,"%7.2f", eff->processtime        );  */
-            if (influent->log_required_g == 999999.0 && gw_virus_flag == FALSE) //groundwater w/o virus dis. req'd.
+            if (influent->log_required_g == 999999.0 && ctx->gw_virus_flag == FALSE) //groundwater w/o virus dis. req'd.
             {
                 e |= fprintf(fout, "    na");
                 e |= fprintf(fout, "     na");
                 e |= fprintf(fout, "    na");
             }
-            else if (influent->log_required_g == 999999.0 && gw_virus_flag == TRUE) //groundwater w/virus dis. req'd.
+            else if (influent->log_required_g == 999999.0 && ctx->gw_virus_flag == TRUE) //groundwater w/virus dis. req'd.
             {
                 e |= fprintf(fout, "    na");
                 e |= fprintf(fout, "%8.1f", eff->ct_ratio_v);
@@ -1414,25 +1427,25 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
 */
 
         /* RUN MODEL AGAIN and Print Inactivation at Min Temp & Max Flow */
-        coldflag = TRUE;
+        ctx->coldflag = TRUE;
         if (runmodel(train) == FALSE)
             return (FALSE);
-        coldflag = FALSE;
+        ctx->coldflag = FALSE;
 
-        if (swflag == TRUE)
+        if (ctx->swflag == TRUE)
             strcpy(buffer, "for Surface Water Plant ");
         else
             strcpy(buffer, "for Groundwater Plant ");
-        if (coagflag)
+        if (ctx->coagflag)
         {
-            if (filtflag)
+            if (ctx->filtflag)
                 strcat(buffer, "with Coagulation and Filtration");
             else
                 strcat(buffer, "with Coagulation");
         }
         else
         {
-            if (filtflag)
+            if (ctx->filtflag)
                 strcat(buffer, "with Filtration");
             else
                 strcat(buffer, ""); /* without coagulation or filtration. */
@@ -1464,13 +1477,13 @@ int single_sim_mode(struct ProcessTrain *train,               /* Process train c
             e |= fprintf(fout, "%7.2f", eff->o3_res);
             e |= fprintf(fout, "%7.2f", eff->clo2_res);
             /* e |= fprintf(fout,"%7.2f", eff->processtime        );    */
-            if (influent->log_required_g == 999999.0 && gw_virus_flag == FALSE) //groundwater w/virus dis. req'd.
+            if (influent->log_required_g == 999999.0 && ctx->gw_virus_flag == FALSE) //groundwater w/virus dis. req'd.
             {
                 e |= fprintf(fout, "    na");
                 e |= fprintf(fout, "     na");
                 e |= fprintf(fout, "    na");
             }
-            else if (influent->log_required_g == 999999.0 && gw_virus_flag == TRUE) //groundwater w/virus dis. req'd.
+            else if (influent->log_required_g == 999999.0 && ctx->gw_virus_flag == TRUE) //groundwater w/virus dis. req'd.
             {
                 e |= fprintf(fout, "    na");
                 e |= fprintf(fout, "%8.1f", eff->ct_ratio_v);
@@ -1596,8 +1609,6 @@ void sim_opt_mode(ProcessTrain *train)
     BORG_Archive result;
     BORG_Problem problem;
 
-    const char *borg_header = "alk_Q1 pH_Q1 DBPsf_Q1 alk_Q2 pH_Q2 DBPsf_Q2 alk_Q3 pH_Q3 DBPsf_Q3 alk_Q4 pH_Q4 DBPsf_Q4 wc_freq_TTHM wc_freq_HAA5 expect_solids expect_lime expect_co2 lraa_const toc_const ct_const \n"; /* Header for Borg results file */
-
     /* Initialize problem formulation variables */
     // int nvars;   // number of decision variables
     // int nobjs;   // number of objectives
@@ -1726,5 +1737,119 @@ void sim_opt_mode(ProcessTrain *train)
     fclose(fres);
 }
 
+/* Re-evaluation mode */
+
+// purpose: read the decision variables of a Pareto archive written by sim_opt_mode(): a header
+// line, then a line per solution starting with its N_VARS decision variables (the objectives and
+// constraints that follow are not read). Blank lines and lines starting with '#' are skipped.
+static int read_archive(const char *filename, std::vector<double> &vars, FILE *ferr)
+{
+    std::ifstream fin(filename);
+    std::string line;
+    const char *text;
+    char *tail;
+    int line_number = 0, i;
+    double value;
+
+    if (!fin)
+    {
+        fprintf(ferr, "Error: could not read file %s\n", filename);
+        return (FALSE);
+    }
+    while (std::getline(fin, line))
+    {
+        line_number++;
+        text = line.c_str() + strspn(line.c_str(), " \t\r");
+        if (*text == '\0' || *text == '#' || (line_number == 1 && strncmp(text, "alk_Q1", 6) == 0))
+            continue;
+        for (i = 0; i < N_VARS; i++)
+        {
+            value = strtod(text, &tail);
+            if (tail == text)
+            {
+                fprintf(ferr, "Error: %s line %d: expected %d decision variables\n", filename, line_number, N_VARS);
+                return (FALSE);
+            }
+            if ((i % N_VAR_TYPES == 0 && (value < MIN_ALK || value > MAX_ALK)) ||
+                (i % N_VAR_TYPES == 1 && (value < MIN_PH || value > MAX_PH)) ||
+                (i % N_VAR_TYPES == 2 && (value < MIN_DBP_SF || value > MAX_DBP_SF)))
+            {
+                fprintf(ferr, "Error: %s line %d: decision variable %d (%g) is out of bounds\n", filename, line_number, i + 1, value);
+                return (FALSE);
+            }
+            vars.push_back(value);
+            text = tail;
+        }
+    }
+    return (TRUE);
+}
+
+// purpose: evaluate solution k of the archive in a worker, see run_worker_pool()
+static void reevaluate_task(long k, double *values, void *arg)
+{
+    double *vars = (double *)arg + k * N_VARS;
+
+    wtp(vars, values, values + N_OBJS);
+}
+
+/**
+ * Re-evaluation mode: evaluates every solution of a Pareto archive written by sim_opt_mode()
+ * with wtp(), over the Monte Carlo scenarios of simopt_params (e.g. a larger scenario store).
+ * @param archive_filename: Pareto archive file.
+ * @param n_workers: number of worker processes, 0 for one per processor.
+ * @param fout: stream for the new archive: the header of sim_opt_mode(), then the decision
+ *              variables, objectives and constraints of each solution, in the order of the
+ *              archive (NA objectives and constraints for a solution that failed).
+ * @return the number of solutions that failed, or -1 on error.
+ * Notes:
+ *  1. The solutions are evaluated on worker processes (see run_worker_pool()), which share
+ *     the scenarios read by wtp_read_scenarios() beforehand.
+ *  2. A solution for which wtp() exits (e.g. auto_dose() cannot meet a setpoint) fails alone.
+ */
+int reevaluate_mode(const char *archive_filename, int n_workers, FILE *fout)
+{
+    std::vector<double> vars, values;
+    std::vector<std::string> status;
+    long n, k;
+    int n_failed, i, e = 0;
+
+    if (read_archive(archive_filename, vars, stderr) == FALSE)
+        return (-1);
+    if ((n = (long)vars.size() / N_VARS) == 0)
+    {
+        fprintf(stderr, "Error: %s has no solutions\n", archive_filename);
+        return (-1);
+    }
+
+    wtp_read_scenarios(); // once, before the workers are forked
+    values.resize(n * (N_OBJS + N_CONSTS));
+    if ((n_failed = run_worker_pool(n, N_OBJS + N_CONSTS, n_workers, reevaluate_task, &vars[0], &values[0], status)) < 0)
+        return (-1);
+
+    e |= fprintf(fout, "%s", borg_header) < 0;
+    for (k = 0; k < n; k++)
+    {
+        for (i = 0; i < N_VARS; i++)
+            e |= fprintf(fout, "%.17g ", vars[k * N_VARS + i]) < 0;
+        for (i = 0; i < N_OBJS + N_CONSTS; i++)
+        {
+            if (status[k] == "ok")
+                e |= fprintf(fout, "%.17g ", values[k * (N_OBJS + N_CONSTS) + i]) < 0;
+            else
+                e |= fprintf(fout, "NA ") < 0;
+        }
+        e |= fprintf(fout, "\n") < 0;
+        if (status[k] != "ok")
+            fprintf(stderr, "Warning: solution %ld of %s %s\n", k + 1, archive_filename, status[k].c_str());
+    }
+    if (e)
+    {
+        fprintf(stderr, "Error: could not write the re-evaluated archive.\n");
+        return (-1);
+    }
+    printf("Re-evaluated %ld solutions over %d scenarios: %d failed\n", n, simopt_params.num_wq_scenarios, n_failed);
+    return (n_failed);
+}
+
 /* Validation mode */
 // void validation_mode(ProcessTrain *train, ValidationParameters params);
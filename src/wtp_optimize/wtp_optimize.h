@@ -13,6 +13,7 @@
 #include <getopt.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 // Function declarations
 // std::string read_json(const char *filename);
@@ -20,7 +21,7 @@
 
 void validate_optarg_runmode(std::string runmode);
 void validate_optarg_int(char *optarg, char opt);
-void validate_optarg_file(char *optarg, char opt);
+void validate_optarg_file(const char *optarg, char opt);
 void display_usage_help();
 void save_cli_args(std::string filepath_cli_args, int argc, char** argv);
 void copy_file(std::string source_path, std::string dest_path);
@@ -100,6 +101,32 @@ struct SingleSimParameters
     const char* influent_filename;
 };
 
+struct BatchParameters
+{ // batch simulation parameters, see batch_sim_mode()
+    const char *manifest_filename;   // file of "influent,operations" pairs or NULL for the cross product of the patterns
+    const char *influent_pattern;    // glob pattern of influent files
+    const char *operations_pattern;  // glob pattern of operations files
+    const char *influent_dir;        // directory of influent files, ending with '/'
+    const char *operations_dir;      // directory of operations files, ending with '/'
+    int n_workers;                   // number of worker processes, 0 for one per processor
+};
+
+struct ServeParameters
+{ // simulation server parameters, see serve_mode()
+    const char *socket_filename;     // Unix domain socket to listen on
+    const char *influent_dir;        // directory of influent files, ending with '/'
+    const char *operations_dir;      // directory of operations files, ending with '/'
+    const char *scenario_filename;   // Monte Carlo scenario store (see open_scenario_store()) or NULL
+    int n_workers;                   // number of worker processes, 0 for one per processor
+};
+
+struct StreamParameters
+{ // streaming dosing parameters, see stream_mode()
+    const char *stream_filename;     // file or FIFO of influent records, or NULL for stdin
+    double setpoints[3];             // default set points by ALKALINITY_SETPT..DBP_SAFETY_FACTOR, NAN if none
+    int timeout_ms;                  // time limit of the doses of a record, in milliseconds
+};
+
 // struct TimeSeriesParameters
 // { // water quality time series parameters
 //     bool ts_flag;
@@ -125,6 +152,45 @@ struct SimOptParameters
 { // simulation-optimization parameters
     int num_func_evals;
     int num_wq_scenarios;
+    const char *network_filename;  // distribution network file (see open_network()) or NULL
+    const char *scenario_filename; // Monte Carlo scenario store (see open_scenario_store()) or NULL for the CSV file
+    struct TraceWriter *trace;     // trace of every scenario x quarter (see open_trace()) or NULL
+    int trace_units;               // TRUE to add the effluent of every unit to the trace, see wtp_trace_columns()
+};
+
+/* Trace files of per-cell results, see trace_store.cpp */
+#define TRACE_MAGIC "WTPTRCE"     // 8 bytes with the terminating 0
+#define TRACE_VERSION 1
+#define TRACE_NAME_LEN 32
+#define TRACE_BLOCK_ROWS 4096     // rows of a row group
+#define TRACE_QUEUE_ROWS 8192     // rows the queue of trace_append() holds, a power of 2
+struct TraceWriter;
+
+/* Monte Carlo influent scenario store, see scenario_store.cpp */
+#define SCENARIO_MAGIC "WTPSCEN"  // 8 bytes with the terminating 0
+#define SCENARIO_VERSION 1
+#define N_SCENARIO_PARAMS 10      // INF_ALKALINITY..INF_UV254
+#define SCENARIO_NAME_LEN 16
+
+struct ScenarioHeader
+{   // start of a scenario store file
+    char magic[8];          // SCENARIO_MAGIC
+    uint32_t version;       // SCENARIO_VERSION
+    uint32_t byte_order;    // 0x01020304 in the byte order of the writer
+    uint32_t n_sims;        // number of Monte Carlo simulations
+    uint32_t n_years;       // N_YEARS
+    uint32_t n_quarters;    // N_QUARTERS_PER_YEAR
+    uint32_t n_params;      // N_SCENARIO_PARAMS
+    char names[N_SCENARIO_PARAMS][SCENARIO_NAME_LEN];  // parameter of each column, in INF_ order
+};
+
+struct ScenarioStore
+{   // memory mapped scenario store
+    const struct ScenarioHeader *header;
+    int n_sims;                                // number of Monte Carlo simulations
+    const double *column[N_SCENARIO_PARAMS];   // values of each INF_ parameter, see scenario_value()
+    void *map;                                 // mapping of the file
+    size_t map_size;
 };
 
 struct OperationalParameters
@@ -148,11 +214,63 @@ struct InfluentParameters
     double uv254;  // ultraviolet absorbance at 254 nm
 };
 
+struct CsvTable
+{   // numeric csv file, see read_csv_table()
+    std::string filename;
+    std::vector<std::string> names;  // column names of the header line
+    std::vector<double> values;      // n_rows x n_cols values, row by row
+    std::vector<long> lines;         // line of the file of each row
+    int n_cols;
+    long n_rows;
+};
+
+// Column names of the input files, see read_csv.cpp
+#define N_MONTECARLO_COLS (3 + N_SCENARIO_PARAMS)  // sim, year, quarter, then the INF_ parameters
+#define N_OPERATIONS_COLS 3                        // ALKALINITY_SETPT, PH_SETPT, DBP_SAFETY_FACTOR
+extern const char *montecarlo_columns[N_MONTECARLO_COLS];
+extern const char *const *influent_columns;       // INF_ order
+extern const char *operations_columns[N_OPERATIONS_COLS];
+
 /* Function declarations */
-// read_montecarlo.cpp
-// void read_montecarlo(double ***samples, int n_samples, int n_timesteps, int n_params, FILE *fin); /* Read in Monte Carlo samples of influent water quality */
-std::vector<double> read_single_sim(std::string filename, bool header);
-std::vector< std::vector<double> > read_montecarlo(std::string filename, bool header, int nsims);
+// read_csv.cpp
+int read_csv_table(const char *filename, struct CsvTable *table, FILE *ferr);  // read header line and rows of numbers
+int csv_columns(const struct CsvTable *table, const char *const *names, int n, int *index, FILE *ferr);  // find columns by name
+int read_single_row(const char *filename, const char *const *names, int n, double *values, FILE *ferr);  // first row of a single quarter file
+int read_single_file(const std::string &filename, const char *const *names, int n,
+                     std::vector<double> &values, std::string &error);  // read_single_row() keeping the error message
+std::vector<double> read_single_sim(std::string filename, const char *const *names, int n);
+std::vector< std::vector<double> > read_montecarlo(std::string filename, int nsims);
+
+// scenario_store.cpp
+int write_scenario_store(const char *csv_filename, const char *store_filename, int nsims, FILE *ferr);  // convert Monte Carlo CSV file to scenario store
+struct ScenarioStore *open_scenario_store(const char *filename, FILE *ferr);  // map scenario store read-only
+void close_scenario_store(struct ScenarioStore *store);
+double scenario_value(const struct ScenarioStore *store, int p, int k, int i, int j);  // parameter p of simulation k, year i, quarter j
+
+// worker_pool.cpp
+typedef void (*PoolTask)(long item, double *values, void *arg);  // evaluates one item of run_worker_pool()
+int run_worker_pool(long n_items, int n_values, int n_workers, PoolTask task, void *arg,
+                    double *values, std::vector<std::string> &status);  // evaluate items on worker processes
+
+// batch_sim.cpp
+#define N_BATCH_COLS 19                          // results of batch_sim()
+extern const char *batch_columns[N_BATCH_COLS];
+int train_influent(struct ProcessTrain *train, double *influent_wq);  // influent of the .wtp file, in INF_ order
+void batch_sim(struct ProcessTrain *train, struct TrainSnapshot *start, const double *influent_wq,
+               const double *operations, double *values);  // single simulation of one pair from the train as read
+int batch_sim_mode(struct ProcessTrain *train, struct BatchParameters *params, FILE *fout);  // single simulation of many influent/operations pairs
+
+// serve.cpp
+int serve_mode(struct ProcessTrain *train, struct ServeParameters *params);  // answer simulation requests on a Unix domain socket
+
+// stream_dose.cpp
+int stream_mode(struct ProcessTrain *train, struct StreamParameters *params, FILE *fout);  // dose a stream of influent records as they arrive
+
+// trace_store.cpp
+struct TraceWriter *open_trace(const char *filename, const std::vector<std::string> &names, FILE *ferr);  // create trace file and start its writer thread
+void trace_append(struct TraceWriter *trace, const double *values);  // queue one row, from any thread
+int close_trace(struct TraceWriter *trace, FILE *ferr);  // write remaining rows and close
+int read_trace_table(const char *filename, struct CsvTable *table, FILE *ferr);  // read trace file into a table
 
 // wtp_optimize.cpp
 // void single_sim_mode(struct ProcessTrain *train, struct SingleSimParameters params);
@@ -170,10 +288,13 @@ int single_sim_mode(struct ProcessTrain *train, /* Process train control structu
 // void multi_sim_autodose(struct ProcessTrain *train, struct MultiSimAutoDose params);
 // void sim_opt_mode(struct ProcessTrain *train, struct SimOptParameters params);
 void sim_opt_mode(struct ProcessTrain *train);
+int reevaluate_mode(const char *archive_filename, int n_workers, FILE *fout);  // evaluate a Pareto archive over other scenarios
 // void validation_mode(struct ProcessTrain *train, struct ValidationParameters params);
 
 // wtp_problem.cpp
 void wtp(double* vars, double* objs, double* consts);  // Water Treatment Plant Model problem definition
+void wtp_read_scenarios();  // read the Monte Carlo data of wtp() once
+std::vector<std::string> wtp_trace_columns(struct ProcessTrain *train, int units);  // columns of the trace rows of wtp()
 void validate_wq_nonnegative (double value, const char* name);  // validate that water quality parameter is non-negative
 void validate_wq_bounds(double value, const char *name, double minimum, double maximum);  // validate that water quality parameter is between some specified bounds
 void validate_vars_bounds(double value, const char *name, double minimum, double maximum);  // validate that the decision variable is between some specified bounds
@@ -4,8 +4,7 @@
 #include <vector>
 #include <iostream>
 
-/* Metadata for Monte Carlo water quality influent data */
-#define HEADER true                              // header in Monte Carlo CSV (comma separated value) file
+/* Columns of the rows of read_montecarlo(), see montecarlo_columns */
 #define SIM_COL 0                                // simulation number column
 #define YEAR_COL 1                               // year column
 #define QUARTER_COL 2                            // quarter column
@@ -20,6 +19,70 @@
 #define TURB_COL 11                              // turbidity column
 #define UV254_COL 12                             // UV254 absorbance column
 
+/* Columns of the trace rows of wtp(), see wtp_trace_columns() */
+static const char *trace_cell_columns[] = {
+    "fe", "sim", "year", "quarter", "alk_setpt", "pH_setpt", "DBPsf",
+    "lime_dose", "co2_dose", "alum_dose", "naocl_dose",
+    "TTHM", "HAA5", "solids", "ct_ratio", "ct_ratio_c", "ct_ratio_v", "ec_exempt", "ec_step1"};
+#define N_TRACE_CELL_COLS (int)(sizeof(trace_cell_columns) / sizeof(trace_cell_columns[0]))
+static const char *trace_unit_columns[] = {"pH", "alk", "toc", "uv254", "cl2", "nh2cl", "TTHM", "HAA5"};
+#define N_TRACE_UNIT_COLS (int)(sizeof(trace_unit_columns) / sizeof(trace_unit_columns[0]))
+
+// purpose: count the unit processes of a process train
+static int count_units(struct ProcessTrain *train)
+{
+    struct UnitProcess *unit;
+    int n = 0;
+
+    for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit))
+    {
+        n++;
+    }
+    return (n);
+}
+
+/* Monte Carlo influent water quality data of wtp(), see wtp_read_scenarios() */
+static const char *montecarlo_filename = "./in/monte_carlo/influent-wq-data.csv";
+static std::vector<std::vector<double>> monte_carlo; // 2D vector holding Monte Carlo data
+static struct ScenarioStore *scenarios = NULL;       // mapped scenario store, used in place of monte_carlo if given
+
+// purpose: read the Monte Carlo influent water quality data of wtp() (simopt_params.num_wq_scenarios
+// simulations of simopt_params.scenario_filename, or of the CSV file if NULL). Only the first call
+// reads; call it before forking workers (see run_worker_pool()) so that they share the data.
+void wtp_read_scenarios()
+{
+    static int done = FALSE;
+    int num_wq_scenarios = simopt_params.num_wq_scenarios;  // number of water quality scenarios
+
+    if (done == TRUE)
+    {
+        return;
+    }
+    done = TRUE;
+    if (simopt_params.scenario_filename != NULL)
+    {
+        if ((scenarios = open_scenario_store(simopt_params.scenario_filename, stderr)) == NULL)
+        {
+            exit(EXIT_FAILURE);
+        }
+        if (scenarios->n_sims < num_wq_scenarios)
+        {
+            fprintf(stderr, "Error: number of Monte Carlo simulations specified (%d) exceeds the %d of scenario store %s\n",
+                    num_wq_scenarios, scenarios->n_sims, simopt_params.scenario_filename);
+            exit(EXIT_FAILURE);
+        }
+    }
+    else
+    {
+        monte_carlo = read_montecarlo(montecarlo_filename, num_wq_scenarios);
+    }
+}
+
+#ifdef WTP_EVALUATOR
+/* Specialized runmodel() generated from the process train, see bin/makefile */
+int WTP_EVALUATOR(struct ProcessTrain *train);
+#endif
+
 void wtp(double *vars, double *objs, double *consts)
 {
 /*
@@ -55,23 +118,42 @@ void wtp(double *vars, double *objs, double *consts)
         exit(EXIT_FAILURE);
     }
 
+#ifdef WTP_EVALUATOR
+    train->evaluator = WTP_EVALUATOR; // run the generated evaluator instead of interpreting the train
+#endif
+    train->ctx.outputs = WTP_OUT_OBJECTIVES; // only TTHM, HAA5, solids, EC flags, and CT ratios are read below
+    if (simopt_params.trace != NULL && simopt_params.trace_units == TRUE)
+    {
+        train->ctx.outputs = WTP_OUT_ALL; // the DBPs of every unit are traced
+    }
+    std::vector<double> trace_row; // one row of the trace, see wtp_trace_columns()
+    if (simopt_params.trace != NULL)
+    {
+        trace_row.resize(N_TRACE_CELL_COLS + (simopt_params.trace_units ? N_TRACE_UNIT_COLS * count_units(train) : 0));
+    }
+
+    // Sampling nodes of the distribution network, if any (see open_network())
+    if (simopt_params.network_filename != NULL && open_network(simopt_params.network_filename, train, stderr) == FALSE)
+    {
+        exit(EXIT_FAILURE);
+    }
+    struct DistNode *node;
+
     // /* Check that the treatment train was read correctly */
     // writewtp(stdout, train, stderr); // write out process train to file
 
     /* Read in Monte Carlo influent water quality data */
-    static std::vector<std::vector<double>> monte_carlo; // 2D vector holding Monte Carlo data
     static int count = 0;                                // keep track of how many times wtp() has been called
-    std::string filename = "./in/monte_carlo/influent-wq-data.csv";
+    std::string filename = montecarlo_filename;
     int num_wq_scenarios = simopt_params.num_wq_scenarios;  // number of water quality scenarios
 
     count++; // increment problem call count
     std::cout << "Starting WTP problem call number " << count << std::endl;
 
     // only read in the data the first time the wtp problem is called
-    if (count == 1)
-    {
-        monte_carlo = read_montecarlo(filename.c_str(), HEADER, num_wq_scenarios);
-    }
+    wtp_read_scenarios();
+    double wq[N_SCENARIO_PARAMS]; // influent water quality of a quarter, in INF_ order
+    int p;
 
     /* Initialize accounting variables*/
     int lime_cntr;            /* Record how many times lime is added to water */
@@ -167,26 +249,16 @@ void wtp(double *vars, double *objs, double *consts)
         sum_lime_dose = 0;
         sum_co2_dose = 0;
 
+        if (train->network != NULL)
+        {
+            dist_network_reset(train->network); // new time series of quarters at each node
+        }
+
         /* Run time series of water qualities (timestep is a quarter of a year) */
         for (i = 0; i < N_YEARS; i++)
         {
             for (j = 0; j < N_QUARTERS_PER_YEAR; j++)
             {
-                int row = j + i * N_QUARTERS_PER_YEAR + k * N_TIMESTEPS;
-
-                /* Verify that data is read in correctly */
-                int expected_sim = k + 1;
-                int expected_year = i + 1;
-                int expected_quarter = j + 1;
-
-                int actual_sim = monte_carlo[row][SIM_COL];
-                int actual_year = monte_carlo[row][YEAR_COL];
-                int actual_quarter = monte_carlo[row][QUARTER_COL];
-
-                validate_sim_year_quarter(expected_sim, actual_sim, "simulation number", SIM_COL, filename.c_str());
-                validate_sim_year_quarter(expected_year, actual_year, "year", YEAR_COL, filename.c_str());
-                validate_sim_year_quarter(expected_quarter, actual_quarter, "quarter", QUARTER_COL, filename.c_str());
-
                 /* Define decision variables */
                 alk_setpt_1 = vars[N_VAR_TYPES * j]; 
                 pH_setpt_1 = vars[N_VAR_TYPES * j + 1];
@@ -197,27 +269,57 @@ void wtp(double *vars, double *objs, double *consts)
                 validate_vars_bounds(pH_setpt_1, "pH setpoint #1 ", MIN_PH, MAX_PH);
                 validate_vars_bounds(DBP_safety_factor, "DBP safety factor", MIN_DBP_SF, MAX_DBP_SF);
 
-                /* Verify that water quality data is within reasonable bounds */
-                double pH = monte_carlo[row][PH_COL];
-                validate_wq_bounds(pH, "pH", 0.0, 14.0); // note: pH can theoretically be below 0 and above 14, but it is highly unlikely for these conditions to arise
-                double temp = monte_carlo[row][TEMP_COL];
-                validate_wq_bounds(temp, "temperature", 0.0, 100.0);
-                double toc = monte_carlo[row][TOC_COL];
-                validate_wq_nonnegative(toc, "total organic carbon");
-                double uv254 = monte_carlo[row][UV254_COL];
-                validate_wq_nonnegative(uv254, "uv254 absorbance");
-                double bromide = monte_carlo[row][BROMIDE_COL];
-                validate_wq_nonnegative(bromide, "bromide");
-                double alkalinity = monte_carlo[row][ALK_COL];
-                validate_wq_nonnegative(alkalinity, "alkalinity");
-                double calcium = monte_carlo[row][CALCIUM_COL];
-                validate_wq_nonnegative(calcium, "calcium");
-                double hardness = monte_carlo[row][HARD_COL];
-                validate_wq_nonnegative(hardness, "total hardness");
-                double nh3 = monte_carlo[row][AMMONIA_COL];
-                validate_wq_nonnegative(nh3, "ammonia");
-                double ntu = monte_carlo[row][TURB_COL];
-                validate_wq_nonnegative(ntu, "turbidity");
+                if (scenarios != NULL)
+                {
+                    /* Sequence and bounds were validated by write_scenario_store() */
+                    for (p = 0; p < N_SCENARIO_PARAMS; p++)
+                    {
+                        wq[p] = scenario_value(scenarios, p, k, i, j);
+                    }
+                }
+                else
+                {
+                    int row = j + i * N_QUARTERS_PER_YEAR + k * N_TIMESTEPS;
+
+                    /* Verify that data is read in correctly */
+                    int expected_sim = k + 1;
+                    int expected_year = i + 1;
+                    int expected_quarter = j + 1;
+
+                    int actual_sim = monte_carlo[row][SIM_COL];
+                    int actual_year = monte_carlo[row][YEAR_COL];
+                    int actual_quarter = monte_carlo[row][QUARTER_COL];
+
+                    validate_sim_year_quarter(expected_sim, actual_sim, "simulation number", SIM_COL, filename.c_str());
+                    validate_sim_year_quarter(expected_year, actual_year, "year", YEAR_COL, filename.c_str());
+                    validate_sim_year_quarter(expected_quarter, actual_quarter, "quarter", QUARTER_COL, filename.c_str());
+
+                    /* Verify that water quality data is within reasonable bounds */
+                    for (p = 0; p < N_SCENARIO_PARAMS; p++)
+                    {
+                        wq[p] = monte_carlo[row][ALK_COL + p]; // columns follow the INF_ order
+                    }
+                    validate_wq_bounds(wq[INF_PH], "pH", 0.0, 14.0); // note: pH can theoretically be below 0 and above 14, but it is highly unlikely for these conditions to arise
+                    validate_wq_bounds(wq[INF_TEMPERATURE], "temperature", 0.0, 100.0);
+                    validate_wq_nonnegative(wq[INF_TOTAL_ORGANIC_CARBON], "total organic carbon");
+                    validate_wq_nonnegative(wq[INF_UV254], "uv254 absorbance");
+                    validate_wq_nonnegative(wq[INF_BROMIDE], "bromide");
+                    validate_wq_nonnegative(wq[INF_ALKALINITY], "alkalinity");
+                    validate_wq_nonnegative(wq[INF_CALCIUM_HARDNESS], "calcium");
+                    validate_wq_nonnegative(wq[INF_TOTAL_HARDNESS], "total hardness");
+                    validate_wq_nonnegative(wq[INF_AMMONIA], "ammonia");
+                    validate_wq_nonnegative(wq[INF_TURBIDITY], "turbidity");
+                }
+                double pH = wq[INF_PH];
+                double temp = wq[INF_TEMPERATURE];
+                double toc = wq[INF_TOTAL_ORGANIC_CARBON];
+                double uv254 = wq[INF_UV254];
+                double bromide = wq[INF_BROMIDE];
+                double alkalinity = wq[INF_ALKALINITY];
+                double calcium = wq[INF_CALCIUM_HARDNESS];
+                double hardness = wq[INF_TOTAL_HARDNESS];
+                double nh3 = wq[INF_AMMONIA];
+                double ntu = wq[INF_TURBIDITY];
 
                 /* Reset chemical doses back to zero for process train */
                 chem_reset(train);
@@ -364,6 +466,28 @@ void wtp(double *vars, double *objs, double *consts)
                     toc_viol_cntr += 1; 
                 }
 
+                // Locational running annual average DBPs constraint at each node of the distribution network
+                if (train->network != NULL)
+                {
+                    dist_network(train);
+                    dist_network_quarter(train->network);
+                    for (int n = 0; n < train->network->n_nodes; n++)
+                    {
+                        node = &train->network->node[n];
+                        if (node->n_quarters >= NODE_QUARTERS)
+                        {
+                            if (node->lraa_TTHM > MCL_TTHM)
+                            {
+                                LRAA_TTHM_exceed_count++;
+                            }
+                            if (node->lraa_HAA5 > MCL_HAA5)
+                            {
+                                LRAA_HAA5_exceed_count++;
+                            }
+                        }
+                    }
+                }
+
                 // Check contact time ratio constraint
                 // printf("ct_ratio: %f\n", eos->ct_ratio);  // debugging
                 // printf("ct_ratio_c: %f\n", eos->ct_ratio_c);  // debugging
@@ -373,6 +497,53 @@ void wtp(double *vars, double *objs, double *consts)
                 {
                     ct_viol_cntr += 1; 
                 }
+
+                // Trace the results of this quarter, see wtp_trace_columns()
+                if (simopt_params.trace != NULL)
+                {
+                    double *row = trace_row.data();
+                    int t = N_QUARTERS_PER_YEAR * i + j;
+                    row[0] = fe_count;
+                    row[1] = k + 1;
+                    row[2] = i + 1;
+                    row[3] = j + 1;
+                    row[4] = alk_setpt_1;
+                    row[5] = pH_setpt_1;
+                    row[6] = DBP_safety_factor;
+                    row[7] = lime_dose[t];
+                    row[8] = co2_dose[t];
+                    row[9] = alum_dose[t];
+                    row[10] = 0.0;
+                    row[11] = eos->TTHM;
+                    row[12] = eos->HAA5;
+                    row[13] = eos->solids;
+                    row[14] = eos->ct_ratio;
+                    row[15] = eos->ct_ratio_c;
+                    row[16] = eos->ct_ratio_v;
+                    row[17] = eos->ec_exempt;
+                    row[18] = eos->ec_meeting_step1;
+                    row += N_TRACE_CELL_COLS;
+                    for (unit = FirstUnitProcess(train); unit; unit = NextUnitProcess(unit))
+                    {
+                        if (unit->type == HYPOCHLORITE)
+                        {
+                            trace_row[10] += unit->data.chemical->naocl;
+                        }
+                        if (simopt_params.trace_units == TRUE)
+                        {
+                            row[0] = unit->eff.pH;
+                            row[1] = unit->eff.Alk * MW_CaCO3 / 2;
+                            row[2] = unit->eff.TOC;
+                            row[3] = unit->eff.UV_out;
+                            row[4] = unit->eff.FreeCl2 * MW_Cl2;
+                            row[5] = unit->eff.NH2Cl * MW_Cl2;
+                            row[6] = unit->eff.TTHM;
+                            row[7] = unit->eff.HAA5;
+                            row += N_TRACE_UNIT_COLS;
+                        }
+                    }
+                    trace_append(simopt_params.trace, trace_row.data());
+                }
             }
         }
 
@@ -610,6 +781,38 @@ void wtp(double *vars, double *objs, double *consts)
 //     return;
 // }
 
+/**
+ * Names the columns of the trace rows that wtp() appends to simopt_params.trace, one row per
+ * Monte Carlo simulation and quarter of each function evaluation.
+ * @param train: process train evaluated by wtp().
+ * @param units: TRUE to add the effluent of every unit of the train.
+ * @return the column names: function evaluation, simulation, year and quarter (1 based), the
+ *         decision variables of the quarter, the chemical doses (mg/L), the end of system TTHM
+ *         and HAA5 (ug/L), solids (mg/L), CT ratios and enhanced coagulation flags; then, with
+ *         units, "u<n>_pH", "u<n>_alk" (mg/L as CaCO3), "u<n>_toc" (mg/L), "u<n>_uv254" (1/cm),
+ *         "u<n>_cl2" and "u<n>_nh2cl" (mg/L as Cl2), "u<n>_TTHM" and "u<n>_HAA5" (ug/L) of the
+ *         n-th unit of the train (1 based).
+ */
+std::vector<std::string> wtp_trace_columns(struct ProcessTrain *train, int units)
+{
+    std::vector<std::string> names(trace_cell_columns, trace_cell_columns + N_TRACE_CELL_COLS);
+    int n, c;
+    char name[TRACE_NAME_LEN];
+
+    if (units == TRUE)
+    {
+        for (n = 1; n <= count_units(train); n++)
+        {
+            for (c = 0; c < N_TRACE_UNIT_COLS; c++)
+            {
+                snprintf(name, sizeof(name), "u%d_%s", n, trace_unit_columns[c]);
+                names.push_back(name);
+            }
+        }
+    }
+    return (names);
+}
+
 // validate that water quality parameter is non-negative
 void validate_wq_nonnegative(double value, const char *name)
 {